@@ -81,6 +81,15 @@ extern const uint8_t CONFIG_HOST_IP[];
 // All v3 Pipsqueaks should have such a sensor installed.
 #define CONFIG_HAS_BOARD_SENSOR true
 
+// Whether the device regulates temperature with its PID loop
+// (true) or with fixed heater and chiller pulses (false).
+#define CONFIG_PID_CONTROL false
+
+// Whether the device only logs temperatures, deep sleeping between
+// samples (true), or regulates temperature (false). Deep sleep
+// requires GPIO16 (D0) to be wired to RST.
+#define CONFIG_MONITOR_MODE false
+
 // The GPIO pin number (or constant that resolves to that pin
 // number) to which OneWire devices (e.g. DS18B20 temperature
 // sensors) are connected.
@@ -1,12 +1,7 @@
 #include "PipsqueakConfig.h"
 #include <EEPROM.h>
 #include <InitializationParameters.h>
-
-// Value in the first byte of the buffer if previously initialized
-#define INITIALIZED_MARKER        0x0F
-
-// Schema version value
-#define SCHEMA_VERSION            3
+#include <ConfigImage.h>
 
 PipsqueakConfig::PipsqueakConfig()
 :
@@ -34,115 +29,74 @@ PipsqueakConfig::PipsqueakConfig()
   memset(_boardSensorAddress, 0, DS18B20_ADDRESS_SIZE);
 }
 
-/*
-| Start     | Size   | Type      | Description
-| --------- | ------ | --------- | ----------------------------------------------------
-| 0         | 1      | uint8     | EEPROM previously written flag (0x0F if previously written, random value unknown if never written)
-| 1         | 1      | uint8     | EEPROM schema version
-| 2         | 1      | uint8     | Config flags - not relevant for Pipsqeakv3
-| 3         | 1      | ---       | reserved
-| 4         | 4      | uint32    | EEPROM write count - number of times that the EEPROM has been updated.
-| 8         | 4      | uint32    | deviceID
-| 12        | 4      | float     | setpoint in celsius
-| 16        | 4      | uint8[4]  | host server's ipv4 address, expressed in octets
-| 20        | 2      | uint16    | host server's port
-| 22        | 32     | char[32]  | wifi ssid, up to 32 characters including null termination
-| 54        | 64     | char[64]  | wifi password, at most 64 characters including null termination
-| 118       | 32     | uint8[32] | secret encryption key specific to this device
-| 150       | 1      | uint8     | signal enable GPIO pin number
-| 151       | 1      | uint8     | 1Wire GPIO pin number for board sensor (not presently used)
-| 152       | 8      | uint8[8]  | 1Wire address of onboard DS18B20 temperature sensor
-| 160       | 1      | uint8     | 1Wire GPIO pin number for remote sensor
-| 161       | 8      | uint8[8]  | 1Wire address of onboard DS18B20 temperature sensor (not presently used)
-| 169       | 1      | uint8     | Red LED indicator signal GPIO pin number
-| 170       | 1      | uint8     | Green LED indicator signal GPIO pin number
-| 171       | 1      | uint8     | Heater pin count (n) - should be exactly 1 for Pipsqueak v3
-| 172       | n      | uint8     | Heater signal GPIO pin numbers
-| 172+n     | 1      | uint8     | Chiller pin count (m) - should be exactly 1 for Pipsqueak v3
-| 172+n+1   | m      | uint8     | Chiller signal GPIO pin numbers
-*/
+// See the ConfigImage library for the layout
 void PipsqueakConfig::readContents() {
+  ConfigImageStatus status = CONFIG_IMAGE_BLANK;
   if (!IGNORE_PREVIOUS_CONFIG) {
-    uint8_t i;
-    size_t cursor = 0;
-    EEPROM.begin(256);
-    EEPROM.get(cursor, _previouslyWrittenFlag);
-    if (previouslyInitialized()) {
-      cursor += 1;
-      EEPROM.get(cursor, _schemaVersion);
-      cursor += 1;
-      EEPROM.get(cursor, _configurationFlags);
-      cursor += 1;
-      // reserved
-      cursor += 1;
-      EEPROM.get(cursor, _writeCount);
-      cursor += 4;
-      EEPROM.get(cursor, _deviceID);
-      cursor += 4;
-      EEPROM.get(cursor, _setpoint);
-      cursor += 4;
-      EEPROM.get(cursor, _hostIP);
-      cursor += 4;
-      EEPROM.get(cursor, _hostPort);
-      cursor += 2;
-      EEPROM.get(cursor, _wifiSSID);
-      cursor += 32;
-      EEPROM.get(cursor, _wifiPassword);
-      cursor += 64;
-      for (i = 0; i < 32; i++) EEPROM.get(cursor + i, _secretKey[i]);
-      cursor += 32;
-      EEPROM.get(cursor, _enablePin);
-      cursor += 1;
-      EEPROM.get(cursor, _oneWirePin); // onboard sensor
-      cursor += 1;
-      for (i = 0; i < DS18B20_ADDRESS_SIZE; i++) EEPROM.get(cursor + i, _boardSensorAddress[i]);
-      cursor += DS18B20_ADDRESS_SIZE;
-      EEPROM.get(cursor, _oneWirePin); // remote sensor
-      cursor += 1;
-      for (i = 0; i < DS18B20_ADDRESS_SIZE; i++) EEPROM.get(cursor + i, _remoteSensorAddress[i]);
-      cursor += DS18B20_ADDRESS_SIZE;
-      EEPROM.get(cursor, _redIndicatorPin);
-      cursor += 1;
-      EEPROM.get(cursor, _greenIndicatorPin);
-      cursor += 1;
-      EEPROM.get(cursor, _heaterPinCount);
-      cursor += 1;
-      _heaterPins = new uint8_t[_heaterPinCount];
-      for (i = 0; i < _heaterPinCount; i++) EEPROM.get(cursor + i, _heaterPins[i]);
-      cursor += _heaterPinCount;
-      EEPROM.get(cursor, _chillerPinCount);
-      cursor += 1;
-      _chillerPins = new uint8_t[_chillerPinCount];
-      for (i = 0; i < _chillerPinCount; i++) EEPROM.get(cursor + i, _chillerPins[i]);
-      cursor += _chillerPinCount;
-      EEPROM.end();
+    ConfigImage image;
+    EEPROM.begin(CONFIG_IMAGE_SIZE);
+    status = ConfigImageFormat::parse(EEPROM.getDataPtr(), &image);
+    _schemaVersion = EEPROM.getDataPtr()[1];
+    EEPROM.end();
+    if (status == CONFIG_IMAGE_VALID || status == CONFIG_IMAGE_MIGRATED) {
+      _previouslyWrittenFlag = image.marker;
+      _configurationFlags = image.flags;
+      _writeCount = image.writeCount;
+      _deviceID = image.deviceID;
+      _setpoint = image.setpoint;
+      memcpy(_hostIP, image.hostIP, 4);
+      _hostPort = image.hostPort;
+      memcpy(_wifiSSID, image.wifiSSID, 32);
+      memcpy(_wifiPassword, image.wifiPassword, 64);
+      memcpy(_secretKey, image.secretKey, 32);
+      _enablePin = image.enablePin;
+      _oneWirePin = image.oneWirePin;
+      memcpy(_boardSensorAddress, image.boardSensorAddress, DS18B20_ADDRESS_SIZE);
+      memcpy(_remoteSensorAddress, image.remoteSensorAddress, DS18B20_ADDRESS_SIZE);
+      _redIndicatorPin = image.redIndicatorPin;
+      _greenIndicatorPin = image.greenIndicatorPin;
+      _heaterPinCount = 1;
+      _heaterPins = new uint8_t[1] { image.heaterPin };
+      _chillerPinCount = 1;
+      _chillerPins = new uint8_t[1] { image.chillerPin };
     }
   }
 
   if (IGNORE_PREVIOUS_CONFIG) {
     Serial.println("PipsqueakConfig.readContents(): aborted due to IGNORE_PREVIOUS_CONFIG option");
+  } else if (status == CONFIG_IMAGE_MIGRATED) {
+    Serial.printf("PipsqueakConfig.readContents(): Previous version %u configuration detected, migrated & loaded\n", _schemaVersion);
   } else if (previouslyInitialized()) {
     Serial.println("PipsqueakConfig.readContents(): Previous configuration detected & loaded");
-  } else {
+  } else if (status == CONFIG_IMAGE_BLANK) {
     Serial.println("PipsqueakConfig.readContents(): Fresh EEPROM state - no previous configuration detected");
+  } else {
+    Serial.printf("PipsqueakConfig.readContents(): Unusable version %u configuration detected - treated as fresh\n", _schemaVersion);
   }
 }
 
 bool PipsqueakConfig::previouslyInitialized() {
-  return _previouslyWrittenFlag == INITIALIZED_MARKER;
+  return _previouslyWrittenFlag == CONFIG_IMAGE_MARKER;
 }
 
 void PipsqueakConfig::applyUpdates() {
-  _schemaVersion = SCHEMA_VERSION;
+  _schemaVersion = CONFIG_IMAGE_VERSION;
   _deviceID = CONFIG_DEVICE_ID;
   memcpy(_secretKey, &CONFIG_SECRET_KEY, 32);
   memcpy(_hostIP, &CONFIG_HOST_IP, 4);
   _hostPort = CONFIG_HOST_PORT;
   memcpy(_wifiSSID, CONFIG_WIFI_SSID, min(31, (int) strlen(CONFIG_WIFI_SSID)));
-  memcpy(_wifiPassword, CONFIG_WIFI_SSID, min(63, (int) strlen(CONFIG_WIFI_SSID)));
+  memcpy(_wifiPassword, CONFIG_WIFI_PASSWORD, min(63, (int) strlen(CONFIG_WIFI_PASSWORD)));
   _setpoint = CONFIG_INITIAL_SETPOINT;
+  _configurationFlags = 0x00;
   if (CONFIG_HAS_BOARD_SENSOR) {
-    _configurationFlags = 0x01;
+    _configurationFlags |= CONFIG_FLAG_BOARD_SENSOR;
+  }
+  if (CONFIG_PID_CONTROL) {
+    _configurationFlags |= CONFIG_FLAG_PID_CONTROL;
+  }
+  if (CONFIG_MONITOR_MODE) {
+    _configurationFlags |= CONFIG_FLAG_MONITOR_MODE;
   }
   _oneWirePin = CONFIG_ONE_WIRE_PIN;
   _enablePin = CONFIG_SIGNAL_ENABLE_PIN;
@@ -218,7 +172,7 @@ bool PipsqueakConfig::updated() {
   PipsqueakConfig * savedConfig = new PipsqueakConfig();
   savedConfig->readContents();
   uint8_t i;
-  if (_previouslyWrittenFlag != INITIALIZED_MARKER) return true;
+  if (_previouslyWrittenFlag != CONFIG_IMAGE_MARKER) return true;
   if (_configurationFlags != savedConfig->_configurationFlags) return true;
   if (_deviceID != savedConfig->_deviceID) return true;
   if (_setpoint != savedConfig->_setpoint) return true;
@@ -325,70 +279,39 @@ bool PipsqueakConfig::commitUpdates() {
   if (DRY_RUN) return false;
   if (previouslyInitialized() && !ALLOW_UPDATE) return false;
 
-  EEPROM.begin(256);
-  size_t cursor;
-  size_t i;
-
-  // First nullify the entire buffer
-  for (cursor = 0; cursor < 256; cursor++) EEPROM.put(cursor, 0x00);
-
-  // Now backfill with new values
-  cursor = 0;
-  EEPROM.put(cursor, INITIALIZED_MARKER);
-  cursor += 1;
-  EEPROM.put(cursor, _schemaVersion);
-  cursor += 1;
-  EEPROM.put(cursor, _configurationFlags);
-  cursor += 1;
-  // reserved
-  cursor += 1;
   if (previouslyInitialized()) {
     _writeCount = _writeCount + 1;
   } else {
     _writeCount = 1;
   }
-  EEPROM.put(cursor, _writeCount);
-  cursor += 4;
-  EEPROM.put(cursor, _deviceID);
-  cursor += 4;
-  EEPROM.put(cursor, _setpoint);
-  cursor += 4;
-  for (i = 0; i < 4; i++) EEPROM.put(cursor + i, _hostIP[i]);
-  cursor += 4;
-  EEPROM.put(cursor, _hostPort);
-  cursor += 2;
-  EEPROM.put(cursor, _wifiSSID);
-  cursor += 31;
-  EEPROM.put(cursor, 0x00);
-  cursor += 1;
-  EEPROM.put(cursor, _wifiPassword);
-  cursor += 63;
-  EEPROM.put(cursor, 0x00);
-  cursor += 1;
-  for (i = 0; i < 32; i++) EEPROM.put(cursor + i, _secretKey[i]);
-  cursor += 32;
-  EEPROM.put(cursor, _enablePin);
-  cursor += 1;
-  EEPROM.put(cursor, _oneWirePin);
-  cursor += 1;
-  for (i = 0; i < DS18B20_ADDRESS_SIZE; i++) EEPROM.put(cursor + i, _boardSensorAddress[i]);
-  cursor += DS18B20_ADDRESS_SIZE;
-  EEPROM.put(cursor, _oneWirePin);
-  cursor += 1;
-  for (i = 0; i < DS18B20_ADDRESS_SIZE; i++) EEPROM.put(cursor + i, _remoteSensorAddress[i]);
-  cursor += DS18B20_ADDRESS_SIZE;
-  EEPROM.put(cursor, _redIndicatorPin);
-  cursor += 1;
-  EEPROM.put(cursor, _greenIndicatorPin);
-  cursor += 1;
-  EEPROM.put(cursor, _heaterPinCount);
-  cursor += 1;
-  for (i = 0; i < _heaterPinCount; i++) EEPROM.put(cursor + i, _heaterPins[i]);
-  cursor += _heaterPinCount;
-  EEPROM.put(cursor, _chillerPinCount);
-  cursor += 1;
-  for (i = 0; i < _chillerPinCount; i++) EEPROM.put(cursor + i, _chillerPins[i]);
-  cursor += _chillerPinCount;
+
+  ConfigImage image;
+  memset(&image, 0, sizeof(image));
+  image.flags = _configurationFlags;
+  image.writeCount = _writeCount;
+  image.deviceID = _deviceID;
+  image.setpoint = _setpoint;
+  memcpy(image.hostIP, _hostIP, 4);
+  image.hostPort = _hostPort;
+  memcpy(image.wifiSSID, _wifiSSID, 31);
+  memcpy(image.wifiPassword, _wifiPassword, 63);
+  memcpy(image.secretKey, _secretKey, 32);
+  image.enablePin = _enablePin;
+  image.oneWirePin = _oneWirePin;
+  image.redIndicatorPin = _redIndicatorPin;
+  image.greenIndicatorPin = _greenIndicatorPin;
+  image.heaterPin = _heaterPins[0];
+  image.chillerPin = _chillerPins[0];
+  memcpy(image.boardSensorAddress, _boardSensorAddress, DS18B20_ADDRESS_SIZE);
+  memcpy(image.remoteSensorAddress, _remoteSensorAddress, DS18B20_ADDRESS_SIZE);
+  // The autotuned parameters are left zeroed, reading as "not tuned"
+  ConfigImageFormat::seal(&image);
+
+  // Only the image is mapped, so the commit erases the fermentation
+  // profile in the rest of the sector
+  EEPROM.begin(CONFIG_IMAGE_SIZE);
+  memset(EEPROM.getDataPtr(), 0, CONFIG_IMAGE_SIZE);
+  memcpy(EEPROM.getDataPtr(), &image, sizeof(image));
   EEPROM.commit();
 
   Serial.printf("PipsqueakConfig.commitUpdates(): completed flash write number %u\n", _writeCount);
@@ -405,10 +328,10 @@ bool PipsqueakConfig::verifyContents() {
   Serial.print("\n");
   Serial.println("-- VERIFICATION -------------------------------------------------------------");
   Serial.print("\n");
-  if (savedConfig->_previouslyWrittenFlag == INITIALIZED_MARKER) {
+  if (savedConfig->_previouslyWrittenFlag == CONFIG_IMAGE_MARKER) {
     Serial.println("[ OK ] Previously Written Flag");
   } else {
-    Serial.printf("[ !! ] Previously Written Flag: 0x%02X (expected 0x%02X)\n", savedConfig->_previouslyWrittenFlag, INITIALIZED_MARKER);
+    Serial.printf("[ !! ] Previously Written Flag: 0x%02X (expected 0x%02X)\n", savedConfig->_previouslyWrittenFlag, CONFIG_IMAGE_MARKER);
     errorCount += 1;
   }
 
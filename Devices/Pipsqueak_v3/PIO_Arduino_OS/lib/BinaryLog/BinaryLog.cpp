@@ -0,0 +1,57 @@
+#include "BinaryLog.h"
+
+#define RING_MASK (BINARY_LOG_RING_WORDS - 1)
+#define DROPPED_MASK 0xFF
+
+uint32_t BinaryLog::_ring[BINARY_LOG_RING_WORDS];
+size_t BinaryLog::_tail = 0;
+size_t BinaryLog::_size = 0;
+uint32_t BinaryLog::_dropCount = 0;
+
+void BinaryLog::append(uint16_t format, const uint32_t * arguments, uint8_t count) {
+  if (count > BINARY_LOG_ARGUMENT_LIMIT) count = BINARY_LOG_ARGUMENT_LIMIT;
+  size_t recordSize = BINARY_LOG_RECORD_OVERHEAD + count;
+  while (BINARY_LOG_RING_WORDS - _size < recordSize) drop();
+
+  size_t head = _tail + _size;
+  _ring[head++ & RING_MASK] = (uint32_t) format << 16 | (uint32_t) count << 8;
+  _ring[head++ & RING_MASK] = millis();
+  for (uint8_t i = 0; i < count; i++) _ring[head++ & RING_MASK] = arguments[i];
+  _size += recordSize;
+}
+
+size_t BinaryLog::read(uint32_t * buffer) {
+  if (_size == 0) return 0;
+  size_t recordSize = BINARY_LOG_RECORD_OVERHEAD + (_ring[_tail] >> 8 & 0xFF);
+  for (size_t i = 0; i < recordSize; i++) buffer[i] = _ring[(_tail + i) & RING_MASK];
+  _tail = (_tail + recordSize) & RING_MASK;
+  _size -= recordSize;
+  return recordSize;
+}
+
+size_t BinaryLog::getSize() {
+  return _size;
+}
+
+uint32_t BinaryLog::getDropCount() {
+  return _dropCount;
+}
+
+void BinaryLog::reset() {
+  _tail = 0;
+  _size = 0;
+  _dropCount = 0;
+}
+
+// Drops the oldest record, counting it, and any dropped before it,
+// against the record after it. A record is far smaller than the
+// ring, so there always is one.
+void BinaryLog::drop() {
+  uint32_t header = _ring[_tail];
+  size_t recordSize = BINARY_LOG_RECORD_OVERHEAD + (header >> 8 & 0xFF);
+  _tail = (_tail + recordSize) & RING_MASK;
+  _size -= recordSize;
+  _dropCount += 1;
+  uint32_t dropped = (header & DROPPED_MASK) + (_ring[_tail] & DROPPED_MASK) + 1;
+  _ring[_tail] = (_ring[_tail] & ~DROPPED_MASK) | (dropped < DROPPED_MASK ? dropped : DROPPED_MASK);
+}
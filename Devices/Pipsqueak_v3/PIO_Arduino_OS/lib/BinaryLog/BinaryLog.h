@@ -0,0 +1,84 @@
+#ifndef BinaryLog_h
+#define BinaryLog_h
+
+#include <Arduino.h>
+#include <LogFormats.h>
+
+// words of RAM records are kept in; a power of two
+#define BINARY_LOG_RING_WORDS 512
+#define BINARY_LOG_ARGUMENT_LIMIT 6
+// the header and the timestamp
+#define BINARY_LOG_RECORD_OVERHEAD 2
+#define BINARY_LOG_RECORD_LIMIT (BINARY_LOG_RECORD_OVERHEAD + BINARY_LOG_ARGUMENT_LIMIT)
+
+/**
+ * Keeps diagnostic records in a fixed ring in RAM, without
+ * formatting them. A record is the ID of its format (see
+ * LogFormats.h), the time and each argument as a raw 32-bit word:
+ * integers as they are, floats as their bits. Formatting is left to
+ * scripts/decode_log.py, on a host, so the format strings never
+ * take up space on the device.
+ *
+ * Writing a record costs a few dozen cycles and no heap, so the
+ * log is always on. When the ring is full, the oldest records are
+ * dropped to make room, and the oldest left says how many went.
+ *
+ * Record layout, in 32-bit words:
+ *
+ * | Word | Content
+ * | ---- | ---------------------------------------------------------------
+ * | 0    | Format ID (bits 16-31), argument count (8-15), records dropped just before this one (0-7, saturating)
+ * | 1    | millis() when written
+ * | 2+   | Arguments
+ *
+ * Not ISR safe.
+ */
+class BinaryLog {
+  public:
+    /**
+     * Appends a record of the given format. Each argument must be
+     * an integer, enum, bool or float, at most
+     * BINARY_LOG_ARGUMENT_LIMIT of them, matching the format's
+     * conversions.
+     */
+    template <typename... Arguments>
+    static void write(uint16_t format, Arguments... arguments) {
+      static_assert(sizeof...(arguments) <= BINARY_LOG_ARGUMENT_LIMIT, "too many log arguments");
+      const uint32_t words[] = { 0, toWord(arguments)... };
+      append(format, &words[1], sizeof...(arguments));
+    }
+
+    /** Appends a record of the given format and argument words. */
+    static void append(uint16_t format, const uint32_t * arguments, uint8_t count);
+
+    /**
+     * Removes the oldest record, copying it into the buffer, which
+     * must hold BINARY_LOG_RECORD_LIMIT words. Returns its size in
+     * words, or 0 if there are none.
+     */
+    static size_t read(uint32_t * buffer);
+
+    /** Returns the number of words held. */
+    static size_t getSize();
+
+    /** Returns the number of records dropped since the last reset. */
+    static uint32_t getDropCount();
+
+    /** Discards every record. */
+    static void reset();
+
+  private:
+    static uint32_t _ring[BINARY_LOG_RING_WORDS];
+    static size_t _tail;
+    static size_t _size;
+    static uint32_t _dropCount;
+
+    template <typename T>
+    static uint32_t toWord(T value) { return (uint32_t) value; }
+    static uint32_t toWord(float value) { uint32_t word; memcpy(&word, &value, 4); return word; }
+    static uint32_t toWord(double value) { return toWord((float) value); }
+
+    static void drop();
+};
+
+#endif // BinaryLog_h
@@ -0,0 +1,76 @@
+#ifndef LogFormats_h
+#define LogFormats_h
+
+/**
+ * The formats of BinaryLog records, by ID: X(name, ID, format).
+ *
+ * Records name their format by ID, so append new formats rather
+ * than renumber, leaving room in each module's block. Formats take
+ * printf's integer and floating point conversions only; strings
+ * can't be logged. scripts/decode_log.py reads the formats from
+ * this file.
+ */
+#define LOG_FORMATS(X) \
+  X(LOG_SCHEDULER_OVERRUN, 1, "Scheduler.run(%u): overrun, started %u ms late") \
+  \
+  X(LOG_STATE_CLOCK_SAMPLE, 10, "PipsqueakState.synchronizeClock(%u): result %u, error bound %u ms") \
+  X(LOG_STATE_SETPOINT, 11, "PipsqueakState.setRemoteTemperatureSetpoint(): setpoint updated from %f to %f") \
+  X(LOG_STATE_PROFILE, 12, "PipsqueakState.setProfile(): profile %u with %u segments") \
+  X(LOG_STATE_PROFILE_SETPOINT, 13, "PipsqueakState.evaluateProfile(): setpoint update event @ %fC") \
+  X(LOG_STATE_ERROR, 14, "PipsqueakState.recordError(%d, %d)") \
+  X(LOG_STATE_TUNING_RESULT, 15, "PipsqueakState.recordTuningResult(): Ku=%f Pu=%us outcome=%u") \
+  X(LOG_STATE_CONTROL_START, 16, "PipsqueakState.recordControlStart(): %u ms after boot") \
+  X(LOG_STATE_MEMORY_LOW_WATER, 17, "PipsqueakState.recordMemoryLowWater(): heap=%u block=%u frag=%u%% stack=%u") \
+  \
+  X(LOG_CLIENT_WIFI_SCANNING, 30, "PipsqueakClient.loop(): previous access point unavailable; scanning") \
+  X(LOG_CLIENT_WIFI_CONNECTED, 31, "PipsqueakClient.loop(): WiFi connected") \
+  X(LOG_CLIENT_WIFI_LOST, 32, "PipsqueakClient.loop(): WiFi connection lost; reconnecting") \
+  X(LOG_CLIENT_RESPONSE_READY, 33, "PipsqueakClient.loop(): protocol %u response complete/ready") \
+  X(LOG_CLIENT_DISCONNECTED, 34, "PipsqueakClient.loop(): client connection terminated normally") \
+  X(LOG_CLIENT_TIMEOUT, 35, "PipsqueakClient.loop(): timeout") \
+  X(LOG_CLIENT_TRANSMISSION_ERROR, 36, "PipsqueakClient.loop(): transmission error: %d") \
+  X(LOG_CLIENT_BROKEN_PIPE, 37, "PipsqueakClient.loop(): disconnected while transmitting") \
+  X(LOG_CLIENT_CONNECTION_LOST, 38, "PipsqueakClient.loop(): disconnected after connecting but before transmitting") \
+  X(LOG_CLIENT_CONNECTION_FAILED, 39, "PipsqueakClient.loop(): disconnected while connecting") \
+  X(LOG_CLIENT_REQUEST_FAILED, 40, "PipsqueakClient.loop(): protocol %u failed with %u errors") \
+  X(LOG_CLIENT_REQUEST_SUCCEEDED, 41, "PipsqueakClient.loop(): protocol %u succeeded in %u seconds") \
+  X(LOG_CLIENT_CONNECTED, 42, "PipsqueakClient.loop(): client connection established") \
+  X(LOG_CLIENT_EVENTS_ADDED, 43, "PipsqueakClient.loop(): added %u status events to TelemetryRequest") \
+  X(LOG_CLIENT_TELEMETRY_ENQUEUED, 44, "PipsqueakClient.loop(): auto-enqueuing a TelemetryRequest for transmission") \
+  X(LOG_CLIENT_TIME_STAGED, 45, "PipsqueakClient.loop(): auto-staging a TimeRequest for transmission") \
+  X(LOG_CLIENT_REQUEST_STAGED, 46, "PipsqueakClient.loop(): staging a protocol %u request for transmission") \
+  X(LOG_CLIENT_CONNECT, 47, "PipsqueakClient.loop(): connect()") \
+  X(LOG_CLIENT_ENQUEUE_REJECTED, 48, "PipsqueakClient.enqueue(%u): rejected (already enqueued)") \
+  X(LOG_CLIENT_ENQUEUE_ACCEPTED, 49, "PipsqueakClient.enqueue(%u): accepted") \
+  X(LOG_CLIENT_WIFI_UNAVAILABLE, 50, "PipsqueakClient.connect(): WiFi is not connected") \
+  X(LOG_CLIENT_CONNECTING, 51, "PipsqueakClient.connect(): Initiating client connection attempt to %u.%u.%u.%u:%u") \
+  X(LOG_CLIENT_REQUEST_UNREADY, 52, "PipsqueakClient.transmit(): protocol %u request not populated or otherwise unready to transmit") \
+  X(LOG_CLIENT_CANNOT_SEND, 53, "PipsqueakClient.transmit(): async client cannot send") \
+  X(LOG_CLIENT_BUFFER_FULL, 54, "PipsqueakClient.transmit(): async client does not have space for the entire message") \
+  X(LOG_CLIENT_TRANSMITTED, 55, "PipsqueakClient.transmit(): Wrote %u bytes to the async client") \
+  X(LOG_CLIENT_SESSION_ENDED, 56, "PipsqueakClient.endSession()") \
+  X(LOG_CLIENT_CLOCK_RESTART, 57, "PipsqueakClient.synchronizeClock(): out of sync; starting over from this response") \
+  X(LOG_CLIENT_CLOCK_SAMPLE, 58, "PipsqueakClient.synchronizeClock(): %u after a %u ms round trip") \
+  X(LOG_CLIENT_PROFILE_REJECTED, 59, "PipsqueakClient.applyProfile(): rejected profile %u") \
+  X(LOG_CLIENT_CRASH_DUMP_UNREADABLE, 60, "PipsqueakClient.prepareCrashDumpRequest(): unable to read dump %u at %u") \
+  X(LOG_CLIENT_CRASH_DUMP_UPLOADED, 61, "PipsqueakClient.applyCrashDumpChunk(): dump %u uploaded") \
+  \
+  X(LOG_SENSORS_RESTORED, 70, "PipsqueakSensors.restoreSensors(): board %u, remote %u, ambient %u restored") \
+  X(LOG_SENSORS_ATTACHED, 71, "PipsqueakSensors.attachPresentSensors(): sensor %u attached (0 board, 1 remote, 2 ambient)") \
+  X(LOG_SENSORS_DETACHED, 72, "PipsqueakSensors.detachAbsentSensors(): sensor %u detached (0 board, 1 remote, 2 ambient)") \
+  \
+  X(LOG_CONTROLLER_PHASE_RESTORED, 80, "PipsqueakController.restorePhase(): %u ms recovery, %u ms to the next period, integral %f") \
+  X(LOG_CONTROLLER_PERIOD, 81, "PipsqueakController.controlPeriod(): %f C filtered, %f C ambient, output %f, integral %f, feed-forward %f") \
+  X(LOG_CONTROLLER_AUTOTUNE_STARTED, 82, "PipsqueakController.autotunePeriod(): starting autotune") \
+  X(LOG_CONTROLLER_AUTOTUNE_COMPLETE, 83, "PipsqueakController.autotuneComplete(): outcome %u, Ku %f, Pu %u ms") \
+  X(LOG_CONTROLLER_HEATER_PULSE, 84, "PipsqueakController.heaterPulse(): %u ms @ %u%%") \
+  X(LOG_CONTROLLER_CHILLER_PULSE, 85, "PipsqueakController.chillerPulse(): %u ms") \
+  X(LOG_CONTROLLER_STOPPED, 86, "PipsqueakController.stopRunning()")
+
+#define LOG_FORMAT_ID(name, id, format) name = id,
+enum LogFormat {
+  LOG_FORMATS(LOG_FORMAT_ID)
+};
+#undef LOG_FORMAT_ID
+
+#endif // LogFormats_h
@@ -0,0 +1,192 @@
+#include "ClockDiscipline.h"
+#include <math.h>
+
+ClockDiscipline::ClockDiscipline()
+:
+  _sampleCount { 0 },
+  _newest { 0 },
+  _driftLow { -CLOCK_MAX_DRIFT },
+  _driftHigh { CLOCK_MAX_DRIFT },
+  _baseLocalMillis { 0 },
+  _baseTime { 0 },
+  _rate { 0 },
+  _slewRate { 0 },
+  _slewMillis { 0 }
+{
+  memset(_samples, 0, sizeof(_samples));
+}
+
+void ClockDiscipline::reset() {
+  _sampleCount = 0;
+  _driftLow = -CLOCK_MAX_DRIFT;
+  _driftHigh = CLOCK_MAX_DRIFT;
+  _rate = 0;
+  _slewRate = 0;
+  _slewMillis = 0;
+}
+
+ClockSampleResult ClockDiscipline::addSample(uint32_t serverTime, uint32_t sentMillis, uint32_t receivedMillis) {
+  uint32_t roundTrip = receivedMillis - sentMillis;
+  if (roundTrip > CLOCK_MAX_ROUND_TRIP) return CLOCK_SAMPLE_REJECTED;
+
+  // The server stamped its response with the whole second at some
+  // moment during the round trip
+  uint32_t halfRoundTrip = (roundTrip + 1) / 2;
+  uint32_t midpoint = sentMillis + roundTrip / 2;
+  Sample sample = {
+    midpoint,
+    midpoint,
+    (int64_t) serverTime * 1000 - halfRoundTrip,
+    (int64_t) serverTime * 1000 + 999 + halfRoundTrip
+  };
+
+  int64_t earliest;
+  int64_t latest;
+  bool consistent = _sampleCount > 0 && sample.localMillis - getSample(0)->localMillis < CLOCK_SAMPLE_LIFETIME;
+  if (consistent) {
+    consistent = getBounds(sample.localMillis, &earliest, &latest) &&
+      sample.earliest <= latest && earliest <= sample.latest;
+  }
+  if (!consistent) {
+    // The first sample, or the server's clock has jumped
+    reset();
+  }
+
+  if (_sampleCount > 0 && sample.localMillis - getSample(0)->openedMillis < CLOCK_SAMPLE_SPACING) {
+    project(getSample(0), sample.localMillis, &earliest, &latest);
+    sample.openedMillis = getSample(0)->openedMillis;
+    if (earliest > sample.earliest) sample.earliest = earliest;
+    if (latest < sample.latest) sample.latest = latest;
+    *getSample(0) = sample;
+  } else {
+    _newest = (_newest + 1) % CLOCK_SAMPLE_COUNT;
+    _samples[_newest] = sample;
+    if (_sampleCount < CLOCK_SAMPLE_COUNT) _sampleCount += 1;
+  }
+  while (_sampleCount > 1 && sample.localMillis - getSample(_sampleCount - 1)->localMillis >= CLOCK_SAMPLE_LIFETIME) {
+    _sampleCount -= 1;
+  }
+  if (!updateDrift()) {
+    // No one drift rate fits every sample; keep only the newest
+    _sampleCount = 1;
+    updateDrift();
+  }
+
+  getBounds(receivedMillis, &earliest, &latest);
+  int64_t estimate = earliest + (latest - earliest) / 2;
+  rebase(receivedMillis);
+  _rate = getDrift();
+  int64_t error = estimate - _baseTime;
+  if (!consistent || error > CLOCK_STEP_THRESHOLD || error < -CLOCK_STEP_THRESHOLD) {
+    _baseTime = estimate;
+    _slewMillis = 0;
+    return CLOCK_SAMPLE_STEPPED;
+  }
+  _slewRate = error < 0 ? -CLOCK_SLEW_RATE : CLOCK_SLEW_RATE;
+  _slewMillis = (uint32_t) ((error < 0 ? -error : error) / CLOCK_SLEW_RATE);
+  return CLOCK_SAMPLE_SLEWED;
+}
+
+bool ClockDiscipline::isSynchronized() {
+  return _sampleCount > 0;
+}
+
+int64_t ClockDiscipline::getTimeMillis(uint32_t localMillis) {
+  if (localMillis - _baseLocalMillis >= CLOCK_REBASE_INTERVAL) rebase(localMillis);
+  return getTimeAfter(localMillis - _baseLocalMillis);
+}
+
+uint32_t ClockDiscipline::getUnixTime(uint32_t localMillis) {
+  return (uint32_t) (getTimeMillis(localMillis) / 1000);
+}
+
+uint16_t ClockDiscipline::getMillisIntoSecond(uint32_t localMillis) {
+  return (uint16_t) (getTimeMillis(localMillis) % 1000);
+}
+
+uint32_t ClockDiscipline::getErrorBound(uint32_t localMillis) {
+  if (_sampleCount == 0) return UINT32_MAX;
+  int64_t earliest;
+  int64_t latest;
+  getBounds(localMillis, &earliest, &latest);
+  int64_t time = getTimeMillis(localMillis);
+  int64_t bound = time - earliest > latest - time ? time - earliest : latest - time;
+  return bound < 0 ? 0 : bound > UINT32_MAX ? UINT32_MAX : (uint32_t) bound;
+}
+
+bool ClockDiscipline::isSyncDue(uint32_t localMillis) {
+  if (_sampleCount == 0) return true;
+  if (localMillis - getSample(0)->localMillis >= CLOCK_SAMPLE_LIFETIME) return true;
+  return getErrorBound(localMillis) > CLOCK_ERROR_LIMIT;
+}
+
+float ClockDiscipline::getDrift() {
+  return (_driftLow + _driftHigh) / 2;
+}
+
+float ClockDiscipline::getDriftUncertainty() {
+  return (_driftHigh - _driftLow) / 2;
+}
+
+size_t ClockDiscipline::getSampleCount() {
+  return _sampleCount;
+}
+
+ClockDiscipline::Sample * ClockDiscipline::getSample(size_t age) {
+  return &_samples[(_newest + CLOCK_SAMPLE_COUNT - age) % CLOCK_SAMPLE_COUNT];
+}
+
+void ClockDiscipline::project(Sample * sample, uint32_t localMillis, int64_t * earliest, int64_t * latest) {
+  int32_t elapsed = (int32_t) (localMillis - sample->localMillis);
+  float slowest = elapsed >= 0 ? _driftLow : _driftHigh;
+  float fastest = elapsed >= 0 ? _driftHigh : _driftLow;
+  *earliest = sample->earliest + elapsed + (int64_t) floorf(elapsed * slowest);
+  *latest = sample->latest + elapsed + (int64_t) ceilf(elapsed * fastest);
+}
+
+bool ClockDiscipline::getBounds(uint32_t localMillis, int64_t * earliest, int64_t * latest) {
+  project(getSample(0), localMillis, earliest, latest);
+  int64_t intersectionEarliest = *earliest;
+  int64_t intersectionLatest = *latest;
+  for (size_t age = 1; age < _sampleCount; age++) {
+    int64_t sampleEarliest;
+    int64_t sampleLatest;
+    project(getSample(age), localMillis, &sampleEarliest, &sampleLatest);
+    if (sampleEarliest > intersectionEarliest) intersectionEarliest = sampleEarliest;
+    if (sampleLatest < intersectionLatest) intersectionLatest = sampleLatest;
+  }
+  // Should the intersection be empty, the newest sample alone will do
+  if (intersectionEarliest > intersectionLatest) return false;
+  *earliest = intersectionEarliest;
+  *latest = intersectionLatest;
+  return true;
+}
+
+bool ClockDiscipline::updateDrift() {
+  _driftLow = -CLOCK_MAX_DRIFT;
+  _driftHigh = CLOCK_MAX_DRIFT;
+  for (size_t older = 1; older < _sampleCount; older++) {
+    for (size_t newer = 0; newer < older; newer++) {
+      Sample * a = getSample(older);
+      Sample * b = getSample(newer);
+      int64_t elapsed = (uint32_t) (b->localMillis - a->localMillis);
+      float low = (float) (b->earliest - a->latest - elapsed) / elapsed;
+      float high = (float) (b->latest - a->earliest - elapsed) / elapsed;
+      if (low > _driftLow) _driftLow = low;
+      if (high < _driftHigh) _driftHigh = high;
+    }
+  }
+  return _driftLow <= _driftHigh;
+}
+
+int64_t ClockDiscipline::getTimeAfter(uint32_t elapsedMillis) {
+  uint32_t slewed = elapsedMillis < _slewMillis ? elapsedMillis : _slewMillis;
+  return _baseTime + elapsedMillis + (int64_t) floorf(elapsedMillis * _rate) + (int64_t) floorf(slewed * _slewRate);
+}
+
+void ClockDiscipline::rebase(uint32_t localMillis) {
+  uint32_t elapsed = localMillis - _baseLocalMillis;
+  _baseTime = getTimeAfter(elapsed);
+  _slewMillis -= elapsed < _slewMillis ? elapsed : _slewMillis;
+  _baseLocalMillis = localMillis;
+}
@@ -0,0 +1,152 @@
+#ifndef ClockDiscipline_h
+#define ClockDiscipline_h
+
+#include <Arduino.h>
+
+// Bound on the crystal's drift, well beyond its specified tolerance
+#define CLOCK_MAX_DRIFT 0.0002 // 200 ppm
+// Responses slower than this say too little about the server's time
+#define CLOCK_MAX_ROUND_TRIP 2000 // ms
+#define CLOCK_SAMPLE_COUNT 8
+// Samples closer together than this are merged into one
+#define CLOCK_SAMPLE_SPACING 1800000 // ms
+// Samples older than this are discarded rather than projected
+#define CLOCK_SAMPLE_LIFETIME 604800000 // ms
+// Errors larger than this are stepped rather than slewed
+#define CLOCK_STEP_THRESHOLD 2000 // ms
+// As NTP, the rate at which smaller errors are slewed away
+#define CLOCK_SLEW_RATE 0.0005 // 500 ppm
+// A sync is due once the clock may be this far from the server's
+#define CLOCK_ERROR_LIMIT 1000 // ms
+#define CLOCK_REBASE_INTERVAL 86400000 // ms
+
+enum ClockSampleResult {
+  CLOCK_SAMPLE_REJECTED,
+  CLOCK_SAMPLE_STEPPED,
+  CLOCK_SAMPLE_SLEWED
+};
+
+/**
+ * Disciplines a clock running on millis() to the server's clock,
+ * estimating both the offset between the two and the drift of the
+ * local crystal.
+ *
+ * The server only reports whole seconds, so each response bounds
+ * the server's time at the midpoint of its round trip to an
+ * interval a second and a round trip wide. The intervals of the
+ * most recent CLOCK_SAMPLE_COUNT samples, projected forward with
+ * the drift bounds they imply, are intersected; the clock follows
+ * the middle of the intersection, slewing toward it at no more
+ * than CLOCK_SLEW_RATE. As the bounds on the drift tighten, the
+ * intersection widens ever more slowly, and syncs fall due less
+ * and less often.
+ *
+ * Pure arithmetic: no I/O and no clock. The caller supplies the
+ * millis() readings.
+ */
+class ClockDiscipline {
+  public:
+    ClockDiscipline();
+
+    /**
+     * Discards all samples, e.g. when the server reports that the
+     * clocks are out of sync.
+     */
+    void reset();
+
+    /**
+     * Adds a sample from a successful request-response cycle.
+     *
+     * serverTime: the Unix timestamp in the response
+     * sentMillis: millis() when the request was transmitted
+     * receivedMillis: millis() when the response began to arrive
+     *
+     * Returns CLOCK_SAMPLE_STEPPED if the clock jumped to the new
+     * estimate, which it does for the first sample and for samples
+     * inconsistent with those before them, CLOCK_SAMPLE_SLEWED if
+     * the clock will slew toward it, or CLOCK_SAMPLE_REJECTED if
+     * the round trip took too long for the sample to be of use.
+     */
+    ClockSampleResult addSample(uint32_t serverTime, uint32_t sentMillis, uint32_t receivedMillis);
+
+    /**
+     * Indicates whether any samples have been accepted since
+     * construction or the last reset().
+     */
+    bool isSynchronized();
+
+    /**
+     * Returns the disciplined time in ms since the Unix epoch at
+     * the given millis() reading, which must not precede the
+     * receivedMillis of the most recent sample.
+     */
+    int64_t getTimeMillis(uint32_t localMillis);
+
+    /**
+     * Returns the disciplined Unix time at the given millis()
+     * reading.
+     */
+    uint32_t getUnixTime(uint32_t localMillis);
+
+    /**
+     * Returns how many ms of the current disciplined second have
+     * elapsed at the given millis() reading.
+     */
+    uint16_t getMillisIntoSecond(uint32_t localMillis);
+
+    /**
+     * Returns the largest error the disciplined time may have at
+     * the given millis() reading, in ms.
+     */
+    uint32_t getErrorBound(uint32_t localMillis);
+
+    /**
+     * Indicates that another sample is needed to keep the error
+     * within CLOCK_ERROR_LIMIT.
+     */
+    bool isSyncDue(uint32_t localMillis);
+
+    /**
+     * Returns the estimated drift of the local crystal as a
+     * fraction, positive when millis() runs slow.
+     */
+    float getDrift();
+
+    /**
+     * Returns the half-width of the bounds on the drift.
+     */
+    float getDriftUncertainty();
+
+    /**
+     * Returns the number of samples held.
+     */
+    size_t getSampleCount();
+
+  private:
+    struct Sample {
+      uint32_t openedMillis; // when the first sample merged into this one arrived
+      uint32_t localMillis;
+      int64_t earliest; // bounds on the server's time then,
+      int64_t latest;   // in ms since the Unix epoch
+    };
+
+    Sample _samples[CLOCK_SAMPLE_COUNT];
+    size_t _sampleCount;
+    size_t _newest;
+    float _driftLow;
+    float _driftHigh;
+    uint32_t _baseLocalMillis;
+    int64_t _baseTime;
+    float _rate;
+    float _slewRate;
+    uint32_t _slewMillis;
+
+    Sample * getSample(size_t age);
+    void project(Sample * sample, uint32_t localMillis, int64_t * earliest, int64_t * latest);
+    bool getBounds(uint32_t localMillis, int64_t * earliest, int64_t * latest);
+    bool updateDrift();
+    int64_t getTimeAfter(uint32_t elapsedMillis);
+    void rebase(uint32_t localMillis);
+};
+
+#endif // ClockDiscipline_h
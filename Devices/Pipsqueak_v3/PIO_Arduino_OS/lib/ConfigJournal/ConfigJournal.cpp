@@ -0,0 +1,208 @@
+#include "ConfigJournal.h"
+#include <ConfigImage.h>
+#include <Metrics.h>
+
+// "PSQJ", little endian
+#define SECTOR_MAGIC 0x4A515350
+
+#define ERASED_WORD 0xFFFFFFFF
+
+#define RECORD_BUFFER_WORDS ((CONFIG_JOURNAL_RECORD_HEADER_SIZE + CONFIG_JOURNAL_VALUE_LIMIT) / 4)
+
+// Compaction copies the latest value of every key into one sector
+static_assert(CONFIG_JOURNAL_SECTOR_HEADER_SIZE + CONFIG_JOURNAL_KEY_LIMIT * (CONFIG_JOURNAL_RECORD_HEADER_SIZE + CONFIG_JOURNAL_VALUE_LIMIT) <= CONFIG_JOURNAL_SECTOR_SIZE, "a full set of values must fit in a sector");
+static_assert(CONFIG_JOURNAL_VALUE_LIMIT % 4 == 0 && CONFIG_JOURNAL_VALUE_LIMIT <= UINT8_MAX, "values are sized by a byte, in words");
+
+ConfigJournal::ConfigJournal(JournalFlash * flash)
+:
+  _flash { flash },
+  _ready { false },
+  _sector { 0 },
+  _sequence { 0 },
+  _base { 0 },
+  _cursor { CONFIG_JOURNAL_SECTOR_SIZE },
+  _appendCount { 0 }
+{
+  memset(_index, 0, sizeof(_index));
+}
+
+bool ConfigJournal::begin(uint32_t base) {
+  _ready = false;
+  _base = base;
+  _appendCount = 0;
+  memset(_index, 0, sizeof(_index));
+  size_t sectorCount = _flash->getSectorCount();
+  if (sectorCount < 2) return false;
+
+  bool found = false;
+  size_t newestSector = 0;
+  uint32_t newestSequence = 0;
+  uint32_t newestBase = 0;
+  for (size_t sector = 0; sector < sectorCount; sector++) {
+    uint32_t sequence;
+    uint32_t sectorBase;
+    if (!readSectorHeader(sector, &sequence, &sectorBase)) continue;
+    if (found && sequence <= newestSequence) continue;
+    found = true;
+    newestSector = sector;
+    newestSequence = sequence;
+    newestBase = sectorBase;
+  }
+
+  if (found && newestBase == base) {
+    _sector = newestSector;
+    _sequence = newestSequence;
+    scan();
+  } else {
+    // Start afresh, leaving the stale journal to be erased in turn
+    _sector = found ? (newestSector + 1) % sectorCount : 0;
+    _sequence = newestSequence + 1;
+    Metrics::increment(METRIC_FLASH_ERASES);
+    if (!_flash->erase(_sector)) return false;
+    if (!writeSectorHeader(_sector, _sequence)) return false;
+    _cursor = CONFIG_JOURNAL_SECTOR_HEADER_SIZE;
+  }
+  _ready = true;
+  return true;
+}
+
+bool ConfigJournal::isReady() {
+  return _ready;
+}
+
+bool ConfigJournal::read(uint8_t key, void * data, size_t size) {
+  if (!_ready || key >= CONFIG_JOURNAL_KEY_LIMIT) return false;
+  if (_index[key].offset == 0 || _index[key].size != size) return false;
+  uint32_t buffer[CONFIG_JOURNAL_VALUE_LIMIT / 4];
+  if (!readValue(key, buffer)) return false;
+  memcpy(data, buffer, size);
+  return true;
+}
+
+bool ConfigJournal::write(uint8_t key, const void * data, size_t size) {
+  if (!_ready || key >= CONFIG_JOURNAL_KEY_LIMIT) return false;
+  if (size == 0 || size > CONFIG_JOURNAL_VALUE_LIMIT) return false;
+
+  if (_index[key].offset != 0 && _index[key].size == size) {
+    uint32_t buffer[CONFIG_JOURNAL_VALUE_LIMIT / 4];
+    if (readValue(key, buffer) && memcmp(buffer, data, size) == 0) return true;
+  }
+
+  size_t recordSize = getRecordSize(size);
+  if (_cursor + recordSize > CONFIG_JOURNAL_SECTOR_SIZE) return compact(key, data, size);
+  if (!append(_sector, _cursor, key, data, size)) {
+    // Whatever reached the flash can't be appended to; move on next time
+    _cursor = CONFIG_JOURNAL_SECTOR_SIZE;
+    return false;
+  }
+  _index[key] = { (uint16_t) _cursor, (uint8_t) size };
+  _cursor += recordSize;
+  _appendCount += 1;
+  return true;
+}
+
+uint32_t ConfigJournal::getAppendCount() {
+  return _appendCount;
+}
+
+uint32_t ConfigJournal::getEraseCount() {
+  return _sequence;
+}
+
+size_t ConfigJournal::getFreeSpace() {
+  if (!_ready) return 0;
+  return CONFIG_JOURNAL_SECTOR_SIZE - _cursor;
+}
+
+bool ConfigJournal::readSectorHeader(size_t sector, uint32_t * sequence, uint32_t * base) {
+  uint32_t header[CONFIG_JOURNAL_SECTOR_HEADER_SIZE / 4];
+  if (!_flash->read(sector, 0, header, sizeof(header))) return false;
+  if (header[0] != SECTOR_MAGIC) return false;
+  if (header[3] != ConfigImageFormat::crc32(header, 12)) return false;
+  *sequence = header[1];
+  *base = header[2];
+  return true;
+}
+
+bool ConfigJournal::writeSectorHeader(size_t sector, uint32_t sequence) {
+  uint32_t header[CONFIG_JOURNAL_SECTOR_HEADER_SIZE / 4] = { SECTOR_MAGIC, sequence, _base, 0 };
+  header[3] = ConfigImageFormat::crc32(header, 12);
+  return _flash->write(sector, 0, header, sizeof(header));
+}
+
+void ConfigJournal::scan() {
+  uint32_t buffer[RECORD_BUFFER_WORDS];
+  _cursor = CONFIG_JOURNAL_SECTOR_HEADER_SIZE;
+  while (_cursor + CONFIG_JOURNAL_RECORD_HEADER_SIZE <= CONFIG_JOURNAL_SECTOR_SIZE) {
+    if (!_flash->read(_sector, _cursor, buffer, CONFIG_JOURNAL_RECORD_HEADER_SIZE)) break;
+    if (buffer[0] == ERASED_WORD) return;
+
+    uint8_t * header = (uint8_t *) buffer;
+    uint8_t key = header[0];
+    uint8_t size = header[1];
+    size_t recordSize = getRecordSize(size);
+    if (key >= CONFIG_JOURNAL_KEY_LIMIT || size == 0 || size > CONFIG_JOURNAL_VALUE_LIMIT) break;
+    if (_cursor + recordSize > CONFIG_JOURNAL_SECTOR_SIZE) break;
+    if (!_flash->read(_sector, _cursor + CONFIG_JOURNAL_RECORD_HEADER_SIZE, &buffer[2], recordSize - CONFIG_JOURNAL_RECORD_HEADER_SIZE)) break;
+    if (buffer[1] != ConfigImageFormat::crc32(&buffer[2], size, ConfigImageFormat::crc32(header, 4))) break;
+
+    _index[key] = { (uint16_t) _cursor, size };
+    _cursor += recordSize;
+  }
+  // A torn record: nothing more may be appended to this sector
+  _cursor = CONFIG_JOURNAL_SECTOR_SIZE;
+}
+
+bool ConfigJournal::append(size_t sector, uint32_t offset, uint8_t key, const void * data, size_t size) {
+  uint32_t buffer[RECORD_BUFFER_WORDS];
+  size_t recordSize = getRecordSize(size);
+  uint8_t * header = (uint8_t *) buffer;
+  header[0] = key;
+  header[1] = (uint8_t) size;
+  header[2] = 0;
+  header[3] = 0;
+  // Padding is left erased
+  memset(&buffer[2], 0xFF, recordSize - CONFIG_JOURNAL_RECORD_HEADER_SIZE);
+  memcpy(&buffer[2], data, size);
+  buffer[1] = ConfigImageFormat::crc32(data, size, ConfigImageFormat::crc32(header, 4));
+  return _flash->write(sector, offset, buffer, recordSize);
+}
+
+bool ConfigJournal::readValue(uint8_t key, uint32_t * buffer) {
+  Entry entry = _index[key];
+  return _flash->read(_sector, entry.offset + CONFIG_JOURNAL_RECORD_HEADER_SIZE, buffer, getRecordSize(entry.size) - CONFIG_JOURNAL_RECORD_HEADER_SIZE);
+}
+
+bool ConfigJournal::compact(uint8_t key, const void * data, size_t size) {
+  size_t next = (_sector + 1) % _flash->getSectorCount();
+  Metrics::increment(METRIC_FLASH_ERASES);
+  if (!_flash->erase(next)) return false;
+
+  // The active sector stays in charge until the next one has its header
+  Entry index[CONFIG_JOURNAL_KEY_LIMIT];
+  memset(index, 0, sizeof(index));
+  uint32_t cursor = CONFIG_JOURNAL_SECTOR_HEADER_SIZE;
+  uint32_t buffer[CONFIG_JOURNAL_VALUE_LIMIT / 4];
+  for (uint8_t k = 0; k < CONFIG_JOURNAL_KEY_LIMIT; k++) {
+    if (k == key || _index[k].offset == 0) continue;
+    if (!readValue(k, buffer)) return false;
+    if (!append(next, cursor, k, buffer, _index[k].size)) return false;
+    index[k] = { (uint16_t) cursor, _index[k].size };
+    cursor += getRecordSize(_index[k].size);
+  }
+  if (!append(next, cursor, key, data, size)) return false;
+  index[key] = { (uint16_t) cursor, (uint8_t) size };
+  cursor += getRecordSize(size);
+  if (!writeSectorHeader(next, _sequence + 1)) return false;
+
+  _sector = next;
+  _sequence += 1;
+  _cursor = cursor;
+  memcpy(_index, index, sizeof(_index));
+  _appendCount += 1;
+  return true;
+}
+
+size_t ConfigJournal::getRecordSize(size_t size) {
+  return CONFIG_JOURNAL_RECORD_HEADER_SIZE + (size + 3) / 4 * 4;
+}
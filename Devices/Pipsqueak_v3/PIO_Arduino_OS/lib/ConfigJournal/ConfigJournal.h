@@ -0,0 +1,132 @@
+#ifndef ConfigJournal_h
+#define ConfigJournal_h
+
+#include <Arduino.h>
+
+// flash is erased a sector at a time
+#define CONFIG_JOURNAL_SECTOR_SIZE 4096
+
+// keys are 0 to CONFIG_JOURNAL_KEY_LIMIT - 1
+#define CONFIG_JOURNAL_KEY_LIMIT 8
+
+// largest value, in bytes; a multiple of 4
+#define CONFIG_JOURNAL_VALUE_LIMIT 252
+
+// each sector starts with a header: magic, sequence, base, CRC-32
+#define CONFIG_JOURNAL_SECTOR_HEADER_SIZE 16
+
+// each record starts with a header: key, size, reserved, CRC-32
+#define CONFIG_JOURNAL_RECORD_HEADER_SIZE 8
+
+/**
+ * The flash sectors holding a ConfigJournal. Offsets and sizes
+ * are multiples of 4, and data is word aligned, as the esp8266's
+ * flash API requires.
+ *
+ * Like NOR flash, a write may only clear bits; erasing a sector
+ * sets all of its bits.
+ */
+class JournalFlash {
+  public:
+    virtual size_t getSectorCount() = 0;
+    virtual bool erase(size_t sector) = 0;
+    virtual bool read(size_t sector, uint32_t offset, uint32_t * data, size_t size) = 0;
+    virtual bool write(size_t sector, uint32_t offset, const uint32_t * data, size_t size) = 0;
+};
+
+/**
+ * An append-only key/value store, kept in a ring of flash sectors,
+ * for configuration that changes as the Pipsqueak runs.
+ *
+ * Writing a value appends a CRC'd record to the active sector, which
+ * takes a few words of flash rather than a sector erase. Once the
+ * active sector fills, the latest value of every key is copied into
+ * the next sector of the ring, which is erased first. Erases are thus
+ * both rare and spread evenly across the ring.
+ *
+ * A RAM index holds where the latest record of each key lies, so
+ * that reads needn't scan.
+ *
+ * The journal is bound to a base, e.g. the CRC of the configuration
+ * that its values override. A journal found with a different base is
+ * discarded, so that values written before the device was
+ * re-initialized don't outlive the re-initialization.
+ *
+ * Power may be lost at any time: a torn record fails its CRC and is
+ * ignored, and a sector only becomes active once everything has been
+ * copied into it, so an interrupted copy leaves the previous sector
+ * in charge.
+ *
+ * Not thread safe or ISR-safe.
+ */
+class ConfigJournal {
+  public:
+    ConfigJournal(JournalFlash * flash);
+
+    /**
+     * Finds the active sector and indexes its records, or starts a
+     * new journal if there is none with the given base. Returns
+     * false if the flash has fewer than two sectors or fails.
+     */
+    bool begin(uint32_t base);
+
+    /**
+     * Indicates whether begin() succeeded.
+     */
+    bool isReady();
+
+    /**
+     * Reads the latest value of the given key into data. Returns
+     * false, leaving data untouched, if the key has no value of the
+     * given size.
+     */
+    bool read(uint8_t key, void * data, size_t size);
+
+    /**
+     * Appends a value for the given key, unless it is unchanged.
+     * Returns false if the journal isn't ready, the key or size is
+     * out of range, or the flash fails.
+     */
+    bool write(uint8_t key, const void * data, size_t size);
+
+    /**
+     * Returns the number of records appended since begin().
+     */
+    uint32_t getAppendCount();
+
+    /**
+     * Returns the number of sectors the ring has had erased over
+     * its life, a measure of wear.
+     */
+    uint32_t getEraseCount();
+
+    /**
+     * Returns the bytes left in the active sector.
+     */
+    size_t getFreeSpace();
+
+  private:
+    struct Entry {
+      uint16_t offset; // 0 if the key has no value
+      uint8_t size;
+    };
+
+    JournalFlash * _flash;
+    bool _ready;
+    size_t _sector;
+    uint32_t _sequence;
+    uint32_t _base;
+    uint32_t _cursor;
+    uint32_t _appendCount;
+    Entry _index[CONFIG_JOURNAL_KEY_LIMIT];
+
+    bool readSectorHeader(size_t sector, uint32_t * sequence, uint32_t * base);
+    bool writeSectorHeader(size_t sector, uint32_t sequence);
+    void scan();
+    bool append(size_t sector, uint32_t offset, uint8_t key, const void * data, size_t size);
+    bool readValue(uint8_t key, uint32_t * buffer);
+    bool compact(uint8_t key, const void * data, size_t size);
+    static size_t getRecordSize(size_t size);
+};
+
+#endif // ConfigJournal_h
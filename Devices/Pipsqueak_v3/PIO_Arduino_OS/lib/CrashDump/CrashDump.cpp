@@ -0,0 +1,137 @@
+#include "CrashDump.h"
+#include <ConfigImage.h>
+
+#define UPLOADED_OFFSET 4
+#define NOT_UPLOADED 0xFFFFFFFF
+
+// read at a time while checking the CRC
+#define CHECK_BLOCK_SIZE 64
+
+CrashDump::CrashDump(JournalFlash * flash)
+:
+  _flash { flash },
+  _valid { false },
+  _recordCount { 0 },
+  _recordCursor { 0 }
+{
+  memset(&_header, 0, sizeof(_header));
+  memset(_records, 0, sizeof(_records));
+}
+
+bool CrashDump::begin() {
+  _valid = false;
+  if (_flash->getSectorCount() == 0) return false;
+  if (!_flash->read(0, 0, (uint32_t *) &_header, sizeof(_header))) return false;
+  if (_header.magic != CRASH_DUMP_MAGIC || _header.version != CRASH_DUMP_VERSION) return true;
+  if (_header.headerSize != sizeof(CrashDumpHeader)) return true;
+  if (_header.size < sizeof(CrashDumpHeader) || _header.size > CONFIG_JOURNAL_SECTOR_SIZE || _header.size % 4 != 0) return true;
+
+  uint32_t crc = ConfigImageFormat::crc32((const uint8_t *) &_header + CRASH_DUMP_CRC_OFFSET, sizeof(_header) - CRASH_DUMP_CRC_OFFSET);
+  uint32_t block[CHECK_BLOCK_SIZE / 4];
+  for (uint32_t offset = sizeof(_header); offset < _header.size; offset += CHECK_BLOCK_SIZE) {
+    size_t size = min((size_t) (_header.size - offset), (size_t) CHECK_BLOCK_SIZE);
+    if (!_flash->read(0, offset, block, size)) return false;
+    crc = ConfigImageFormat::crc32(block, size, crc);
+  }
+  _valid = crc == _header.crc;
+  return true;
+}
+
+void CrashDump::addRecord(uint8_t type, int8_t code, uint32_t millis) {
+  CrashDumpRecord * record = &_records[_recordCursor];
+  record->millis = millis;
+  record->type = type;
+  record->code = code;
+  record->reserved = 0;
+  _recordCursor = (_recordCursor + 1) % CRASH_DUMP_RECORD_LIMIT;
+  if (_recordCount < CRASH_DUMP_RECORD_LIMIT) _recordCount += 1;
+}
+
+bool CrashDump::capture(const CrashDumpContext * context, const uint32_t * stack, size_t stackSize) {
+  if (_flash->getSectorCount() == 0) return false;
+  stackSize = min(stackSize, (size_t) CRASH_DUMP_STACK_LIMIT) & ~((size_t) 3);
+  uint8_t profilerCount = (uint8_t) Profiler::getRecentCount();
+
+  uint32_t dumpID = _valid ? _header.dumpID + 1 : 1;
+  _valid = false;
+  memset(&_header, 0, sizeof(_header));
+  _header.magic = CRASH_DUMP_MAGIC;
+  _header.uploaded = NOT_UPLOADED;
+  _header.version = CRASH_DUMP_VERSION;
+  _header.headerSize = sizeof(CrashDumpHeader);
+  _header.size = sizeof(CrashDumpHeader) + stackSize +
+    profilerCount * CRASH_DUMP_PROFILER_RUN_SIZE + _recordCount * CRASH_DUMP_RECORD_SIZE;
+  _header.dumpID = dumpID;
+  _header.uptimeMillis = context->uptimeMillis;
+  _header.unixTime = context->unixTime;
+  _header.reason = context->reason;
+  _header.exccause = context->exccause;
+  _header.epc1 = context->epc1;
+  _header.epc2 = context->epc2;
+  _header.epc3 = context->epc3;
+  _header.excvaddr = context->excvaddr;
+  _header.depc = context->depc;
+  _header.stackPointer = context->stackPointer;
+  _header.stackEnd = context->stackEnd;
+  _header.stackSize = (uint16_t) stackSize;
+  _header.profilerCount = profilerCount;
+  _header.recordCount = (uint8_t) _recordCount;
+  _header.activeSlots = Profiler::getActiveSlots();
+
+  if (!_flash->erase(0)) return false;
+
+  // The body first, so that the dump only appears once it's whole
+  uint32_t crc = ConfigImageFormat::crc32((const uint8_t *) &_header + CRASH_DUMP_CRC_OFFSET, sizeof(_header) - CRASH_DUMP_CRC_OFFSET);
+  uint32_t offset = sizeof(CrashDumpHeader);
+  if (stackSize > 0 && !write(&offset, stack, stackSize, &crc)) return false;
+  for (size_t age = profilerCount; age > 0; age--) {
+    ProfilerRun run = Profiler::getRecent(age - 1);
+    if (!write(&offset, &run, sizeof(run), &crc)) return false;
+  }
+  for (size_t i = 0; i < _recordCount; i++) {
+    CrashDumpRecord * record = &_records[(_recordCursor + CRASH_DUMP_RECORD_LIMIT - _recordCount + i) % CRASH_DUMP_RECORD_LIMIT];
+    if (!write(&offset, record, sizeof(CrashDumpRecord), &crc)) return false;
+  }
+
+  _header.crc = crc;
+  if (!_flash->write(0, 0, (const uint32_t *) &_header, sizeof(_header))) return false;
+  _valid = true;
+  return true;
+}
+
+bool CrashDump::isPending() {
+  return _valid && _header.uploaded == NOT_UPLOADED;
+}
+
+uint32_t CrashDump::getDumpID() {
+  return _valid ? _header.dumpID : 0;
+}
+
+uint32_t CrashDump::getSize() {
+  return _valid ? _header.size : 0;
+}
+
+const CrashDumpHeader * CrashDump::getHeader() {
+  return &_header;
+}
+
+bool CrashDump::read(uint32_t offset, uint32_t * data, size_t size) {
+  if (!_valid || offset % 4 != 0 || size % 4 != 0) return false;
+  if (offset > _header.size || size > _header.size - offset) return false;
+  return _flash->read(0, offset, data, size);
+}
+
+bool CrashDump::markUploaded() {
+  if (!_valid) return false;
+  uint32_t uploaded = 0;
+  if (!_flash->write(0, UPLOADED_OFFSET, &uploaded, sizeof(uploaded))) return false;
+  _header.uploaded = uploaded;
+  return true;
+}
+
+bool CrashDump::write(uint32_t * offset, const void * data, size_t size, uint32_t * crc) {
+  if (!_flash->write(0, *offset, (const uint32_t *) data, size)) return false;
+  *crc = ConfigImageFormat::crc32(data, size, *crc);
+  *offset += size;
+  return true;
+}
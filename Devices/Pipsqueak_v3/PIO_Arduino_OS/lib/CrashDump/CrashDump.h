@@ -0,0 +1,179 @@
+#ifndef CrashDump_h
+#define CrashDump_h
+
+#include <Arduino.h>
+#include <ConfigJournal.h>
+#include <Profiler.h>
+
+// "PQCD", little-endian
+#define CRASH_DUMP_MAGIC 0x44435150
+// bumped whenever the layout of a dump changes
+#define CRASH_DUMP_VERSION 1
+
+// bytes of stack kept, from the stack pointer up; a multiple of 4
+#define CRASH_DUMP_STACK_LIMIT 2048
+
+// error records kept, newest last
+#define CRASH_DUMP_RECORD_LIMIT 16
+
+#define CRASH_DUMP_RECORD_SIZE 8
+#define CRASH_DUMP_PROFILER_RUN_SIZE 8
+
+// the uploaded flag and CRC are followed by the CRC'd part of the header
+#define CRASH_DUMP_CRC_OFFSET 12
+
+/**
+ * The registers and timing of a crash, as the esp8266 core hands
+ * them to custom_crash_callback().
+ */
+struct CrashDumpContext {
+  uint32_t reason;
+  uint32_t exccause;
+  uint32_t epc1;
+  uint32_t epc2;
+  uint32_t epc3;
+  uint32_t excvaddr;
+  uint32_t depc;
+  uint32_t stackPointer;
+  uint32_t stackEnd;
+  uint32_t uptimeMillis;
+  uint32_t unixTime; // 0 if the clock wasn't synchronized
+};
+
+/**
+ * The start of a dump as stored and uploaded, followed by
+ * stackSize bytes of stack, profilerCount ProfilerRuns (oldest
+ * first) and recordCount CrashDumpRecords (oldest first).
+ * Little-endian throughout.
+ */
+struct CrashDumpHeader {
+  uint32_t magic;
+  uint32_t uploaded; // all ones until the dump is uploaded; not CRC'd
+  uint32_t crc;      // CRC-32 of everything from CRASH_DUMP_CRC_OFFSET on
+  uint16_t version;
+  uint16_t headerSize;
+  uint32_t size;     // of the whole dump, in bytes
+  uint32_t dumpID;   // counts up from 1 with each crash
+  uint32_t uptimeMillis;
+  uint32_t unixTime;
+  uint32_t reason;
+  uint32_t exccause;
+  uint32_t epc1;
+  uint32_t epc2;
+  uint32_t epc3;
+  uint32_t excvaddr;
+  uint32_t depc;
+  uint32_t stackPointer;
+  uint32_t stackEnd;
+  uint16_t stackSize;
+  uint8_t profilerCount;
+  uint8_t recordCount;
+  uint32_t activeSlots; // Profiler::getActiveSlots() at the crash
+};
+
+/**
+ * An error recorded before the crash.
+ */
+struct CrashDumpRecord {
+  uint32_t millis;
+  uint8_t type;
+  int8_t code;
+  uint16_t reserved;
+};
+
+/**
+ * Keeps the post-mortem of the latest crash in a flash sector, for
+ * upload once the Pipsqueak is back up: the registers and reset
+ * reason, a window of the stack, the profiler's recent runs and
+ * which code paths were running, and the last few errors recorded.
+ * That's more than the reboot report's 256-byte message can carry.
+ *
+ * capture() is meant for custom_crash_callback(), which the esp8266
+ * core invokes after an exception or software watchdog reset, with
+ * interrupts off and the heap suspect, so it allocates nothing and
+ * writes straight from RAM to flash. A hardware watchdog reset
+ * gives no such chance, so leaves no dump.
+ *
+ * The body is written before the header, so a dump torn by a power
+ * cut has no header and is ignored. A newer crash replaces an older
+ * dump, uploaded or not.
+ *
+ * Stored in the first sector of a JournalFlash, which needs only
+ * the one.
+ *
+ * Not thread safe or ISR-safe.
+ */
+class CrashDump {
+  public:
+    CrashDump(JournalFlash * flash);
+
+    /**
+     * Reads the stored dump's header, if any. Invoke once, early
+     * in setup(). Returns false if the flash has no sectors or
+     * fails.
+     */
+    bool begin();
+
+    /**
+     * Adds an error to those a dump will carry, dropping the
+     * oldest once there are CRASH_DUMP_RECORD_LIMIT.
+     */
+    void addRecord(uint8_t type, int8_t code, uint32_t millis);
+
+    /**
+     * Erases the sector and writes a new dump, with the given
+     * registers, up to CRASH_DUMP_STACK_LIMIT bytes of the given
+     * stack, and the profiler's and this instance's records.
+     * Returns false if the flash fails.
+     */
+    bool capture(const CrashDumpContext * context, const uint32_t * stack, size_t stackSize);
+
+    /**
+     * Indicates whether a dump is stored that has yet to be
+     * uploaded.
+     */
+    bool isPending();
+
+    /**
+     * Returns the stored dump's ID, or 0 if there is none.
+     */
+    uint32_t getDumpID();
+
+    /**
+     * Returns the stored dump's size in bytes, or 0 if there is
+     * none.
+     */
+    uint32_t getSize();
+
+    /**
+     * Returns the stored dump's header. Undefined if there is
+     * none.
+     */
+    const CrashDumpHeader * getHeader();
+
+    /**
+     * Reads part of the stored dump. The offset and size must be
+     * multiples of 4. Returns false if they fall outside the dump
+     * or the flash fails.
+     */
+    bool read(uint32_t offset, uint32_t * data, size_t size);
+
+    /**
+     * Marks the stored dump uploaded, which takes a word of flash
+     * and no erase. Returns false if there is none or the flash
+     * fails.
+     */
+    bool markUploaded();
+
+  private:
+    JournalFlash * _flash;
+    bool _valid;
+    CrashDumpHeader _header;
+    CrashDumpRecord _records[CRASH_DUMP_RECORD_LIMIT];
+    size_t _recordCount;
+    size_t _recordCursor;
+
+    bool write(uint32_t * offset, const void * data, size_t size, uint32_t * crc);
+};
+
+#endif // CrashDump_h
@@ -0,0 +1,93 @@
+#include "CrashDumpProtocol.h"
+
+// CrashDumpResponse /////////////////////////////////////////////////////////////////////////////////
+
+CrashDumpResponse::CrashDumpResponse(Hmac * hmac) : Response(hmac, "CrashDumpResponse")
+{
+}
+
+volatile byte * ICACHE_RAM_ATTR CrashDumpResponse::getBuffer() {
+  return _buffer;
+}
+
+byte * CrashDumpResponse::getPayload() {
+  return _payload;
+}
+
+size_t ICACHE_RAM_ATTR CrashDumpResponse::getExpectedSize() {
+  return CRASH_DUMP_RESPONSE_SIZE;
+}
+
+uint8_t CrashDumpResponse::getExpectedProtocol() {
+  return CRASH_DUMP_PROTOCOL_ID;
+}
+
+
+// CrashDumpRequest //////////////////////////////////////////////////////////////////////////////////
+
+CrashDumpRequest::CrashDumpRequest(uint32_t deviceID, Hmac * hmac)
+  :
+  Request(hmac, "CrashDumpRequest"),
+  _size { CRASH_DUMP_REQUEST_BASE_SIZE },
+  _dumpID { 0 },
+  _chunkOffset { 0 },
+  _chunkSize { 0 },
+  _response(hmac)
+{
+  Request::initialize(_buffer, CRASH_DUMP_REQUEST_MAX_SIZE, CRASH_DUMP_PROTOCOL_ID, deviceID);
+}
+
+void CrashDumpRequest::reset() {
+  Request::reset();
+  localReset();
+}
+
+void CrashDumpRequest::setChunk(uint32_t dumpID, uint32_t dumpSize, uint32_t chunkOffset, const byte * chunk, size_t chunkSize) {
+  if (_dumpID > 0) localReset();
+  Request::setPopulated();
+  _dumpID = dumpID;
+  _chunkOffset = chunkOffset;
+  _chunkSize = min(chunkSize, (size_t) CRASH_DUMP_REQUEST_CHUNK_SIZE_LIMIT);
+  _size = CRASH_DUMP_REQUEST_BASE_SIZE + _chunkSize;
+  uint16_t size = (uint16_t) _chunkSize;
+  memcpy(&_buffer[CRASH_DUMP_REQUEST_DUMP_ID_OFFSET], &dumpID, 4);
+  memcpy(&_buffer[CRASH_DUMP_REQUEST_DUMP_SIZE_OFFSET], &dumpSize, 4);
+  memcpy(&_buffer[CRASH_DUMP_REQUEST_CHUNK_OFFSET_OFFSET], &chunkOffset, 4);
+  memcpy(&_buffer[CRASH_DUMP_REQUEST_CHUNK_SIZE_OFFSET], &size, 2);
+  memcpy(&_buffer[CRASH_DUMP_REQUEST_CHUNK_OFFSET], chunk, _chunkSize);
+}
+
+uint32_t CrashDumpRequest::getDumpID() {
+  return _dumpID;
+}
+
+uint32_t CrashDumpRequest::getChunkOffset() {
+  return _chunkOffset;
+}
+
+size_t CrashDumpRequest::getChunkSize() {
+  return _chunkSize;
+}
+
+size_t CrashDumpRequest::getSize() {
+  return _size;
+}
+
+CrashDumpResponse * CrashDumpRequest::getResponse() {
+  return &_response;
+}
+
+byte * CrashDumpRequest::getBuffer() {
+  return _buffer;
+}
+
+void CrashDumpRequest::localReset() {
+  if (_dumpID > 0) {
+    memset(&_buffer[CRASH_DUMP_REQUEST_DUMP_ID_OFFSET], 0, REQUEST_HEADER_SIZE - CRASH_DUMP_REQUEST_DUMP_ID_OFFSET);
+    memset(&_buffer[CRASH_DUMP_REQUEST_CHUNK_OFFSET], 0, _chunkSize);
+  }
+  _size = CRASH_DUMP_REQUEST_BASE_SIZE;
+  _dumpID = 0;
+  _chunkOffset = 0;
+  _chunkSize = 0;
+}
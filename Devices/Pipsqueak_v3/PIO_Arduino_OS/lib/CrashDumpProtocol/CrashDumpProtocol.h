@@ -0,0 +1,100 @@
+#ifndef CrashDumpProtocol_h
+#define CrashDumpProtocol_h
+
+#include <Arduino.h>
+#include <Request.h>
+#include <Response.h>
+
+#define CRASH_DUMP_PROTOCOL_ID 0x05
+
+// a multiple of 4, as dumps are read from flash a word at a time
+#define CRASH_DUMP_REQUEST_CHUNK_SIZE_LIMIT 256
+#define CRASH_DUMP_REQUEST_BASE_SIZE REQUEST_BASE_SIZE
+#define CRASH_DUMP_REQUEST_MAX_SIZE REQUEST_BASE_SIZE + CRASH_DUMP_REQUEST_CHUNK_SIZE_LIMIT
+#define CRASH_DUMP_REQUEST_DUMP_ID_OFFSET 14
+#define CRASH_DUMP_REQUEST_DUMP_SIZE_OFFSET 18
+#define CRASH_DUMP_REQUEST_CHUNK_OFFSET_OFFSET 22
+#define CRASH_DUMP_REQUEST_CHUNK_SIZE_OFFSET 26
+#define CRASH_DUMP_REQUEST_CHUNK_OFFSET REQUEST_HEADER_SIZE
+
+#define CRASH_DUMP_RESPONSE_SIZE RESPONSE_BASE_SIZE
+
+/**
+ * Parses and encapsulates the server's CrashDumpRequest
+ * response, which acknowledges the chunk.
+ */
+class CrashDumpResponse: public Response {
+  public:
+    CrashDumpResponse(Hmac * hmac);
+
+  protected:
+    volatile byte * getBuffer();
+    byte * getPayload();
+    size_t getExpectedSize();
+    uint8_t getExpectedProtocol();
+
+  private:
+    volatile byte _buffer[CRASH_DUMP_RESPONSE_SIZE];
+    byte _payload[CRASH_DUMP_RESPONSE_SIZE];
+};
+
+
+/**
+ * Used to upload a crash dump (see the CrashDump library) to
+ * the server a chunk at a time, each chunk in a request of
+ * its own.
+ */
+class CrashDumpRequest: public Request {
+  public:
+    CrashDumpRequest(uint32_t deviceID, Hmac * hmac);
+
+    /** See Request.reset() */
+    void reset();
+
+    /**
+     * Populates the request with a chunk of the given dump.
+     * Chunks beyond CRASH_DUMP_REQUEST_CHUNK_SIZE_LIMIT bytes
+     * are truncated.
+     *
+     * dumpID: identifies the dump the chunk belongs to
+     * dumpSize: of the whole dump, in bytes
+     * chunkOffset: where the chunk starts within the dump
+     */
+    void setChunk(uint32_t dumpID, uint32_t dumpSize, uint32_t chunkOffset, const byte * chunk, size_t chunkSize);
+
+    /**
+     * Returns the dump ID set via setChunk(), or 0.
+     */
+    uint32_t getDumpID();
+
+    /**
+     * Returns the chunk offset set via setChunk(), or 0.
+     */
+    uint32_t getChunkOffset();
+
+    /**
+     * Returns the size of the chunk set via setChunk(), or 0.
+     */
+    size_t getChunkSize();
+
+    /** See Request.getSize() */
+    size_t getSize();
+
+    /** See Request.getResponse() */
+    CrashDumpResponse * getResponse();
+
+    /** See Request.getBuffer() */
+    byte * getBuffer();
+
+  private:
+    byte _buffer[CRASH_DUMP_REQUEST_MAX_SIZE];
+    size_t _size;
+    uint32_t _dumpID;
+    uint32_t _chunkOffset;
+    size_t _chunkSize;
+    CrashDumpResponse _response;
+
+    void localReset();
+};
+
+#endif // CrashDumpProtocol_h
@@ -1,9 +1,8 @@
 #include "DS18B20.h"
+#include <Profiler.h>
+#include <Metrics.h>
 #include <math.h>
 
-// DS18B20 identifier byte (first byte in address)
-#define DS18B20_FAMILY_CODE         0x28
-
 // DS18B20 command bytes
 #define COMMAND_BEGIN_CONVERSION    0x44
 #define COMMAND_RECALL_MEMORY       0xB8
@@ -39,7 +38,7 @@
 // minimum number of readings before we have confidence in our observation
 #define DS18B20_MIN_READINGS 3
 
-DS18B20::DS18B20(OneWire * oneWire, byte * address, byte resolution, uint32_t readingTTL)
+DS18B20::DS18B20(OneWire * oneWire, byte * address, byte resolution, uint32_t readingTTL, bool configured)
 :
   _sensing { false },
   _sensingStartMillis { 0 },
@@ -55,7 +54,7 @@ DS18B20::DS18B20(OneWire * oneWire, byte * address, byte resolution, uint32_t re
   memcpy(_address, address, DS18B20_ADDRESS_SIZE);
   memset(_scratchpad, 0, DS18B20_SCRATCHPAD_SIZE);
   for (uint8_t i = 0; i < DS18B20_HISTORY_SIZE; i++) _readings[i] = NAN;
-  setSensorResolution();
+  if (!configured) setSensorResolution();
 }
 
 size_t DS18B20::detect(OneWire * oneWire, byte * buffer, size_t maxCount) {
@@ -63,7 +62,7 @@ size_t DS18B20::detect(OneWire * oneWire, byte * buffer, size_t maxCount) {
   size_t count = 0;
   byte * addressBuffer = buffer;
   while (oneWire->search(addressBuffer)) {
-    if (!OneWire::crc8(addressBuffer, 7) == addressBuffer[7]) {
+    if (OneWire::crc8(addressBuffer, 7) != addressBuffer[7]) {
       #ifdef DEBUG_DS18B20
       Serial.println("DS18B20.detect(): device detected on 1Wire bus, but address fails CRC check");
       #endif
@@ -88,6 +87,10 @@ size_t DS18B20::detect(OneWire * oneWire, byte * buffer, size_t maxCount) {
   return count;
 }
 
+const byte * DS18B20::getAddress() {
+  return _address;
+}
+
 void DS18B20::startSensing() {
   if (_sensing) return;
   _oneWire->reset();
@@ -105,6 +108,11 @@ bool DS18B20::isReadyToRead() {
   return _sensing && (millis() - _sensingStartMillis) >= getConversionTime();
 }
 
+uint32_t DS18B20::getMillisUntilReady() {
+  if (isReadyToRead() || !_sensing) return 0;
+  return getConversionTime() - (millis() - _sensingStartMillis);
+}
+
 bool DS18B20::read() {
   if (!_sensing) return true;
 
@@ -127,7 +135,9 @@ bool DS18B20::read() {
     #ifdef DEBUG_DS18B20
     Serial.printf("DS18B20.readSensor(): sensor is not configured for %u-bit resolution\n", _resolution);
     #endif
-    setSensorResolution();
+    // once per reading, so as not to hold up the loop; the next
+    // reading checks it took
+    writeSensorResolution();
     doneReading();
     return true;
   }
@@ -170,6 +180,22 @@ float DS18B20::getTemperature() {
   return _currentReading;
 }
 
+float DS18B20::getLastReading() {
+  if (_countOfReadings == 0) return NAN;
+  return _readings[(_cursor == 0 ? DS18B20_HISTORY_SIZE : _cursor) - 1];
+}
+
+void DS18B20::seed(float reading) {
+  if (isnan(reading) || _countOfReadings > 0) return;
+  // one short of the minimum, so the next reading is accepted as is
+  for (uint8_t i = 0; i < DS18B20_MIN_READINGS - 1; i++) {
+    _readings[_cursor] = reading;
+    _cursor = (_cursor + 1) % DS18B20_HISTORY_SIZE;
+    _countOfReadings++;
+  }
+  _lastSuccessfulRead = millis();
+}
+
 byte DS18B20::getResolutionConfigValue() {
   switch (_resolution) {
     case 9: return CONFIG_9_BIT;
@@ -277,39 +303,39 @@ void DS18B20::doneReading() {
 }
 
 byte DS18B20::getSensorResolution() {
+  // the sensor may have been unplugged, so don't wait on it indefinitely
   bool successfulRead = false;
+  size_t attempts = 0;
   do {
     successfulRead = readScratchpad();
+    attempts += 1;
     #ifdef DEBUG_DS18B20
     Serial.printf("DS18B20.getSensorResolution(): %ssuccessful scratchpad read\n", successfulRead ? "" : "un");
     #endif
     yield();
-  } while (!successfulRead);
+  } while (!successfulRead && attempts < MAX_READ_ATTEMPTS);
 
-  return _scratchpad[INDEX_CONFIG];
+  return successfulRead ? _scratchpad[INDEX_CONFIG] : 0;
 }
 
 void DS18B20::setSensorResolution() {
   byte originalResolution = getSensorResolution();
   byte currentResolution = originalResolution;
+  size_t attempts = 0;
   while (currentResolution != getResolutionConfigValue()) {
+    if (attempts++ >= MAX_READ_ATTEMPTS) {
+      // read() retries when it sees the wrong configuration
+      #ifdef DEBUG_DS18B20
+      Serial.println("DS18B20.setSensorResolution(): sensor unresponsive; giving up for now");
+      #endif
+      return;
+    }
+
     #ifdef DEBUG_DS18B20
     Serial.printf("DS18B20.setSensorResolution(): attempting to update resolution config from 0x%02X to 0x%02X\n", currentResolution, getResolutionConfigValue());
     #endif
 
-    // write the new configuration
-    _oneWire->reset();
-    _oneWire->select(_address);
-    _oneWire->write(COMMAND_WRITE_SCRATCHPAD);
-    _oneWire->write(ALARM_HIGH_BYTE);
-    _oneWire->write(ALARM_LOW_BYTE);
-    _oneWire->write(getResolutionConfigValue());
-
-    // ask the sensor to persist the configuration to EEPROM
-    _oneWire->reset();
-    _oneWire->select(_address);
-    _oneWire->write(COMMAND_COPY_SCRATCHPAD);
-
+    writeSensorResolution();
     currentResolution = getSensorResolution();
   }
 
@@ -322,12 +348,30 @@ void DS18B20::setSensorResolution() {
   #endif
 }
 
+void DS18B20::writeSensorResolution() {
+  // write the new configuration
+  _oneWire->reset();
+  _oneWire->select(_address);
+  _oneWire->write(COMMAND_WRITE_SCRATCHPAD);
+  _oneWire->write(ALARM_HIGH_BYTE);
+  _oneWire->write(ALARM_LOW_BYTE);
+  _oneWire->write(getResolutionConfigValue());
+
+  // ask the sensor to persist the configuration to EEPROM
+  _oneWire->reset();
+  _oneWire->select(_address);
+  _oneWire->write(COMMAND_COPY_SCRATCHPAD);
+}
+
 bool DS18B20::readScratchpad() {
+  PROFILER_SCOPE(PROFILER_SLOT_READ_SCRATCHPAD);
   _oneWire->reset();
   _oneWire->select(_address);
   _oneWire->write(COMMAND_READ_SCRATCHPAD);
   for (uint8_t i = 0; i < DS18B20_SCRATCHPAD_SIZE; i++) {
     _scratchpad[i] = _oneWire->read();
   }
-  return OneWire::crc8(_scratchpad, INDEX_CRC) == _scratchpad[INDEX_CRC];
+  if (OneWire::crc8(_scratchpad, INDEX_CRC) == _scratchpad[INDEX_CRC]) return true;
+  Metrics::increment(METRIC_SENSOR_CRC_FAILURES);
+  return false;
 }
@@ -4,6 +4,9 @@
 #include <Arduino.h>
 #include <OneWire.h>
 
+// DS18B20 identifier byte (first byte in address)
+#define DS18B20_FAMILY_CODE 0x28
+
 #define DS18B20_HISTORY_SIZE 10
 #define DS18B20_ADDRESS_SIZE 8
 #define DS18B20_SCRATCHPAD_SIZE 9
@@ -20,8 +23,11 @@ class DS18B20 {
      * resolution: 9, 10, 11 or 12, representing the bit depth of the reading
      * readingTTL: millisecond lifespan of a reading, beyond which a reading
      *  is considered unreliable.
+     * configured: true if the sensor is known to be configured for the
+     *  resolution already, e.g. before a warm restart, which skips the
+     *  blocking configuration check; read() still verifies it
      */
-    DS18B20(OneWire * oneWire, byte * address, byte resolution, uint32_t readingTTL);
+    DS18B20(OneWire * oneWire, byte * address, byte resolution, uint32_t readingTTL, bool configured = false);
 
     /**
      * Detected DS18B20 devices on the OneWire bus.
@@ -33,6 +39,11 @@ class DS18B20 {
      */
     static size_t detect(OneWire * oneWire, byte * buffer, size_t maxCount);
 
+    /**
+     * Returns the sensor's 8-byte chip address.
+     */
+    const byte * getAddress();
+
     /**
      * Begins the "conversion" process via which temperature is read.
      * This process takes some time - less with lower resolutions, more
@@ -55,6 +66,13 @@ class DS18B20 {
      */
     bool isReadyToRead();
 
+    /**
+     * Returns the number of milliseconds until the conversion
+     * in progress completes, or 0 if it has completed or the
+     * sensor is not sensing.
+     */
+    uint32_t getMillisUntilReady();
+
     /**
      * Attempts to read the temperature from the sensor.
      * Returns true if further calls to this method will not be
@@ -76,6 +94,22 @@ class DS18B20 {
      */
     float getTemperature();
 
+    /**
+     * Returns the most recent successful reading, without the
+     * smoothing applied by getTemperature(), or NAN if there has
+     * been none. For one-off readings, e.g. upon waking from deep
+     * sleep.
+     */
+    float getLastReading();
+
+    /**
+     * Primes the history with a reading taken before a warm
+     * restart, so that the next successful reading is accepted at
+     * once rather than after several. No-op if the reading is NAN
+     * or readings have already been taken.
+     */
+    void seed(float reading);
+
   private:
     OneWire * _oneWire;
     byte _address[DS18B20_ADDRESS_SIZE];
@@ -98,6 +132,7 @@ class DS18B20 {
     void doneReading();
     byte getSensorResolution();
     void setSensorResolution();
+    void writeSensorResolution();
     bool readScratchpad();
 };
 
@@ -85,6 +85,8 @@ enum ErrorType { None = 0, Pipsqueak = 1, TcpStack = 2 };
 #define RESPONSE_ERROR_INVALID_PROTOCOL 35
 // The challenge response from the server did not match the challenge in the request
 #define RESPONSE_ERROR_CHALLENGE_FAILED 36
+// The fermentation profile in the server response was malformed and has been ignored
+#define RESPONSE_ERROR_INVALID_PROFILE 37
 
 // Device Error Codes  ////////////////////////////////////////////////////////////////////////////
 // Indicate hardware, software or state errors
@@ -104,5 +106,7 @@ enum ErrorType { None = 0, Pipsqueak = 1, TcpStack = 2 };
 #define REMOTE_TEMPERATURE_NAN_ERROR 70
 // WiFi connection failure
 #define WIFI_CONNECTION_ERROR 71
+// A scheduled task started well after its deadline
+#define SCHEDULER_OVERRUN_ERROR 72
 
 #endif // Errors_h
@@ -0,0 +1,56 @@
+#include "FeedForward.h"
+
+FeedForward::FeedForward(float timeConstant, float gainLimit)
+:
+  _timeConstant { timeConstant },
+  _gainLimit { gainLimit }
+{
+  setGains(0, 0);
+}
+
+float FeedForward::compute(float setpoint, float ambient) {
+  if (isnan(ambient)) return 0;
+  float gradient = setpoint - ambient;
+  return gradient * (gradient > 0 ? _heating.gain : _chilling.gain);
+}
+
+void FeedForward::learn(float output, float setpoint, float measurement, float ambient, float elapsedSeconds) {
+  if (isnan(ambient) || isnan(measurement)) return;
+  if (fabsf(setpoint - measurement) > FEED_FORWARD_LEARNING_BAND) return;
+  float gradient = setpoint - ambient;
+  observe(gradient > 0 ? &_heating : &_chilling, gradient, output, elapsedSeconds);
+}
+
+void FeedForward::observe(Regression * regression, float gradient, float output, float elapsedSeconds) {
+  // Exponentially weighted moments; early samples are weighted
+  // equally so the first one doesn't drag the means toward 0
+  float weight = elapsedSeconds / (_timeConstant + elapsedSeconds);
+  if (regression->samples < UINT32_MAX) regression->samples += 1;
+  weight = max(weight, 1.0f / regression->samples);
+
+  float gradientDelta = gradient - regression->meanGradient;
+  float outputDelta = output - regression->meanOutput;
+  regression->meanGradient += weight * gradientDelta;
+  regression->meanOutput += weight * outputDelta;
+  regression->variance = (1 - weight) * (regression->variance + weight * gradientDelta * gradientDelta);
+  regression->covariance = (1 - weight) * (regression->covariance + weight * gradientDelta * outputDelta);
+
+  // A negative slope means something other than the surroundings
+  // dominates, so there is nothing to compensate in advance
+  if (regression->variance >= FEED_FORWARD_MINIMUM_VARIANCE) {
+    regression->gain = constrain(regression->covariance / regression->variance, 0, _gainLimit);
+  }
+}
+
+void FeedForward::setGains(float heatingGain, float chillingGain) {
+  _heating = { 0, 0, 0, 0, 0, constrain(heatingGain, 0, _gainLimit) };
+  _chilling = { 0, 0, 0, 0, 0, constrain(chillingGain, 0, _gainLimit) };
+}
+
+float FeedForward::getHeatingGain() {
+  return _heating.gain;
+}
+
+float FeedForward::getChillingGain() {
+  return _chilling.gain;
+}
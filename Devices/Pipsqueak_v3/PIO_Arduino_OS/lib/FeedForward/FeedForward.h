@@ -0,0 +1,84 @@
+#ifndef FeedForward_h
+#define FeedForward_h
+
+#include <Arduino.h>
+
+// learning pauses unless the temperature is this close to the setpoint
+#define FEED_FORWARD_LEARNING_BAND 0.25 // degrees C
+
+// coefficients are held until the gradient has varied at least this much
+#define FEED_FORWARD_MINIMUM_VARIANCE 0.25 // degrees C squared
+
+/**
+ * Estimates the output needed to hold the setpoint against heat
+ * exchanged with the surroundings, which is proportional to the
+ * gradient between the setpoint and the ambient temperature.
+ *
+ * The coefficient is learned rather than configured: whenever the
+ * temperature is close to the setpoint, the output holding it there
+ * is regressed against the gradient over a slow moving window. The
+ * slope is the coefficient; the intercept, which reflects loads
+ * that don't depend on the surroundings (e.g. the heat of an active
+ * ferment), is left to the integral term. Separate coefficients are
+ * learned for gradients that call for heating and for chilling, as
+ * the heater and chiller are unlikely to be equally powerful.
+ *
+ * Pure arithmetic: no I/O and no clock. The caller supplies the
+ * time elapsed between learning steps.
+ */
+class FeedForward {
+  public:
+    /**
+     * Constructor.
+     *
+     * timeConstant: seconds over which the coefficients adapt;
+     *               should span a full swing of the ambient
+     *               temperature, typically a day
+     * gainLimit: upper limit on the coefficients, output units
+     *            per degree C of gradient
+     */
+    FeedForward(float timeConstant, float gainLimit);
+
+    /**
+     * Returns the estimated output needed to hold the setpoint
+     * at the given ambient temperature: positive to heat, negative
+     * to chill. Returns 0 if the ambient temperature is NAN.
+     */
+    float compute(float setpoint, float ambient);
+
+    /**
+     * Folds the output applied over the last elapsedSeconds into
+     * the regression for the current gradient, provided the
+     * measurement is within FEED_FORWARD_LEARNING_BAND of the
+     * setpoint.
+     */
+    void learn(float output, float setpoint, float measurement, float ambient, float elapsedSeconds);
+
+    /**
+     * Replaces the learned coefficients and discards the
+     * observations they were learned from.
+     */
+    void setGains(float heatingGain, float chillingGain);
+
+    float getHeatingGain();
+    float getChillingGain();
+
+  private:
+    struct Regression {
+      uint32_t samples;
+      float meanGradient;
+      float meanOutput;
+      float variance;
+      float covariance;
+      float gain;
+    };
+
+    void observe(Regression * regression, float gradient, float output, float elapsedSeconds);
+
+    float _timeConstant;
+    float _gainLimit;
+    Regression _heating;
+    Regression _chilling;
+};
+
+#endif // FeedForward_h
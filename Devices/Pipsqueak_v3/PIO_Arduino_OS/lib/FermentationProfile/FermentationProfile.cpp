@@ -0,0 +1,72 @@
+#include "FermentationProfile.h"
+
+#define SECONDS_PER_HOUR 3600.0
+
+FermentationProfile::FermentationProfile()
+:
+  _profileID { 0 },
+  _segmentCount { 0 }
+{
+  memset(_segments, 0, sizeof(_segments));
+}
+
+void FermentationProfile::clear() {
+  _profileID = 0;
+  _segmentCount = 0;
+  memset(_segments, 0, sizeof(_segments));
+}
+
+bool FermentationProfile::load(uint32_t profileID, uint8_t segmentCount, const ProfileSegment * segments) {
+  if (segmentCount > PROFILE_SEGMENT_LIMIT) return false;
+  for (size_t i = 0; i < segmentCount; i++) {
+    if (!isfinite(segments[i].target)) return false;
+    if (!isfinite(segments[i].rampRate) || segments[i].rampRate < 0) return false;
+    if (i > 0 && segments[i].start <= segments[i - 1].start) return false;
+  }
+  clear();
+  if (profileID != 0 && segmentCount > 0) {
+    _profileID = profileID;
+    _segmentCount = segmentCount;
+    memcpy(_segments, segments, segmentCount * sizeof(ProfileSegment));
+  }
+  return true;
+}
+
+bool FermentationProfile::isLoaded() {
+  return _segmentCount > 0;
+}
+
+uint32_t FermentationProfile::getProfileID() {
+  return _profileID;
+}
+
+uint8_t FermentationProfile::getSegmentCount() {
+  return _segmentCount;
+}
+
+const ProfileSegment * FermentationProfile::getSegment(size_t index) {
+  return &_segments[index];
+}
+
+float FermentationProfile::evaluate(uint32_t timestamp) {
+  if (_segmentCount == 0 || timestamp < _segments[0].start) return NAN;
+
+  // Walk forward to the segment in effect, carrying the setpoint
+  // each segment had reached when the next one took over
+  float setpoint = _segments[0].target;
+  size_t current = 0;
+  while (current + 1 < _segmentCount && timestamp >= _segments[current + 1].start) {
+    setpoint = ramp(setpoint, &_segments[current], _segments[current + 1].start - _segments[current].start);
+    current += 1;
+  }
+  setpoint = ramp(setpoint, &_segments[current], timestamp - _segments[current].start);
+
+  return roundf(setpoint / PROFILE_SETPOINT_RESOLUTION) * PROFILE_SETPOINT_RESOLUTION;
+}
+
+float FermentationProfile::ramp(float from, const ProfileSegment * segment, uint32_t elapsed) {
+  if (segment->rampRate <= 0) return segment->target;
+  float change = segment->rampRate * (elapsed / SECONDS_PER_HOUR);
+  if (fabsf(segment->target - from) <= change) return segment->target;
+  return segment->target > from ? from + change : from - change;
+}
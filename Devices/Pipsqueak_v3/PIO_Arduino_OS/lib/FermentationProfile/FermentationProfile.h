@@ -0,0 +1,92 @@
+#ifndef FermentationProfile_h
+#define FermentationProfile_h
+
+#include <Arduino.h>
+
+#define PROFILE_SEGMENT_LIMIT 16
+
+// Matches the DS18B20's resolution, so a ramp changes the setpoint
+// no more often than the measurement can resolve the change.
+#define PROFILE_SETPOINT_RESOLUTION 0.0625
+
+/**
+ * One step of a fermentation profile. Beginning at the start
+ * time, the setpoint moves from wherever the previous segment
+ * left it toward the target at the ramp rate, then holds at the
+ * target until the next segment starts.
+ */
+struct ProfileSegment {
+  // seconds since Jan 1 1970
+  uint32_t start;
+  // degrees Celsius
+  float target;
+  // degrees Celsius per hour; 0 steps straight to the target
+  float rampRate;
+};
+
+/**
+ * A schedule of setpoint ramps and holds, evaluated locally so
+ * that it keeps running while the server is unreachable.
+ *
+ * Pure arithmetic: no I/O and no clock. The caller supplies
+ * the time at which to evaluate the profile.
+ */
+class FermentationProfile {
+  public:
+    FermentationProfile();
+
+    /**
+     * Discards all segments.
+     */
+    void clear();
+
+    /**
+     * Replaces the profile. Segments must be in order of strictly
+     * increasing start time, with finite targets and non-negative
+     * ramp rates.
+     *
+     * Returns false, leaving the current profile in place, if the
+     * segments are invalid. A profile ID or segment count of 0
+     * clears the profile.
+     */
+    bool load(uint32_t profileID, uint8_t segmentCount, const ProfileSegment * segments);
+
+    /**
+     * Indicates whether the profile has any segments.
+     */
+    bool isLoaded();
+
+    /**
+     * Returns the server-assigned ID of the profile, or 0 if
+     * none is loaded.
+     */
+    uint32_t getProfileID();
+
+    uint8_t getSegmentCount();
+
+    /**
+     * Returns the segment at the given index. Behavior is
+     * undefined if the index is not less than getSegmentCount().
+     */
+    const ProfileSegment * getSegment(size_t index);
+
+    /**
+     * Returns the setpoint in degrees Celsius at the given time,
+     * rounded to PROFILE_SETPOINT_RESOLUTION, or NAN if no
+     * profile is loaded or the first segment has yet to start.
+     *
+     * The first segment steps straight to its target; there is
+     * no earlier segment to ramp from. After the final segment's
+     * target is reached, it is held indefinitely.
+     */
+    float evaluate(uint32_t timestamp);
+
+  private:
+    uint32_t _profileID;
+    uint8_t _segmentCount;
+    ProfileSegment _segments[PROFILE_SEGMENT_LIMIT];
+
+    float ramp(float from, const ProfileSegment * segment, uint32_t elapsed);
+};
+
+#endif // FermentationProfile_h
@@ -1,4 +1,5 @@
 #include "Hmac.h"
+#include <Profiler.h>
 
 const uint32_t sha256K[] = {
   0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
@@ -41,6 +42,7 @@ bool Hmac::validate(const byte * messageContent, size_t messageContentLength, co
 // frequently to avoid watchdog timeouts and to keep timing-sensitive processes (e.g. the
 // wifi stack) happy
 void Hmac::compute(const byte * messageContent, size_t messageContentLength) {
+  PROFILER_SCOPE(PROFILER_SLOT_HMAC_COMPUTE);
   // Start inner hash
   init();
   size_t i;
@@ -0,0 +1,71 @@
+#include "MemoryMonitor.h"
+
+MemoryMonitor::MemoryMonitor(PipsqueakState * pipsqueakState)
+:
+  _state { pipsqueakState },
+  _lastReport { 0 }
+{
+  clear(&_period);
+  clear(&_boot);
+}
+
+void MemoryMonitor::schedule(Scheduler * scheduler) {
+  _lastReport = millis();
+  scheduler->every("memory", MEMORY_SAMPLE_INTERVAL, [](void * memory) { ((MemoryMonitor *) memory)->loop(); }, this);
+}
+
+void MemoryMonitor::loop() {
+  sample();
+  if (_state->isClockSynchronized() && millis() - _lastReport >= MEMORY_REPORT_INTERVAL) {
+    _lastReport = millis();
+    report();
+  }
+}
+
+void MemoryMonitor::sample() {
+  uint32_t freeHeap = ESP.getFreeHeap();
+  uint32_t maxFreeBlock = ESP.getMaxFreeBlockSize();
+  uint8_t fragmentation = ESP.getHeapFragmentation();
+  uint32_t freeStack = ESP.getFreeContStack();
+  lower(&_period, freeHeap, maxFreeBlock, fragmentation, freeStack);
+  lower(&_boot, freeHeap, maxFreeBlock, fragmentation, freeStack);
+}
+
+void MemoryMonitor::reset() {
+  clear(&_period);
+  ESP.resetFreeContStack();
+}
+
+const MemoryLowWater * MemoryMonitor::getPeriodLowWater() {
+  return &_period;
+}
+
+const MemoryLowWater * MemoryMonitor::getBootLowWater() {
+  return &_boot;
+}
+
+void MemoryMonitor::report() {
+  #ifdef DEBUG_MEMORY_MONITOR
+  Serial.printf("MemoryMonitor.report(): %u samples\n", _period.sampleCount);
+  #endif
+  if (_period.sampleCount > 0) {
+    _state->recordMemoryLowWater(_period.freeHeap, _period.maxFreeBlock, _period.fragmentation, _period.freeStack);
+  }
+  reset();
+}
+
+void MemoryMonitor::clear(MemoryLowWater * lowWater) {
+  lowWater->freeHeap = UINT32_MAX;
+  lowWater->maxFreeBlock = UINT32_MAX;
+  lowWater->fragmentation = 0;
+  lowWater->freeStack = UINT32_MAX;
+  lowWater->sampleCount = 0;
+}
+
+void MemoryMonitor::lower(MemoryLowWater * lowWater, uint32_t freeHeap, uint32_t maxFreeBlock, uint8_t fragmentation, uint32_t freeStack) {
+  lowWater->freeHeap = min(lowWater->freeHeap, freeHeap);
+  lowWater->maxFreeBlock = min(lowWater->maxFreeBlock, maxFreeBlock);
+  lowWater->fragmentation = max(lowWater->fragmentation, fragmentation);
+  lowWater->freeStack = min(lowWater->freeStack, freeStack);
+  lowWater->sampleCount += 1;
+}
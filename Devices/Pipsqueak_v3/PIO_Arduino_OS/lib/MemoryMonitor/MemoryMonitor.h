@@ -0,0 +1,81 @@
+#ifndef MemoryMonitor_h
+#define MemoryMonitor_h
+
+#include <Arduino.h>
+#include <PipsqueakState.h>
+#include <Scheduler.h>
+
+#define MEMORY_SAMPLE_INTERVAL 1000 // ms
+#define MEMORY_REPORT_INTERVAL 3600000 // ms
+
+// Un-comment to enable debug statements via Serial
+// #define DEBUG_MEMORY_MONITOR
+
+/**
+ * The worst of the samples taken over a period.
+ */
+struct MemoryLowWater {
+  uint32_t freeHeap;      // least free heap, bytes
+  uint32_t maxFreeBlock;  // smallest largest free block, bytes
+  uint8_t fragmentation;  // highest fragmentation, %
+  uint32_t freeStack;     // least of the loop's stack never used, bytes
+  uint32_t sampleCount;
+};
+
+/**
+ * Samples the heap and the loop's stack every
+ * MEMORY_SAMPLE_INTERVAL ms, keeping their low-water marks both
+ * since boot and since the last report. Every
+ * MEMORY_REPORT_INTERVAL ms, once the clock is synchronized, the
+ * period's marks are recorded as a status event and start over.
+ *
+ * The heap is sampled between tasks, so an allocation made and
+ * freed within a task goes unseen. The stack's mark is the esp8266
+ * core's: the depth the loop's stack has ever reached, found from
+ * the pattern it was painted with, so nothing is missed there. The
+ * SDK's system stack isn't covered.
+ */
+class MemoryMonitor {
+  public:
+    /**
+     * Constructor.
+     *
+     * pipsqueakState: ptr to singleton application instance
+     */
+    MemoryMonitor(PipsqueakState * pipsqueakState);
+
+    /**
+     * Registers a task that samples every MEMORY_SAMPLE_INTERVAL ms.
+     */
+    void schedule(Scheduler * scheduler);
+
+    /** Invoked by the task registered via schedule(). */
+    void loop();
+
+    /** Samples the heap and stack, lowering the marks as need be. */
+    void sample();
+
+    /**
+     * Starts the period's marks over, and the stack's, from the
+     * depth it's at now.
+     */
+    void reset();
+
+    /** The marks since the last report. */
+    const MemoryLowWater * getPeriodLowWater();
+
+    /** The marks since boot. */
+    const MemoryLowWater * getBootLowWater();
+
+  private:
+    PipsqueakState * _state;
+    uint32_t _lastReport;
+    MemoryLowWater _period;
+    MemoryLowWater _boot;
+
+    void report();
+    static void clear(MemoryLowWater * lowWater);
+    static void lower(MemoryLowWater * lowWater, uint32_t freeHeap, uint32_t maxFreeBlock, uint8_t fragmentation, uint32_t freeStack);
+};
+
+#endif // MemoryMonitor_h
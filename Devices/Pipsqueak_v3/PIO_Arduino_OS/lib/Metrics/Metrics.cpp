@@ -0,0 +1,164 @@
+#include "Metrics.h"
+
+struct MetricDefinition {
+  const char * name;
+  MetricKind kind;
+  // histograms: the upper bounds of all but the last bucket
+  uint32_t bounds[METRIC_BUCKET_COUNT - 1];
+  // counters: whether a period's count may pass 65535, so that it
+  // takes two snapshot slots
+  bool wide;
+};
+
+static const MetricDefinition metricDefinitions[METRIC_COUNT] = {
+  { "client.requestsSent", MetricCounter, {} },
+  { "client.bytesSent", MetricCounter, {}, true },
+  { "client.bytesReceived", MetricCounter, {}, true },
+  { "client.requestFailures", MetricCounter, {} },
+  { "client.requestRetries", MetricCounter, {} },
+  { "client.requestsDropped", MetricCounter, {} },
+  { "client.roundTripMillis", MetricHistogram, { 250, 1000, 4000 } },
+  { "client.wifiReconnects", MetricCounter, {} },
+  { "ds18b20.crcFailures", MetricCounter, {} },
+  { "controller.heaterPulses", MetricCounter, {} },
+  { "controller.chillerPulses", MetricCounter, {} },
+  { "state.statusEventsDropped", MetricCounter, {} },
+  { "state.statusQueueDepth", MetricGauge, {} },
+  { "config.persists", MetricCounter, {} },
+  { "configJournal.flashErases", MetricCounter, {} }
+};
+
+uint32_t Metrics::_values[METRIC_COUNT][METRIC_BUCKET_COUNT];
+
+static uint16_t saturate(uint32_t value) {
+  return (uint16_t) min(value, (uint32_t) UINT16_MAX);
+}
+
+void Metrics::increment(uint8_t metric, uint32_t amount) {
+  if (metric >= METRIC_COUNT || metricDefinitions[metric].kind != MetricCounter) return;
+  _values[metric][0] += amount;
+  _values[metric][1] += amount;
+}
+
+void Metrics::set(uint8_t metric, uint32_t value) {
+  if (metric >= METRIC_COUNT || metricDefinitions[metric].kind != MetricGauge) return;
+  _values[metric][0] = value;
+  if (value > _values[metric][1]) _values[metric][1] = value;
+}
+
+void Metrics::observe(uint8_t metric, uint32_t value) {
+  if (metric >= METRIC_COUNT || metricDefinitions[metric].kind != MetricHistogram) return;
+  uint8_t bucket = 0;
+  while (bucket < METRIC_BUCKET_COUNT - 1 && value >= metricDefinitions[metric].bounds[bucket]) bucket++;
+  _values[metric][bucket] += 1;
+}
+
+void Metrics::reset() {
+  for (uint8_t metric = 0; metric < METRIC_COUNT; metric++) {
+    switch (metricDefinitions[metric].kind) {
+      case MetricCounter:
+        _values[metric][0] = 0;
+        break;
+      case MetricGauge:
+        _values[metric][1] = _values[metric][0];
+        break;
+      case MetricHistogram:
+        memset(_values[metric], 0, sizeof(_values[metric]));
+        break;
+    }
+  }
+}
+
+const char * Metrics::getName(uint8_t metric) {
+  if (metric >= METRIC_COUNT) return NULL;
+  return metricDefinitions[metric].name;
+}
+
+MetricKind Metrics::getKind(uint8_t metric) {
+  if (metric >= METRIC_COUNT) return MetricCounter;
+  return metricDefinitions[metric].kind;
+}
+
+uint32_t Metrics::getValue(uint8_t metric) {
+  if (metric >= METRIC_COUNT || metricDefinitions[metric].kind == MetricHistogram) return 0;
+  return _values[metric][0];
+}
+
+uint32_t Metrics::getExtent(uint8_t metric) {
+  if (metric >= METRIC_COUNT || metricDefinitions[metric].kind == MetricHistogram) return 0;
+  return _values[metric][1];
+}
+
+uint32_t Metrics::getBucketCount(uint8_t metric, uint8_t bucket) {
+  if (metric >= METRIC_COUNT || metricDefinitions[metric].kind != MetricHistogram) return 0;
+  if (bucket >= METRIC_BUCKET_COUNT) return 0;
+  return _values[metric][bucket];
+}
+
+uint32_t Metrics::getBucketBound(uint8_t metric, uint8_t bucket) {
+  if (metric >= METRIC_COUNT || metricDefinitions[metric].kind != MetricHistogram) return 0;
+  if (bucket >= METRIC_BUCKET_COUNT - 1) return UINT32_MAX;
+  return metricDefinitions[metric].bounds[bucket];
+}
+
+bool Metrics::isActive(uint8_t metric) {
+  if (metric >= METRIC_COUNT) return false;
+  switch (metricDefinitions[metric].kind) {
+    case MetricCounter:
+      return _values[metric][0] > 0;
+    case MetricGauge:
+      return true;
+    default:
+      for (uint8_t bucket = 0; bucket < METRIC_BUCKET_COUNT; bucket++) {
+        if (_values[metric][bucket] > 0) return true;
+      }
+      return false;
+  }
+}
+
+uint8_t Metrics::getSnapshotSize() {
+  uint16_t slots[METRIC_SLOT_LIMIT];
+  uint8_t size = 0;
+  for (uint8_t metric = 0; metric < METRIC_COUNT; metric++) {
+    size += getSlots(metric, slots);
+  }
+  return size;
+}
+
+uint8_t Metrics::readSnapshot(uint8_t start, uint16_t * slots, uint8_t count) {
+  memset(slots, 0, count * sizeof(uint16_t));
+  uint16_t metricSlots[METRIC_SLOT_LIMIT];
+  uint8_t slot = 0;
+  uint8_t read = 0;
+  for (uint8_t metric = 0; metric < METRIC_COUNT; metric++) {
+    uint8_t metricSlotCount = getSlots(metric, metricSlots);
+    for (uint8_t i = 0; i < metricSlotCount; i++, slot++) {
+      if (slot < start || slot - start >= count) continue;
+      slots[slot - start] = metricSlots[i];
+      read++;
+    }
+  }
+  return read;
+}
+
+uint8_t Metrics::getSlots(uint8_t metric, uint16_t * slots) {
+  switch (metricDefinitions[metric].kind) {
+    case MetricCounter:
+      if (!metricDefinitions[metric].wide) {
+        slots[0] = saturate(_values[metric][0]);
+        return 1;
+      }
+      slots[0] = (uint16_t) _values[metric][0];
+      slots[1] = (uint16_t) (_values[metric][0] >> 16);
+      return 2;
+    case MetricGauge:
+      slots[0] = saturate(_values[metric][0]);
+      slots[1] = saturate(_values[metric][1]);
+      return 2;
+    default:
+      for (uint8_t bucket = 0; bucket < METRIC_BUCKET_COUNT; bucket++) {
+        slots[bucket] = saturate(_values[metric][bucket]);
+      }
+      return METRIC_BUCKET_COUNT;
+  }
+}
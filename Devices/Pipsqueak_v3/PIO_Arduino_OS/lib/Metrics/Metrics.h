@@ -0,0 +1,130 @@
+#ifndef Metrics_h
+#define Metrics_h
+
+#include <Arduino.h>
+
+// Registered metrics, declared in Metrics.cpp; the IDs order the
+// slots of metric snapshots, so append new metrics rather than renumber
+#define METRIC_REQUESTS_SENT 0
+#define METRIC_BYTES_SENT 1
+#define METRIC_BYTES_RECEIVED 2
+#define METRIC_REQUEST_FAILURES 3
+#define METRIC_REQUEST_RETRIES 4
+#define METRIC_REQUESTS_DROPPED 5
+#define METRIC_ROUND_TRIP 6
+#define METRIC_WIFI_RECONNECTS 7
+#define METRIC_SENSOR_CRC_FAILURES 8
+#define METRIC_HEATER_PULSES 9
+#define METRIC_CHILLER_PULSES 10
+#define METRIC_STATUS_EVENTS_DROPPED 11
+#define METRIC_STATUS_QUEUE_DEPTH 12
+#define METRIC_CONFIG_PERSISTS 13
+#define METRIC_FLASH_ERASES 14
+#define METRIC_COUNT 15
+
+// a histogram's buckets; all but the last have an upper bound
+#define METRIC_BUCKET_COUNT 4
+
+// the most 16-bit snapshot slots one metric takes
+#define METRIC_SLOT_LIMIT METRIC_BUCKET_COUNT
+
+enum MetricKind : uint8_t {
+  // counts events: how many this period, and since boot
+  MetricCounter = 0,
+  // tracks a level: its latest value, and its peak this period
+  MetricGauge = 1,
+  // counts values into fixed buckets this period
+  MetricHistogram = 2
+};
+
+/**
+ * A registry of operational counters, gauges and histograms, each
+ * declared at compile time with a fixed ID, in one static array of
+ * METRIC_BUCKET_COUNT words per metric.
+ *
+ * Updating a metric costs a few cycles and no heap, so metrics are
+ * always on. PipsqueakState reports a snapshot of them all, packed
+ * into a few metric status events, every METRICS_REPORT_INTERVAL,
+ * then starts a new period; the main program dumps them to Serial
+ * on request.
+ *
+ * Not ISR safe.
+ */
+class Metrics {
+  public:
+    /** Adds to a counter. Ignores other metrics. */
+    static void increment(uint8_t metric, uint32_t amount = 1);
+
+    /** Sets a gauge's value. Ignores other metrics. */
+    static void set(uint8_t metric, uint32_t value);
+
+    /** Counts a value into a histogram's bucket. Ignores other metrics. */
+    static void observe(uint8_t metric, uint32_t value);
+
+    /**
+     * Starts a new period: zeroes counters' counts for the period,
+     * gauges' peaks, and histograms. Counters' totals are kept.
+     */
+    static void reset();
+
+    /** Returns the metric's human-readable name, or NULL if unknown. */
+    static const char * getName(uint8_t metric);
+
+    /** Returns the metric's kind; MetricCounter if unknown. */
+    static MetricKind getKind(uint8_t metric);
+
+    /**
+     * Returns a counter's count this period, or a gauge's latest
+     * value; 0 for histograms and unknown metrics.
+     */
+    static uint32_t getValue(uint8_t metric);
+
+    /**
+     * Returns a counter's total since boot, or a gauge's peak this
+     * period; 0 for histograms and unknown metrics.
+     */
+    static uint32_t getExtent(uint8_t metric);
+
+    /** Returns how many values a histogram counted this period into the bucket. */
+    static uint32_t getBucketCount(uint8_t metric, uint8_t bucket);
+
+    /**
+     * Returns the upper bound of the histogram's bucket, exclusive;
+     * UINT32_MAX for the last bucket.
+     */
+    static uint32_t getBucketBound(uint8_t metric, uint8_t bucket);
+
+    /**
+     * Returns whether anything was counted into the metric this
+     * period; always so for gauges.
+     */
+    static bool isActive(uint8_t metric);
+
+    /**
+     * Returns how many 16-bit slots a snapshot of every metric
+     * takes. Each metric takes its slots in the order of the IDs:
+     *
+     * counter: its count this period, saturating at 65535; a wide
+     *          counter's count takes two slots, low word first
+     * gauge: its latest value and its peak this period, saturating
+     * histogram: its bucket counts this period, saturating
+     */
+    static uint8_t getSnapshotSize();
+
+    /**
+     * Fills slots with count slots of the snapshot, from slot
+     * start on, zeroing any past its end. Returns how many came
+     * from the snapshot.
+     */
+    static uint8_t readSnapshot(uint8_t start, uint16_t * slots, uint8_t count);
+
+  private:
+    /** Fills slots with the metric's snapshot slots and returns how many. */
+    static uint8_t getSlots(uint8_t metric, uint16_t * slots);
+
+    // counters: count this period, total; gauges: value, peak;
+    // histograms: bucket counts
+    static uint32_t _values[METRIC_COUNT][METRIC_BUCKET_COUNT];
+};
+
+#endif // Metrics_h
@@ -0,0 +1,71 @@
+#include "MonitorBatch.h"
+
+MonitorBatch::MonitorBatch()
+:
+  _clock { 0 },
+  _wakeCount { 0 },
+  _sampleCount { 0 }
+{
+  memset(_sensorAddress, 0, MONITOR_BATCH_ADDRESS_SIZE);
+  memset(_samples, 0, sizeof(_samples));
+}
+
+void MonitorBatch::clear() {
+  _clock = 0;
+  _sampleCount = 0;
+}
+
+void MonitorBatch::advance(uint32_t elapsedMillis) {
+  _clock += elapsedMillis;
+}
+
+uint32_t MonitorBatch::getClock() {
+  return _clock;
+}
+
+void MonitorBatch::append(float temperature) {
+  if (isFull()) {
+    memmove(&_samples[0], &_samples[1], (MONITOR_BATCH_LIMIT - 1) * sizeof(Sample));
+    _sampleCount -= 1;
+  }
+  _samples[_sampleCount] = { _clock, temperature };
+  _sampleCount += 1;
+}
+
+size_t MonitorBatch::getSampleCount() {
+  return _sampleCount;
+}
+
+bool MonitorBatch::isFull() {
+  return _sampleCount >= MONITOR_BATCH_LIMIT;
+}
+
+float MonitorBatch::getTemperature(size_t index) {
+  if (index >= _sampleCount) return NAN;
+  return _samples[index].temperature;
+}
+
+uint32_t MonitorBatch::getTimestamp(size_t index, uint32_t now) {
+  if (index >= _sampleCount) return 0;
+  return now - (_clock - _samples[index].clock) / 1000;
+}
+
+void MonitorBatch::countWake() {
+  if (_wakeCount < UINT16_MAX) _wakeCount += 1;
+}
+
+void MonitorBatch::resetWakeCount() {
+  _wakeCount = 0;
+}
+
+uint16_t MonitorBatch::getWakeCount() {
+  return _wakeCount;
+}
+
+const uint8_t * MonitorBatch::getSensorAddress() {
+  return _sensorAddress;
+}
+
+void MonitorBatch::setSensorAddress(const uint8_t * address) {
+  memcpy(_sensorAddress, address, MONITOR_BATCH_ADDRESS_SIZE);
+}
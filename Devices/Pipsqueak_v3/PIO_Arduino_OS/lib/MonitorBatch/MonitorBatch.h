@@ -0,0 +1,91 @@
+#ifndef MonitorBatch_h
+#define MonitorBatch_h
+
+#include <Arduino.h>
+
+// samples held between flushes; the oldest are dropped beyond this
+#define MONITOR_BATCH_LIMIT 32
+
+#define MONITOR_BATCH_ADDRESS_SIZE 8
+
+/**
+ * The temperature samples a monitor-mode Pipsqueak collects across
+ * deep sleeps, kept in RTC memory between wakes.
+ *
+ * The device clock doesn't survive deep sleep, so samples are timed
+ * by a batch clock that the caller advances by the time spent awake
+ * and asleep. Once the clock is synchronized, a sample's Unix
+ * timestamp is found by counting back from the current time.
+ *
+ * Plain data with no pointers, so that it may be copied to and from
+ * RTC memory as is. Pure arithmetic: no I/O.
+ */
+class MonitorBatch {
+  public:
+    MonitorBatch();
+
+    /**
+     * Discards the samples and restarts the batch clock. The
+     * wake count and sensor address are kept.
+     */
+    void clear();
+
+    /**
+     * Advances the batch clock, e.g. by the time spent awake plus
+     * the time about to be spent asleep.
+     */
+    void advance(uint32_t elapsedMillis);
+
+    /**
+     * Returns the batch clock, in ms since the batch began.
+     */
+    uint32_t getClock();
+
+    /**
+     * Appends a sample at the current batch clock, dropping the
+     * oldest sample if the batch is full.
+     */
+    void append(float temperature);
+
+    size_t getSampleCount();
+    bool isFull();
+
+    /**
+     * Returns the temperature of the given sample, oldest first.
+     */
+    float getTemperature(size_t index);
+
+    /**
+     * Returns the Unix timestamp of the given sample, given the
+     * current Unix time.
+     */
+    uint32_t getTimestamp(size_t index, uint32_t now);
+
+    /**
+     * Counts wakes since the last flush.
+     */
+    void countWake();
+    void resetWakeCount();
+    uint16_t getWakeCount();
+
+    /**
+     * The address of the sensor sampled, cached so that later
+     * wakes needn't search the bus. All zeros if unknown.
+     */
+    const uint8_t * getSensorAddress();
+    void setSensorAddress(const uint8_t * address);
+
+  private:
+    struct Sample {
+      uint32_t clock;
+      float temperature;
+    };
+
+    uint32_t _clock;
+    uint16_t _wakeCount;
+    uint16_t _sampleCount;
+    uint8_t _sensorAddress[MONITOR_BATCH_ADDRESS_SIZE];
+    Sample _samples[MONITOR_BATCH_LIMIT];
+};
+
+#endif // MonitorBatch_h
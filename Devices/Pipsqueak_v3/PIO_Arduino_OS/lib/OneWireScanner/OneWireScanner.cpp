@@ -0,0 +1,204 @@
+#include "OneWireScanner.h"
+
+#define COMMAND_SEARCH_ROM          0xF0
+
+#define ONE_WIRE_ADDRESS_BITS       64
+#define INDEX_CRC                   7
+
+OneWireScanner::OneWireScanner(OneWire * oneWire)
+:
+  _phase { Waiting },
+  _sweepEndMillis { 0 },
+  _firstSweep { true },
+  _lastDiscrepancy { 0 },
+  _lastZero { 0 },
+  _idBitNumber { 1 },
+  _deviceCount { 0 }
+{
+  _oneWire = oneWire;
+  memset(_romNo, 0, ONE_WIRE_ADDRESS_SIZE);
+  memset(_addresses, 0, ONE_WIRE_SCANNER_CAPACITY * ONE_WIRE_ADDRESS_SIZE);
+  memset(_missedSweeps, 0, ONE_WIRE_SCANNER_CAPACITY);
+  memset(_seen, 0, ONE_WIRE_SCANNER_CAPACITY);
+}
+
+bool OneWireScanner::step() {
+  switch (_phase) {
+    case Waiting:
+      if (!_firstSweep && millis() - _sweepEndMillis < ONE_WIRE_SCANNER_SWEEP_INTERVAL) return false;
+      memset(_romNo, 0, ONE_WIRE_ADDRESS_SIZE);
+      memset(_seen, 0, ONE_WIRE_SCANNER_CAPACITY);
+      _lastDiscrepancy = 0;
+      _phase = Reset;
+      return false;
+    case Reset:
+      if (!_oneWire->reset()) {
+        #ifdef DEBUG_ONE_WIRE_SCANNER
+        Serial.println("OneWireScanner.step(): no presence pulse; bus is empty");
+        #endif
+        sweepComplete(true);
+        return true;
+      }
+      _phase = Command;
+      return false;
+    case Command:
+      _oneWire->write(COMMAND_SEARCH_ROM);
+      _idBitNumber = 1;
+      _lastZero = 0;
+      _phase = Search;
+      return false;
+    case Search:
+      searchBits();
+      return _phase == Waiting;
+  }
+  return false;
+}
+
+void OneWireScanner::interrupt() {
+  // The pass restarts from the same last discrepancy, so it retraces the
+  // same branch of the ROM tree
+  if (_phase == Command || _phase == Search) _phase = Reset;
+}
+
+bool OneWireScanner::isSweeping() {
+  return _phase != Waiting;
+}
+
+uint32_t OneWireScanner::getMillisUntilSweep() {
+  if (isSweeping() || _firstSweep) return 0;
+  uint32_t elapsed = millis() - _sweepEndMillis;
+  return elapsed < ONE_WIRE_SCANNER_SWEEP_INTERVAL ? ONE_WIRE_SCANNER_SWEEP_INTERVAL - elapsed : 0;
+}
+
+size_t OneWireScanner::getDeviceCount() {
+  return _deviceCount;
+}
+
+const byte * OneWireScanner::getDeviceAddress(size_t index) {
+  if (index >= _deviceCount) return NULL;
+  return &_addresses[index * ONE_WIRE_ADDRESS_SIZE];
+}
+
+bool OneWireScanner::isPresent(const byte * address) {
+  return indexOf(address) >= 0;
+}
+
+void OneWireScanner::searchBits() {
+  for (uint8_t i = 0; i < ONE_WIRE_SCANNER_BITS_PER_STEP; i++) {
+    uint8_t romByteNumber = (_idBitNumber - 1) / 8;
+    byte romByteMask = 1 << ((_idBitNumber - 1) % 8);
+    uint8_t idBit = _oneWire->read_bit();
+    uint8_t cmpIdBit = _oneWire->read_bit();
+    uint8_t direction;
+
+    if (idBit && cmpIdBit) {
+      // no device participated; one was likely unplugged mid-pass
+      #ifdef DEBUG_ONE_WIRE_SCANNER
+      Serial.printf("OneWireScanner.searchBits(): no response at bit %u; sweep abandoned\n", _idBitNumber);
+      #endif
+      sweepComplete(false);
+      return;
+    }
+
+    if (idBit != cmpIdBit) {
+      direction = idBit;
+    } else {
+      if (_idBitNumber < _lastDiscrepancy) {
+        direction = (_romNo[romByteNumber] & romByteMask) > 0;
+      } else {
+        direction = _idBitNumber == _lastDiscrepancy;
+      }
+      if (direction == 0) _lastZero = _idBitNumber;
+    }
+
+    if (direction) {
+      _romNo[romByteNumber] |= romByteMask;
+    } else {
+      _romNo[romByteNumber] &= ~romByteMask;
+    }
+    _oneWire->write_bit(direction);
+
+    if (_idBitNumber == ONE_WIRE_ADDRESS_BITS) {
+      passComplete();
+      return;
+    }
+    _idBitNumber += 1;
+  }
+}
+
+void OneWireScanner::passComplete() {
+  _lastDiscrepancy = _lastZero;
+  if (OneWire::crc8(_romNo, INDEX_CRC) == _romNo[INDEX_CRC]) {
+    deviceFound();
+  } else {
+    #ifdef DEBUG_ONE_WIRE_SCANNER
+    Serial.println("OneWireScanner.passComplete(): address fails CRC check");
+    #endif
+  }
+  if (_lastDiscrepancy == 0) {
+    sweepComplete(true);
+  } else {
+    _phase = Reset;
+  }
+}
+
+void OneWireScanner::sweepComplete(bool successful) {
+  if (successful) {
+    size_t i = 0;
+    while (i < _deviceCount) {
+      if (_seen[i]) {
+        _missedSweeps[i] = 0;
+      } else {
+        _missedSweeps[i] += 1;
+      }
+      if (_missedSweeps[i] >= ONE_WIRE_SCANNER_MISSED_SWEEP_LIMIT) {
+        #ifdef DEBUG_ONE_WIRE_SCANNER
+        Serial.printf("OneWireScanner.sweepComplete(): device %u removed\n", i);
+        #endif
+        removeDevice(i);
+      } else {
+        i += 1;
+      }
+    }
+  }
+  _sweepEndMillis = millis();
+  _firstSweep = false;
+  _phase = Waiting;
+}
+
+void OneWireScanner::deviceFound() {
+  int index = indexOf(_romNo);
+  if (index >= 0) {
+    _seen[index] = true;
+    return;
+  }
+  if (_deviceCount >= ONE_WIRE_SCANNER_CAPACITY) {
+    #ifdef DEBUG_ONE_WIRE_SCANNER
+    Serial.println("OneWireScanner.deviceFound(): device table is full");
+    #endif
+    return;
+  }
+  #ifdef DEBUG_ONE_WIRE_SCANNER
+  Serial.printf("OneWireScanner.deviceFound(): device %u added\n", _deviceCount);
+  #endif
+  memcpy(&_addresses[_deviceCount * ONE_WIRE_ADDRESS_SIZE], _romNo, ONE_WIRE_ADDRESS_SIZE);
+  _missedSweeps[_deviceCount] = 0;
+  _seen[_deviceCount] = true;
+  _deviceCount += 1;
+}
+
+int OneWireScanner::indexOf(const byte * address) {
+  for (size_t i = 0; i < _deviceCount; i++) {
+    if (memcmp(&_addresses[i * ONE_WIRE_ADDRESS_SIZE], address, ONE_WIRE_ADDRESS_SIZE) == 0) return i;
+  }
+  return -1;
+}
+
+void OneWireScanner::removeDevice(size_t index) {
+  for (size_t i = index; i + 1 < _deviceCount; i++) {
+    memcpy(&_addresses[i * ONE_WIRE_ADDRESS_SIZE], &_addresses[(i + 1) * ONE_WIRE_ADDRESS_SIZE], ONE_WIRE_ADDRESS_SIZE);
+    _missedSweeps[i] = _missedSweeps[i + 1];
+    _seen[i] = _seen[i + 1];
+  }
+  _deviceCount -= 1;
+}
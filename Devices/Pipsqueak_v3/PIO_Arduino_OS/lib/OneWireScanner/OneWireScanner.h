@@ -0,0 +1,113 @@
+#ifndef OneWireScanner_h
+#define OneWireScanner_h
+
+#include <Arduino.h>
+#include <OneWire.h>
+
+#define ONE_WIRE_ADDRESS_SIZE 8
+
+// maximum number of devices tracked as present on the bus
+#define ONE_WIRE_SCANNER_CAPACITY 4
+
+// ROM bits resolved per call to step(); each bit costs three time slots (~200us)
+#define ONE_WIRE_SCANNER_BITS_PER_STEP 4
+
+// delay between the end of one sweep and the beginning of the next
+#define ONE_WIRE_SCANNER_SWEEP_INTERVAL 5000 // ms
+
+// consecutive sweeps a device may go unseen before it is considered absent
+#define ONE_WIRE_SCANNER_MISSED_SWEEP_LIMIT 2
+
+// Un-comment to enable detailed debug statements
+// #define DEBUG_ONE_WIRE_SCANNER true
+
+/**
+ * Performs the 1-Wire ROM search incrementally, a few bits per
+ * call to step(), so that hot-plugged devices are noticed without
+ * blocking the main loop for an entire sweep of the bus.
+ *
+ * No single call to step() performs more than one reset pulse,
+ * one command byte, or ONE_WIRE_SCANNER_BITS_PER_STEP search bits,
+ * whichever applies.
+ *
+ * Maintains a table of devices seen by recent sweeps. A device is
+ * dropped from the table after it goes unseen for
+ * ONE_WIRE_SCANNER_MISSED_SWEEP_LIMIT consecutive sweeps.
+ *
+ * The bus must not be used for anything else while a search pass
+ * is in progress; call interrupt() after any other bus traffic so
+ * that the pass in flight is restarted.
+ */
+class OneWireScanner {
+  public:
+    OneWireScanner(OneWire * oneWire);
+
+    /**
+     * Advances the search by a bounded amount of bus activity.
+     * Does nothing while waiting for the next sweep to fall due.
+     *
+     * Returns true when a sweep has just completed, and thus when
+     * the table of present devices may have changed.
+     */
+    bool step();
+
+    /**
+     * Abandons the search pass in progress, if any, so that it is
+     * restarted from its reset pulse on the next step. Invoke after
+     * any other use of the bus.
+     */
+    void interrupt();
+
+    /**
+     * Indicates whether a sweep is in progress.
+     */
+    bool isSweeping();
+
+    /**
+     * Returns the number of milliseconds until the next sweep
+     * falls due, or 0 if a sweep is due or in progress.
+     */
+    uint32_t getMillisUntilSweep();
+
+    /**
+     * Returns the number of devices in the table.
+     */
+    size_t getDeviceCount();
+
+    /**
+     * Returns the address of the device at the given index in the
+     * table, or NULL if the index is out of range.
+     */
+    const byte * getDeviceAddress(size_t index);
+
+    /**
+     * Indicates whether a device with the given address is in the
+     * table.
+     */
+    bool isPresent(const byte * address);
+
+  private:
+    enum Phase { Waiting, Reset, Command, Search };
+
+    OneWire * _oneWire;
+    Phase _phase;
+    uint32_t _sweepEndMillis;
+    bool _firstSweep;
+    byte _romNo[ONE_WIRE_ADDRESS_SIZE];
+    uint8_t _lastDiscrepancy;
+    uint8_t _lastZero;
+    uint8_t _idBitNumber;
+    byte _addresses[ONE_WIRE_SCANNER_CAPACITY * ONE_WIRE_ADDRESS_SIZE];
+    uint8_t _missedSweeps[ONE_WIRE_SCANNER_CAPACITY];
+    bool _seen[ONE_WIRE_SCANNER_CAPACITY];
+    size_t _deviceCount;
+
+    void searchBits();
+    void passComplete();
+    void sweepComplete(bool successful);
+    void deviceFound();
+    int indexOf(const byte * address);
+    void removeDevice(size_t index);
+};
+
+#endif // OneWireScanner_h
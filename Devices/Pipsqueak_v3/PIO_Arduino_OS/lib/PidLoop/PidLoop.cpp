@@ -0,0 +1,77 @@
+#include "PidLoop.h"
+
+PidLoop::PidLoop(float kp, float ki, float kd, float outputMin, float outputMax)
+:
+  _kp { kp },
+  _ki { ki },
+  _kd { kd },
+  _outputMin { outputMin },
+  _outputMax { outputMax },
+  _integral { 0 },
+  _previousMeasurement { 0 },
+  _output { 0 },
+  _primed { false }
+{
+}
+
+void PidLoop::setGains(float kp, float ki, float kd) {
+  _kp = kp;
+  _ki = ki;
+  _kd = kd;
+}
+
+float PidLoop::getKp() {
+  return _kp;
+}
+
+float PidLoop::getKi() {
+  return _ki;
+}
+
+float PidLoop::getKd() {
+  return _kd;
+}
+
+void PidLoop::reset() {
+  _integral = 0;
+  _output = 0;
+  _primed = false;
+}
+
+float PidLoop::update(float setpoint, float measurement, float elapsedSeconds, float feedForward) {
+  float error = setpoint - measurement;
+
+  // Differentiate the measurement rather than the error so that
+  // setpoint changes don't kick the output
+  float derivative = 0;
+  if (_primed && elapsedSeconds > 0) {
+    derivative = -_kd * (measurement - _previousMeasurement) / elapsedSeconds;
+  }
+  _previousMeasurement = measurement;
+  _primed = true;
+
+  float proportional = _kp * error;
+  float integral = _integral + _ki * error * elapsedSeconds;
+  float output = proportional + integral + derivative + feedForward;
+
+  // Only accumulate when doing so doesn't drive further into saturation
+  if (!(output > _outputMax && error > 0) && !(output < _outputMin && error < 0)) {
+    _integral = constrain(integral, _outputMin, _outputMax);
+  }
+
+  _output = constrain(proportional + _integral + derivative + feedForward, _outputMin, _outputMax);
+  return _output;
+}
+
+float PidLoop::getOutput() {
+  return _output;
+}
+
+float PidLoop::getIntegral() {
+  return _integral;
+}
+
+void PidLoop::setIntegral(float integral) {
+  if (isnan(integral)) return;
+  _integral = constrain(integral, _outputMin, _outputMax);
+}
@@ -0,0 +1,83 @@
+#ifndef PidLoop_h
+#define PidLoop_h
+
+#include <Arduino.h>
+
+/**
+ * A discrete PID loop with derivative-on-measurement and
+ * conditional-integration anti-windup.
+ *
+ * Pure arithmetic: no I/O and no clock. The caller supplies
+ * the time elapsed between updates.
+ */
+class PidLoop {
+  public:
+    /**
+     * Constructor.
+     *
+     * kp: proportional gain, output units per unit of error
+     * ki: integral gain, output units per unit of error-second
+     * kd: derivative gain, output units per unit of error/second
+     * outputMin, outputMax: limits on the output
+     */
+    PidLoop(float kp, float ki, float kd, float outputMin, float outputMax);
+
+    /**
+     * Replaces the gains. The accumulated integral term is
+     * preserved, so the output does not jump.
+     */
+    void setGains(float kp, float ki, float kd);
+
+    float getKp();
+    float getKi();
+    float getKd();
+
+    /**
+     * Discards the accumulated integral and the previous
+     * measurement. Invoke when control has been interrupted.
+     */
+    void reset();
+
+    /**
+     * Computes and returns the output for a new measurement
+     * taken elapsedSeconds after the previous one.
+     *
+     * The optional feed-forward term is added to the output
+     * before it is limited, so the loop only has to correct
+     * for whatever the feed-forward term gets wrong.
+     *
+     * The integral term is not accumulated while the output is
+     * saturated in the direction the error would push it.
+     */
+    float update(float setpoint, float measurement, float elapsedSeconds, float feedForward = 0);
+
+    /**
+     * Returns the output computed by the most recent update.
+     */
+    float getOutput();
+
+    /**
+     * Returns the integral term's current contribution to the
+     * output.
+     */
+    float getIntegral();
+
+    /**
+     * Restores an integral term saved earlier, e.g. before a warm
+     * restart, limited to the output limits.
+     */
+    void setIntegral(float integral);
+
+  private:
+    float _kp;
+    float _ki;
+    float _kd;
+    float _outputMin;
+    float _outputMax;
+    float _integral;
+    float _previousMeasurement;
+    float _output;
+    bool _primed;
+};
+
+#endif // PidLoop_h
@@ -11,9 +11,28 @@
 #include <SetpointProtocol.h>
 #include <TelemetryProtocol.h>
 #include <RebootProtocol.h>
+#include <ProfileProtocol.h>
+#include <CrashDumpProtocol.h>
 #include <PipsqueakState.h>
+#include <Scheduler.h>
 
 #define REQUEST_QUEUE_DEPTH 10
+#define PROFILE_REFRESH_INTERVAL 3600000
+#define CLIENT_TASK_INTERVAL 100 // ms
+
+// a crash dump goes up a chunk at a time, once control has started,
+// so as not to hold up the requests that matter more
+#define CRASH_DUMP_CHUNK_INTERVAL 5000 // ms
+// after this many failures in a row, the dump waits for the next boot
+#define CRASH_DUMP_ATTEMPT_LIMIT 5
+
+// after a soft reset, how long to try the access point used before
+// it before scanning for any with the configured SSID
+#define CLIENT_FAST_CONNECT_TIMEOUT 3000 // ms
+
+// after losing the access point, how long the radio is left
+// disconnected before rejoining
+#define CLIENT_WIFI_REJOIN_DELAY 500 // ms
 
 // Un-comment to enable extensive debug statements via Serial
 // #define DEBUG_PIPSQUEAK_CLIENT
@@ -51,7 +70,16 @@ class PipsqueakClient {
     void setup();
 
     /**
-     * Invoke upon each iteration of the main loop() function.
+     * Registers a task that runs loop() every
+     * CLIENT_TASK_INTERVAL ms, and whenever the connection
+     * is established, data arrives, or the connection fails
+     * or ends. Invoke once after setup().
+     */
+    void schedule(Scheduler * scheduler);
+
+    /**
+     * Drives the request/response cycle. Invoked by the task
+     * registered via schedule().
      */
     void loop();
 
@@ -104,6 +132,30 @@ class PipsqueakClient {
      */
     ReportRebootRequest * getReportRebootRequest();
 
+    /**
+     * Returns a pointer to the ProfileRequest singleton held by
+     * the client. Also used to access the response via
+     * Request::getResponse().
+     *
+     * Note that the client requests the profile upon setup and
+     * every PROFILE_REFRESH_INTERVAL milliseconds thereafter,
+     * applying the response via PipsqueakState::setProfile().
+     */
+    ProfileRequest * getProfileRequest();
+
+    /**
+     * Returns a pointer to the CrashDumpRequest singleton held by
+     * the client. Also used to access the response via
+     * Request::getResponse().
+     *
+     * Note that the client uploads any pending crash dump on its
+     * own, one chunk every CRASH_DUMP_CHUNK_INTERVAL ms once the
+     * controller has started (or back to back in monitor mode),
+     * and marks it uploaded once the server has acknowledged every
+     * chunk.
+     */
+    CrashDumpRequest * getCrashDumpRequest();
+
     /**
      * Enqueues a request to be transmitted. The queue depth
      * is limited.
@@ -118,11 +170,16 @@ class PipsqueakClient {
     SetpointRequest _setpointRequest;
     TelemetryRequest _telemetryRequest;
     ReportRebootRequest _reportRebootRequest;
+    ProfileRequest _profileRequest;
+    CrashDumpRequest _crashDumpRequest;
     Request * _requestQueue[REQUEST_QUEUE_DEPTH];
     size_t _requestQueueDepth;
     size_t _requestQueueCursor;
     bool _wiFiConnectionEstablished;
     bool _wiFiReconnecting;
+    bool _wiFiFastConnecting;
+    bool _wiFiRejoinPending;
+    uint32_t _wiFiDisconnectMillis;
     AsyncClient _client;
     Request * _request;
     Response * _response;
@@ -137,7 +194,15 @@ class PipsqueakClient {
     volatile bool _disconnected;
     char _rebootMessage[REPORT_REBOOT_REQUEST_MESSAGE_SIZE_LIMIT];
     uint32_t _lastRequestAttemptTimestamp;
+    uint32_t _lastProfileRequestTimestamp;
+    uint32_t _sentMillis;
+    uint32_t _crashDumpOffset;
+    uint32_t _lastCrashDumpChunkTimestamp;
+    uint8_t _crashDumpAttempts;
+    Scheduler * _scheduler;
+    TaskID _task;
 
+    void wake();
     void connect();
     void onConnect();
     void transmit();
@@ -148,7 +213,14 @@ class PipsqueakClient {
     void endSession();
     void synchronizeClock();
     bool clockSyncRequired();
+    bool isClockSyncErrorReported();
+    void applyResponse();
+    void applyProfile();
     void prepareReportRebootRequest();
+    bool isCrashDumpChunkDue();
+    void prepareCrashDumpRequest();
+    void applyCrashDumpChunk();
+    void saveAccessPoint();
     bool isRateLimited();
 };
 
@@ -1,6 +1,10 @@
 #include "PipsqueakClient.h"
 #include <ESP8266WiFi.h>
 #include <TimeLib.h>
+#include <Profiler.h>
+#include <BinaryLog.h>
+#include <Metrics.h>
+#include <PowerManager.h>
 
 extern "C" {
   #include <user_interface.h>
@@ -12,10 +16,15 @@ PipsqueakClient::PipsqueakClient(PipsqueakState * pipsqueakState, Hmac * hmac)
   _setpointRequest(pipsqueakState->getConfig()->getDeviceID(), hmac),
   _telemetryRequest(pipsqueakState->getConfig()->getDeviceID(), hmac),
   _reportRebootRequest(pipsqueakState->getConfig()->getDeviceID(), hmac),
+  _profileRequest(pipsqueakState->getConfig()->getDeviceID(), hmac),
+  _crashDumpRequest(pipsqueakState->getConfig()->getDeviceID(), hmac),
   _requestQueueDepth { 0 },
   _requestQueueCursor { 0 },
   _wiFiConnectionEstablished { false },
   _wiFiReconnecting { false },
+  _wiFiFastConnecting { false },
+  _wiFiRejoinPending { false },
+  _wiFiDisconnectMillis { 0 },
   _client(),
   _request { NULL },
   _response { NULL },
@@ -28,7 +37,14 @@ PipsqueakClient::PipsqueakClient(PipsqueakState * pipsqueakState, Hmac * hmac)
   _timeoutDetected { false },
   _disconnecting { false },
   _disconnected { false },
-  _lastRequestAttemptTimestamp { 0 }
+  _lastRequestAttemptTimestamp { 0 },
+  _lastProfileRequestTimestamp { 0 },
+  _sentMillis { 0 },
+  _crashDumpOffset { 0 },
+  _lastCrashDumpChunkTimestamp { 0 },
+  _crashDumpAttempts { 0 },
+  _scheduler { NULL },
+  _task { SCHEDULER_NO_TASK }
 {
   _state = pipsqueakState;
 }
@@ -41,45 +57,86 @@ void PipsqueakClient::setup() {
   _client.onTimeout([](void * networkClient, AsyncClient * asyncClient, uint32_t time) { ((PipsqueakClient *) networkClient)->onTimeout(time); }, this);
   _client.onDisconnect([](void * networkClient, AsyncClient * asyncClient) { ((PipsqueakClient *) networkClient)->onDisconnect(); }, this);
 
-  // Always issue a TimeRequest first to establish clock sync
-  enqueue(&_timeRequest);
+  // Always issue a TimeRequest first to establish clock sync,
+  // unless the clock carried on through a soft reset
+  if (!_state->isClockSynchronized()) enqueue(&_timeRequest);
 
-  // Then issue a report reboot request and setpoint request
-  prepareReportRebootRequest();
-  enqueue(&_reportRebootRequest);
-  _setpointRequest.setReboot();
-  enqueue(&_setpointRequest);
+  // A monitor wakes from deep sleep routinely; that isn't a reboot
+  // worth reporting, and it has no use for a setpoint or profile
+  if (_state->getConfig()->isMonitorModeEnabled()) {
+    if (ESP.getResetInfoPtr()->reason != REASON_DEEP_SLEEP_AWAKE) {
+      prepareReportRebootRequest();
+      enqueue(&_reportRebootRequest);
+    }
+  } else {
+    // Then issue a report reboot request and setpoint request
+    prepareReportRebootRequest();
+    enqueue(&_reportRebootRequest);
+    _setpointRequest.setReboot();
+    enqueue(&_setpointRequest);
+    enqueue(&_profileRequest);
+  }
+  _lastProfileRequestTimestamp = millis();
 
-  // Initiate WiFi connection
+  // Initiate WiFi connection, straight to the access point used
+  // before a soft reset if there was one
   WiFi.mode(WIFI_STA);
-  WiFi.begin(_state->getConfig()->getWifiSSID(), _state->getConfig()->getWifiPassword());
+  WarmBootRecord * warmBoot = _state->getWarmBoot()->getRecord();
+  if (_state->getWarmBoot()->isRestored() && (warmBoot->flags & WARM_BOOT_FLAG_WIFI)) {
+    _wiFiFastConnecting = true;
+    WiFi.begin(_state->getConfig()->getWifiSSID(), _state->getConfig()->getWifiPassword(), warmBoot->wifiChannel, warmBoot->wifiBssid);
+  } else {
+    WiFi.begin(_state->getConfig()->getWifiSSID(), _state->getConfig()->getWifiPassword());
+  }
+}
+
+void PipsqueakClient::schedule(Scheduler * scheduler) {
+  _scheduler = scheduler;
+  _task = scheduler->every("client", CLIENT_TASK_INTERVAL, [](void * client) { ((PipsqueakClient *) client)->loop(); }, this);
+}
+
+void ICACHE_RAM_ATTR PipsqueakClient::wake() {
+  if (_scheduler) _scheduler->wake(_task);
 }
 
 void PipsqueakClient::loop() {
+  PROFILER_SCOPE(PROFILER_SLOT_CLIENT_LOOP);
   // Don't do anything until the WiFi connection is initially established
   if (!_wiFiConnectionEstablished || _wiFiReconnecting) {
+    _state->setRadioRequired(true);
+    if (_wiFiRejoinPending) {
+      // a network callback may wake the task ahead of time
+      if (millis() - _wiFiDisconnectMillis < CLIENT_WIFI_REJOIN_DELAY) return;
+      _wiFiRejoinPending = false;
+      WiFi.begin(_state->getConfig()->getWifiSSID(), _state->getConfig()->getWifiPassword());
+    }
+    if (_wiFiFastConnecting && !WiFi.isConnected() && millis() > CLIENT_FAST_CONNECT_TIMEOUT) {
+      BinaryLog::write(LOG_CLIENT_WIFI_SCANNING);
+      _wiFiFastConnecting = false;
+      WiFi.disconnect();
+      WiFi.begin(_state->getConfig()->getWifiSSID(), _state->getConfig()->getWifiPassword());
+    }
     if (!WiFi.isConnected()) return;
     _wiFiReconnecting = false;
+    _wiFiFastConnecting = false;
     _wiFiConnectionEstablished = true;
-    #ifdef DEBUG_PIPSQUEAK_CLIENT
-    Serial.println("PipsqueakClient.loop(): WiFi connected");
-    #endif
+    saveAccessPoint();
+    BinaryLog::write(LOG_CLIENT_WIFI_CONNECTED);
   } else if (!WiFi.isConnected()) {
-    #ifdef DEBUG_PIPSQUEAK_CLIENT
-    Serial.println("PipsqueakClient.loop(): WiFi connection lost; reconnecting");
-    #endif
+    BinaryLog::write(LOG_CLIENT_WIFI_LOST);
+    Metrics::increment(METRIC_WIFI_RECONNECTS);
     // setAutoReconnect(true) has been unreliable - may be trying to use same channel?
     _wiFiReconnecting = true;
     _state->recordError(ErrorType::Pipsqueak, WIFI_CONNECTION_ERROR);
+    // rejoined on a later run, rather than waiting it out here
     WiFi.disconnect();
-    delay(500);
-    WiFi.begin(_state->getConfig()->getWifiSSID(), _state->getConfig()->getWifiPassword());
+    _wiFiRejoinPending = true;
+    _wiFiDisconnectMillis = millis();
+    if (_scheduler) _scheduler->wakeIn(_task, CLIENT_WIFI_REJOIN_DELAY);
   }
 
   if (_transmitting && _response->isComplete()) {
-    #ifdef DEBUG_PIPSQUEAK_CLIENT
-    Serial.printf("PipsqueakClient.loop(): %s complete/ready\n", _response->getName());
-    #endif
+    BinaryLog::write(LOG_CLIENT_RESPONSE_READY, _request->getProtocol());
     endSession();
   }
 
@@ -87,48 +144,36 @@ void PipsqueakClient::loop() {
 
   if (_disconnected) {
     if (_disconnecting) {
-      #ifdef DEBUG_PIPSQUEAK_CLIENT
-      Serial.println("PipsqueakClient.loop(): client connection terminated normally");
-      #endif
+      BinaryLog::write(LOG_CLIENT_DISCONNECTED);
       _connected = false;
       _disconnecting = false;
     }
 
     if (_timeoutDetected) {
-      #ifdef DEBUG_PIPSQUEAK_CLIENT
-      Serial.println("PipsqueakClient.loop(): timeout");
-      #endif
+      BinaryLog::write(LOG_CLIENT_TIMEOUT);
       _response->addError(ErrorType::Pipsqueak, NETWORK_ERROR_TIMEOUT);
     }
 
     if (_errorDetected) {
-      #ifdef DEBUG_PIPSQUEAK_CLIENT
-      Serial.printf("PipsqueakClient.loop(): transmission error: %d: %s\n", _errorCode, _client.errorToString(_errorCode));
-      #endif
+      BinaryLog::write(LOG_CLIENT_TRANSMISSION_ERROR, _errorCode);
       _response->addError(ErrorType::TcpStack, _errorCode);
     }
 
     if (_transmitting) {
-      #ifdef DEBUG_PIPSQUEAK_CLIENT
-      Serial.println("PipsqueakClient.loop(): disconnected while transmitting.");
-      #endif
+      BinaryLog::write(LOG_CLIENT_BROKEN_PIPE);
       _response->addError(ErrorType::Pipsqueak, NETWORK_ERROR_BROKEN_PIPE);
       _transmitting = false;
       _connected = false;
     }
 
     if (_connected) {
-      #ifdef DEBUG_PIPSQUEAK_CLIENT
-      Serial.println("PipsqueakClient.loop(): disconnected after connecting but before transmitting.");
-      #endif
+      BinaryLog::write(LOG_CLIENT_CONNECTION_LOST);
       _response->addError(ErrorType::Pipsqueak, NETWORK_ERROR_CONNECTION_LOST);
       _connected = false;
     }
 
     if (_connecting) {
-      #ifdef DEBUG_PIPSQUEAK_CLIENT
-      Serial.println("PipsqueakClient.loop(): disconnected while connecting.");
-      #endif
+      BinaryLog::write(LOG_CLIENT_CONNECTION_FAILED);
       _response->addError(ErrorType::Pipsqueak, NETWORK_ERROR_CONNECTION_FAILED);
       _connecting = false;
       _client.close(true);
@@ -136,20 +181,27 @@ void PipsqueakClient::loop() {
 
     _disconnected = false;
     if (_response != NULL) {
-      _response->ready(now() - _request->getTimestamp());
+      {
+        // Verifies the response's HMAC
+        CpuBoost boost(_state);
+        _response->ready(now() - _request->getTimestamp());
+      }
       // invoke whether errors are present or not
       _state->recordErrors(_response);
       synchronizeClock();
       clockSyncIsRequired = clockSyncRequired();
-      #ifdef DEBUG_PIPSQUEAK_CLIENT
+      applyResponse();
       if (_response->hasErrors()) {
-        Serial.printf("PipsqueakClient.loop(): %s failed with %u errors\n", _request->getName(), _response->errorCount());
+        BinaryLog::write(LOG_CLIENT_REQUEST_FAILED, _request->getProtocol(), _response->errorCount());
+        Metrics::increment(METRIC_REQUEST_FAILURES);
       } else {
-        Serial.printf("PipsqueakClient.loop(): %s succeeded in %lu seconds\n", _request->getName(), _response->getElapsedTime());
+        BinaryLog::write(LOG_CLIENT_REQUEST_SUCCEEDED, _request->getProtocol(), _response->getElapsedTime());
+        Metrics::observe(METRIC_ROUND_TRIP, _response->getReceivedMillis() - _sentMillis);
       }
-      #endif
-      if (_response->hasErrors() && _request != &_timeRequest) {
+      // A crash dump chunk is retried when the next one would be due
+      if (_response->hasErrors() && _request != &_timeRequest && _request != &_crashDumpRequest) {
         _request->failed();
+        Metrics::increment(METRIC_REQUEST_RETRIES);
         enqueue(_request);
       } else {
         _request->reset();
@@ -163,9 +215,7 @@ void PipsqueakClient::loop() {
   }
 
   if (_connected && !_transmitting) {
-    #ifdef DEBUG_PIPSQUEAK_CLIENT
-    Serial.println("PipsqueakClient.loop(): client connection established");
-    #endif
+    BinaryLog::write(LOG_CLIENT_CONNECTED);
     transmit();
   }
 
@@ -178,24 +228,36 @@ void PipsqueakClient::loop() {
       count += 1;
     }
     if (count > 0) {
-      #ifdef DEBUG_PIPSQUEAK_CLIENT
-      Serial.printf("PipsqueakClient.loop(): added %u status events to TelemetryRequest\n", count);
-      #endif
+      BinaryLog::write(LOG_CLIENT_EVENTS_ADDED, count);
       if (_request != &_telemetryRequest) {
-        #ifdef DEBUG_PIPSQUEAK_CLIENT
-        Serial.println("PipsqueakClient.loop(): auto-enqueuing a TelemetryRequest for transmission");
-        #endif
+        BinaryLog::write(LOG_CLIENT_TELEMETRY_ENQUEUED);
         enqueue(&_telemetryRequest);
       }
       yield();
     }
   }
 
+  if (!_state->getConfig()->isMonitorModeEnabled() && millis() - _lastProfileRequestTimestamp >= PROFILE_REFRESH_INTERVAL) {
+    _lastProfileRequestTimestamp = millis();
+    if (_request != &_profileRequest) {
+      enqueue(&_profileRequest);
+    }
+  }
+
+  if (isCrashDumpChunkDue()) {
+    prepareCrashDumpRequest();
+    if (_crashDumpRequest.isPopulated()) enqueue(&_crashDumpRequest);
+  }
+
+  // Every response disciplines the clock; ask for the time only when
+  // none has arrived for long enough that it may have wandered
+  if (_state->isClockSyncDue() && _request != &_timeRequest) {
+    enqueue(&_timeRequest);
+  }
+
   if (_request == NULL) {
     if (clockSyncIsRequired) {
-      #ifdef DEBUG_PIPSQUEAK_CLIENT
-      Serial.println("PipsqueakClient.loop(): auto-staging a TimeRequest for transmission");
-      #endif
+      BinaryLog::write(LOG_CLIENT_TIME_STAGED);
       _timeRequest.reset();
       _request = &_timeRequest;
       _response = _request->getResponse();
@@ -204,18 +266,24 @@ void PipsqueakClient::loop() {
       _response = _request->getResponse();
       _requestQueueCursor = (_requestQueueCursor + 1) % REQUEST_QUEUE_DEPTH;
       _requestQueueDepth -= 1;
-      #ifdef DEBUG_PIPSQUEAK_CLIENT
-      Serial.printf("PipsqueakClient.loop(): staging a %s for transmission\n", _request->getName());
-      #endif
+      BinaryLog::write(LOG_CLIENT_REQUEST_STAGED, _request->getProtocol());
     }
   }
 
   if (!_busy && _request != NULL && !isRateLimited()) {
-    #ifdef DEBUG_PIPSQUEAK_CLIENT
-    Serial.println("PipsqueakClient.loop(): connect()");
-    #endif
+    BinaryLog::write(LOG_CLIENT_CONNECT);
     connect();
   }
+
+  // Pending requests need the radio too, lest a monitor sleep on them
+  _state->setRadioRequired(_busy || _request != NULL || _requestQueueDepth > 0 || _wiFiReconnecting);
+}
+
+void PipsqueakClient::saveAccessPoint() {
+  WarmBootRecord * warmBoot = _state->getWarmBoot()->getRecord();
+  warmBoot->wifiChannel = WiFi.channel();
+  memcpy(warmBoot->wifiBssid, WiFi.BSSID(), WARM_BOOT_BSSID_SIZE);
+  warmBoot->flags |= WARM_BOOT_FLAG_WIFI;
 }
 
 TimeRequest * PipsqueakClient::getTimeRequest() {
@@ -234,21 +302,28 @@ ReportRebootRequest * PipsqueakClient::getReportRebootRequest() {
   return &_reportRebootRequest;
 }
 
+ProfileRequest * PipsqueakClient::getProfileRequest() {
+  return &_profileRequest;
+}
+
+CrashDumpRequest * PipsqueakClient::getCrashDumpRequest() {
+  return &_crashDumpRequest;
+}
+
 bool PipsqueakClient::enqueue(Request * request) {
-  if (_requestQueueDepth >= REQUEST_QUEUE_DEPTH) return false;
+  if (_requestQueueDepth >= REQUEST_QUEUE_DEPTH) {
+    Metrics::increment(METRIC_REQUESTS_DROPPED);
+    return false;
+  }
   for (size_t i = _requestQueueCursor; i < (_requestQueueCursor + _requestQueueDepth); i++) {
     if (_requestQueue[(i % REQUEST_QUEUE_DEPTH)] == request) {
-      #ifdef DEBUG_PIPSQUEAK_CLIENT
-      Serial.printf("PipsqueakClient.enqueue(%s): rejected (already enqueued)\n", request->getName());
-      #endif
+      BinaryLog::write(LOG_CLIENT_ENQUEUE_REJECTED, request->getProtocol());
       return false;
     }
   }
   _requestQueue[(_requestQueueCursor + _requestQueueDepth) % REQUEST_QUEUE_DEPTH] = request;
   _requestQueueDepth += 1;
-  #ifdef DEBUG_PIPSQUEAK_CLIENT
-  Serial.printf("PipsqueakClient.enqueue(%s): accepted\n", request->getName());
-  #endif
+  BinaryLog::write(LOG_CLIENT_ENQUEUE_ACCEPTED, request->getProtocol());
   return true;
 }
 
@@ -265,31 +340,32 @@ void PipsqueakClient::connect() {
   _lastRequestAttemptTimestamp = millis();
 
   if (!WiFi.isConnected()) {
-    #ifdef DEBUG_PIPSQUEAK_CLIENT
-    Serial.println("PipsqueakClient.connect(): WiFi is not connected.");
-    #endif
+    BinaryLog::write(LOG_CLIENT_WIFI_UNAVAILABLE);
     _response->addError(ErrorType::Pipsqueak, NETWORK_ERROR_WIFI_CONNECTION);
     _disconnected = true;
     return;
   }
 
   PipsqueakConfig * config = _state->getConfig();
-  #ifdef DEBUG_PIPSQUEAK_CLIENT
-  Serial.printf("PipsqueakClient.connect(): Initiating client connection attempt to %s:%u\n", config->getHostIP()->toString().c_str(), config->getHostPort());
-  #endif
+  BinaryLog::write(LOG_CLIENT_CONNECTING, (*config->getHostIP())[0], (*config->getHostIP())[1], (*config->getHostIP())[2], (*config->getHostIP())[3], config->getHostPort());
   _client.connect(*(config->getHostIP()), config->getHostPort());
 }
 
 void ICACHE_RAM_ATTR PipsqueakClient::onConnect() {
   _connecting = false;
   _connected = true;
+  wake();
 }
 
 void PipsqueakClient::transmit() {
-  if (!_request->ready(now(), RANDOM_REG32)) {
-    #ifdef DEBUG_PIPSQUEAK_CLIENT
-    Serial.printf("PipsqueakClient.transmit(): %s not populated or otherwise unready to transmit\n", _request->getName());
-    #endif
+  bool ready;
+  {
+    // Computes the request's HMAC
+    CpuBoost boost(_state);
+    ready = _request->ready(now(), RANDOM_REG32);
+  }
+  if (!ready) {
+    BinaryLog::write(LOG_CLIENT_REQUEST_UNREADY, _request->getProtocol());
     _response->reset();
     _response->addError(ErrorType::Pipsqueak, REQUEST_NOT_POPULATED);
     endSession();
@@ -297,53 +373,53 @@ void PipsqueakClient::transmit() {
   }
 
   if (!_client.canSend()) {
-    #ifdef DEBUG_PIPSQUEAK_CLIENT
-    Serial.println("PipsqueakClient.transmit(): async client cannot send");
-    #endif
+    BinaryLog::write(LOG_CLIENT_CANNOT_SEND);
     _response->addError(ErrorType::Pipsqueak, NETWORK_ERROR_CLIENT_STATE);
     endSession();
     return;
   }
 
   if (_client.space() < _request->getSize()) {
-    #ifdef DEBUG_PIPSQUEAK_CLIENT
-    Serial.println("PipsqueakClient.transmit(): async client does not have space for the entire message");
-    #endif
+    BinaryLog::write(LOG_CLIENT_BUFFER_FULL);
     _response->addError(ErrorType::Pipsqueak, NETWORK_ERROR_BUFFER_FULL);
     endSession();
     return;
   }
 
   _transmitting = true;
+  _sentMillis = millis();
   _client.write((const char *) _request->getBuffer(), _request->getSize());
 
-  #ifdef DEBUG_PIPSQUEAK_CLIENT
-  Serial.printf("PipsqueakClient.transmit(): Wrote %d bytes to the async client\n", _request->getSize());
-  #endif
+  BinaryLog::write(LOG_CLIENT_TRANSMITTED, _request->getSize());
+  Metrics::increment(METRIC_REQUESTS_SENT);
+  Metrics::increment(METRIC_BYTES_SENT, _request->getSize());
 }
 
 void ICACHE_RAM_ATTR PipsqueakClient::onData(void * data, size_t len) {
   _response->receiveBytes(data, len);
+  Metrics::increment(METRIC_BYTES_RECEIVED, len);
   _client.ack(len);
+  if (_response->isComplete()) wake();
 };
 
 void ICACHE_RAM_ATTR PipsqueakClient::onError(uint8_t error) {
   _errorDetected = true;
   _errorCode = error;
+  wake();
 }
 
 void ICACHE_RAM_ATTR PipsqueakClient::onTimeout(uint32_t time) {
   _timeoutDetected = true;
+  wake();
 }
 
 void ICACHE_RAM_ATTR PipsqueakClient::onDisconnect() {
   _disconnected = true;
+  wake();
 }
 
 void PipsqueakClient::endSession() {
-  #ifdef DEBUG_PIPSQUEAK_CLIENT
-  Serial.println("PipsqueakClient.endSession()");
-  #endif
+  BinaryLog::write(LOG_CLIENT_SESSION_ENDED);
  _transmitting = false;
   _disconnecting = true;
   _client.close(true);
@@ -351,24 +427,27 @@ void PipsqueakClient::endSession() {
 
 void PipsqueakClient::synchronizeClock() {
   if (_response == NULL) return;
-  if (_response->hasErrors()) return;
-  if (_response->getElapsedTime() > 1) {
-    #ifdef DEBUG_PIPSQUEAK_CLIENT
-    Serial.printf("PipsqueakClient.synchronizeClock(): %lu seconds elapsed\n", _response->getElapsedTime());
-    #endif
-    return;
+  // The server signs its timestamp whatever else went wrong, even when
+  // it rejected the request for being out of sync with its clock
+  if (!_response->isAuthentic()) return;
+  if (isClockSyncErrorReported()) {
+    BinaryLog::write(LOG_CLIENT_CLOCK_RESTART);
+    _state->setClockSynchronized(false);
   }
-  #ifdef DEBUG_PIPSQUEAK_CLIENT
-  Serial.printf("PipsqueakClient.synchronizeClock(): success @ %u\n", _response->getTimestamp());
-  #endif
-  setTime(_response->getTimestamp());
-  _state->setClockSynchronized(true);
+  BinaryLog::write(LOG_CLIENT_CLOCK_SAMPLE, _response->getTimestamp(), _response->getReceivedMillis() - _sentMillis);
+  _state->synchronizeClock(_response->getTimestamp(), _sentMillis, _response->getReceivedMillis());
 }
 
 bool PipsqueakClient::clockSyncRequired() {
   if (_response == NULL) return false;
-  if (_request == &_timeRequest && _response->hasErrors()) return true;
 
+  // Only if no response, not even the one that reported the clocks out
+  // of sync, has synchronized the clock: it failed, or it took too long
+  // for its timestamp to be of use
+  return !_state->isClockSynchronized();
+}
+
+bool PipsqueakClient::isClockSyncErrorReported() {
   for (size_t i = 0; i < _response->errorCount(); i++) {
     if (_response->getErrorType(i) != ErrorType::Pipsqueak) {
       continue;
@@ -380,20 +459,43 @@ bool PipsqueakClient::clockSyncRequired() {
       code == REQUEST_ERROR_CLOCK_SYNC_BEHIND ||
       code == REQUEST_ERROR_CLOCK_SYNC_AHEAD
     ) {
-      #ifdef DEBUG_PIPSQUEAK_CLIENT
-      Serial.println("PipsqueakClient.clockSyncRequired(): out of sync");
-      #endif
-      _state->setClockSynchronized(false);
       return true;
     }
   }
-
-  // If neither clock sync errors are present, clocks are either sufficiently
-  // in sync, or a problem bigger than clock sync (for example, network
-  // connectivity) is preventing determination of synchronicity.
   return false;
 }
 
+void PipsqueakClient::applyResponse() {
+  if (_response == NULL) return;
+  if (_response->hasErrors()) return;
+  if (_request == &_setpointRequest) {
+    float setpoint = _setpointRequest.getResponse()->getSetpoint();
+    if (isfinite(setpoint)) _state->setRemoteTemperatureSetpoint(setpoint);
+  } else if (_request == &_telemetryRequest) {
+    float setpoint = _telemetryRequest.getResponse()->getSetpoint();
+    if (isfinite(setpoint)) _state->setRemoteTemperatureSetpoint(setpoint);
+  } else if (_request == &_profileRequest) {
+    applyProfile();
+  } else if (_request == &_crashDumpRequest) {
+    applyCrashDumpChunk();
+  }
+}
+
+void PipsqueakClient::applyProfile() {
+  ProfileResponse * response = _profileRequest.getResponse();
+  uint8_t segmentCount = response->getSegmentCount();
+  ProfileSegment segments[PROFILE_SEGMENT_LIMIT];
+  for (size_t i = 0; i < segmentCount && i < PROFILE_SEGMENT_LIMIT; i++) {
+    segments[i].start = response->getSegmentStart(i);
+    segments[i].target = response->getSegmentTarget(i);
+    segments[i].rampRate = response->getSegmentRampRate(i);
+  }
+  if (!_state->setProfile(response->getProfileID(), segmentCount, segments)) {
+    BinaryLog::write(LOG_CLIENT_PROFILE_REJECTED, response->getProfileID());
+    _state->recordError(ErrorType::Pipsqueak, RESPONSE_ERROR_INVALID_PROFILE);
+  }
+}
+
 void PipsqueakClient::prepareReportRebootRequest() {
   if (ESP.getResetInfoPtr()->reason == REASON_DEFAULT_RST) {
     _reportRebootRequest.reportNormalReboot();
@@ -420,12 +522,51 @@ void PipsqueakClient::prepareReportRebootRequest() {
     ESP.getResetInfoPtr()->excvaddr,
     ESP.getResetInfoPtr()->depc
   );
+  // The rest of the story follows in a crash dump
+  if (_state->getCrashDump()->isPending()) {
+    size_t length = strlen(_rebootMessage);
+    snprintf(&_rebootMessage[length], REPORT_REBOOT_REQUEST_MESSAGE_SIZE_LIMIT - length, " dump:%u", _state->getCrashDump()->getDumpID());
+  }
   #ifdef DEBUG_PIPSQUEAK_CLIENT
   Serial.printf("ReportExceptionRequest(): reset diagnostic = %s\n", _rebootMessage);
   #endif
   _reportRebootRequest.reportExceptionalReboot(_rebootMessage);
 }
 
+bool PipsqueakClient::isCrashDumpChunkDue() {
+  if (!_state->getCrashDump()->isPending() || _crashDumpRequest.isPopulated()) return false;
+  if (_crashDumpAttempts >= CRASH_DUMP_ATTEMPT_LIMIT) return false;
+  // A monitor has no control to hold up, and would sleep between chunks
+  if (_state->getConfig()->isMonitorModeEnabled()) return true;
+  if (_state->getMillisToControlStart() == 0) return false;
+  return millis() - _lastCrashDumpChunkTimestamp >= CRASH_DUMP_CHUNK_INTERVAL;
+}
+
+void PipsqueakClient::prepareCrashDumpRequest() {
+  CrashDump * crashDump = _state->getCrashDump();
+  uint32_t chunk[CRASH_DUMP_REQUEST_CHUNK_SIZE_LIMIT / 4];
+  size_t size = min((size_t) (crashDump->getSize() - _crashDumpOffset), (size_t) CRASH_DUMP_REQUEST_CHUNK_SIZE_LIMIT);
+  _lastCrashDumpChunkTimestamp = millis();
+  _crashDumpAttempts += 1;
+  if (!crashDump->read(_crashDumpOffset, chunk, size)) {
+    BinaryLog::write(LOG_CLIENT_CRASH_DUMP_UNREADABLE, crashDump->getDumpID(), _crashDumpOffset);
+    _crashDumpAttempts = CRASH_DUMP_ATTEMPT_LIMIT;
+    return;
+  }
+  _crashDumpRequest.setChunk(crashDump->getDumpID(), crashDump->getSize(), _crashDumpOffset, (const byte *) chunk, size);
+}
+
+void PipsqueakClient::applyCrashDumpChunk() {
+  CrashDump * crashDump = _state->getCrashDump();
+  _crashDumpAttempts = 0;
+  _crashDumpOffset += _crashDumpRequest.getChunkSize();
+  if (_crashDumpOffset >= crashDump->getSize()) {
+    BinaryLog::write(LOG_CLIENT_CRASH_DUMP_UPLOADED, crashDump->getDumpID());
+    crashDump->markUploaded();
+    _crashDumpOffset = 0;
+  }
+}
+
 bool PipsqueakClient::isRateLimited() {
   // Rate limit imposed here one request per second
   return millis() - _lastRequestAttemptTimestamp < 1000;
@@ -1,268 +1,359 @@
 #include "PipsqueakConfig.h"
 #include <Arduino.h>
-#include <EEPROM.h>
+#include <ConfigJournal.h>
+#include <Metrics.h>
+#include <flash_hal.h>
 
-#define SCHEMA_VERSION 3
 #define DEFAULT_PORT 9001
 #define DEFAULT_SETPOINT 15
 
 #define BOARD_TEMPERATURE_LIMIT 40
 
-#define INITIALIZED_FLAG 0x0F
+// The board sensor reads this much above ambient, warmed by the
+// regulator and the ESP8266
+#define BOARD_SELF_HEATING 3
+
+// The fermentation profile lives in the second half of the EEPROM.
+// Persisting rewrites the whole flash sector, so every write carries
+// both halves; otherwise persisting the image would erase the
+// profile.
+#define EEPROM_SIZE 512
+#define PROFILE_OFFSET 256
+#define PROFILE_SEGMENTS_OFFSET PROFILE_OFFSET + 8
+#define PROFILE_SEGMENT_SIZE 12
+
+// The image is read and written straight from flash, rather than
+// through the EEPROM library, whose buffer is allocated on the heap
+extern "C" uint32_t _EEPROM_start;
+#define EEPROM_PHYS_ADDR ((uint32_t) (uintptr_t) &_EEPROM_start - 0x40200000)
+
+// Values the OS changes are journaled rather than committed to the
+// EEPROM, which would erase its sector on every change.
+#define JOURNAL_KEY_SETPOINT 0
+#define JOURNAL_KEY_TUNING 1
+#define JOURNAL_KEY_PROFILE 2
+#define JOURNAL_TUNING_SIZE 16
+#define JOURNAL_PROFILE_SIZE (8 + PROFILE_SEGMENT_LIMIT * PROFILE_SEGMENT_SIZE)
+
+class EspJournalFlash : public JournalFlash {
+  public:
+    EspJournalFlash() {
+      // No journal if the flash layout leaves no room for it
+      _sectorCount = FS_PHYS_SIZE >= JOURNAL_SECTOR_COUNT * SPI_FLASH_SEC_SIZE ? JOURNAL_SECTOR_COUNT : 0;
+      _firstSector = (FS_PHYS_ADDR + FS_PHYS_SIZE) / SPI_FLASH_SEC_SIZE - _sectorCount;
+    }
+
+    size_t getSectorCount() {
+      return _sectorCount;
+    }
+
+    bool erase(size_t sector) {
+      return ESP.flashEraseSector(_firstSector + sector);
+    }
+
+    bool read(size_t sector, uint32_t offset, uint32_t * data, size_t size) {
+      return ESP.flashRead((_firstSector + sector) * SPI_FLASH_SEC_SIZE + offset, data, size);
+    }
+
+    bool write(size_t sector, uint32_t offset, const uint32_t * data, size_t size) {
+      return ESP.flashWrite((_firstSector + sector) * SPI_FLASH_SEC_SIZE + offset, data, size);
+    }
+
+  private:
+    uint32_t _firstSector;
+    size_t _sectorCount;
+};
+
+static EspJournalFlash journalFlash;
+
+// Staging for persist(), which runs long after setup()
+static uint32_t persistBuffer[EEPROM_SIZE / 4];
 
 PipsqueakConfig::PipsqueakConfig()
   :
-  _hostIP { NULL },
-  _hostPort { DEFAULT_PORT },
-  _deviceID { 0 },
-  _configurationFlags { 0 },
-  _enablePin { 0 },
-  _oneWirePin { 0 },
-  _redIndicatorPin { 0 },
-  _greenIndicatorPin { 0 },
-  _heaterPin { 0 },
-  _chillerPin { 0 },
-  _setpoint { DEFAULT_SETPOINT }
+  _imageStatus(CONFIG_IMAGE_BLANK),
+  _hostIP(),
+  _profile(),
+  _journal(&journalFlash)
 {
-  memset(_wifiSSID, 0, WIFI_SSID_BUFFER_SIZE);
-  memset(_wifiPassword, 0, WIFI_PASSWORD_BUFFER_SIZE);
-  memset(_secretKey, 0, SECRET_KEY_BUFFER_SIZE);
-  memset(_boardSensorAddress, 0, BOARD_SENSOR_ADDRESS_SIZE);
+  memset(&_image, 0, sizeof(_image));
+  _image.hostPort = DEFAULT_PORT;
+  _image.setpoint = DEFAULT_SETPOINT;
 }
 
 void PipsqueakConfig::setup() {
   size_t i;
-  size_t cursor = 0;
-  uint8_t initializedFlag;
-  uint8_t schemaVersion;
-
-  EEPROM.begin(256);
-  EEPROM.get(cursor, initializedFlag);
-  cursor += 1;
-  if (initializedFlag != INITIALIZED_FLAG) {
-    #ifdef DEBUG_PIPSQUEAK_CONFIG
-    Serial.println("Fatal Error: EEPROM has not been initialized");
-    #endif
-    delay(5000);
-    ESP.restart();
+  uint32_t raw[CONFIG_IMAGE_SIZE / 4];
+  ConfigImageStatus status = CONFIG_IMAGE_BLANK;
+  if (ESP.flashRead(EEPROM_PHYS_ADDR, raw, CONFIG_IMAGE_SIZE)) {
+    status = ConfigImageFormat::parse((const uint8_t *) raw, &_image);
   }
-  EEPROM.get(cursor, schemaVersion);
-  cursor += 1;
-  if (schemaVersion != SCHEMA_VERSION) {
+  _imageStatus = status;
+  if (!isUsable()) {
+    // Nothing to run on until the initializer is run again, which a
+    // restart would not change
     #ifdef DEBUG_PIPSQUEAK_CONFIG
-    Serial.printf("Fatal Error: unsupported EEPROM schema version: %u\n", schemaVersion);
+    Serial.printf("Fatal Error: EEPROM image unusable (status %u, version %u)\n", status, ((uint8_t *) raw)[1]);
     #endif
-    delay(5000);
-    ESP.restart();
+    memset(&_image, 0, sizeof(_image));
+    _image.enablePin = BOARD_SIGNAL_ENABLE_PIN;
+    _image.oneWirePin = BOARD_ONE_WIRE_PIN;
+    _image.redIndicatorPin = BOARD_RED_INDICATOR_PIN;
+    _image.greenIndicatorPin = BOARD_GREEN_INDICATOR_PIN;
+    _image.heaterPin = BOARD_HEATER_PIN;
+    _image.chillerPin = BOARD_CHILLER_PIN;
+    return;
   }
-  EEPROM.get(cursor, _configurationFlags);
-  cursor += 1;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): configurationFlags = %u\n", _configurationFlags);
-  #endif
-  // skip reserved byte
-  cursor += 1;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  uint32_t writeCount;
-  EEPROM.get(cursor, writeCount);
-  Serial.printf("PipsqueakConfig.setup(): writeCount = %u\n", writeCount);
-  #endif
-  cursor += 4;
-  EEPROM.get(cursor, _deviceID);
-  cursor += 4;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): deviceID = %u\n", _deviceID);
-  #endif
-  EEPROM.get(cursor, _setpoint);
-  cursor += 4;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): setpoint = %f degrees C\n", _setpoint);
-  #endif
-  uint8_t hostIP[4];
-  EEPROM.get(cursor, hostIP);
-  _hostIP = new IPAddress(hostIP);
-  cursor += 4;
   #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): hostIP = %u.%u.%u.%u\n", hostIP[0], hostIP[1], hostIP[2], hostIP[3]);
+  Serial.printf("PipsqueakConfig.setup(): image version %u%s, written %u times\n", ((uint8_t *) raw)[1], status == CONFIG_IMAGE_MIGRATED ? " (migrated)" : "", _image.writeCount);
   #endif
-  EEPROM.get(cursor, _hostPort);
-  cursor += 2;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): hostPort = %u\n", _hostPort);
-  #endif
-  EEPROM.get(cursor, _wifiSSID);
-  cursor += WIFI_SSID_BUFFER_SIZE;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): wifiSSID = %s\n", _wifiSSID);
-  #endif
-  EEPROM.get(cursor, _wifiPassword);
-  cursor += WIFI_PASSWORD_BUFFER_SIZE;
+
+  // The journal is bound to the image as written, so that
+  // re-initializing discards it
+  _journal.begin(ConfigImageFormat::crc32(raw, CONFIG_IMAGE_SIZE));
   #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): wifiPassword = %s\n", _wifiPassword);
+  Serial.printf("PipsqueakConfig.setup(): journal %s, %u bytes free, %u sector erases\n", _journal.isReady() ? "ready" : "unavailable", _journal.getFreeSpace(), _journal.getEraseCount());
   #endif
-  for (i = 0; i < SECRET_KEY_BUFFER_SIZE; i++) {
-    EEPROM.get(cursor + i, _secretKey[i]);
+  _journal.read(JOURNAL_KEY_SETPOINT, &_image.setpoint, sizeof(_image.setpoint));
+  uint32_t tuning[JOURNAL_TUNING_SIZE / 4];
+  if (_journal.read(JOURNAL_KEY_TUNING, tuning, JOURNAL_TUNING_SIZE)) {
+    memcpy(&_image.proportionalGain, &tuning[0], 4);
+    memcpy(&_image.integralGain, &tuning[1], 4);
+    memcpy(&_image.derivativeGain, &tuning[2], 4);
+    _image.controlPeriod = tuning[3];
   }
-  cursor += SECRET_KEY_BUFFER_SIZE;
+  if (!isTuned()) {
+    _image.controlPeriod = 0;
+  }
+  _hostIP = IPAddress(_image.hostIP);
   #ifdef DEBUG_PIPSQUEAK_CONFIG
+  Serial.printf("PipsqueakConfig.setup(): configurationFlags = %u\n", _image.flags);
+  Serial.printf("PipsqueakConfig.setup(): deviceID = %u\n", _image.deviceID);
+  Serial.printf("PipsqueakConfig.setup(): setpoint = %f degrees C\n", _image.setpoint);
+  Serial.printf("PipsqueakConfig.setup(): host = %u.%u.%u.%u:%u\n", _image.hostIP[0], _image.hostIP[1], _image.hostIP[2], _image.hostIP[3], _image.hostPort);
+  Serial.printf("PipsqueakConfig.setup(): wifiSSID = %s\n", _image.wifiSSID);
+  Serial.printf("PipsqueakConfig.setup(): wifiPassword = %s\n", _image.wifiPassword);
   Serial.print("PipsqueakConfig.setup(): secretkey = ");
-  for (i = 0; i < 32; i++) {
-    Serial.printf("0x%02X", _secretKey[i]);
-    if (i < 31) Serial.print(" ");
+  for (i = 0; i < CONFIG_IMAGE_SECRET_KEY_SIZE; i++) {
+    Serial.printf("0x%02X", _image.secretKey[i]);
+    if (i < CONFIG_IMAGE_SECRET_KEY_SIZE - 1) Serial.print(" ");
   }
   Serial.print("\n");
-  #endif
-  EEPROM.get(cursor, _enablePin);
-  cursor += 1;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): enablePin = GPIO %02u\n", _enablePin);
-  #endif
-  // skip 1wire pin for board sensor - same as for remote sensor
-  cursor += 1;
-  for (i = 0; i < BOARD_SENSOR_ADDRESS_SIZE; i++) {
-    EEPROM.get(cursor + i, _boardSensorAddress[i]);
-  }
-  cursor += BOARD_SENSOR_ADDRESS_SIZE;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
+  Serial.printf("PipsqueakConfig.setup(): pins = enable GPIO %02u, 1-Wire GPIO %02u, red GPIO %02u, green GPIO %02u, heater GPIO %02u, chiller GPIO %02u\n", _image.enablePin, _image.oneWirePin, _image.redIndicatorPin, _image.greenIndicatorPin, _image.heaterPin, _image.chillerPin);
   Serial.print("PipsqueakConfig.setup(): boardSensorAddress = ");
-  for (i = 0; i < 8; i++) {
-    Serial.printf("0x%02X", _boardSensorAddress[i]);
-    if (i < 7) Serial.print(" ");
+  for (i = 0; i < CONFIG_IMAGE_ADDRESS_SIZE; i++) {
+    Serial.printf("0x%02X", _image.boardSensorAddress[i]);
+    if (i < CONFIG_IMAGE_ADDRESS_SIZE - 1) Serial.print(" ");
   }
   Serial.print("\n");
-  #endif
-  EEPROM.get(cursor, _oneWirePin);
-  cursor += 1;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): oneWirePin = GPIO %02u\n", _oneWirePin);
-  #endif
-  // skip remote sensor address - autodetected
-  cursor += 8;
-  EEPROM.get(cursor, _redIndicatorPin);
-  cursor += 1;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): redIndicatorPin = GPIO %02u\n", _redIndicatorPin);
-  #endif
-  EEPROM.get(cursor, _greenIndicatorPin);
-  cursor += 1;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): greenIndicatorPin = GPIO %02u\n", _greenIndicatorPin);
-  #endif
-  uint8_t heaterPinCount;
-  EEPROM.get(cursor, heaterPinCount);
-  cursor += 1;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): heaterPinCount = %u\n", heaterPinCount);
-  #endif
-  if (heaterPinCount != 1) {
-    #ifdef DEBUG_PIPSQUEAK_CONFIG
-    Serial.printf("Fatal Error: exactly one configured heater pin required, %u found\n", heaterPinCount);
-    #endif
-    delay(5000);
-    ESP.restart();
+  Serial.print("PipsqueakConfig.setup(): remoteSensorAddress = ");
+  for (i = 0; i < CONFIG_IMAGE_ADDRESS_SIZE; i++) {
+    Serial.printf("0x%02X", _image.remoteSensorAddress[i]);
+    if (i < CONFIG_IMAGE_ADDRESS_SIZE - 1) Serial.print(" ");
   }
-  EEPROM.get(cursor, _heaterPin);
-  cursor += heaterPinCount;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): heaterPin = GPIO %02u\n", _heaterPin);
-  #endif
-  uint8_t chillerPinCount;
-  EEPROM.get(cursor, chillerPinCount);
-  cursor += 1;
-  #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): chillerPinCount = %u\n", chillerPinCount);
+  Serial.print("\n");
+  Serial.printf("PipsqueakConfig.setup(): tuning = Kp %f, Ki %f, Kd %f, period %u ms\n", _image.proportionalGain, _image.integralGain, _image.derivativeGain, _image.controlPeriod);
   #endif
-  if (chillerPinCount != 1) {
-    #ifdef DEBUG_PIPSQUEAK_CONFIG
-    Serial.printf("Fatal Error: exactly one configured chiller pin required, %u found\n", chillerPinCount);
-    #endif
-    delay(5);
-    ESP.restart();
+
+  // The journaled profile is laid out as in the EEPROM
+  uint32_t profileBuffer[JOURNAL_PROFILE_SIZE / 4];
+  uint8_t * profile = (uint8_t *) profileBuffer;
+  if (!_journal.read(JOURNAL_KEY_PROFILE, profile, JOURNAL_PROFILE_SIZE)) {
+    ESP.flashRead(EEPROM_PHYS_ADDR + PROFILE_OFFSET, profileBuffer, JOURNAL_PROFILE_SIZE);
+  }
+  uint32_t profileID;
+  uint8_t segmentCount;
+  ProfileSegment segments[PROFILE_SEGMENT_LIMIT];
+  memcpy(&profileID, &profile[0], 4);
+  memcpy(&segmentCount, &profile[4], 1);
+  size_t cursor = PROFILE_SEGMENTS_OFFSET - PROFILE_OFFSET;
+  // An erased sector reads as 0xFF, which load() rejects as too many segments
+  for (i = 0; i < segmentCount && i < PROFILE_SEGMENT_LIMIT; i++) {
+    memcpy(&segments[i].start, &profile[cursor], 4);
+    memcpy(&segments[i].target, &profile[cursor + 4], 4);
+    memcpy(&segments[i].rampRate, &profile[cursor + 8], 4);
+    cursor += PROFILE_SEGMENT_SIZE;
   }
-  EEPROM.get(cursor, _chillerPin);
-  cursor += chillerPinCount;
+  _profile.load(profileID, segmentCount, segments);
   #ifdef DEBUG_PIPSQUEAK_CONFIG
-  Serial.printf("PipsqueakConfig.setup(): chillerPin = GPIO %02u\n", _chillerPin);
+  Serial.printf("PipsqueakConfig.setup(): profile = %u with %u segments\n", _profile.getProfileID(), _profile.getSegmentCount());
   #endif
-  EEPROM.end();
 }
 
 const char * PipsqueakConfig::getWifiSSID() {
-  return _wifiSSID;
+  return _image.wifiSSID;
 }
 
 const char * PipsqueakConfig::getWifiPassword() {
-  return _wifiPassword;
+  return _image.wifiPassword;
 }
 
 IPAddress * PipsqueakConfig::getHostIP() {
-  return _hostIP;
+  return &_hostIP;
 }
 
 uint16_t PipsqueakConfig::getHostPort() {
-  return _hostPort;
+  return _image.hostPort;
 }
 
 uint32_t PipsqueakConfig::getDeviceID() {
-  return _deviceID;
+  return _image.deviceID;
 }
 
 const byte * PipsqueakConfig::getSecretKey() {
-  return _secretKey;
+  return _image.secretKey;
+}
+
+bool PipsqueakConfig::isUsable() {
+  return _imageStatus == CONFIG_IMAGE_VALID || _imageStatus == CONFIG_IMAGE_MIGRATED;
+}
+
+ConfigImageStatus PipsqueakConfig::getImageStatus() {
+  return _imageStatus;
 }
 
 uint8_t PipsqueakConfig::getSignalEnablePin() {
-  return _enablePin;
+  return _image.enablePin;
 }
 
 uint8_t PipsqueakConfig::getOneWirePin() {
-  return _oneWirePin;
+  return _image.oneWirePin;
 }
 
 uint8_t PipsqueakConfig::getRedIndicatorPin() {
-  return _redIndicatorPin;
+  return _image.redIndicatorPin;
 }
 
 uint8_t PipsqueakConfig::getGreenIndicatorPin() {
-  return _greenIndicatorPin;
+  return _image.greenIndicatorPin;
 }
 
 uint8_t PipsqueakConfig::getHeaterPin() {
-  return _heaterPin;
+  return _image.heaterPin;
 }
 
 uint8_t PipsqueakConfig::getChillerPin() {
-  return _chillerPin;
+  return _image.chillerPin;
 }
 
 void PipsqueakConfig::setTemperatureSetpoint(float setpoint) {
-  if (setpoint != _setpoint) {
-    _setpoint = setpoint;
-    persist();
+  if (setpoint != _image.setpoint) {
+    _image.setpoint = setpoint;
+    if (!_journal.write(JOURNAL_KEY_SETPOINT, &_image.setpoint, sizeof(_image.setpoint))) persist();
   }
 }
 
 float PipsqueakConfig::getTemperatureSetpoint() {
-  return _setpoint;
+  return _image.setpoint;
 }
 
 bool PipsqueakConfig::isBoardSensorAddress(uint8_t * address) {
-  return memcmp(address, _boardSensorAddress, BOARD_SENSOR_ADDRESS_SIZE) == 0;
+  return memcmp(address, _image.boardSensorAddress, BOARD_SENSOR_ADDRESS_SIZE) == 0;
 }
 
 uint8_t * PipsqueakConfig::getBoardSensorAddress() {
-  return _boardSensorAddress;
+  return _image.boardSensorAddress;
 }
 
 float PipsqueakConfig::getBoardTemperatureLimit() {
   return BOARD_TEMPERATURE_LIMIT;
 }
 
+float PipsqueakConfig::getBoardSelfHeating() {
+  return BOARD_SELF_HEATING;
+}
+
+uint8_t * PipsqueakConfig::getRemoteSensorAddress() {
+  return _image.remoteSensorAddress;
+}
+
+bool PipsqueakConfig::isPidControlEnabled() {
+  return _image.flags & CONFIG_FLAG_PID_CONTROL;
+}
+
+bool PipsqueakConfig::isMonitorModeEnabled() {
+  return _image.flags & CONFIG_FLAG_MONITOR_MODE;
+}
+
+bool PipsqueakConfig::isTuned() {
+  if (_image.controlPeriod == 0) return false;
+  if (!isfinite(_image.proportionalGain) || _image.proportionalGain <= 0) return false;
+  if (!isfinite(_image.integralGain) || _image.integralGain < 0) return false;
+  if (!isfinite(_image.derivativeGain) || _image.derivativeGain < 0) return false;
+  return true;
+}
+
+float PipsqueakConfig::getProportionalGain() {
+  return _image.proportionalGain;
+}
+
+float PipsqueakConfig::getIntegralGain() {
+  return _image.integralGain;
+}
+
+float PipsqueakConfig::getDerivativeGain() {
+  return _image.derivativeGain;
+}
+
+uint32_t PipsqueakConfig::getControlPeriod() {
+  return _image.controlPeriod;
+}
+
+void PipsqueakConfig::setTuning(float proportionalGain, float integralGain, float derivativeGain, uint32_t controlPeriod) {
+  _image.proportionalGain = proportionalGain;
+  _image.integralGain = integralGain;
+  _image.derivativeGain = derivativeGain;
+  _image.controlPeriod = controlPeriod;
+  uint32_t tuning[JOURNAL_TUNING_SIZE / 4];
+  memcpy(&tuning[0], &_image.proportionalGain, 4);
+  memcpy(&tuning[1], &_image.integralGain, 4);
+  memcpy(&tuning[2], &_image.derivativeGain, 4);
+  tuning[3] = _image.controlPeriod;
+  if (!_journal.write(JOURNAL_KEY_TUNING, tuning, JOURNAL_TUNING_SIZE)) persist();
+}
+
+FermentationProfile * PipsqueakConfig::getProfile() {
+  return &_profile;
+}
+
+bool PipsqueakConfig::setProfile(uint32_t profileID, uint8_t segmentCount, const ProfileSegment * segments) {
+  if (!_profile.load(profileID, segmentCount, segments)) return false;
+  uint8_t profile[JOURNAL_PROFILE_SIZE];
+  memset(profile, 0, JOURNAL_PROFILE_SIZE);
+  memcpy(&profile[0], &profileID, 4);
+  profile[4] = _profile.getSegmentCount();
+  size_t cursor = PROFILE_SEGMENTS_OFFSET - PROFILE_OFFSET;
+  for (size_t i = 0; i < _profile.getSegmentCount(); i++) {
+    memcpy(&profile[cursor], &_profile.getSegment(i)->start, 4);
+    memcpy(&profile[cursor + 4], &_profile.getSegment(i)->target, 4);
+    memcpy(&profile[cursor + 8], &_profile.getSegment(i)->rampRate, 4);
+    cursor += PROFILE_SEGMENT_SIZE;
+  }
+  if (!_journal.write(JOURNAL_KEY_PROFILE, profile, JOURNAL_PROFILE_SIZE)) persist();
+  return true;
+}
+
 void PipsqueakConfig::persist() {
-  EEPROM.begin(256);
-  uint32_t writeCount;
-  EEPROM.get(4, writeCount);
-  EEPROM.put(4, writeCount + 1);
-  EEPROM.put(12, _setpoint);
-  EEPROM.end();
+  // Only if the journal fails, which is then restarted: rewriting the
+  // image changes its CRC, which discards whatever was journaled
+  _image.writeCount += 1;
+  Metrics::increment(METRIC_CONFIG_PERSISTS);
+  ConfigImageFormat::seal(&_image);
+  uint8_t * data = (uint8_t *) persistBuffer;
+  memset(data, 0, EEPROM_SIZE);
+  memcpy(data, &_image, sizeof(_image));
+  uint32_t profileID = _profile.getProfileID();
+  memcpy(&data[PROFILE_OFFSET], &profileID, 4);
+  data[PROFILE_OFFSET + 4] = _profile.getSegmentCount();
+  size_t cursor = PROFILE_SEGMENTS_OFFSET;
+  for (size_t i = 0; i < _profile.getSegmentCount(); i++) {
+    memcpy(&data[cursor], &_profile.getSegment(i)->start, 4);
+    memcpy(&data[cursor + 4], &_profile.getSegment(i)->target, 4);
+    memcpy(&data[cursor + 8], &_profile.getSegment(i)->rampRate, 4);
+    cursor += PROFILE_SEGMENT_SIZE;
+  }
+  uint32_t base = ConfigImageFormat::crc32(data, CONFIG_IMAGE_SIZE);
+  ESP.flashEraseSector(EEPROM_PHYS_ADDR / SPI_FLASH_SEC_SIZE);
+  ESP.flashWrite(EEPROM_PHYS_ADDR, persistBuffer, EEPROM_SIZE);
+  _journal.begin(base);
 }
@@ -3,18 +3,38 @@
 
 #include <Arduino.h>
 #include <ESP8266WiFi.h>
+#include <FermentationProfile.h>
+#include <ConfigJournal.h>
+#include <ConfigImage.h>
 
 // Un-comment to enable detailed debug statements to Serial
 // #define DEBUG_PIPSQUEAK_CONFIG
 
-#define WIFI_SSID_BUFFER_SIZE 32
-#define WIFI_PASSWORD_BUFFER_SIZE 64
-#define SECRET_KEY_BUFFER_SIZE 32
-#define BOARD_SENSOR_ADDRESS_SIZE 8
+#define BOARD_SENSOR_ADDRESS_SIZE CONFIG_IMAGE_ADDRESS_SIZE
+
+// The journal takes the last sectors of the filesystem region, just
+// below the EEPROM's, and the crash dump the sector below those; the
+// Pipsqueak has no filesystem.
+#define JOURNAL_SECTOR_COUNT 4
+
+// The Pipsqueak v3 board's wiring, assumed when the image cannot be
+// read, so that the outputs can be held off and the fault shown
+#define BOARD_SIGNAL_ENABLE_PIN D1
+#define BOARD_ONE_WIRE_PIN D2
+#define BOARD_RED_INDICATOR_PIN D7
+#define BOARD_GREEN_INDICATOR_PIN D6
+#define BOARD_CHILLER_PIN D5
+#define BOARD_HEATER_PIN D8
 
 /**
  * Encapsulates access to persistant memory holding
- * configuration data.
+ * configuration data: the ConfigImage written by the
+ * initializer, read in one go upon setup().
+ *
+ * The values the OS changes (the setpoint, the tuning
+ * and the fermentation profile) are appended to a
+ * ConfigJournal rather than committed to the EEPROM,
+ * whose values they override.
  *
  * Not thread safe or ISR-safe.
  */
@@ -27,9 +47,26 @@ class PipsqueakConfig {
      * class. Until this method is invoked, the values
      * returned by other methods of this class will be
      * meaningless initial values.
+     *
+     * An image of an older version is migrated; one of a
+     * newer version is read as far as this OS knows it.
+     * An image that is blank, corrupt or unsupported leaves
+     * the config unusable.
      */
     void setup();
 
+    /**
+     * Indicates whether setup() read a usable image. If not,
+     * only the pin numbers mean anything: those of the
+     * Pipsqueak v3 board's wiring.
+     */
+    bool isUsable();
+
+    /**
+     * Returns what setup() made of the image.
+     */
+    ConfigImageStatus getImageStatus();
+
     /**
      * Returns the WiFi access point ID to which the
      * Pipsqueak should attempt to connect.
@@ -154,22 +191,80 @@ class PipsqueakConfig {
      */
     float getBoardTemperatureLimit();
 
+    /**
+     * Returns the amount, in degrees Celsius, by which
+     * the onboard sensor reads above the ambient
+     * temperature, warmed by the board's own components.
+     */
+    float getBoardSelfHeating();
+
+    /**
+     * Returns the address of the remote DS18B20
+     * temperature sensor IC recorded by the initializer,
+     * or all zeros if none was recorded. Any other probe
+     * may take its place.
+     */
+    uint8_t * getRemoteSensorAddress();
+
+    /**
+     * Indicates whether the temperature is to be regulated
+     * by the PID loop rather than by fixed "bang bang"
+     * pulses.
+     */
+    bool isPidControlEnabled();
+
+    /**
+     * Indicates whether the device only logs temperatures,
+     * sleeping between samples, rather than regulating them.
+     */
+    bool isMonitorModeEnabled();
+
+    /**
+     * Indicates whether autotuned PID parameters have been
+     * stored.
+     */
+    bool isTuned();
+
+    /**
+     * Returns the autotuned PID gains. Meaningless unless
+     * isTuned() returns true.
+     */
+    float getProportionalGain();
+    float getIntegralGain();
+    float getDerivativeGain();
+
+    /**
+     * Returns the autotuned PID control period in
+     * milliseconds, or 0 if not tuned.
+     */
+    uint32_t getControlPeriod();
+
+    /**
+     * Updates and persists autotuned PID parameters.
+     */
+    void setTuning(float proportionalGain, float integralGain, float derivativeGain, uint32_t controlPeriod);
+
+    /**
+     * Returns the persisted fermentation profile, which
+     * is empty if none has been downloaded.
+     */
+    FermentationProfile * getProfile();
+
+    /**
+     * Replaces and persists the fermentation profile.
+     *
+     * Returns false, leaving the current profile in
+     * place, if the segments are invalid. See
+     * FermentationProfile::load().
+     */
+    bool setProfile(uint32_t profileID, uint8_t segmentCount, const ProfileSegment * segments);
+
   private:
-    char _wifiSSID[WIFI_SSID_BUFFER_SIZE];
-    char _wifiPassword[WIFI_PASSWORD_BUFFER_SIZE];
-    IPAddress * _hostIP;
-    uint16_t _hostPort;
-    uint32_t _deviceID;
-    byte _secretKey[SECRET_KEY_BUFFER_SIZE];
-    uint8_t _configurationFlags;
-    uint8_t _enablePin;
-    uint8_t _oneWirePin;
-    uint8_t _redIndicatorPin;
-    uint8_t _greenIndicatorPin;
-    uint8_t _heaterPin;
-    uint8_t _chillerPin;
-    float _setpoint;
-    byte _boardSensorAddress[BOARD_SENSOR_ADDRESS_SIZE];
+    ConfigImage _image;
+    ConfigImageStatus _imageStatus;
+    IPAddress _hostIP;
+    FermentationProfile _profile;
+    ConfigJournal _journal;
 
     void persist();
 };
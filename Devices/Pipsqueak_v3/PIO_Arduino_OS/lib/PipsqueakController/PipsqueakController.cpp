@@ -1,4 +1,7 @@
 #include "PipsqueakController.h"
+#include <Profiler.h>
+#include <BinaryLog.h>
+#include <Metrics.h>
 
 #define HEATER_PULSE_DURATION 10000
 #define HEATER_PULSE_POWER 100
@@ -14,30 +17,241 @@
 
 #define TEMPERATURE_TOLERANCE REMOTE_SENSOR_RESOLUTION
 
+// PID mode: output is -1.0 (full chill) to 1.0 (full heat)
+#define PID_OUTPUT_MIN -1.0
+#define PID_OUTPUT_MAX 1.0
+#define PID_CONTROL_PERIOD 30000 // ms
+#define PID_KP 0.5    // per degree C
+#define PID_KI 0.0005 // per degree C second
+#define PID_KD 20.0   // per degree C per second
+
+// PID mode: feed-forward from the ambient temperature, learned over
+// a day so that the daily swing in ambient temperature is captured
+#define FEED_FORWARD_TIME_CONSTANT 86400 // s
+#define FEED_FORWARD_GAIN_LIMIT 0.5      // per degree C
+
+// PID mode: relay-feedback autotuning switches the heater between full
+// power and off across a band twice the sensor resolution wide
+#define AUTOTUNE_OUTPUT_HIGH 1.0
+#define AUTOTUNE_OUTPUT_LOW 0.0
+#define AUTOTUNE_HYSTERESIS (2 * REMOTE_SENSOR_RESOLUTION)
+
+// PID mode: exponential moving average of the remote and ambient temperatures
+#define FILTER_INTERVAL 1000 // ms
+#define FILTER_WEIGHT 0.2
+
+// PID mode: heater power below this is not worth switching on for
+#define HEATER_MINIMUM_POWER 5 // percent
+
+// PID mode: chiller on-times shorter than this are rounded
+#define CHILLER_MINIMUM_PULSE_DURATION 1000 // ms
+
 PipsqueakController::PipsqueakController(PipsqueakState * state)
 :
+  _pid { PID_KP, PID_KI, PID_KD, PID_OUTPUT_MIN, PID_OUTPUT_MAX },
+  _feedForward { FEED_FORWARD_TIME_CONSTANT, FEED_FORWARD_GAIN_LIMIT },
+  _autotune { AUTOTUNE_OUTPUT_HIGH, AUTOTUNE_OUTPUT_LOW, AUTOTUNE_HYSTERESIS },
+  _autotuneRequested { false },
+  _heater(),
+  _chiller(),
   _heating { false },
   _chilling { false },
-  _pulseDuration { 0 },
   _recoveryDuration { INITIAL_QUIET_PERIOD },
-  _lastToggled { 0 }
+  _lastToggled { 0 },
+  _filteredTemperature { NAN },
+  _filteredAmbient { NAN },
+  _lastFiltered { 0 },
+  _lastControlPeriod { 0 },
+  _controlPeriod { PID_CONTROL_PERIOD },
+  _phaseRestored { false }
 {
   _state = state;
   _config = state->getConfig();
 }
 
 void PipsqueakController::setup() {
-  pinMode(_config->getHeaterPin(), OUTPUT);
-  digitalWrite(_config->getHeaterPin(), LOW);
-  pinMode(_config->getChillerPin(), OUTPUT);
-  digitalWrite(_config->getChillerPin(), LOW);
+  _heater.setup(_config->getHeaterPin());
+  _chiller.setup(_config->getChillerPin());
+  if (_config->isTuned()) {
+    applyTuning();
+  } else if (_config->isPidControlEnabled()) {
+    // Untuned vessels tune themselves once per boot until they succeed
+    _autotuneRequested = true;
+  }
+  if (_state->getWarmBoot()->isRestored()) restorePhase();
+}
+
+void PipsqueakController::restorePhase() {
+  WarmBoot * warmBoot = _state->getWarmBoot();
+  WarmBootRecord * record = warmBoot->getRecord();
+  if (!(record->flags & WARM_BOOT_FLAG_CONTROLLER)) return;
+
+  // The learned gains don't go stale
+  _feedForward.setGains(record->heatingGain, record->chillingGain);
+  if (!warmBoot->isRecent()) return;
+
+  // Carry on with the recovery and control period in progress,
+  // less the time spent resetting
+  uint32_t downtime = warmBoot->getDowntime();
+  _recoveryDuration = record->recoveryRemaining > downtime ? record->recoveryRemaining - downtime : 0;
+  _lastToggled = millis();
+  uint32_t periodRemaining = record->periodRemaining > downtime ? record->periodRemaining - downtime : 0;
+  _lastControlPeriod = millis() - (_controlPeriod - min(periodRemaining, _controlPeriod));
+  _pid.setIntegral(record->integral);
+  _phaseRestored = true;
+  BinaryLog::write(LOG_CONTROLLER_PHASE_RESTORED, _recoveryDuration, periodRemaining, _pid.getIntegral());
+}
+
+void PipsqueakController::savePhase() {
+  WarmBootRecord * record = _state->getWarmBoot()->getRecord();
+  // A pulse cut short by a reset is followed by its full recovery
+  if (isRunning()) {
+    record->recoveryRemaining = _recoveryDuration;
+  } else if (isRecovering()) {
+    record->recoveryRemaining = _recoveryDuration - (millis() - _lastToggled);
+  } else {
+    record->recoveryRemaining = 0;
+  }
+  record->periodRemaining = _controlPeriod - min((uint32_t) (millis() - _lastControlPeriod), _controlPeriod);
+  record->integral = _pid.getIntegral();
+  record->heatingGain = _feedForward.getHeatingGain();
+  record->chillingGain = _feedForward.getChillingGain();
+  record->flags |= WARM_BOOT_FLAG_CONTROLLER;
+}
+
+bool PipsqueakController::startAutotune() {
+  if (!_config->isPidControlEnabled()) return false;
+  _autotuneRequested = true;
+  return true;
+}
+
+bool PipsqueakController::isAutotuning() {
+  return _autotuneRequested || _autotune.isRunning();
+}
+
+void PipsqueakController::schedule(Scheduler * scheduler) {
+  scheduler->every("controller", CONTROLLER_TASK_INTERVAL, [](void * controller) { ((PipsqueakController *) controller)->loop(); }, this);
 }
 
 void PipsqueakController::loop() {
+  PROFILER_SCOPE(PROFILER_SLOT_CONTROLLER_LOOP);
+  // Control resumes on the restored schedule once the readings are valid
+  if (_phaseRestored && _state->isSafeToOperate()) _state->recordControlStart();
+  if (_config->isPidControlEnabled()) {
+    pidLoop();
+  } else {
+    bangBangLoop();
+  }
+  if (shouldStopRunning()) stopRunning();
+  _state->setOutputActive(_heater.isActive() || _chiller.isActive());
+  savePhase();
+}
+
+void PipsqueakController::bangBangLoop() {
+  if (!isRunning() && !isRecovering() && _state->isSafeToOperate()) _state->recordControlStart();
   if (shouldHeat()) heaterPulse();
   if (shouldChill()) chillerPulse();
-  if (shouldStopRunning()) stopRunning();
-  if (_heating) modulateHeater();
+}
+
+void PipsqueakController::pidLoop() {
+  filterTemperature();
+  if (_autotune.isRunning() && !_state->isSafeToOperate()) {
+    _autotune.abort();
+    autotuneComplete();
+  }
+  // Each period's pulse runs to completion before the next period begins
+  if (isRunning() || millis() - _lastControlPeriod < _controlPeriod) return;
+  _lastControlPeriod = millis();
+  if (_autotuneRequested || _autotune.isRunning()) {
+    autotunePeriod();
+  } else {
+    controlPeriod();
+  }
+}
+
+void PipsqueakController::filterTemperature() {
+  if (millis() - _lastFiltered < FILTER_INTERVAL) return;
+  _lastFiltered = millis();
+  float temperature = _state->getRemoteTemperature();
+  if (isnan(temperature) || isnan(_filteredTemperature)) {
+    _filteredTemperature = temperature;
+  } else {
+    _filteredTemperature += FILTER_WEIGHT * (temperature - _filteredTemperature);
+  }
+  float ambient = _state->getAmbientTemperature();
+  if (isnan(ambient) || isnan(_filteredAmbient)) {
+    _filteredAmbient = ambient;
+  } else {
+    _filteredAmbient += FILTER_WEIGHT * (ambient - _filteredAmbient);
+  }
+}
+
+void PipsqueakController::controlPeriod() {
+  if (!_state->isSafeToOperate() || isnan(_filteredTemperature)) {
+    // Start afresh once it is safe again rather than acting on stale history
+    _pid.reset();
+    return;
+  }
+  _state->recordControlStart();
+
+  float setpoint = _state->getTemperatureSetpoint();
+  float elapsedSeconds = _controlPeriod / 1000.0;
+  float feedForward = _feedForward.compute(setpoint, _filteredAmbient);
+  float output = _pid.update(setpoint, _filteredTemperature, elapsedSeconds, feedForward);
+  _feedForward.learn(output, setpoint, _filteredTemperature, _filteredAmbient, elapsedSeconds);
+  BinaryLog::write(LOG_CONTROLLER_PERIOD, _filteredTemperature, _filteredAmbient, output, _pid.getIntegral(), feedForward);
+
+  if (output > 0) {
+    uint8_t percentPower = (uint8_t) roundf(output * 100);
+    if (percentPower >= HEATER_MINIMUM_POWER) {
+      heaterPulse(_controlPeriod, percentPower, 0);
+    }
+  } else if (output < 0 && !isRecovering()) {
+    uint32_t pulseDuration = (uint32_t) roundf(-output * _controlPeriod);
+    if (pulseDuration >= CHILLER_MINIMUM_PULSE_DURATION / 2) {
+      chillerPulse(max(pulseDuration, (uint32_t) CHILLER_MINIMUM_PULSE_DURATION), CHILLER_RECOVERY_DURATION);
+    }
+  }
+}
+
+void PipsqueakController::autotunePeriod() {
+  if (!_state->isSafeToOperate() || isnan(_filteredTemperature)) return;
+  _state->recordControlStart();
+  if (_autotuneRequested) {
+    BinaryLog::write(LOG_CONTROLLER_AUTOTUNE_STARTED);
+    _autotuneRequested = false;
+    // with the heater off, the vessel settles at the ambient temperature
+    _autotune.start(_state->getTemperatureSetpoint(), millis(), _filteredAmbient);
+  }
+  float output = _autotune.update(_filteredTemperature, millis());
+  if (!_autotune.isRunning()) {
+    autotuneComplete();
+    return;
+  }
+  if (output > 0) {
+    heaterPulse(_controlPeriod, (uint8_t) roundf(output * 100), 0);
+  }
+}
+
+void PipsqueakController::autotuneComplete() {
+  AutotuneOutcome outcome = _autotune.getOutcome();
+  BinaryLog::write(LOG_CONTROLLER_AUTOTUNE_COMPLETE, outcome, _autotune.getUltimateGain(), _autotune.getUltimatePeriod());
+  if (outcome == AutotuneSucceeded) {
+    _config->setTuning(
+      _autotune.getProportionalGain(),
+      _autotune.getIntegralGain(),
+      _autotune.getDerivativeGain(),
+      _autotune.getControlPeriod()
+    );
+    applyTuning();
+  }
+  _state->recordTuningResult(_autotune.getUltimateGain(), _autotune.getUltimatePeriod() / 1000, outcome);
+  _pid.reset();
+}
+
+void PipsqueakController::applyTuning() {
+  _pid.setGains(_config->getProportionalGain(), _config->getIntegralGain(), _config->getDerivativeGain());
+  _controlPeriod = _config->getControlPeriod();
 }
 
 bool PipsqueakController::isRunning() {
@@ -53,25 +267,17 @@ bool PipsqueakController::shouldHeat() {
 }
 
 void PipsqueakController::heaterPulse() {
-  #ifdef DEBUG_PIPSQUEAK_CONTROLLER
-  Serial.println("PipsqueakController.heaterPulse()");
-  #endif
-  _heating = true;
-  _pulseDuration = HEATER_PULSE_DURATION;
-  _recoveryDuration = HEATER_RECOVERY_DURATION;
-  _lastToggled = millis();
-  _state->recordHeaterPulse(HEATER_PULSE_DURATION, HEATER_PULSE_POWER, HEATER_RECOVERY_DURATION);
+  heaterPulse(HEATER_PULSE_DURATION, HEATER_PULSE_POWER, HEATER_RECOVERY_DURATION);
 }
 
-void PipsqueakController::modulateHeater() {
-  if (!_heating) return;
-  // Use poor man's pulse-width modulation to reduce power delivery
-  // 100ms period, deliver power for the first _percentPower ms of each period
-  // Note that this neatly takes care of % power values > 100
-  digitalWrite(_config->getHeaterPin(), (millis() % 100) < HEATER_PULSE_POWER ? HIGH : LOW);
-  #ifdef DEBUG_PIPSQUEAK_CONTROLLER
-  Serial.printf("PipsqueakController.modulateHeater(): %s\n", (millis() % 100) < HEATER_PULSE_POWER ? "HIGH" : "LOW");
-  #endif
+void PipsqueakController::heaterPulse(uint32_t pulseDuration, uint8_t percentPower, uint32_t recoveryDuration) {
+  BinaryLog::write(LOG_CONTROLLER_HEATER_PULSE, pulseDuration, percentPower);
+  Metrics::increment(METRIC_HEATER_PULSES);
+  _heating = true;
+  _recoveryDuration = recoveryDuration;
+  _lastToggled = millis();
+  _state->recordHeaterPulse(pulseDuration, percentPower, recoveryDuration);
+  _heater.start(pulseDuration, percentPower);
 }
 
 bool PipsqueakController::shouldChill() {
@@ -83,15 +289,17 @@ bool PipsqueakController::shouldChill() {
 }
 
 void PipsqueakController::chillerPulse() {
-  #ifdef DEBUG_PIPSQUEAK_CONTROLLER
-  Serial.println("PipsqueakController.chillerPulse()");
-  #endif
+  chillerPulse(CHILLER_PULSE_DURATION, CHILLER_RECOVERY_DURATION);
+}
+
+void PipsqueakController::chillerPulse(uint32_t pulseDuration, uint32_t recoveryDuration) {
+  BinaryLog::write(LOG_CONTROLLER_CHILLER_PULSE, pulseDuration);
+  Metrics::increment(METRIC_CHILLER_PULSES);
   _chilling = true;
-  _pulseDuration = CHILLER_PULSE_DURATION;
-  _recoveryDuration = CHILLER_RECOVERY_DURATION;
+  _recoveryDuration = recoveryDuration;
   _lastToggled = millis();
-  _state->recordChillerPulse(CHILLER_PULSE_DURATION, CHILLER_RECOVERY_DURATION);
-  digitalWrite(_config->getChillerPin(), HIGH);
+  _state->recordChillerPulse(pulseDuration, recoveryDuration);
+  _chiller.start(pulseDuration);
 }
 
 bool PipsqueakController::isRecovering() {
@@ -101,24 +309,23 @@ bool PipsqueakController::isRecovering() {
 bool PipsqueakController::shouldStopRunning() {
   if (!isRunning()) return false;
   if (!_state->isSafeToOperate()) return true;
-  return millis() - _lastToggled >= _pulseDuration;
+  // The outputs end their own pulses; this just catches up with them
+  return !(_heater.isActive() || _chiller.isActive());
 }
 
 void PipsqueakController::stopRunning() {
-  #ifdef DEBUG_PIPSQUEAK_CONTROLLER
-  Serial.println("PipsqueakController.stopRunning()");
-  #endif
-  digitalWrite(_config->getHeaterPin(), LOW);
+  BinaryLog::write(LOG_CONTROLLER_STOPPED);
+  _heater.stop();
   _heating = false;
-  digitalWrite(_config->getChillerPin(), LOW);
+  _chiller.stop();
   _chilling = false;
   _lastToggled = millis();
 }
 
 float PipsqueakController::upperLimit() {
-  return _config->getTemperatureSetpoint() + TEMPERATURE_TOLERANCE;
+  return _state->getTemperatureSetpoint() + TEMPERATURE_TOLERANCE;
 }
 
 float PipsqueakController::lowerLimit() {
-  return _config->getTemperatureSetpoint() - TEMPERATURE_TOLERANCE;
+  return _state->getTemperatureSetpoint() - TEMPERATURE_TOLERANCE;
 }
@@ -3,31 +3,80 @@
 
 #include <Arduino.h>
 #include <PipsqueakState.h>
+#include <PidLoop.h>
+#include <FeedForward.h>
+#include <PulseOutput.h>
+#include <RelayAutotune.h>
+#include <Scheduler.h>
 
-// Un-comment to enable detailed debug logging
-// #define DEBUG_PIPSQUEAK_CONTROLLER
+#define CONTROLLER_TASK_INTERVAL 100 // ms
 
 class PipsqueakController {
   public:
     PipsqueakController(PipsqueakState * state);
     void setup();
+
+    /**
+     * Registers a task that runs loop() every
+     * CONTROLLER_TASK_INTERVAL ms. Invoke once after setup().
+     */
+    void schedule(Scheduler * scheduler);
+
     void loop();
 
+    /**
+     * Requests a relay-feedback autotuning experiment, which
+     * begins at the start of the next control period provided
+     * it is safe to operate. The experiment runs the heater
+     * in place of the PID loop until it completes, persisting
+     * the derived PID parameters on success.
+     *
+     * Returns false if PID control is not enabled.
+     */
+    bool startAutotune();
+
+    /**
+     * Indicates whether an autotuning experiment is requested
+     * or in progress.
+     */
+    bool isAutotuning();
+
   private:
     PipsqueakState * _state;
     PipsqueakConfig * _config;
+    PidLoop _pid;
+    FeedForward _feedForward;
+    RelayAutotune _autotune;
+    bool _autotuneRequested;
+    PulseOutput _heater;
+    PulseOutput _chiller;
     bool _heating;
     bool _chilling;
-    uint32_t _pulseDuration;
     uint32_t _recoveryDuration;
     uint32_t _lastToggled;
+    float _filteredTemperature;
+    float _filteredAmbient;
+    uint32_t _lastFiltered;
+    uint32_t _lastControlPeriod;
+    uint32_t _controlPeriod;
+    bool _phaseRestored;
 
+    void bangBangLoop();
+    void pidLoop();
+    void filterTemperature();
+    void controlPeriod();
+    void autotunePeriod();
+    void autotuneComplete();
+    void applyTuning();
+    void restorePhase();
+    void savePhase();
     bool isRunning();
     bool shouldHeat();
     void heaterPulse();
-    void modulateHeater();
+    void heaterPulse(uint32_t pulseDuration, uint8_t percentPower, uint32_t recoveryDuration);
     bool shouldChill();
     void chillerPulse();
+    void chillerPulse(uint32_t pulseDuration, uint32_t recoveryDuration);
     bool isRecovering();
     bool shouldStopRunning();
     void stopRunning();
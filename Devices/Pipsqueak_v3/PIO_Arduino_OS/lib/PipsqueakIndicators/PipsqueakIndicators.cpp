@@ -1,5 +1,6 @@
 #include "PipsqueakIndicators.h"
 #include <ESP8266WiFi.h>
+#include <Profiler.h>
 
 PipsqueakIndicators::PipsqueakIndicators(PipsqueakState * state) {
   _state = state;
@@ -13,7 +14,12 @@ void PipsqueakIndicators::setup() {
   digitalWrite(_config->getGreenIndicatorPin(), LOW);
 }
 
+void PipsqueakIndicators::schedule(Scheduler * scheduler) {
+  scheduler->every("indicators", INDICATORS_TASK_INTERVAL, [](void * indicators) { ((PipsqueakIndicators *) indicators)->loop(); }, this);
+}
+
 void PipsqueakIndicators::loop() {
+  PROFILER_SCOPE(PROFILER_SLOT_INDICATORS_LOOP);
   uint8_t greenState = HIGH;
   uint8_t redState = LOW;
 
@@ -21,7 +27,13 @@ void PipsqueakIndicators::loop() {
   Serial.println("PipsqueakIndicators.loop(): begin loop -----------------------");
   #endif
 
-  if (!_state->isInitialized()) {
+  if (!_config->isUsable()) {
+    #ifdef DEBUG_PIPSQUEAK_INDICATORS
+    Serial.println("PipsqueakIndicators.loop(): configuration unusable");
+    #endif
+    greenState = LOW;
+    redState = blink(BLINK_PATTERN_DASH_DASH);
+  } else if (!_state->isInitialized()) {
     #ifdef DEBUG_PIPSQUEAK_INDICATORS
     Serial.println("PipsqueakIndicators.loop(): initializing");
     #endif
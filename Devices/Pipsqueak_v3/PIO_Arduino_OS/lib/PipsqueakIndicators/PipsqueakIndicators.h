@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <PipsqueakState.h>
+#include <Scheduler.h>
 
 // long on - short off
 #define BLINK_PATTERN_DASH_DOT 0
@@ -18,10 +19,20 @@
 // Un-comment for detailed debugging
 // #define DEBUG_PIPSQUEAK_INDICATORS
 
+// Blink patterns are made of 250ms phases
+#define INDICATORS_TASK_INTERVAL 250 // ms
+
 class PipsqueakIndicators {
   public:
     PipsqueakIndicators(PipsqueakState * state);
     void setup();
+
+    /**
+     * Registers a task that runs loop() every
+     * INDICATORS_TASK_INTERVAL ms. Invoke once after setup().
+     */
+    void schedule(Scheduler * scheduler);
+
     void loop();
 
   private:
@@ -0,0 +1,140 @@
+#include "PipsqueakMonitor.h"
+#include <DS18B20.h>
+#include <RtcStore.h>
+#include <TimeLib.h>
+
+#define SENSOR_SEARCH_LIMIT 4
+
+PipsqueakMonitor::PipsqueakMonitor(PipsqueakState * pipsqueakState)
+:
+  _state { pipsqueakState },
+  _config { pipsqueakState->getConfig() },
+  _batch(),
+  _flushDue { false },
+  _sampled { false },
+  _recorded { false }
+{
+}
+
+void PipsqueakMonitor::setup() {
+  // No batch survives a loss of power, so report upon power-up
+  bool poweredUp = !RtcStore::read(RTC_STORE_MONITOR_BATCH, &_batch, sizeof(_batch));
+  _batch.countWake();
+  sample();
+  _flushDue = poweredUp || _batch.getWakeCount() >= MONITOR_FLUSH_WAKES || _batch.isFull();
+  #ifdef DEBUG_PIPSQUEAK_MONITOR
+  Serial.printf("PipsqueakMonitor.setup(): wake %u, %u samples, flush %s\n", _batch.getWakeCount(), _batch.getSampleCount(), _flushDue ? "due" : "not due");
+  #endif
+}
+
+void PipsqueakMonitor::sample() {
+  OneWire oneWire(_config->getOneWirePin());
+  uint8_t remoteAddress[DS18B20_ADDRESS_SIZE];
+  if (!findRemoteSensor(&oneWire, remoteAddress)) {
+    _state->setRemoteSensorDetected(false);
+    return;
+  }
+
+  // Both convert at once; the remote, at the higher resolution, takes longer
+  DS18B20 remote(&oneWire, remoteAddress, MONITOR_REMOTE_SENSOR_RESOLUTION, MONITOR_SLEEP_INTERVAL);
+  DS18B20 board(&oneWire, _config->getBoardSensorAddress(), MONITOR_BOARD_SENSOR_RESOLUTION, MONITOR_SLEEP_INTERVAL);
+  remote.startSensing();
+  board.startSensing();
+  delay(remote.getMillisUntilReady());
+  while (!remote.read()) yield();
+  while (!board.read()) yield();
+
+  float temperature = remote.getLastReading();
+  float boardTemperature = board.getLastReading();
+  if (isnan(temperature)) {
+    // Search again next time, in case the probe was swapped
+    uint8_t unknown[DS18B20_ADDRESS_SIZE] = { 0 };
+    _batch.setSensorAddress(unknown);
+  } else {
+    _batch.append(temperature);
+    _sampled = true;
+  }
+
+  // Just as PipsqueakSensors would, should this wake flush
+  _state->setBoardSensorDetected(!isnan(boardTemperature));
+  _state->setBoardTemperature(boardTemperature);
+  _state->setRemoteSensorDetected(!isnan(temperature));
+  _state->setRemoteTemperature(temperature);
+}
+
+bool PipsqueakMonitor::findRemoteSensor(OneWire * oneWire, uint8_t * address) {
+  uint8_t unknown[DS18B20_ADDRESS_SIZE] = { 0 };
+  if (memcmp(_batch.getSensorAddress(), unknown, DS18B20_ADDRESS_SIZE) != 0) {
+    memcpy(address, _batch.getSensorAddress(), DS18B20_ADDRESS_SIZE);
+    return true;
+  }
+
+  uint8_t found[SENSOR_SEARCH_LIMIT * DS18B20_ADDRESS_SIZE];
+  size_t count = min(DS18B20::detect(oneWire, found, SENSOR_SEARCH_LIMIT), (size_t) SENSOR_SEARCH_LIMIT);
+  uint8_t * candidate = NULL;
+  for (size_t i = 0; i < count; i++) {
+    uint8_t * sensor = &found[i * DS18B20_ADDRESS_SIZE];
+    if (_config->isBoardSensorAddress(sensor)) continue;
+    // Prefer the probe recorded by the initializer over, e.g., an ambient probe
+    if (memcmp(sensor, _config->getRemoteSensorAddress(), DS18B20_ADDRESS_SIZE) == 0) {
+      candidate = sensor;
+      break;
+    }
+    if (!candidate) candidate = sensor;
+  }
+  if (!candidate) return false;
+  memcpy(address, candidate, DS18B20_ADDRESS_SIZE);
+  _batch.setSensorAddress(address);
+  return true;
+}
+
+bool PipsqueakMonitor::isFlushDue() {
+  return _flushDue;
+}
+
+bool PipsqueakMonitor::isFlushDueAfterNextSample() {
+  return _batch.getWakeCount() + 1 >= MONITOR_FLUSH_WAKES ||
+    _batch.getSampleCount() + 1 >= MONITOR_BATCH_LIMIT;
+}
+
+void PipsqueakMonitor::sleep() {
+  // The clock stops in deep sleep, so the batch clock is advanced
+  // by the time awake and the time about to be spent asleep
+  _batch.advance(millis() + MONITOR_SLEEP_INTERVAL);
+  if (_flushDue) _batch.resetWakeCount();
+  bool flushNext = isFlushDueAfterNextSample();
+  RtcStore::write(RTC_STORE_MONITOR_BATCH, &_batch, sizeof(_batch));
+  #ifdef DEBUG_PIPSQUEAK_MONITOR
+  Serial.printf("PipsqueakMonitor.sleep(): %u samples; radio %s upon waking\n", _batch.getSampleCount(), flushNext ? "enabled" : "disabled");
+  #endif
+  ESP.deepSleep(MONITOR_SLEEP_INTERVAL * 1000ULL, flushNext ? WAKE_RF_DEFAULT : WAKE_RF_DISABLED);
+}
+
+void PipsqueakMonitor::schedule(Scheduler * scheduler) {
+  scheduler->every("monitor", MONITOR_TASK_INTERVAL, [](void * monitor) { ((PipsqueakMonitor *) monitor)->loop(); }, this);
+}
+
+void PipsqueakMonitor::loop() {
+  if (millis() > MONITOR_FLUSH_TIMEOUT) {
+    #ifdef DEBUG_PIPSQUEAK_MONITOR
+    Serial.println("PipsqueakMonitor.loop(): flush timed out; keeping the batch");
+    #endif
+    sleep();
+  }
+  if (!_state->isClockSynchronized()) return;
+
+  if (!_recorded) {
+    // PipsqueakState reports this wake's sample upon clock sync
+    size_t count = _batch.getSampleCount() - (_sampled ? 1 : 0);
+    for (size_t i = 0; i < count; i++) {
+      _state->recordTemperatureObservation(_batch.getTimestamp(i, now()), _batch.getTemperature(i));
+    }
+    _recorded = true;
+    return;
+  }
+
+  if (!_state->hasStatusEvents() && !_state->isRadioRequired()) {
+    _batch.clear();
+    sleep();
+  }
+}
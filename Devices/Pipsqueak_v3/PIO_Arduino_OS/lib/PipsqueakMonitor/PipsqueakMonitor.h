@@ -0,0 +1,89 @@
+#ifndef PipsqueakMonitor_h
+#define PipsqueakMonitor_h
+
+#include <Arduino.h>
+#include <PipsqueakState.h>
+#include <MonitorBatch.h>
+#include <OneWire.h>
+#include <Scheduler.h>
+
+#define MONITOR_SLEEP_INTERVAL 60000 // ms
+#define MONITOR_FLUSH_WAKES 15
+#define MONITOR_FLUSH_TIMEOUT 30000 // ms
+#define MONITOR_TASK_INTERVAL 100 // ms
+#define MONITOR_REMOTE_SENSOR_RESOLUTION 12 // bits
+#define MONITOR_BOARD_SENSOR_RESOLUTION 9 // bits
+
+// Un-comment to enable debug statements via Serial
+// #define DEBUG_PIPSQUEAK_MONITOR
+
+/**
+ * Runs a Pipsqueak in monitor mode (see
+ * PipsqueakConfig::isMonitorModeEnabled()): it wakes from deep
+ * sleep every MONITOR_SLEEP_INTERVAL ms, samples the remote
+ * temperature once, appends the sample to a batch kept in RTC
+ * memory, and goes back to sleep. Every MONITOR_FLUSH_WAKES
+ * wakes, when the batch is full, and upon power-up, it instead
+ * stays awake long enough for the client to synchronize the clock
+ * and report the batch as temperature observation status events.
+ *
+ * The radio is only calibrated on wakes that flush.
+ */
+class PipsqueakMonitor {
+  public:
+    /**
+     * Constructor.
+     *
+     * pipsqueakState: ptr to singleton application instance
+     */
+    PipsqueakMonitor(PipsqueakState * pipsqueakState);
+
+    /**
+     * Restores the batch and samples the temperature. Invoke once
+     * in the Arduino's setup() function, right after the setup()
+     * method of the PipsqueakState.
+     */
+    void setup();
+
+    /**
+     * Indicates whether this wake is to flush the batch. If not,
+     * invoke sleep() right away.
+     */
+    bool isFlushDue();
+
+    /**
+     * Saves the batch to RTC memory and deep sleeps for
+     * MONITOR_SLEEP_INTERVAL ms. Does not return: the device
+     * resets upon waking.
+     */
+    void sleep();
+
+    /**
+     * Registers a task that runs loop() every
+     * MONITOR_TASK_INTERVAL ms while flushing. Invoke once after
+     * setup().
+     */
+    void schedule(Scheduler * scheduler);
+
+    /**
+     * Records the batch as status events once the clock is
+     * synchronized, and sleeps once they have been sent, or after
+     * MONITOR_FLUSH_TIMEOUT ms, whichever is sooner. Invoked by the
+     * task registered via schedule().
+     */
+    void loop();
+
+  private:
+    PipsqueakState * _state;
+    PipsqueakConfig * _config;
+    MonitorBatch _batch;
+    bool _flushDue;
+    bool _sampled;
+    bool _recorded;
+
+    void sample();
+    bool findRemoteSensor(OneWire * oneWire, uint8_t * address);
+    bool isFlushDueAfterNextSample();
+};
+
+#endif // PipsqueakMonitor_h
@@ -1,95 +1,217 @@
 #include "PipsqueakSensors.h"
+#include <Profiler.h>
+#include <BinaryLog.h>
+#include <new>
 
 // amount of time that a temperature reading is considered "current"
 #define BOARD_READING_TTL           1000 // ms
 #define REMOTE_READING_TTL          5000 // ms
+#define AMBIENT_READING_TTL         5000 // ms
 
 #define BOARD_SENSOR_RESOLUTION     9  // bits
 #define REMOTE_SENSOR_RESOLUTION    12 // bits
+#define AMBIENT_SENSOR_RESOLUTION   9  // bits
+
+// the slot each role's sensor is constructed in
+#define BOARD_SENSOR_SLOT           0
+#define REMOTE_SENSOR_SLOT          1
+#define AMBIENT_SENSOR_SLOT         2
 
 PipsqueakSensors::PipsqueakSensors(PipsqueakState * state)
 :
+  _oneWire(),
+  _scanner(&_oneWire),
   _boardSensor { NULL },
   _remoteSensor { NULL },
-  _sensorToggle { false }
+  _ambientSensor { NULL },
+  _sensorCursor { 0 },
+  _scheduler { NULL },
+  _task { SCHEDULER_NO_TASK }
 {
   _state = state;
   _config = state->getConfig();
 }
 
 void PipsqueakSensors::setup() {
-  _oneWire = new OneWire(_config->getOneWirePin());
+  _oneWire.begin(_config->getOneWirePin());
+
+  // After a soft reset, carry on with the sensors attached before
+  // it rather than waiting on the first sweep of the bus
+  if (_state->getWarmBoot()->isRestored()) restoreSensors();
+}
+
+void PipsqueakSensors::schedule(Scheduler * scheduler) {
+  _scheduler = scheduler;
+  _task = scheduler->every("sensors", SENSORS_TASK_INTERVAL, [](void * context) {
+    PipsqueakSensors * sensors = (PipsqueakSensors *) context;
+    sensors->loop();
+    sensors->_scheduler->wakeIn(sensors->_task, sensors->getIdleMillis());
+  }, this);
 }
 
 void PipsqueakSensors::loop() {
-  if (!(_boardSensor || _remoteSensor)) {
-    detectSensors();
-    return;
+  PROFILER_SCOPE(PROFILER_SLOT_SENSORS_LOOP);
+  if (_boardSensor && _boardSensor->isReadyToRead()) {
+    if (_boardSensor->read()) {
+      _state->setBoardTemperature(_boardSensor->getTemperature());
+    }
+    _scanner.interrupt();
   }
-  if (_boardSensor->isReadyToRead() && _boardSensor->read()) {
-    _state->setBoardTemperature(_boardSensor->getTemperature());
+  if (_remoteSensor && _remoteSensor->isReadyToRead()) {
+    if (_remoteSensor->read()) {
+      _state->setRemoteTemperature(_remoteSensor->getTemperature());
+    }
+    _scanner.interrupt();
   }
-  if (_remoteSensor->isReadyToRead() && _remoteSensor->read()) {
-    _state->setRemoteTemperature(_remoteSensor->getTemperature());
+  if (_ambientSensor && _ambientSensor->isReadyToRead()) {
+    if (_ambientSensor->read()) {
+      _state->setAmbientTemperature(_ambientSensor->getTemperature());
+    }
+    _scanner.interrupt();
   }
-  if (!(_boardSensor->isSensing() || _remoteSensor->isSensing())) {
-    if (_sensorToggle) {
-      _remoteSensor->startSensing();
-    } else {
-      _boardSensor->startSensing();
+
+  // The bus is idle while a conversion is in progress, so use
+  // that time to advance the search for attached sensors
+  if (isConverting() || !(_boardSensor || _remoteSensor || _ambientSensor)) {
+    if (_scanner.step()) {
+      detachAbsentSensors();
+      attachPresentSensors();
+      saveSensors();
     }
-    _sensorToggle = !_sensorToggle;
+    return;
   }
+
+  startConversion();
 }
 
-void PipsqueakSensors::detectSensors() {
-  byte addressBuffer[2 * DS18B20_ADDRESS_SIZE];
-  size_t countOfSensorsDetected = DS18B20::detect(_oneWire, addressBuffer, 2);
-  if (countOfSensorsDetected == 0) {
-    #ifdef DEBUG_PIPSQUEAK_SENSORS
-    Serial.println("PipsqueakSensors.detectSensors(): no devices detected");
-    #endif
-    return;
+void PipsqueakSensors::restoreSensors() {
+  WarmBoot * warmBoot = _state->getWarmBoot();
+  WarmBootRecord * record = warmBoot->getRecord();
+  uint8_t none[DS18B20_ADDRESS_SIZE] = { 0 };
+
+  if (!isnan(record->boardTemperature)) {
+    _boardSensor = attach(BOARD_SENSOR_SLOT, _config->getBoardSensorAddress(), BOARD_SENSOR_RESOLUTION, BOARD_READING_TTL);
+    if (warmBoot->isRecent()) _boardSensor->seed(record->boardTemperature);
+    _state->setBoardSensorDetected(true);
   }
-  if (countOfSensorsDetected > 2) {
-    #ifdef DEBUG_PIPSQUEAK_SENSORS
-    Serial.printf("PipsqueakSensors.detectSensors(): %u devices detected\n", countOfSensorsDetected);
-    #endif
-    return;
+  if (memcmp(record->remoteSensorAddress, none, DS18B20_ADDRESS_SIZE) != 0) {
+    _remoteSensor = attach(REMOTE_SENSOR_SLOT, record->remoteSensorAddress, REMOTE_SENSOR_RESOLUTION, REMOTE_READING_TTL);
+    if (warmBoot->isRecent()) _remoteSensor->seed(record->remoteTemperature);
+    _state->setRemoteSensorDetected(true);
+  }
+  if (memcmp(record->ambientSensorAddress, none, DS18B20_ADDRESS_SIZE) != 0) {
+    _ambientSensor = attach(AMBIENT_SENSOR_SLOT, record->ambientSensorAddress, AMBIENT_SENSOR_RESOLUTION, AMBIENT_READING_TTL);
+    if (warmBoot->isRecent()) _ambientSensor->seed(record->ambientTemperature);
   }
+  BinaryLog::write(LOG_SENSORS_RESTORED, _boardSensor != NULL, _remoteSensor != NULL, _ambientSensor != NULL);
+}
 
-  // First find the board sensor
-  if (!_boardSensor) {
-    for (size_t i = 0; i < 2; i++) {
-      if (_config->isBoardSensorAddress(&addressBuffer[i * DS18B20_ADDRESS_SIZE])) {
-        #ifdef DEBUG_PIPSQUEAK_SENSORS
-        Serial.println("PipsqueakSensors.detectSensors(): board sensor detected");
-        #endif
-        _boardSensor = new DS18B20(_oneWire, &addressBuffer[i * DS18B20_ADDRESS_SIZE], BOARD_SENSOR_RESOLUTION, BOARD_READING_TTL);
-        _state->setBoardSensorDetected(true);
-      }
+void PipsqueakSensors::saveSensors() {
+  WarmBootRecord * record = _state->getWarmBoot()->getRecord();
+  memset(record->remoteSensorAddress, 0, DS18B20_ADDRESS_SIZE);
+  memset(record->ambientSensorAddress, 0, DS18B20_ADDRESS_SIZE);
+  if (_remoteSensor) memcpy(record->remoteSensorAddress, _remoteSensor->getAddress(), DS18B20_ADDRESS_SIZE);
+  if (_ambientSensor) memcpy(record->ambientSensorAddress, _ambientSensor->getAddress(), DS18B20_ADDRESS_SIZE);
+}
+
+// Attached as if configured, so as not to block the loop on a sensor
+// just plugged in; its first read() corrects the resolution if need be
+DS18B20 * PipsqueakSensors::attach(uint8_t slot, byte * address, byte resolution, uint32_t readingTTL) {
+  return new (_sensorSlots[slot]) DS18B20(&_oneWire, address, resolution, readingTTL, true);
+}
+
+void PipsqueakSensors::detach(DS18B20 ** sensor) {
+  (*sensor)->~DS18B20();
+  *sensor = NULL;
+}
+
+bool PipsqueakSensors::isConverting() {
+  return (_boardSensor && _boardSensor->isSensing()) ||
+    (_remoteSensor && _remoteSensor->isSensing()) ||
+    (_ambientSensor && _ambientSensor->isSensing());
+}
+
+uint32_t PipsqueakSensors::getIdleMillis() {
+  // The search only advances while a conversion is in progress
+  if (!isConverting()) return SENSORS_TASK_INTERVAL;
+  uint32_t idleMillis = _scanner.getMillisUntilSweep();
+  if (idleMillis == 0) return SENSORS_TASK_INTERVAL;
+  if (_boardSensor && _boardSensor->isSensing()) idleMillis = min(idleMillis, _boardSensor->getMillisUntilReady());
+  if (_remoteSensor && _remoteSensor->isSensing()) idleMillis = min(idleMillis, _remoteSensor->getMillisUntilReady());
+  if (_ambientSensor && _ambientSensor->isSensing()) idleMillis = min(idleMillis, _ambientSensor->getMillisUntilReady());
+  return idleMillis;
+}
+
+bool PipsqueakSensors::isAttached(uint8_t * address) {
+  if (_remoteSensor && memcmp(address, _remoteSensor->getAddress(), DS18B20_ADDRESS_SIZE) == 0) return true;
+  if (_ambientSensor && memcmp(address, _ambientSensor->getAddress(), DS18B20_ADDRESS_SIZE) == 0) return true;
+  return false;
+}
+
+bool PipsqueakSensors::isRecordedRemoteSensorPresent() {
+  return _scanner.isPresent(_config->getRemoteSensorAddress());
+}
+
+void PipsqueakSensors::startConversion() {
+  // Take turns, skipping sensors that aren't attached
+  DS18B20 * sensors[SENSOR_COUNT] = { _remoteSensor, _boardSensor, _ambientSensor };
+  for (size_t i = 0; i < SENSOR_COUNT; i++) {
+    DS18B20 * sensor = sensors[_sensorCursor];
+    _sensorCursor = (_sensorCursor + 1) % SENSOR_COUNT;
+    if (sensor) {
+      sensor->startSensing();
+      break;
     }
   }
+  _scanner.interrupt();
+}
+
+void PipsqueakSensors::detachAbsentSensors() {
+  if (_boardSensor && !_scanner.isPresent(_boardSensor->getAddress())) {
+    BinaryLog::write(LOG_SENSORS_DETACHED, BOARD_SENSOR_SLOT);
+    detach(&_boardSensor);
+    _state->setBoardTemperature(NAN);
+  }
+  if (_remoteSensor && !_scanner.isPresent(_remoteSensor->getAddress())) {
+    BinaryLog::write(LOG_SENSORS_DETACHED, REMOTE_SENSOR_SLOT);
+    detach(&_remoteSensor);
+    _state->setRemoteTemperature(NAN);
+  }
+  if (_ambientSensor && !_scanner.isPresent(_ambientSensor->getAddress())) {
+    BinaryLog::write(LOG_SENSORS_DETACHED, AMBIENT_SENSOR_SLOT);
+    detach(&_ambientSensor);
+    _state->setAmbientTemperature(NAN);
+  }
+  if (!_remoteSensor && _ambientSensor) {
+    // roles are reassigned below, so the remaining probe can take over
+    detach(&_ambientSensor);
+    _state->setAmbientTemperature(NAN);
+  }
+}
 
-  // Then find the "other" sensor - which is the remote sensor
-  if (_boardSensor) {
-    for (size_t i = 0; i < 2; i++) {
-      if (!_config->isBoardSensorAddress(&addressBuffer[i * DS18B20_ADDRESS_SIZE])) {
-        #ifdef DEBUG_PIPSQUEAK_SENSORS
-        Serial.println("PipsqueakSensors.detectSensors(): remote sensor detected");
-        #endif
-        _remoteSensor = new DS18B20(_oneWire, &addressBuffer[i * DS18B20_ADDRESS_SIZE], REMOTE_SENSOR_RESOLUTION, REMOTE_READING_TTL);
-        _state->setRemoteSensorDetected(true);
+void PipsqueakSensors::attachPresentSensors() {
+  byte address[DS18B20_ADDRESS_SIZE];
+  for (size_t i = 0; i < _scanner.getDeviceCount(); i++) {
+    memcpy(address, _scanner.getDeviceAddress(i), DS18B20_ADDRESS_SIZE);
+    if (address[0] != DS18B20_FAMILY_CODE) continue;
+    if (_config->isBoardSensorAddress(address)) {
+      if (!_boardSensor) {
+        BinaryLog::write(LOG_SENSORS_ATTACHED, BOARD_SENSOR_SLOT);
+        _boardSensor = attach(BOARD_SENSOR_SLOT, address, BOARD_SENSOR_RESOLUTION, BOARD_READING_TTL);
       }
+    } else if (isAttached(address)) {
+      continue;
+    } else if (!_remoteSensor && (!isRecordedRemoteSensorPresent() || memcmp(address, _config->getRemoteSensorAddress(), DS18B20_ADDRESS_SIZE) == 0)) {
+      // the recorded remote sensor if present, otherwise the first sensor found
+      BinaryLog::write(LOG_SENSORS_ATTACHED, REMOTE_SENSOR_SLOT);
+      _remoteSensor = attach(REMOTE_SENSOR_SLOT, address, REMOTE_SENSOR_RESOLUTION, REMOTE_READING_TTL);
+    } else if (!_ambientSensor) {
+      BinaryLog::write(LOG_SENSORS_ATTACHED, AMBIENT_SENSOR_SLOT);
+      _ambientSensor = attach(AMBIENT_SENSOR_SLOT, address, AMBIENT_SENSOR_RESOLUTION, AMBIENT_READING_TTL);
     }
   }
 
-  #ifdef DEBUG_PIPSQUEAK_SENSORS
-  if (!_boardSensor) {
-    Serial.println("PipsqueakSensors.detectSensors(): onboard DS18B20 not found");
-  }
-  if (!_remoteSensor) {
-    Serial.println("PipsqueakSensors.detectSensors(): remote DS18B20 not found");
-  }
-  #endif
+  // records an error only on the first sweep or on detachment
+  _state->setBoardSensorDetected(_boardSensor != NULL);
+  _state->setRemoteSensorDetected(_remoteSensor != NULL);
 }
@@ -5,9 +5,14 @@
 #include <PipsqueakState.h>
 #include <OneWire.h>
 #include <DS18B20.h>
+#include <OneWireScanner.h>
+#include <Scheduler.h>
 
-// Un-comment to enable detailed debug statements
-// #define DEBUG_PIPSQUEAK_SENSORS true
+// how often the bus is revisited while a search is in progress
+#define SENSORS_TASK_INTERVAL 2 // ms
+
+// board, remote and ambient
+#define SENSOR_COUNT 3
 
 /**
  * Manages coordination between and collection/distribution
@@ -18,29 +23,65 @@ class PipsqueakSensors {
     PipsqueakSensors(PipsqueakState * state);
 
     /**
-     * Initializes the OneWire bus.
+     * Initializes the OneWire bus, and after a soft reset,
+     * reattaches the sensors attached before it.
      * Invoke in the main program's setup() function.
      * Call only after invoking PipsqueakState.setup().
      */
     void setup();
 
+    /**
+     * Registers a task that runs loop() every
+     * SENSORS_TASK_INTERVAL ms while the bus is being
+     * searched, and otherwise sleeps until the conversion in
+     * progress completes. Invoke once after setup().
+     */
+    void schedule(Scheduler * scheduler);
+
     /**
      * Detects sensors, takes measurements, and updates
      * PipsqueakState.
      *
-     * Invoke in the main program's loop() function.
+     * Sensors are detected by a background search of the
+     * OneWire bus that runs while conversions are in progress,
+     * so probes may be attached or detached at any time.
+     *
+     * A second probe, if attached, measures the ambient
+     * temperature. The remote probe is the one whose address
+     * was recorded by the initializer if it is attached, or
+     * else the first one found; a lone probe is always the
+     * remote probe.
+     *
+     * Invoked by the task registered via schedule().
      */
     void loop();
 
   private:
     PipsqueakState * _state;
     PipsqueakConfig * _config;
-    OneWire * _oneWire;
+    OneWire _oneWire;
+    OneWireScanner _scanner;
     DS18B20 * _boardSensor;
     DS18B20 * _remoteSensor;
-    bool _sensorToggle;
+    DS18B20 * _ambientSensor;
+    // each role's sensor is constructed in its own slot, not on the heap
+    alignas(DS18B20) byte _sensorSlots[SENSOR_COUNT][sizeof(DS18B20)];
+    uint8_t _sensorCursor;
+
+    Scheduler * _scheduler;
+    TaskID _task;
 
-    void detectSensors();
+    DS18B20 * attach(uint8_t slot, byte * address, byte resolution, uint32_t readingTTL);
+    void detach(DS18B20 ** sensor);
+    bool isConverting();
+    uint32_t getIdleMillis();
+    bool isAttached(uint8_t * address);
+    bool isRecordedRemoteSensorPresent();
+    void startConversion();
+    void detachAbsentSensors();
+    void attachPresentSensors();
+    void restoreSensors();
+    void saveSensors();
 };
 
 #endif // PipsqueakSensors_h
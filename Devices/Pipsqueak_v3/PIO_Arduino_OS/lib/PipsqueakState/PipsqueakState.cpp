@@ -4,6 +4,71 @@
 #include <EEPROM.h>
 #include <Errors.h>
 #include <TimeLib.h>
+#include <Profiler.h>
+#include <BinaryLog.h>
+#include <Metrics.h>
+#include <flash_hal.h>
+#ifdef MMU_IRAM_HEAP
+#include <umm_malloc/umm_heap_select.h>
+#endif
+
+extern "C" {
+  #include <user_interface.h>
+}
+
+// The crash dump takes the sector just below the config journal's
+class EspCrashDumpFlash : public JournalFlash {
+  public:
+    EspCrashDumpFlash() {
+      _sectorCount = FS_PHYS_SIZE >= (JOURNAL_SECTOR_COUNT + 1) * SPI_FLASH_SEC_SIZE ? 1 : 0;
+      _sector = (FS_PHYS_ADDR + FS_PHYS_SIZE) / SPI_FLASH_SEC_SIZE - JOURNAL_SECTOR_COUNT - 1;
+    }
+
+    size_t getSectorCount() {
+      return _sectorCount;
+    }
+
+    bool erase(size_t sector) {
+      return ESP.flashEraseSector(_sector);
+    }
+
+    bool read(size_t sector, uint32_t offset, uint32_t * data, size_t size) {
+      return ESP.flashRead(_sector * SPI_FLASH_SEC_SIZE + offset, data, size);
+    }
+
+    bool write(size_t sector, uint32_t offset, const uint32_t * data, size_t size) {
+      return ESP.flashWrite(_sector * SPI_FLASH_SEC_SIZE + offset, data, size);
+    }
+
+  private:
+    uint32_t _sector;
+    size_t _sectorCount;
+};
+
+static EspCrashDumpFlash crashDumpFlash;
+
+// Set once the dump is ready for the crash callback
+static CrashDump * crashDump = NULL;
+
+// Invoked by the esp8266 core after an exception or a software
+// watchdog reset, just before it restarts
+extern "C" void custom_crash_callback(struct rst_info * resetInfo, uint32_t stack, uint32_t stackEnd) {
+  if (crashDump == NULL) return;
+  CrashDumpContext context = {
+    resetInfo->reason,
+    resetInfo->exccause,
+    resetInfo->epc1,
+    resetInfo->epc2,
+    resetInfo->epc3,
+    resetInfo->excvaddr,
+    resetInfo->depc,
+    stack,
+    stackEnd,
+    millis(),
+    timeStatus() == timeNotSet ? 0 : (uint32_t) now()
+  };
+  crashDump->capture(&context, (const uint32_t *) (uintptr_t) stack, stackEnd - stack);
+}
 
 PipsqueakState::PipsqueakState()
 :
@@ -13,29 +78,86 @@ PipsqueakState::PipsqueakState()
   _wifiInitialized { false },
   _clockInitialized { false },
   _clockSynchronized { false },
+  _clockDiscipline(),
   _boardSensorInitialized { false },
   _boardSensorDetected { false },
   _boardTemperatureInitialized { false },
   _boardTemperature { NAN },
   _overheated { false },
+  _ambientTemperature { NAN },
   _remoteSensorInitialized { false },
   _remoteSensorDetected { false },
   _remoteTemperatureInitialized { false },
   _remoteTemperature { NAN },
+  _profileSetpoint { NAN },
+  _radioRequired { true },
+  _outputActive { false },
+  _lastProfileEvaluation { 0 },
+  _lastLatencyReport { 0 },
+  _lastMetricsReport { 0 },
+  _warmBoot(),
+  _lastWarmBootSave { 0 },
+  _crashDump(&crashDumpFlash),
+  _controlStartMillis { 0 },
+  _controlStartReported { false },
+  _statusEventQueue { NULL },
   _statusEventQueueCursor { 0 },
   _statusEventQueueDepth { 0 },
-  _requestSuccessCursor { 0 }
+  _requestSuccessCursor { 0 },
+  _scheduler { NULL },
+  _clockTask { SCHEDULER_NO_TASK }
 
 {
-  memset(_statusEventQueue, 0, STATUS_EVENT_QUEUE_SIZE);
+  #ifdef MMU_IRAM_HEAP
+  // Built with the IRAM heap (an MMU option of the esp8266 core),
+  // the queue is placed there once and for all, leaving its DRAM
+  // to lwIP; if it doesn't fit, it falls back to DRAM
+  {
+    HeapSelectIram iram;
+    _statusEventQueue = (uint32_t *) malloc(STATUS_EVENT_QUEUE_SIZE);
+  }
+  if (!_statusEventQueue) _statusEventQueue = (uint32_t *) malloc(STATUS_EVENT_QUEUE_SIZE);
+  #else
+  _statusEventQueue = _statusEventQueueStorage;
+  #endif
+  for (size_t i = 0; i < STATUS_EVENT_QUEUE_SIZE / 4; i++) _statusEventQueue[i] = 0;
   for (size_t i = 0; i < REQUEST_SUCCESS_QUEUE_SIZE; i++) _requestSuccess[i] = true;
 }
 
 void PipsqueakState::setup() {
+  if (_crashDump.begin()) crashDump = &_crashDump;
   _config.setup();
+
+  // After a soft reset, the clock carries on from where it was
+  _warmBoot.restore(ESP.getResetInfoPtr()->reason, _config.getDeviceID());
+  uint32_t unixTime = _warmBoot.getUnixTime();
+  if (unixTime) {
+    setTime(unixTime);
+    setClockSynchronized(true);
+  }
+}
+
+void PipsqueakState::schedule(Scheduler * scheduler) {
+  _scheduler = scheduler;
+  scheduler->every("state", STATE_TASK_INTERVAL, [](void * state) { ((PipsqueakState *) state)->loop(); }, this);
+  _clockTask = scheduler->every("clock", CLOCK_TASK_INTERVAL, [](void * state) { ((PipsqueakState *) state)->alignClock(); }, this);
+}
+
+void PipsqueakState::alignClock() {
+  if (!_clockDiscipline.isSynchronized()) return;
+  uint32_t localMillis = millis();
+  uint16_t millisIntoSecond = _clockDiscipline.getMillisIntoSecond(localMillis);
+  if (millisIntoSecond > CLOCK_ALIGNMENT_TOLERANCE) {
+    // TimeLib counts whole seconds from setTime(), so come back on
+    // the next boundary; the task's period resumes from there
+    _scheduler->wakeIn(_clockTask, 1000 - millisIntoSecond);
+    return;
+  }
+  setTime(_clockDiscipline.getUnixTime(localMillis));
 }
 
 void PipsqueakState::loop() {
+  PROFILER_SCOPE(PROFILER_SLOT_STATE_LOOP);
   bool overheated = !isnan(_boardTemperature) && _boardTemperature > _config.getBoardTemperatureLimit();
   if (!_overheated && overheated) {
     _overheated = true;
@@ -44,6 +166,31 @@ void PipsqueakState::loop() {
     _overheated = false;
   }
 
+  if (millis() - _lastProfileEvaluation >= PROFILE_EVALUATION_INTERVAL) {
+    _lastProfileEvaluation = millis();
+    evaluateProfile();
+  }
+
+  if (_clockSynchronized && millis() - _lastLatencyReport >= LATENCY_REPORT_INTERVAL) {
+    _lastLatencyReport = millis();
+    recordLatencies();
+  }
+
+  if (_clockSynchronized && millis() - _lastMetricsReport >= METRICS_REPORT_INTERVAL) {
+    _lastMetricsReport = millis();
+    recordMetrics();
+  }
+
+  if (millis() - _lastWarmBootSave >= WARM_BOOT_SAVE_INTERVAL) {
+    _lastWarmBootSave = millis();
+    saveWarmBoot();
+  }
+
+  if (_controlStartMillis && !_controlStartReported && _clockSynchronized) {
+    _controlStartReported = true;
+    recordBootTiming();
+  }
+
   if (!_wifiInitialized && WiFi.isConnected()) {
     _wifiInitialized = true;
   }
@@ -128,6 +275,9 @@ void PipsqueakState::setClockSynchronized(bool synchronized) {
   if (!_clockInitialized) {
     _clockInitialized = true;
   }
+  if (!synchronized) {
+    _clockDiscipline.reset();
+  }
   if (synchronized && !_clockSynchronized) {
     if (_boardTemperatureInitialized) {
       // TODO: board temperature status event
@@ -136,12 +286,34 @@ void PipsqueakState::setClockSynchronized(bool synchronized) {
       _statusEvent.temperatureObservation(now(), _remoteTemperature);
       enqueueStatusEvent();
     }
-    _statusEvent.temperatureSetpoint(now(), _config.getTemperatureSetpoint());
+    _profileSetpoint = _config.getProfile()->evaluate(now());
+    _statusEvent.temperatureSetpoint(now(), getTemperatureSetpoint());
     enqueueStatusEvent();
   }
   _clockSynchronized = synchronized;
 }
 
+void PipsqueakState::synchronizeClock(uint32_t serverTime, uint32_t sentMillis, uint32_t receivedMillis) {
+  ClockSampleResult result = _clockDiscipline.addSample(serverTime, sentMillis, receivedMillis);
+  BinaryLog::write(LOG_STATE_CLOCK_SAMPLE, serverTime, result, _clockDiscipline.getErrorBound(millis()));
+  if (result == CLOCK_SAMPLE_REJECTED) return;
+  if (result == CLOCK_SAMPLE_STEPPED) {
+    // Near enough until the clock task sets it on a second boundary
+    setTime(_clockDiscipline.getUnixTime(millis()));
+    if (_scheduler) _scheduler->wake(_clockTask);
+  }
+  setClockSynchronized(true);
+}
+
+bool PipsqueakState::isClockSyncDue() {
+  // Until the first sample, whatever response comes next will do
+  return _clockDiscipline.isSynchronized() && _clockDiscipline.isSyncDue(millis());
+}
+
+ClockDiscipline * PipsqueakState::getClockDiscipline() {
+  return &_clockDiscipline;
+}
+
 void PipsqueakState::setBoardSensorDetected(bool sensorDetected) {
   if (!sensorDetected && (_boardSensorDetected || !_boardSensorInitialized)) {
     recordError(ErrorType::Pipsqueak, BOARD_SENSOR_DETECTION_ERROR);
@@ -182,6 +354,20 @@ void PipsqueakState::setBoardTemperature(float temperature) {
   }
 }
 
+float PipsqueakState::getAmbientTemperature() {
+  if (!isnan(_ambientTemperature)) return _ambientTemperature;
+  return _boardTemperature - _config.getBoardSelfHeating();
+}
+
+void PipsqueakState::setAmbientTemperature(float temperature) {
+  #ifdef DEBUG_PIPSQUEAK_STATE
+  if (_ambientTemperature != temperature) {
+    Serial.printf("PipsqueakState.setAmbientTemperature(): temperature from %f to %f\n", _ambientTemperature, temperature);
+  }
+  #endif
+  _ambientTemperature = temperature;
+}
+
 void PipsqueakState::setRemoteSensorDetected(bool sensorDetected) {
   if (!sensorDetected && (_remoteSensorDetected || !_remoteSensorInitialized)) {
     recordError(ErrorType::Pipsqueak, REMOTE_SENSOR_DETECTION_ERROR);
@@ -228,27 +414,69 @@ void PipsqueakState::setRemoteTemperature(float temperature) {
 
 void PipsqueakState::setRemoteTemperatureSetpoint(float setpoint) {
   if (_config.getTemperatureSetpoint() != setpoint) {
-    #ifdef DEBUG_PIPSQUEAK_STATE
     float previousSetpoint = _config.getTemperatureSetpoint();
-    #endif
     _config.setTemperatureSetpoint(setpoint);
-    if (_clockSynchronized) {
+    // A running profile masks the remote setpoint
+    if (_clockSynchronized && isnan(_profileSetpoint)) {
       #ifdef DEBUG_PIPSQUEAK_STATE
       Serial.printf("PipsqueakState.setRemoteTemperatureSetpoint(): setpoint update event @ %fC\n", setpoint);
       #endif
       _statusEvent.temperatureSetpoint(now(), setpoint);
       enqueueStatusEvent();
     }
-    #ifdef DEBUG_PIPSQUEAK_STATE
-    Serial.printf("Model.setRemoteSetpoint(): Setpoint updated from %f to %f\n", previousSetpoint, setpoint);
-    #endif
+    BinaryLog::write(LOG_STATE_SETPOINT, previousSetpoint, setpoint);
+  }
+}
+
+float PipsqueakState::getTemperatureSetpoint() {
+  return isnan(_profileSetpoint) ? _config.getTemperatureSetpoint() : _profileSetpoint;
+}
+
+bool PipsqueakState::setProfile(uint32_t profileID, uint8_t segmentCount, const ProfileSegment * segments) {
+  FermentationProfile * profile = _config.getProfile();
+  bool cancellation = profileID == 0 || segmentCount == 0;
+  if (cancellation && !profile->isLoaded()) return true;
+  if (!cancellation && profileID == profile->getProfileID()) return true;
+  if (!_config.setProfile(profileID, segmentCount, segments)) return false;
+  BinaryLog::write(LOG_STATE_PROFILE, profileID, segmentCount);
+  evaluateProfile();
+  return true;
+}
+
+void PipsqueakState::evaluateProfile() {
+  // Hold the last evaluation until the clock can be trusted; a
+  // profile keeps running through network outages regardless,
+  // since those don't unsynchronize the clock.
+  if (!_clockSynchronized) return;
+  float previousSetpoint = getTemperatureSetpoint();
+  _profileSetpoint = _config.getProfile()->evaluate(now());
+  float setpoint = getTemperatureSetpoint();
+  if (setpoint != previousSetpoint) {
+    BinaryLog::write(LOG_STATE_PROFILE_SETPOINT, setpoint);
+    _statusEvent.temperatureSetpoint(now(), setpoint);
+    enqueueStatusEvent();
   }
 }
 
+bool PipsqueakState::isRadioRequired() {
+  return _radioRequired;
+}
+
+void PipsqueakState::setRadioRequired(bool radioRequired) {
+  _radioRequired = radioRequired;
+}
+
+bool PipsqueakState::isOutputActive() {
+  return _outputActive;
+}
+
+void PipsqueakState::setOutputActive(bool outputActive) {
+  _outputActive = outputActive;
+}
+
 void PipsqueakState::recordError(ErrorType errorType, int8_t errorCode) {
-  #ifdef DEBUG_PIPSQUEAK_STATE
-  Serial.printf("Model.recordError(%d, %d)\n", errorType, errorCode);
-  #endif
+  BinaryLog::write(LOG_STATE_ERROR, errorType, errorCode);
+  _crashDump.addRecord((uint8_t) errorType, errorCode, millis());
   time_t timestamp = _clockSynchronized ? now() : 0;
   _statusEvent.error(timestamp, errorType, errorCode);
   enqueueStatusEvent();
@@ -280,10 +508,110 @@ void PipsqueakState::recordHeaterPulse(
   }
 }
 
+void PipsqueakState::recordTuningResult(float ultimateGain, uint32_t ultimatePeriod, uint8_t outcome) {
+  BinaryLog::write(LOG_STATE_TUNING_RESULT, ultimateGain, ultimatePeriod, outcome);
+  time_t timestamp = _clockSynchronized ? now() : 0;
+  _statusEvent.tuningResult(timestamp, ultimateGain, ultimatePeriod, outcome);
+  enqueueStatusEvent();
+}
+
+void PipsqueakState::recordTemperatureObservation(uint32_t timestamp, float temperature) {
+  _statusEvent.temperatureObservation(timestamp, temperature);
+  enqueueStatusEvent();
+}
+
+WarmBoot * PipsqueakState::getWarmBoot() {
+  return &_warmBoot;
+}
+
+CrashDump * PipsqueakState::getCrashDump() {
+  return &_crashDump;
+}
+
+void PipsqueakState::saveWarmBoot() {
+  WarmBootRecord * record = _warmBoot.getRecord();
+  record->boardTemperature = _boardTemperature;
+  record->remoteTemperature = _remoteTemperature;
+  record->ambientTemperature = _ambientTemperature;
+  _warmBoot.save(_clockSynchronized ? now() : 0);
+}
+
+void PipsqueakState::recordControlStart() {
+  if (_controlStartMillis) return;
+  // 0 means not yet
+  _controlStartMillis = millis() > 0 ? millis() : 1;
+  BinaryLog::write(LOG_STATE_CONTROL_START, _controlStartMillis);
+}
+
+uint32_t PipsqueakState::getMillisToControlStart() {
+  return _controlStartMillis;
+}
+
+void PipsqueakState::recordBootTiming() {
+  uint8_t warmBoot = _warmBoot.isRecent() ? STATUS_EVENT_BOOT_WARM :
+    _warmBoot.isRestored() ? STATUS_EVENT_BOOT_WARM_STALE :
+    STATUS_EVENT_BOOT_COLD;
+  _statusEvent.bootTiming(
+    now() - (millis() - _controlStartMillis) / 1000,
+    ESP.getResetInfoPtr()->reason,
+    warmBoot,
+    _controlStartMillis,
+    _warmBoot.isRestored() ? _warmBoot.getDowntime() : 0
+  );
+  enqueueStatusEvent();
+}
+
+void PipsqueakState::recordLatencies() {
+  time_t timestamp = _clockSynchronized ? now() : 0;
+  for (uint8_t slot = 0; slot < PROFILER_SLOT_COUNT; slot++) {
+    uint32_t count = Profiler::getCount(slot);
+    if (count == 0) continue;
+    _statusEvent.latencyHistogram(
+      timestamp,
+      slot,
+      count,
+      Profiler::getMaxCycles(slot),
+      Profiler::getPercentileBucket(slot, 50),
+      Profiler::getPercentileBucket(slot, 99)
+    );
+    enqueueStatusEvent();
+  }
+  Profiler::reset();
+}
+
+void PipsqueakState::recordMetrics() {
+  time_t timestamp = _clockSynchronized ? now() : 0;
+  uint8_t size = Metrics::getSnapshotSize();
+  uint16_t slots[STATUS_EVENT_METRIC_SLOT_COUNT];
+  for (uint8_t firstSlot = 0; firstSlot < size; firstSlot += STATUS_EVENT_METRIC_SLOT_COUNT) {
+    Metrics::readSnapshot(firstSlot, slots, STATUS_EVENT_METRIC_SLOT_COUNT);
+    // The server takes slots it was not sent to be zero
+    bool changed = false;
+    for (uint8_t i = 0; i < STATUS_EVENT_METRIC_SLOT_COUNT; i++) {
+      if (slots[i] != 0) changed = true;
+    }
+    if (!changed) continue;
+    _statusEvent.metricSnapshot(timestamp, firstSlot, slots);
+    enqueueStatusEvent();
+  }
+  Metrics::reset();
+}
+
+void PipsqueakState::recordMemoryLowWater(uint32_t freeHeap, uint32_t maxFreeBlock, uint8_t fragmentation, uint32_t freeStack) {
+  BinaryLog::write(LOG_STATE_MEMORY_LOW_WATER, freeHeap, maxFreeBlock, fragmentation, freeStack);
+  time_t timestamp = _clockSynchronized ? now() : 0;
+  _statusEvent.memoryLowWater(timestamp, freeHeap, maxFreeBlock, fragmentation, freeStack);
+  enqueueStatusEvent();
+}
+
 bool PipsqueakState::hasStatusEvents() {
   return _statusEventQueueDepth > 0;
 }
 
+size_t PipsqueakState::getStatusEventCount() {
+  return _statusEventQueueDepth;
+}
+
 StatusEvent * PipsqueakState::dequeueStatusEvent() {
   #ifdef DEBUG_PIPSQUEAK_STATE
   Serial.println("PipsqueakState.dequeueStatusEvent()");
@@ -292,9 +620,12 @@ StatusEvent * PipsqueakState::dequeueStatusEvent() {
   #ifdef DEBUG_PIPSQUEAK_STATE
   Serial.printf("PipsqueakState.dequeueStatusEvent() from offset %u\n", _statusEventQueueCursor);
   #endif
-  _statusEvent.read(&_statusEventQueue[_statusEventQueueCursor]);
+  uint32_t event[STATUS_EVENT_SIZE / 4];
+  for (size_t i = 0; i < STATUS_EVENT_SIZE / 4; i++) event[i] = _statusEventQueue[_statusEventQueueCursor / 4 + i];
+  _statusEvent.read((byte *) event);
   advanceStatusEventQueueCursor();
   _statusEventQueueDepth -= 1;
+  Metrics::set(METRIC_STATUS_QUEUE_DEPTH, _statusEventQueueDepth);
   return &_statusEvent;
 }
 
@@ -306,13 +637,17 @@ void PipsqueakState::enqueueStatusEvent() {
   #ifdef DEBUG_PIPSQUEAK_STATE
   Serial.printf("PipsqueakState.enqueueStatusEvent() at offset %u\n", head);
   #endif
-  _statusEvent.write(&_statusEventQueue[head]);
+  uint32_t event[STATUS_EVENT_SIZE / 4];
+  _statusEvent.write((byte *) event);
+  for (size_t i = 0; i < STATUS_EVENT_SIZE / 4; i++) _statusEventQueue[head / 4 + i] = event[i];
   if (_statusEventQueueDepth == STATUS_EVENT_QUEUE_DEPTH_LIMIT) {
     // cursor (tail) needs to advance - we just overwrote the oldest event
     advanceStatusEventQueueCursor();
+    Metrics::increment(METRIC_STATUS_EVENTS_DROPPED);
   } else {
     _statusEventQueueDepth += 1;
   }
+  Metrics::set(METRIC_STATUS_QUEUE_DEPTH, _statusEventQueueDepth);
 }
 
 void PipsqueakState::advanceStatusEventQueueCursor() {
@@ -6,6 +6,10 @@
 #include <Response.h>
 #include <PipsqueakConfig.h>
 #include <TelemetryProtocol.h>
+#include <Scheduler.h>
+#include <WarmBoot.h>
+#include <ClockDiscipline.h>
+#include <CrashDump.h>
 
 // Un-comment to enable detailed debug statements to Serial
 // #define DEBUG_PIPSQUEAK_STATE
@@ -15,6 +19,13 @@
 #define REQUEST_SUCCESS_QUEUE_SIZE 4
 
 #define INITIALIZATION_WINDOW_MILLIS 15000
+#define PROFILE_EVALUATION_INTERVAL 1000
+#define LATENCY_REPORT_INTERVAL 3600000 // ms
+#define METRICS_REPORT_INTERVAL 900000 // ms
+#define STATE_TASK_INTERVAL 100 // ms
+#define CLOCK_TASK_INTERVAL 60000 // ms
+// How far past a second boundary the clock may be set
+#define CLOCK_ALIGNMENT_TOLERANCE 50 // ms
 
 /**
  * Provides and maintains shared state.
@@ -29,7 +40,15 @@ class PipsqueakState {
     /** Invoke once before use. */
     void setup();
 
-    /** Invoke on every main loop iteration. */
+    /**
+     * Registers a task that runs loop() every
+     * STATE_TASK_INTERVAL ms, and another that sets the clock
+     * from the ClockDiscipline every CLOCK_TASK_INTERVAL ms.
+     * Invoke once after setup().
+     */
+    void schedule(Scheduler * scheduler);
+
+    /** Invoked by the task registered via schedule(). */
     void loop();
 
     /**
@@ -64,10 +83,34 @@ class PipsqueakState {
     bool isClockSynchronized();
 
     /**
-     * Updates the clock sync state.
+     * Updates the clock sync state. Losing sync discards the
+     * ClockDiscipline's samples.
      */
     void setClockSynchronized(bool synchronized);
 
+    /**
+     * Disciplines the clock with the timestamp of a successful
+     * response, stepping it if need be, and marks it synchronized
+     * unless the round trip took too long to be of use.
+     *
+     * serverTime: the Unix timestamp in the response
+     * sentMillis: millis() when the request was transmitted
+     * receivedMillis: millis() when the response began to arrive
+     */
+    void synchronizeClock(uint32_t serverTime, uint32_t sentMillis, uint32_t receivedMillis);
+
+    /**
+     * Indicates that the clock has been disciplined, but that no
+     * response has arrived for so long that it may have wandered
+     * too far from the server's.
+     */
+    bool isClockSyncDue();
+
+    /**
+     * Returns the ClockDiscipline, for diagnostics.
+     */
+    ClockDiscipline * getClockDiscipline();
+
     /**
      * Indicates whether the onboard temperature sensor has
      * been detected.
@@ -89,6 +132,21 @@ class PipsqueakState {
      */
     void setBoardTemperature(float temperature);
 
+    /**
+     * Returns the ambient temperature in degrees Celsius,
+     * as measured by the optional ambient probe or, failing
+     * that, estimated from the board temperature. Returns
+     * NAN if neither is available.
+     */
+    float getAmbientTemperature();
+
+    /**
+     * Updates the temperature measured by the optional
+     * ambient probe in degrees Celsius. NAN indicates that
+     * no ambient probe is attached.
+     */
+    void setAmbientTemperature(float temperature);
+
     /**
      * Indicates whether the remote temperature sensor has
      * been detected.
@@ -133,6 +191,82 @@ class PipsqueakState {
      */
     void setRemoteTemperatureSetpoint(float setpoint);
 
+    /**
+     * Returns the temperature setpoint in degrees Celsius
+     * that the controller should regulate to: the
+     * fermentation profile's setpoint while a profile is
+     * in effect, and the remote setpoint otherwise.
+     */
+    float getTemperatureSetpoint();
+
+    /**
+     * Replaces the fermentation profile, which takes
+     * precedence over the remote setpoint from its first
+     * segment's start time onward. A profile ID or segment
+     * count of 0 cancels the profile.
+     *
+     * The profile is evaluated against the device clock
+     * once per second while the clock is synchronized,
+     * generating a setpoint status event whenever the
+     * setpoint changes. Re-sending the profile that is
+     * already in effect does nothing.
+     *
+     * Returns false, leaving the current profile in place,
+     * if the segments are invalid.
+     */
+    bool setProfile(uint32_t profileID, uint8_t segmentCount, const ProfileSegment * segments);
+
+    /**
+     * Indicates whether the network client needs the WiFi
+     * radio fully awake, e.g. while connecting or awaiting
+     * a response.
+     */
+    bool isRadioRequired();
+
+    /**
+     * Updates whether the network client needs the radio.
+     */
+    void setRadioRequired(bool radioRequired);
+
+    /**
+     * Indicates whether a heater or chiller pulse is in
+     * progress.
+     */
+    bool isOutputActive();
+
+    /**
+     * Updates whether a heater or chiller pulse is in
+     * progress.
+     */
+    void setOutputActive(bool outputActive);
+
+    /**
+     * Returns the state restored after a soft reset, which the
+     * modules consult in their setup() and keep up to date as they
+     * run. PipsqueakState saves it every WARM_BOOT_SAVE_INTERVAL
+     * ms.
+     */
+    WarmBoot * getWarmBoot();
+
+    /**
+     * Returns the dump of the latest crash, which the client
+     * uploads. Every recorded error is added to the next dump.
+     */
+    CrashDump * getCrashDump();
+
+    /**
+     * Records that the controller has acted on valid readings for
+     * the first time since boot. Once the clock is synchronized, a
+     * boot status event reports how long that took.
+     */
+    void recordControlStart();
+
+    /**
+     * Returns the ms from boot until the controller first acted on
+     * valid readings, or 0 if it hasn't yet.
+     */
+    uint32_t getMillisToControlStart();
+
     /**
      * Generates an error status event.
      */
@@ -154,11 +288,51 @@ class PipsqueakState {
      */
     void recordChillerPulse(uint32_t pulseDuration, uint32_t recoveryDuration);
 
+    /**
+     * Generates an autotuning result status event.
+     */
+    void recordTuningResult(float ultimateGain, uint32_t ultimatePeriod, uint8_t outcome);
+
+    /**
+     * Generates a temperature observation status event for a
+     * remote temperature observed earlier, e.g. while the device
+     * slept in monitor mode.
+     */
+    void recordTemperatureObservation(uint32_t timestamp, float temperature);
+
+    /**
+     * Generates a latency histogram summary status event for each
+     * profiled code path that ran since the last report, then resets
+     * the Profiler. Invoked by loop() every LATENCY_REPORT_INTERVAL
+     * ms once the clock is synchronized.
+     */
+    void recordLatencies();
+
+    /**
+     * Packs a snapshot of every metric into metric status events,
+     * skipping any that would carry only zeroes, then starts a new
+     * period. Invoked by loop() every METRICS_REPORT_INTERVAL ms
+     * once the clock is synchronized.
+     */
+    void recordMetrics();
+
+    /**
+     * Generates a memory low-water status event. Invoked hourly by
+     * MemoryMonitor.
+     */
+    void recordMemoryLowWater(uint32_t freeHeap, uint32_t maxFreeBlock, uint8_t fragmentation, uint32_t freeStack);
+
     /**
      * Indicates whether there are status events in the queue.
      */
     bool hasStatusEvents();
 
+    /**
+     * Returns the number of status events in the queue, at most
+     * STATUS_EVENT_QUEUE_DEPTH_LIMIT.
+     */
+    size_t getStatusEventCount();
+
     /**
      * Removes and returns the oldest status event from the queue.
      *
@@ -176,21 +350,44 @@ class PipsqueakState {
     bool _wifiInitialized;
     bool _clockInitialized;
     bool _clockSynchronized;
+    ClockDiscipline _clockDiscipline;
     bool _boardSensorInitialized;
     bool _boardSensorDetected;
     bool _boardTemperatureInitialized;
     float _boardTemperature;
     bool _overheated;
+    float _ambientTemperature;
     bool _remoteSensorInitialized;
     bool _remoteSensorDetected;
     bool _remoteTemperatureInitialized;
     float _remoteTemperature;
-    byte _statusEventQueue[STATUS_EVENT_QUEUE_SIZE];
+    float _profileSetpoint;
+    bool _radioRequired;
+    bool _outputActive;
+    uint32_t _lastProfileEvaluation;
+    uint32_t _lastLatencyReport;
+    uint32_t _lastMetricsReport;
+    WarmBoot _warmBoot;
+    uint32_t _lastWarmBootSave;
+    CrashDump _crashDump;
+    uint32_t _controlStartMillis;
+    bool _controlStartReported;
+    // accessed a word at a time, so that it may live in IRAM
+    uint32_t * _statusEventQueue;
+    #ifndef MMU_IRAM_HEAP
+    uint32_t _statusEventQueueStorage[STATUS_EVENT_QUEUE_SIZE / 4];
+    #endif
     size_t _statusEventQueueCursor;
     size_t _statusEventQueueDepth;
     bool _requestSuccess[REQUEST_SUCCESS_QUEUE_SIZE];
     size_t _requestSuccessCursor;
+    Scheduler * _scheduler;
+    TaskID _clockTask;
 
+    void alignClock();
+    void evaluateProfile();
+    void saveWarmBoot();
+    void recordBootTiming();
     void enqueueStatusEvent();
     void advanceStatusEventQueueCursor();
 };
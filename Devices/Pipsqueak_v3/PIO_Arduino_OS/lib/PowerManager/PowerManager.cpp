@@ -0,0 +1,88 @@
+#include "PowerManager.h"
+#include <ESP8266WiFi.h>
+
+extern "C" {
+  #include <user_interface.h>
+}
+
+PowerManager::PowerManager(PipsqueakState * pipsqueakState)
+:
+  _state { pipsqueakState },
+  _scheduler { NULL },
+  _mode { PowerAwake },
+  _modeStart { 0 }
+{
+  memset(_modeMillis, 0, sizeof(_modeMillis));
+}
+
+void PowerManager::schedule(Scheduler * scheduler) {
+  _scheduler = scheduler;
+  _modeStart = millis();
+  enterMode(selectMode());
+  scheduler->every("power", POWER_TASK_INTERVAL, [](void * power) { ((PowerManager *) power)->loop(); }, this);
+}
+
+void PowerManager::loop() {
+  PowerMode mode = selectMode();
+  if (mode != _mode) enterMode(mode);
+}
+
+PowerMode PowerManager::selectMode() {
+  if (_state->isRadioRequired()) return PowerAwake;
+  if (_state->isOutputActive()) return PowerModemSleep;
+  return PowerLightSleep;
+}
+
+void PowerManager::enterMode(PowerMode mode) {
+  #ifdef DEBUG_POWER_MANAGER
+  Serial.printf("PowerManager.enterMode(): %u -> %u\n", _mode, mode);
+  #endif
+  uint32_t now = millis();
+  _modeMillis[_mode] += now - _modeStart;
+  _modeStart = now;
+  _mode = mode;
+
+  switch (mode) {
+    case PowerAwake:
+      WiFi.setSleepMode(WIFI_NONE_SLEEP);
+      _scheduler->setIdleSlice(1);
+      break;
+    case PowerModemSleep:
+      WiFi.setSleepMode(WIFI_MODEM_SLEEP);
+      _scheduler->setIdleSlice(1);
+      break;
+    case PowerLightSleep:
+      WiFi.setSleepMode(WIFI_LIGHT_SLEEP, POWER_LISTEN_INTERVAL);
+      _scheduler->setIdleSlice(SCHEDULER_IDLE_LIMIT);
+      break;
+  }
+}
+
+PowerMode PowerManager::getMode() {
+  return _mode;
+}
+
+uint32_t PowerManager::getModeMillis(PowerMode mode) {
+  if (mode >= POWER_MODE_COUNT) return 0;
+  uint32_t modeMillis = _modeMillis[mode];
+  if (mode == _mode) modeMillis += millis() - _modeStart;
+  return modeMillis;
+}
+
+uint32_t PowerManager::getAwakeMillis() {
+  if (!_scheduler) return millis();
+  return millis() - _scheduler->getIdleMillis();
+}
+
+CpuBoost::CpuBoost(PipsqueakState * pipsqueakState)
+:
+  _boosted { false }
+{
+  if (pipsqueakState->isOutputActive()) return;
+  if (system_get_cpu_freq() == SYS_CPU_160MHZ) return;
+  _boosted = system_update_cpu_freq(SYS_CPU_160MHZ);
+}
+
+CpuBoost::~CpuBoost() {
+  if (_boosted) system_update_cpu_freq(SYS_CPU_80MHZ);
+}
@@ -0,0 +1,94 @@
+#ifndef PowerManager_h
+#define PowerManager_h
+
+#include <Arduino.h>
+#include <PipsqueakState.h>
+#include <Scheduler.h>
+
+#define POWER_TASK_INTERVAL 100 // ms
+
+// DTIM beacons the radio sleeps through while light sleeping
+#define POWER_LISTEN_INTERVAL 3
+
+// Un-comment to enable debug statements via Serial
+// #define DEBUG_POWER_MANAGER
+
+enum PowerMode {
+  PowerAwake = 0,
+  PowerModemSleep = 1,
+  PowerLightSleep = 2
+};
+
+#define POWER_MODE_COUNT 3
+
+/**
+ * Chooses how deeply the esp8266 sleeps between tasks:
+ *
+ * - PowerAwake: the radio stays on while the network client
+ *   needs it (see PipsqueakState::isRadioRequired()), so that
+ *   connections and responses aren't held up by beacons.
+ * - PowerModemSleep: the radio sleeps between DTIM beacons; the
+ *   CPU keeps running while a heater or chiller pulse is in
+ *   progress (see PipsqueakState::isOutputActive()), as the
+ *   waveform generator needs its timer.
+ * - PowerLightSleep: otherwise, the radio sleeps through
+ *   POWER_LISTEN_INTERVAL beacons, and the scheduler idles in
+ *   long delays that let the CPU light-sleep until the next
+ *   deadline, e.g. the end of a sensor conversion.
+ *
+ * Also counts the time spent in each mode and the time the CPU
+ * spends running tasks rather than idling.
+ */
+class PowerManager {
+  public:
+    /**
+     * Constructor.
+     *
+     * pipsqueakState: ptr to singleton application instance
+     */
+    PowerManager(PipsqueakState * pipsqueakState);
+
+    /**
+     * Registers a task that re-evaluates the power mode every
+     * POWER_TASK_INTERVAL ms. Invoke once after the other
+     * modules' schedule().
+     */
+    void schedule(Scheduler * scheduler);
+
+    /** Invoked by the task registered via schedule(). */
+    void loop();
+
+    PowerMode getMode();
+
+    /** Total time spent in the given mode, ms. */
+    uint32_t getModeMillis(PowerMode mode);
+
+    /** Total time the CPU spent running tasks, ms. */
+    uint32_t getAwakeMillis();
+
+  private:
+    PipsqueakState * _state;
+    Scheduler * _scheduler;
+    PowerMode _mode;
+    uint32_t _modeStart;
+    uint32_t _modeMillis[POWER_MODE_COUNT];
+
+    PowerMode selectMode();
+    void enterMode(PowerMode mode);
+};
+
+/**
+ * Runs the CPU at 160MHz while in scope, e.g. around an HMAC,
+ * unless a heater or chiller pulse is in progress: the waveform
+ * generator times pulses in CPU cycles.
+ */
+class CpuBoost {
+  public:
+    CpuBoost(PipsqueakState * pipsqueakState);
+    ~CpuBoost();
+
+  private:
+    bool _boosted;
+};
+
+#endif // PowerManager_h
@@ -0,0 +1,87 @@
+#include "ProfileProtocol.h"
+#include <Errors.h>
+
+
+// ProfileResponse /////////////////////////////////////////////////////////////////////////////////
+
+ProfileResponse::ProfileResponse(Hmac * hmac) : Response(hmac, "ProfileResponse")
+{
+}
+
+uint32_t ProfileResponse::getProfileID() {
+  uint32_t profileID;
+  memcpy(&profileID, &_payload[PROFILE_RESPONSE_PROFILE_ID_OFFSET], 4);
+  return profileID;
+}
+
+uint8_t ProfileResponse::getSegmentCount() {
+  return _payload[PROFILE_RESPONSE_SEGMENT_COUNT_OFFSET];
+}
+
+uint32_t ProfileResponse::getSegmentStart(size_t index) {
+  uint32_t start;
+  memcpy(&start, &_payload[getSegmentOffset(index) + PROFILE_RESPONSE_SEGMENT_START_OFFSET], 4);
+  return start;
+}
+
+float ProfileResponse::getSegmentTarget(size_t index) {
+  float target;
+  memcpy(&target, &_payload[getSegmentOffset(index) + PROFILE_RESPONSE_SEGMENT_TARGET_OFFSET], 4);
+  return target;
+}
+
+float ProfileResponse::getSegmentRampRate(size_t index) {
+  float rampRate;
+  memcpy(&rampRate, &_payload[getSegmentOffset(index) + PROFILE_RESPONSE_SEGMENT_RAMP_RATE_OFFSET], 4);
+  return rampRate;
+}
+
+size_t ProfileResponse::getSegmentOffset(size_t index) {
+  return PROFILE_RESPONSE_SEGMENTS_OFFSET + (index * PROFILE_RESPONSE_SEGMENT_SIZE);
+}
+
+volatile byte * ICACHE_RAM_ATTR ProfileResponse::getBuffer() {
+  return _buffer;
+}
+
+byte * ProfileResponse::getPayload() {
+  return _payload;
+}
+
+size_t ICACHE_RAM_ATTR ProfileResponse::getExpectedSize() {
+  return PROFILE_RESPONSE_SIZE;
+}
+
+uint8_t ProfileResponse::getExpectedProtocol() {
+  return PROFILE_PROTOCOL_ID;
+}
+
+
+// ProfileRequest //////////////////////////////////////////////////////////////////////////////////
+
+ProfileRequest::ProfileRequest(uint32_t deviceID, Hmac * hmac)
+:
+  Request(hmac, "ProfileRequest"),
+  _response(hmac)
+{
+  Request::initialize(_buffer, PROFILE_REQUEST_SIZE, PROFILE_PROTOCOL_ID, deviceID);
+  // There is nothing to populate - this request is "populated" when empty
+  setPopulated();
+}
+
+void ProfileRequest::reset() {
+  Request::reset();
+  setPopulated();
+}
+
+size_t ProfileRequest::getSize() {
+  return PROFILE_REQUEST_SIZE;
+}
+
+ProfileResponse * ProfileRequest::getResponse() {
+  return &_response;
+}
+
+byte * ProfileRequest::getBuffer() {
+  return _buffer;
+}
@@ -0,0 +1,104 @@
+#ifndef ProfileProtocol_h
+#define ProfileProtocol_h
+
+#include <Arduino.h>
+#include <Request.h>
+#include <Response.h>
+
+#define PROFILE_PROTOCOL_ID 0x04
+
+#define PROFILE_REQUEST_SIZE REQUEST_BASE_SIZE
+
+#define PROFILE_RESPONSE_SEGMENT_LIMIT 16
+#define PROFILE_RESPONSE_SEGMENT_SIZE 12
+#define PROFILE_RESPONSE_SIZE RESPONSE_BASE_SIZE + (PROFILE_RESPONSE_SEGMENT_SIZE * PROFILE_RESPONSE_SEGMENT_LIMIT)
+#define PROFILE_RESPONSE_PROFILE_ID_OFFSET 14
+#define PROFILE_RESPONSE_SEGMENT_COUNT_OFFSET 18
+#define PROFILE_RESPONSE_SEGMENTS_OFFSET RESPONSE_HEADER_SIZE
+#define PROFILE_RESPONSE_SEGMENT_START_OFFSET 0
+#define PROFILE_RESPONSE_SEGMENT_TARGET_OFFSET 4
+#define PROFILE_RESPONSE_SEGMENT_RAMP_RATE_OFFSET 8
+
+/**
+ * Parses and encapsulates the server's ProfileRequest
+ * response, exposing the fermentation profile that the
+ * server intends for the client device to run.
+ *
+ * The behavior of all accessors is undefined if there
+ * are response errors (i.e. hasErrors() returns true).
+ */
+class ProfileResponse: public Response {
+  public:
+    ProfileResponse(Hmac * hmac);
+
+    /**
+     * The server-assigned profile ID. 0 if the device
+     * should not run a profile.
+     */
+    uint32_t getProfileID();
+
+    /**
+     * The number of segments in the profile, which may be
+     * more than PROFILE_RESPONSE_SEGMENT_LIMIT if the server
+     * is misbehaving. 0 if the device should not run a
+     * profile.
+     */
+    uint8_t getSegmentCount();
+
+    /**
+     * The start time (seconds since Jan 1 1970) of the
+     * segment at the given index.
+     */
+    uint32_t getSegmentStart(size_t index);
+
+    /**
+     * The target temperature in Celsius of the segment at
+     * the given index.
+     */
+    float getSegmentTarget(size_t index);
+
+    /**
+     * The rate, in degrees Celsius per hour, at which the
+     * segment at the given index ramps toward its target.
+     */
+    float getSegmentRampRate(size_t index);
+
+  protected:
+    volatile byte * getBuffer();
+    byte * getPayload();
+    size_t getExpectedSize();
+    uint8_t getExpectedProtocol();
+
+  private:
+    volatile byte _buffer[PROFILE_RESPONSE_SIZE];
+    byte _payload[PROFILE_RESPONSE_SIZE];
+
+    size_t getSegmentOffset(size_t index);
+};
+
+/**
+ * Used to download the fermentation profile that the
+ * client device should be running.
+ */
+class ProfileRequest: public Request {
+  public:
+    ProfileRequest(uint32_t deviceID, Hmac * hmac);
+
+    /** See Request.reset() */
+    void reset();
+
+    /** See Request.getSize() */
+    size_t getSize();
+
+    /** See Request.getResponse() */
+    ProfileResponse * getResponse();
+
+    /** See Request.getBuffer() */
+    byte * getBuffer();
+
+  private:
+    byte _buffer[PROFILE_REQUEST_SIZE];
+    ProfileResponse _response;
+};
+
+#endif // ProfileProtocol_h
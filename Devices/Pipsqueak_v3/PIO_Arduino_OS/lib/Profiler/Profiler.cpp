@@ -0,0 +1,89 @@
+#include "Profiler.h"
+
+static const char * const profilerSlotNames[PROFILER_SLOT_COUNT] = {
+  "state.loop",
+  "client.loop",
+  "indicators.loop",
+  "sensors.loop",
+  "controller.loop",
+  "hmac.compute",
+  "ds18b20.readScratchpad",
+  "response.ready"
+};
+
+Profiler::Histogram Profiler::_histograms[PROFILER_SLOT_COUNT];
+ProfilerRun Profiler::_recent[PROFILER_RECENT_COUNT];
+size_t Profiler::_recentCount = 0;
+size_t Profiler::_recentCursor = 0;
+uint32_t Profiler::_activeSlots = 0;
+
+void Profiler::record(uint8_t slot, uint32_t cycles) {
+  if (slot >= PROFILER_SLOT_COUNT) return;
+  Histogram * histogram = &_histograms[slot];
+  uint8_t bucket = 31 - __builtin_clz(cycles | 1);
+  if (bucket >= PROFILER_BUCKET_COUNT) bucket = PROFILER_BUCKET_COUNT - 1;
+  histogram->buckets[bucket] += 1;
+  histogram->count += 1;
+  if (cycles > histogram->maxCycles) histogram->maxCycles = cycles;
+
+  _activeSlots &= ~(1UL << slot);
+  _recent[_recentCursor].slot = slot;
+  _recent[_recentCursor].cycles = cycles;
+  _recentCursor = (_recentCursor + 1) % PROFILER_RECENT_COUNT;
+  if (_recentCount < PROFILER_RECENT_COUNT) _recentCount += 1;
+}
+
+void Profiler::enter(uint8_t slot) {
+  if (slot >= PROFILER_SLOT_COUNT) return;
+  _activeSlots |= 1UL << slot;
+}
+
+void Profiler::reset() {
+  memset(_histograms, 0, sizeof(_histograms));
+}
+
+const char * Profiler::getName(uint8_t slot) {
+  if (slot >= PROFILER_SLOT_COUNT) return NULL;
+  return profilerSlotNames[slot];
+}
+
+uint32_t Profiler::getCount(uint8_t slot) {
+  if (slot >= PROFILER_SLOT_COUNT) return 0;
+  return _histograms[slot].count;
+}
+
+uint32_t Profiler::getMaxCycles(uint8_t slot) {
+  if (slot >= PROFILER_SLOT_COUNT) return 0;
+  return _histograms[slot].maxCycles;
+}
+
+uint32_t Profiler::getBucketCount(uint8_t slot, uint8_t bucket) {
+  if (slot >= PROFILER_SLOT_COUNT || bucket >= PROFILER_BUCKET_COUNT) return 0;
+  return _histograms[slot].buckets[bucket];
+}
+
+uint8_t Profiler::getPercentileBucket(uint8_t slot, uint8_t percentile) {
+  if (slot >= PROFILER_SLOT_COUNT) return 0;
+  Histogram * histogram = &_histograms[slot];
+  // Smallest bucket at or below which the percentile's share of runs fall
+  uint64_t threshold = ((uint64_t) histogram->count * percentile + 99) / 100;
+  uint64_t cumulative = 0;
+  for (uint8_t bucket = 0; bucket < PROFILER_BUCKET_COUNT; bucket++) {
+    cumulative += histogram->buckets[bucket];
+    if (cumulative >= threshold && cumulative > 0) return bucket;
+  }
+  return 0;
+}
+
+uint32_t Profiler::getActiveSlots() {
+  return _activeSlots;
+}
+
+size_t Profiler::getRecentCount() {
+  return _recentCount;
+}
+
+ProfilerRun Profiler::getRecent(size_t age) {
+  if (age >= _recentCount) return ProfilerRun { 0, { 0, 0, 0 }, 0 };
+  return _recent[(_recentCursor + PROFILER_RECENT_COUNT - 1 - age) % PROFILER_RECENT_COUNT];
+}
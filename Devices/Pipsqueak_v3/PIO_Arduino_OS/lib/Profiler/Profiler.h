@@ -0,0 +1,148 @@
+#ifndef Profiler_h
+#define Profiler_h
+
+#include <Arduino.h>
+
+// Profiled code paths; the slot numbers are reported in latency
+// histogram status events, so append new slots rather than renumber
+#define PROFILER_SLOT_STATE_LOOP 0
+#define PROFILER_SLOT_CLIENT_LOOP 1
+#define PROFILER_SLOT_INDICATORS_LOOP 2
+#define PROFILER_SLOT_SENSORS_LOOP 3
+#define PROFILER_SLOT_CONTROLLER_LOOP 4
+#define PROFILER_SLOT_HMAC_COMPUTE 5
+#define PROFILER_SLOT_READ_SCRATCHPAD 6
+#define PROFILER_SLOT_RESPONSE_READY 7
+#define PROFILER_SLOT_COUNT 8
+
+// bucket n counts runs of 2^n to 2^(n+1)-1 cycles; the last bucket
+// also counts anything longer (2^23 cycles is ~100ms at 80MHz)
+#define PROFILER_BUCKET_COUNT 24
+
+// runs kept, newest last, for crash dumps
+#define PROFILER_RECENT_COUNT 16
+
+/**
+ * One recent run of a profiled code path.
+ */
+struct ProfilerRun {
+  uint8_t slot;
+  uint8_t reserved[3];
+  uint32_t cycles;
+};
+
+/**
+ * Measures how many CPU cycles profiled code paths take, keeping
+ * a log2 histogram, a count and the longest run of each. The last
+ * PROFILER_RECENT_COUNT runs, and which slots are running, are kept
+ * too, so that a crash dump can show what led up to the crash.
+ *
+ * Recording a run costs a few dozen cycles and no heap, so
+ * the profiler is always on. Code paths are profiled by placing
+ * PROFILER_SCOPE(slot) at the top of the function of interest;
+ * the run lasts until the end of the enclosing scope. Off the
+ * esp8266 (e.g. in host-side tests), PROFILER_SCOPE compiles to
+ * nothing.
+ *
+ * Pure arithmetic: no I/O. PipsqueakState reports and resets the
+ * histograms hourly; the main program dumps them to Serial on
+ * request.
+ *
+ * Not ISR safe.
+ */
+class Profiler {
+  public:
+    /**
+     * Adds a run of the given number of cycles to the slot's
+     * histogram. Ignores unknown slots.
+     */
+    static void record(uint8_t slot, uint32_t cycles);
+
+    /**
+     * Marks the slot as running until its next record().
+     */
+    static void enter(uint8_t slot);
+
+    /**
+     * Clears every slot's histogram. The recent runs are kept.
+     */
+    static void reset();
+
+    /**
+     * Returns the slot's human-readable name, or NULL if unknown.
+     */
+    static const char * getName(uint8_t slot);
+
+    /**
+     * Returns how many runs were recorded since the last reset.
+     */
+    static uint32_t getCount(uint8_t slot);
+
+    /**
+     * Returns the longest run since the last reset, in cycles.
+     */
+    static uint32_t getMaxCycles(uint8_t slot);
+
+    /**
+     * Returns how many runs fell into the given bucket.
+     */
+    static uint32_t getBucketCount(uint8_t slot, uint8_t bucket);
+
+    /**
+     * Returns the bucket holding the given percentile (1-100) of
+     * the runs since the last reset; 0 if there were none.
+     */
+    static uint8_t getPercentileBucket(uint8_t slot, uint8_t percentile);
+
+    /**
+     * Returns a bit mask of the slots entered but not yet recorded;
+     * bit n is slot n.
+     */
+    static uint32_t getActiveSlots();
+
+    /**
+     * Returns how many recent runs are kept, up to
+     * PROFILER_RECENT_COUNT.
+     */
+    static size_t getRecentCount();
+
+    /**
+     * Returns a recent run; age 0 is the newest.
+     */
+    static ProfilerRun getRecent(size_t age);
+
+  private:
+    struct Histogram {
+      uint32_t count;
+      uint32_t maxCycles;
+      uint32_t buckets[PROFILER_BUCKET_COUNT];
+    };
+
+    static Histogram _histograms[PROFILER_SLOT_COUNT];
+    static ProfilerRun _recent[PROFILER_RECENT_COUNT];
+    static size_t _recentCount;
+    static size_t _recentCursor;
+    static uint32_t _activeSlots;
+};
+
+#ifdef ARDUINO_ARCH_ESP8266
+/**
+ * Records the cycles from construction to destruction. Use via
+ * PROFILER_SCOPE(slot).
+ */
+class ProfilerScope {
+  public:
+    ProfilerScope(uint8_t slot) : _slot { slot }, _start { ESP.getCycleCount() } { Profiler::enter(slot); }
+    ~ProfilerScope() { Profiler::record(_slot, ESP.getCycleCount() - _start); }
+
+  private:
+    uint8_t _slot;
+    uint32_t _start;
+};
+
+#define PROFILER_SCOPE(slot) ProfilerScope _profilerScope(slot)
+#else
+#define PROFILER_SCOPE(slot)
+#endif
+
+#endif // Profiler_h
@@ -0,0 +1,67 @@
+#include "PulseOutput.h"
+#include <core_esp8266_waveform.h>
+
+#define MICROS_PER_MILLI 1000
+
+PulseOutput::PulseOutput()
+:
+  _pin { 0 },
+  _active { false },
+  _startMillis { 0 },
+  _duration { 0 }
+{
+}
+
+void PulseOutput::setup(uint8_t pin) {
+  _pin = pin;
+  pinMode(_pin, OUTPUT);
+  digitalWrite(_pin, LOW);
+}
+
+bool PulseOutput::start(uint32_t duration, uint8_t percentPower) {
+  percentPower = min(percentPower, (uint8_t) 100);
+  if (duration == 0 || percentPower == 0) {
+    stop();
+    return true;
+  }
+
+  uint32_t highTime;
+  uint32_t lowTime;
+  if (percentPower == 100) {
+    // High throughout, until the pulse ends
+    highTime = PULSE_OUTPUT_PWM_PERIOD;
+    lowTime = 0;
+  } else {
+    duration = ((duration + PULSE_OUTPUT_PWM_PERIOD - 1) / PULSE_OUTPUT_PWM_PERIOD) * PULSE_OUTPUT_PWM_PERIOD;
+    highTime = percentPower * PULSE_OUTPUT_PWM_PERIOD / 100;
+    lowTime = PULSE_OUTPUT_PWM_PERIOD - highTime;
+  }
+  // Beyond the generator's range, the pulse runs until isActive()
+  // finds it over
+  uint32_t runTime = duration <= PULSE_OUTPUT_RUN_TIME_LIMIT ? duration : 0;
+
+  #ifdef DEBUG_PULSE_OUTPUT
+  Serial.printf("PulseOutput.start(): GPIO %02u for %u ms, %u ms high / %u ms low\n", _pin, duration, highTime, lowTime);
+  #endif
+
+  // The generator drives the pin low once the run time expires
+  if (!startWaveform(_pin, highTime * MICROS_PER_MILLI, lowTime * MICROS_PER_MILLI, runTime * MICROS_PER_MILLI)) {
+    stop();
+    return false;
+  }
+  _active = true;
+  _startMillis = millis();
+  _duration = duration;
+  return true;
+}
+
+void PulseOutput::stop() {
+  stopWaveform(_pin);
+  digitalWrite(_pin, LOW);
+  _active = false;
+}
+
+bool PulseOutput::isActive() {
+  if (_active && millis() - _startMillis >= _duration) stop();
+  return _active;
+}
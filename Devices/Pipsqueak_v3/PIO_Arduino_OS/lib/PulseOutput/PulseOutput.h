@@ -0,0 +1,68 @@
+#ifndef PulseOutput_h
+#define PulseOutput_h
+
+#include <Arduino.h>
+
+// Modulation period for partial-power pulses
+#define PULSE_OUTPUT_PWM_PERIOD 100 // ms
+
+// Longest run time handed to the waveform generator, which counts in
+// signed 32-bit CPU cycles: about 13.4 s at 160 MHz
+#define PULSE_OUTPUT_RUN_TIME_LIMIT 10000 // ms
+
+// Un-comment to enable detailed debug statements
+// #define DEBUG_PULSE_OUTPUT true
+
+/**
+ * Drives an active-high output pin through timed pulses using
+ * the esp8266 core's waveform generator, which toggles the pin
+ * from a timer interrupt, so the duty cycle doesn't depend on how
+ * promptly the main loop runs. A pulse of up to
+ * PULSE_OUTPUT_RUN_TIME_LIMIT also ends on the timer; a longer one
+ * runs open-ended and is ended by isActive(), which the owner
+ * invokes from its task.
+ *
+ * A pulse at less than 100% power is modulated with a
+ * PULSE_OUTPUT_PWM_PERIOD period, and its duration is rounded
+ * up to a whole number of periods so that it ends with the pin
+ * low.
+ */
+class PulseOutput {
+  public:
+    PulseOutput();
+
+    /**
+     * Configures the pin as an output and drives it low.
+     */
+    void setup(uint8_t pin);
+
+    /**
+     * Starts a pulse of the given duration in milliseconds at
+     * the given percentage of full power, replacing any pulse
+     * in progress. Values of percentPower above 100 are treated
+     * as 100.
+     *
+     * Returns false, leaving the pin low, if the waveform
+     * generator refused the pulse.
+     */
+    bool start(uint32_t duration, uint8_t percentPower = 100);
+
+    /**
+     * Ends the pulse in progress, if any, and drives the pin low.
+     */
+    void stop();
+
+    /**
+     * Indicates whether a pulse is in progress, ending it if its
+     * duration has passed.
+     */
+    bool isActive();
+
+  private:
+    uint8_t _pin;
+    bool _active;
+    uint32_t _startMillis;
+    uint32_t _duration;
+};
+
+#endif // PulseOutput_h
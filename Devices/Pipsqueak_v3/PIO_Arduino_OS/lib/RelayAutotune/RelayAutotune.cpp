@@ -0,0 +1,146 @@
+#include "RelayAutotune.h"
+
+// Tyreus-Luyben PID tuning rules
+#define TL_GAIN_DIVISOR 2.2
+#define TL_INTEGRAL_TIME_FACTOR 2.2
+#define TL_DERIVATIVE_TIME_DIVISOR 6.3
+
+// control periods per ultimate period
+#define CONTROL_PERIODS_PER_CYCLE 20
+
+RelayAutotune::RelayAutotune(float outputHigh, float outputLow, float hysteresis)
+:
+  _outputHigh { outputHigh },
+  _outputLow { outputLow },
+  _hysteresis { hysteresis },
+  _setpoint { 0 },
+  _outcome { AutotuneIdle },
+  _relayHigh { false },
+  _lastSwitchMillis { 0 },
+  _cycleStartMillis { 0 },
+  _cycleCount { 0 },
+  _maximum { NAN },
+  _minimum { NAN },
+  _sumOfMaxima { 0 },
+  _sumOfMinima { 0 },
+  _sumOfPeriods { 0 },
+  _ultimateGain { NAN },
+  _ultimatePeriod { 0 }
+{
+}
+
+void RelayAutotune::start(float setpoint, uint32_t nowMillis, float restingTemperature) {
+  _setpoint = setpoint;
+  _outcome = AutotuneRunning;
+  _relayHigh = true;
+  _lastSwitchMillis = nowMillis;
+  _cycleStartMillis = nowMillis;
+  _cycleCount = 0;
+  _maximum = NAN;
+  _minimum = NAN;
+  _sumOfMaxima = 0;
+  _sumOfMinima = 0;
+  _sumOfPeriods = 0;
+  _ultimateGain = NAN;
+  _ultimatePeriod = 0;
+  // rather than waiting out AUTOTUNE_HALF_CYCLE_TIMEOUT
+  if (restingTemperature >= setpoint - _hysteresis) finish(AutotuneRefused);
+}
+
+float RelayAutotune::update(float temperature, uint32_t nowMillis) {
+  if (!isRunning()) return _outputLow;
+
+  if (isnan(temperature)) {
+    finish(AutotuneAborted);
+    return _outputLow;
+  }
+
+  if (nowMillis - _lastSwitchMillis > AUTOTUNE_HALF_CYCLE_TIMEOUT) {
+    // the output can't move the temperature across the band
+    finish(AutotuneTimedOut);
+    return _outputLow;
+  }
+
+  if (isnan(_maximum) || temperature > _maximum) _maximum = temperature;
+  if (isnan(_minimum) || temperature < _minimum) _minimum = temperature;
+
+  if (_relayHigh && temperature > _setpoint + _hysteresis) {
+    _relayHigh = false;
+    _lastSwitchMillis = nowMillis;
+    // the peak is still to come, after the switch
+    _maximum = temperature;
+  } else if (!_relayHigh && temperature < _setpoint - _hysteresis) {
+    _relayHigh = true;
+    _lastSwitchMillis = nowMillis;
+    cycleComplete(nowMillis);
+    _minimum = temperature;
+  }
+
+  return _relayHigh ? _outputHigh : _outputLow;
+}
+
+void RelayAutotune::abort() {
+  if (isRunning()) finish(AutotuneAborted);
+}
+
+bool RelayAutotune::isRunning() {
+  return _outcome == AutotuneRunning;
+}
+
+AutotuneOutcome RelayAutotune::getOutcome() {
+  return _outcome;
+}
+
+float RelayAutotune::getUltimateGain() {
+  return _ultimateGain;
+}
+
+uint32_t RelayAutotune::getUltimatePeriod() {
+  return _ultimatePeriod;
+}
+
+float RelayAutotune::getProportionalGain() {
+  return _ultimateGain / TL_GAIN_DIVISOR;
+}
+
+float RelayAutotune::getIntegralGain() {
+  float integralTime = TL_INTEGRAL_TIME_FACTOR * _ultimatePeriod / 1000.0;
+  return getProportionalGain() / integralTime;
+}
+
+float RelayAutotune::getDerivativeGain() {
+  float derivativeTime = _ultimatePeriod / 1000.0 / TL_DERIVATIVE_TIME_DIVISOR;
+  return getProportionalGain() * derivativeTime;
+}
+
+uint32_t RelayAutotune::getControlPeriod() {
+  return constrain(_ultimatePeriod / CONTROL_PERIODS_PER_CYCLE, (uint32_t) AUTOTUNE_MIN_CONTROL_PERIOD, (uint32_t) AUTOTUNE_MAX_CONTROL_PERIOD);
+}
+
+void RelayAutotune::cycleComplete(uint32_t nowMillis) {
+  // The first cycle starts from wherever the temperature happened to
+  // be, so it is not representative of the limit cycle
+  if (_cycleCount > 0) {
+    _sumOfMaxima += _maximum;
+    _sumOfMinima += _minimum;
+    _sumOfPeriods += nowMillis - _cycleStartMillis;
+  }
+  _cycleStartMillis = nowMillis;
+  _cycleCount += 1;
+  if (_cycleCount <= AUTOTUNE_CYCLES) return;
+
+  float amplitude = (_sumOfMaxima - _sumOfMinima) / AUTOTUNE_CYCLES / 2;
+  if (amplitude <= _hysteresis) {
+    finish(AutotuneFailed);
+    return;
+  }
+  // Describing-function analysis of a relay with hysteresis
+  float relayAmplitude = (_outputHigh - _outputLow) / 2;
+  _ultimateGain = 4 * relayAmplitude / (PI * sqrtf(amplitude * amplitude - _hysteresis * _hysteresis));
+  _ultimatePeriod = _sumOfPeriods / AUTOTUNE_CYCLES;
+  finish(AutotuneSucceeded);
+}
+
+void RelayAutotune::finish(AutotuneOutcome outcome) {
+  _outcome = outcome;
+}
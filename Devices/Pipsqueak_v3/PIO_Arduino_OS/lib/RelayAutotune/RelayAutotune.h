@@ -0,0 +1,122 @@
+#ifndef RelayAutotune_h
+#define RelayAutotune_h
+
+#include <Arduino.h>
+
+// cycles measured after the first (discarded) cycle
+#define AUTOTUNE_CYCLES 3
+
+// longest the temperature may take to cross the hysteresis band
+#define AUTOTUNE_HALF_CYCLE_TIMEOUT 14400000 // ms (4 hours)
+
+// control period bounds, as derived from the ultimate period
+#define AUTOTUNE_MIN_CONTROL_PERIOD 10000  // ms
+#define AUTOTUNE_MAX_CONTROL_PERIOD 120000 // ms
+
+enum AutotuneOutcome {
+  AutotuneIdle = 0,
+  AutotuneRunning = 1,
+  AutotuneSucceeded = 2,
+  AutotuneAborted = 3,
+  AutotuneTimedOut = 4,
+  AutotuneFailed = 5,
+  AutotuneRefused = 6
+};
+
+/**
+ * Runs an Astrom-Hagglund relay-feedback experiment: the output
+ * is switched between two levels whenever the temperature crosses
+ * a hysteresis band around the setpoint, which drives the process
+ * into a limit cycle. The cycle's period and amplitude estimate
+ * the ultimate period Pu and ultimate gain Ku, from which PID
+ * gains are derived with the Tyreus-Luyben rules, which favor
+ * robustness over speed for lag-dominated processes such as a
+ * vessel of liquid.
+ *
+ * Pure arithmetic: no I/O. The caller supplies the time with
+ * each measurement and applies the returned output.
+ */
+class RelayAutotune {
+  public:
+    /**
+     * Constructor.
+     *
+     * outputHigh: output applied while below the band
+     * outputLow: output applied while above the band
+     * hysteresis: half-width of the band, degrees C
+     */
+    RelayAutotune(float outputHigh, float outputLow, float hysteresis);
+
+    /**
+     * Begins an experiment around the given setpoint.
+     *
+     * restingTemperature: where the temperature settles with
+     *  outputLow applied, e.g. the ambient temperature for a heater,
+     *  or NAN if unknown. The experiment is refused at once if that
+     *  isn't below the band, as the temperature could never cross it.
+     */
+    void start(float setpoint, uint32_t nowMillis, float restingTemperature = NAN);
+
+    /**
+     * Accepts a measurement and returns the output to apply
+     * until the next measurement. Returns outputLow once the
+     * experiment is no longer running.
+     */
+    float update(float temperature, uint32_t nowMillis);
+
+    /**
+     * Ends the experiment without a result.
+     */
+    void abort();
+
+    /**
+     * Indicates whether an experiment is in progress.
+     */
+    bool isRunning();
+
+    /**
+     * Returns the state or outcome of the most recent experiment.
+     */
+    AutotuneOutcome getOutcome();
+
+    /** Ultimate gain, output units per degree C. */
+    float getUltimateGain();
+
+    /** Ultimate period, ms. */
+    uint32_t getUltimatePeriod();
+
+    /** Derived proportional gain, output units per degree C. */
+    float getProportionalGain();
+
+    /** Derived integral gain, output units per degree C second. */
+    float getIntegralGain();
+
+    /** Derived derivative gain, output units per degree C per second. */
+    float getDerivativeGain();
+
+    /** Derived control period, ms. */
+    uint32_t getControlPeriod();
+
+  private:
+    float _outputHigh;
+    float _outputLow;
+    float _hysteresis;
+    float _setpoint;
+    AutotuneOutcome _outcome;
+    bool _relayHigh;
+    uint32_t _lastSwitchMillis;
+    uint32_t _cycleStartMillis;
+    size_t _cycleCount;
+    float _maximum;
+    float _minimum;
+    float _sumOfMaxima;
+    float _sumOfMinima;
+    uint32_t _sumOfPeriods;
+    float _ultimateGain;
+    uint32_t _ultimatePeriod;
+
+    void cycleComplete(uint32_t nowMillis);
+    void finish(AutotuneOutcome outcome);
+};
+
+#endif // RelayAutotune_h
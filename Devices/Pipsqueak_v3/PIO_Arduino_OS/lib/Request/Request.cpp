@@ -43,6 +43,10 @@ const char * Request::getName() {
   return _name;
 }
 
+uint8_t Request::getProtocol() {
+  return getBuffer()[REQUEST_PROTOCOL_ID_OFFSET];
+}
+
 void Request::initialize(byte * buffer, size_t bufferSize, uint8_t protocolID, uint32_t deviceID) {
   memset(buffer, 0, bufferSize);
   buffer[REQUEST_PROTOCOL_ID_OFFSET] = protocolID;
@@ -189,6 +189,12 @@ class Request {
      */
     const char * getName();
 
+    /**
+     * Returns the protocol ID of this request, for logging where
+     * the name can't be.
+     */
+    uint8_t getProtocol();
+
   protected:
     /**
      * Performs universal initialization actions. Unsets every byte in the buffer
@@ -1,13 +1,16 @@
 #include "Response.h"
 #include <Hmac.h>
 #include <Errors.h>
+#include <Profiler.h>
 
 Response::Response(Hmac * hmac, const char * name)
   :
   _challenge { 0 },
   _bytesReceived { 0 },
+  _receivedMillis { 0 },
   _errorCount { 0 },
   _ready { false },
+  _authentic { false },
   _inUse { false },
   _elapsedTime { 0 }
 {
@@ -21,7 +24,9 @@ void Response::reset() {
   _errorCount = 0;
   _challenge = 0;
   _ready = false;
+  _authentic = false;
   _bytesReceived = 0;
+  _receivedMillis = 0;
   _inUse = false;
   _elapsedTime = 0;
 }
@@ -29,6 +34,7 @@ void Response::reset() {
 void ICACHE_RAM_ATTR Response::receiveBytes(void * data, size_t len) {
   // ignore incoming bytes of the response isn't in use
   if (!isInUse()) return;
+  if (_bytesReceived == 0) _receivedMillis = millis();
   // memcpy is not compatible with volatile memory
   size_t bytesRead = 0;
   for (size_t i = 0; i < len; i++) {
@@ -50,6 +56,7 @@ bool Response::isComplete() {
 }
 
 void Response::ready(time_t elapsedTime) {
+  PROFILER_SCOPE(PROFILER_SLOT_RESPONSE_READY);
   size_t size = _bytesReceived;
   volatile byte * bufferPtr = getBuffer();
   byte * payloadPtr = getPayload();
@@ -57,7 +64,8 @@ void Response::ready(time_t elapsedTime) {
     for (size_t i = 0; i < size; i++) {
       payloadPtr[i] = bufferPtr[i];
     }
-    inspectProtocol() && inspectHmac() && inspectChallenge() && inspectStatusCode();
+    _authentic = inspectProtocol() && inspectHmac() && inspectChallenge();
+    if (_authentic) inspectStatusCode();
   } else if (size > getExpectedSize()) {
     addError(ErrorType::Pipsqueak, RESPONSE_ERROR_EXCESS_DATA);
   } else if (size < getExpectedSize()) {
@@ -71,6 +79,10 @@ bool Response::isReady() {
   return _ready;
 }
 
+bool Response::isAuthentic() {
+  return _authentic;
+}
+
 bool ICACHE_RAM_ATTR Response::isInUse() {
   return _inUse;
 }
@@ -120,6 +132,10 @@ time_t Response::getElapsedTime() {
   return _elapsedTime;
 }
 
+uint32_t Response::getReceivedMillis() {
+  return _receivedMillis;
+}
+
 void Response::setChallenge(uint32_t challenge) {
   _challenge = challenge;
   _inUse = true;
@@ -58,7 +58,8 @@ class Response {
     /**
      * ISR-invoked method that writes incoming response bytes to the derived
      * classes' buffer. Records the total number of bytes received, but writes
-     * no more than getExpectedSize() bytes to the buffer.
+     * no more than getExpectedSize() bytes to the buffer, and the value of
+     * millis() when the first of them arrived.
      */
     void receiveBytes(void * data, size_t len);
 
@@ -86,6 +87,14 @@ class Response {
      */
     bool isReady();
 
+    /**
+     * Indicates that the response arrived whole, for the expected protocol,
+     * with a valid HMAC and the challenge issued. Its timestamp can then be
+     * trusted even if the server reported errors, such as the request being
+     * out of sync with the server's clock.
+     */
+    bool isAuthentic();
+
     /**
      * Indicates that this instance is being used - or about to be used - in a
      * request-response cycle. Useful as a signal to application code that the
@@ -133,6 +142,12 @@ class Response {
      */
     time_t getElapsedTime();
 
+    /**
+     * Returns the value of millis() when the first byte of the response
+     * arrived.
+     */
+    uint32_t getReceivedMillis();
+
     /**
      * Sets the challenge value.
      *
@@ -200,9 +215,11 @@ class Response {
     const char * _name;
     uint32_t _challenge;
     volatile size_t _bytesReceived;
+    volatile uint32_t _receivedMillis;
     size_t _errorCount;
     byte _errors[ERROR_COUNT_LIMIT * 2];
     bool _ready;
+    bool _authentic;
     volatile bool _inUse;
     time_t _elapsedTime;
 
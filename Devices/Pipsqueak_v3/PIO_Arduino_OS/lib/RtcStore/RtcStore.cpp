@@ -0,0 +1,41 @@
+#include "RtcStore.h"
+#include <ConfigImage.h>
+
+static size_t blocksFor(size_t size) {
+  return (size + RTC_STORE_BLOCK_SIZE - 1) / RTC_STORE_BLOCK_SIZE;
+}
+
+static bool fits(uint32_t offset, size_t size) {
+  if (offset < RTC_STORE_FIRST_BLOCK) return false;
+  return offset + RTC_STORE_HEADER_BLOCKS + blocksFor(size) <= RTC_STORE_BLOCK_COUNT;
+}
+
+bool RtcStore::read(uint32_t offset, void * data, size_t size) {
+  if (!fits(offset, size)) return false;
+  uint32_t header[RTC_STORE_HEADER_BLOCKS];
+  if (!ESP.rtcUserMemoryRead(offset, header, sizeof(header))) return false;
+  if (header[0] != size) return false;
+
+  uint32_t buffer[(RTC_STORE_BLOCK_COUNT - RTC_STORE_FIRST_BLOCK) * RTC_STORE_BLOCK_SIZE / sizeof(uint32_t)];
+  size_t bufferSize = blocksFor(size) * RTC_STORE_BLOCK_SIZE;
+  if (!ESP.rtcUserMemoryRead(offset + RTC_STORE_HEADER_BLOCKS, buffer, bufferSize)) return false;
+  if (ConfigImageFormat::crc32(buffer, size) != header[1]) return false;
+  memcpy(data, buffer, size);
+  return true;
+}
+
+bool RtcStore::write(uint32_t offset, const void * data, size_t size) {
+  if (!fits(offset, size)) return false;
+  uint32_t buffer[(RTC_STORE_BLOCK_COUNT - RTC_STORE_FIRST_BLOCK) * RTC_STORE_BLOCK_SIZE / sizeof(uint32_t)];
+  size_t bufferSize = blocksFor(size) * RTC_STORE_BLOCK_SIZE;
+  memset(buffer, 0, bufferSize);
+  memcpy(buffer, data, size);
+  if (!ESP.rtcUserMemoryWrite(offset + RTC_STORE_HEADER_BLOCKS, buffer, bufferSize)) return false;
+  uint32_t header[RTC_STORE_HEADER_BLOCKS] = { (uint32_t) size, ConfigImageFormat::crc32(data, size) };
+  return ESP.rtcUserMemoryWrite(offset, header, sizeof(header));
+}
+
+void RtcStore::erase(uint32_t offset) {
+  uint32_t header[RTC_STORE_HEADER_BLOCKS] = { 0, 0 };
+  ESP.rtcUserMemoryWrite(offset, header, sizeof(header));
+}
@@ -0,0 +1,50 @@
+#ifndef RtcStore_h
+#define RtcStore_h
+
+#include <Arduino.h>
+
+// RTC user memory is 128 4-byte blocks, the first 32 of which are
+// left to the core's OTA updater
+#define RTC_STORE_BLOCK_SIZE 4
+#define RTC_STORE_FIRST_BLOCK 32
+#define RTC_STORE_BLOCK_COUNT 128
+
+// each record is preceded by a 2-block header (size, CRC-32)
+#define RTC_STORE_HEADER_BLOCKS 2
+
+// block offsets of the records; see README.md for the layout
+#define RTC_STORE_MONITOR_BATCH 32
+#define RTC_STORE_WARM_BOOT 102
+
+/**
+ * Keeps records in the esp8266's RTC user memory, which survives
+ * deep sleep and resets, but not power loss.
+ *
+ * Each record is kept at a fixed block offset and is validated
+ * by its size and a CRC-32 when read, so a record that was never
+ * written, or whose memory was lost, reads as absent.
+ *
+ * Not ISR safe.
+ */
+class RtcStore {
+  public:
+    /**
+     * Reads the record at the given block offset into data.
+     * Returns false, leaving data untouched, if there is no valid
+     * record of the given size at that offset.
+     */
+    static bool read(uint32_t offset, void * data, size_t size);
+
+    /**
+     * Writes a record to the given block offset. Returns false if
+     * the record would not fit in RTC user memory.
+     */
+    static bool write(uint32_t offset, const void * data, size_t size);
+
+    /**
+     * Invalidates the record at the given block offset.
+     */
+    static void erase(uint32_t offset);
+};
+
+#endif // RtcStore_h
@@ -0,0 +1,162 @@
+#include "Scheduler.h"
+#include <BinaryLog.h>
+
+Scheduler::Scheduler()
+:
+  _taskCount { 0 },
+  _woken { false },
+  _overrunCallback { NULL },
+  _overrunContext { NULL },
+  _idleSlice { 1 },
+  _idleMillis { 0 }
+{
+  memset(_tasks, 0, sizeof(_tasks));
+}
+
+TaskID Scheduler::every(const char * name, uint32_t periodMillis, TaskCallback callback, void * context) {
+  TaskID task = add(name, periodMillis, callback, context);
+  if (task != SCHEDULER_NO_TASK) wakeIn(task, 0);
+  return task;
+}
+
+TaskID Scheduler::once(const char * name, TaskCallback callback, void * context) {
+  return add(name, 0, callback, context);
+}
+
+TaskID Scheduler::add(const char * name, uint32_t periodMillis, TaskCallback callback, void * context) {
+  if (_taskCount >= SCHEDULER_TASK_LIMIT) {
+    #ifdef DEBUG_SCHEDULER
+    Serial.printf("Scheduler.add(%s): rejected (task limit reached)\n", name);
+    #endif
+    return SCHEDULER_NO_TASK;
+  }
+  Task * task = &_tasks[_taskCount];
+  task->name = name;
+  task->callback = callback;
+  task->context = context;
+  task->period = periodMillis;
+  task->scheduled = false;
+  task->woken = false;
+  _taskCount += 1;
+  return _taskCount - 1;
+}
+
+void Scheduler::wake(TaskID task) {
+  if (!isValid(task)) return;
+  _tasks[task].woken = true;
+  _woken = true;
+}
+
+void Scheduler::wakeIn(TaskID task, uint32_t delayMillis) {
+  if (!isValid(task)) return;
+  _tasks[task].deadline = millis() + delayMillis;
+  _tasks[task].scheduled = true;
+}
+
+void Scheduler::cancel(TaskID task) {
+  if (!isValid(task)) return;
+  _tasks[task].scheduled = false;
+  _tasks[task].woken = false;
+}
+
+void Scheduler::onOverrun(OverrunCallback callback, void * context) {
+  _overrunCallback = callback;
+  _overrunContext = context;
+}
+
+void Scheduler::setIdleSlice(uint32_t sliceMillis) {
+  _idleSlice = max(sliceMillis, (uint32_t) 1);
+}
+
+void Scheduler::loop() {
+  uint32_t idleMillis = runDue();
+  uint32_t idleStart = millis();
+  uint32_t idled = 0;
+  while (!_woken && idled < idleMillis) {
+    delay(min(_idleSlice, idleMillis - idled));
+    idled = millis() - idleStart;
+  }
+  _idleMillis += idled;
+}
+
+uint32_t Scheduler::runDue() {
+  _woken = false;
+  for (TaskID task = 0; task < (TaskID) _taskCount; task++) {
+    bool due = _tasks[task].scheduled && (int32_t) (millis() - _tasks[task].deadline) >= 0;
+    if (due || _tasks[task].woken) run(task);
+  }
+
+  if (_woken) return 0;
+  uint32_t idleMillis = SCHEDULER_IDLE_LIMIT;
+  uint32_t now = millis();
+  for (size_t i = 0; i < _taskCount; i++) {
+    if (!_tasks[i].scheduled) continue;
+    int32_t remaining = (int32_t) (_tasks[i].deadline - now);
+    if (remaining <= 0) return 0;
+    idleMillis = min(idleMillis, (uint32_t) remaining);
+  }
+  return idleMillis;
+}
+
+void Scheduler::run(TaskID task) {
+  Task * t = &_tasks[task];
+  uint32_t now = millis();
+  bool due = t->scheduled && (int32_t) (now - t->deadline) >= 0;
+  uint32_t lateness = due ? now - t->deadline : 0;
+  t->woken = false;
+
+  // Set the next deadline first so that the task may replace it
+  if (t->period == 0) {
+    t->scheduled = false;
+  } else if (!t->scheduled) {
+    wakeIn(task, t->period);
+  } else if (due) {
+    t->deadline += t->period;
+    if ((int32_t) (now - t->deadline) >= 0) t->deadline = now + t->period;
+  }
+
+  uint32_t start = micros();
+  t->callback(t->context);
+  uint32_t duration = micros() - start;
+
+  t->runs += 1;
+  t->maxDuration = max(t->maxDuration, duration);
+  t->maxLateness = max(t->maxLateness, lateness);
+  if (lateness > SCHEDULER_OVERRUN_THRESHOLD) {
+    t->overruns += 1;
+    BinaryLog::write(LOG_SCHEDULER_OVERRUN, task, lateness);
+    if (_overrunCallback) _overrunCallback(task, _overrunContext);
+  }
+}
+
+bool Scheduler::isValid(TaskID task) {
+  return task >= 0 && task < (TaskID) _taskCount;
+}
+
+size_t Scheduler::getTaskCount() {
+  return _taskCount;
+}
+
+const char * Scheduler::getName(TaskID task) {
+  return isValid(task) ? _tasks[task].name : NULL;
+}
+
+uint32_t Scheduler::getRunCount(TaskID task) {
+  return isValid(task) ? _tasks[task].runs : 0;
+}
+
+uint32_t Scheduler::getIdleMillis() {
+  return _idleMillis;
+}
+
+uint32_t Scheduler::getOverrunCount(TaskID task) {
+  return isValid(task) ? _tasks[task].overruns : 0;
+}
+
+uint32_t Scheduler::getMaxLateness(TaskID task) {
+  return isValid(task) ? _tasks[task].maxLateness : 0;
+}
+
+uint32_t Scheduler::getMaxDuration(TaskID task) {
+  return isValid(task) ? _tasks[task].maxDuration : 0;
+}
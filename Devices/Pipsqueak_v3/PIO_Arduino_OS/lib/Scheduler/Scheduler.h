@@ -0,0 +1,155 @@
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#include <Arduino.h>
+
+// maximum number of tasks that may be registered
+#define SCHEDULER_TASK_LIMIT 12
+
+// a task that starts later than this after its deadline has overrun
+#define SCHEDULER_OVERRUN_THRESHOLD 20 // ms
+
+// longest the CPU idles when no task is scheduled
+#define SCHEDULER_IDLE_LIMIT 1000 // ms
+
+#define SCHEDULER_NO_TASK -1
+
+// Un-comment to enable detailed debug statements
+// #define DEBUG_SCHEDULER true
+
+typedef int8_t TaskID;
+typedef void (*TaskCallback)(void * context);
+typedef void (*OverrunCallback)(TaskID task, void * context);
+
+/**
+ * A fixed-capacity cooperative scheduler. Tasks are callbacks
+ * that run either periodically or once, at or after a deadline.
+ * Between deadlines the CPU idles in delay(), which also lets
+ * the network stack run.
+ *
+ * Tasks run to completion in the order in which they were
+ * registered. A task may be woken early from a network callback
+ * via wake(), and may move its own next deadline via wakeIn().
+ *
+ * A task that starts more than SCHEDULER_OVERRUN_THRESHOLD ms
+ * after its deadline has overrun; this is counted against it
+ * and reported to the overrun callback, if any. A periodic task
+ * that falls a whole period behind skips the activations it
+ * missed rather than running back to back.
+ *
+ * Not ISR-safe.
+ */
+class Scheduler {
+  public:
+    Scheduler();
+
+    /**
+     * Registers a task that runs every periodMillis, starting
+     * at the next call to loop().
+     *
+     * Returns SCHEDULER_NO_TASK if SCHEDULER_TASK_LIMIT tasks
+     * are already registered.
+     */
+    TaskID every(const char * name, uint32_t periodMillis, TaskCallback callback, void * context);
+
+    /**
+     * Registers a task that runs only when woken via wake()
+     * or wakeIn(), once per wake.
+     *
+     * Returns SCHEDULER_NO_TASK if SCHEDULER_TASK_LIMIT tasks
+     * are already registered.
+     */
+    TaskID once(const char * name, TaskCallback callback, void * context);
+
+    /**
+     * Runs the task on the next pass, ahead of its deadline.
+     * Safe to invoke from network callbacks.
+     */
+    void wake(TaskID task);
+
+    /**
+     * Sets the task's next deadline delayMillis from now,
+     * replacing the one it had. A periodic task resumes its
+     * period from there.
+     */
+    void wakeIn(TaskID task, uint32_t delayMillis);
+
+    /**
+     * Removes the task's deadline. A periodic task stays
+     * dormant until woken.
+     */
+    void cancel(TaskID task);
+
+    /**
+     * Registers a callback invoked whenever a task overruns.
+     */
+    void onOverrun(OverrunCallback callback, void * context);
+
+    /**
+     * Sets how long each delay() is while idling; 1ms by default.
+     * Wakes are noticed at the end of a slice, so longer slices
+     * delay them, but let the esp8266 light-sleep between deadlines.
+     */
+    void setIdleSlice(uint32_t sliceMillis);
+
+    /**
+     * Runs the tasks that are due or woken, then idles until
+     * the next deadline or wake. Invoke in the main program's
+     * loop() function.
+     */
+    void loop();
+
+    /**
+     * Runs the tasks that are due or woken, and returns the
+     * number of milliseconds until the next deadline: 0 if a
+     * task has been woken in the meantime.
+     */
+    uint32_t runDue();
+
+    size_t getTaskCount();
+    const char * getName(TaskID task);
+
+    /** Number of times the task has run. */
+    uint32_t getRunCount(TaskID task);
+
+    /** Number of times the task has overrun. */
+    uint32_t getOverrunCount(TaskID task);
+
+    /** Latest start relative to a deadline, ms. */
+    uint32_t getMaxLateness(TaskID task);
+
+    /** Longest run, us. */
+    uint32_t getMaxDuration(TaskID task);
+
+    /** Total time spent idling in loop(), ms. */
+    uint32_t getIdleMillis();
+
+  private:
+    struct Task {
+      const char * name;
+      TaskCallback callback;
+      void * context;
+      uint32_t period;
+      uint32_t deadline;
+      bool scheduled;
+      volatile bool woken;
+      uint32_t runs;
+      uint32_t overruns;
+      uint32_t maxLateness;
+      uint32_t maxDuration;
+    };
+
+    Task _tasks[SCHEDULER_TASK_LIMIT];
+    size_t _taskCount;
+    volatile bool _woken;
+    OverrunCallback _overrunCallback;
+    void * _overrunContext;
+    uint32_t _idleSlice;
+    uint32_t _idleMillis;
+
+    TaskID add(const char * name, uint32_t periodMillis, TaskCallback callback, void * context);
+    void run(TaskID task);
+    bool isValid(TaskID task);
+};
+
+#endif // Scheduler_h
@@ -59,6 +59,79 @@ void StatusEvent::chillerPulse(
   memcpy(&_payload[STATUS_EVENT_RECOVERY_DURATION_OFFSET], &recoveryDuration, 4);
 }
 
+void StatusEvent::tuningResult(
+  uint32_t timestamp,
+  float ultimateGain,
+  uint32_t ultimatePeriod,
+  uint8_t outcome
+) {
+  reset();
+  _payload[STATUS_EVENT_TYPE_OFFSET] = STATUS_EVENT_TYPE_TUNING;
+  memcpy(&_payload[STATUS_EVENT_TIMESTAMP_OFFSET], &timestamp, 4);
+  memcpy(&_payload[STATUS_EVENT_ULTIMATE_GAIN_OFFSET], &ultimateGain, 4);
+  memcpy(&_payload[STATUS_EVENT_ULTIMATE_PERIOD_OFFSET], &ultimatePeriod, 4);
+  _payload[STATUS_EVENT_TUNING_OUTCOME_OFFSET] = outcome;
+}
+
+void StatusEvent::latencyHistogram(
+  uint32_t timestamp,
+  uint8_t slot,
+  uint32_t count,
+  uint32_t maxCycles,
+  uint8_t medianBucket,
+  uint8_t tailBucket
+) {
+  reset();
+  _payload[STATUS_EVENT_TYPE_OFFSET] = STATUS_EVENT_TYPE_LATENCY;
+  memcpy(&_payload[STATUS_EVENT_TIMESTAMP_OFFSET], &timestamp, 4);
+  _payload[STATUS_EVENT_LATENCY_SLOT_OFFSET] = slot;
+  memcpy(&_payload[STATUS_EVENT_LATENCY_COUNT_OFFSET], &count, 4);
+  memcpy(&_payload[STATUS_EVENT_LATENCY_MAX_CYCLES_OFFSET], &maxCycles, 4);
+  _payload[STATUS_EVENT_LATENCY_MEDIAN_BUCKET_OFFSET] = medianBucket;
+  _payload[STATUS_EVENT_LATENCY_TAIL_BUCKET_OFFSET] = tailBucket;
+}
+
+void StatusEvent::bootTiming(
+  uint32_t timestamp,
+  uint8_t resetReason,
+  uint8_t warmBoot,
+  uint32_t millisToControl,
+  uint32_t downtime
+) {
+  reset();
+  _payload[STATUS_EVENT_TYPE_OFFSET] = STATUS_EVENT_TYPE_BOOT;
+  memcpy(&_payload[STATUS_EVENT_TIMESTAMP_OFFSET], &timestamp, 4);
+  _payload[STATUS_EVENT_RESET_REASON_OFFSET] = resetReason;
+  _payload[STATUS_EVENT_WARM_BOOT_OFFSET] = warmBoot;
+  memcpy(&_payload[STATUS_EVENT_CONTROL_START_OFFSET], &millisToControl, 4);
+  memcpy(&_payload[STATUS_EVENT_DOWNTIME_OFFSET], &downtime, 4);
+}
+
+void StatusEvent::memoryLowWater(
+  uint32_t timestamp,
+  uint32_t freeHeap,
+  uint32_t maxFreeBlock,
+  uint8_t fragmentation,
+  uint32_t freeStack
+) {
+  reset();
+  uint16_t stack = (uint16_t) min(freeStack, (uint32_t) UINT16_MAX);
+  _payload[STATUS_EVENT_TYPE_OFFSET] = STATUS_EVENT_TYPE_MEMORY;
+  memcpy(&_payload[STATUS_EVENT_TIMESTAMP_OFFSET], &timestamp, 4);
+  memcpy(&_payload[STATUS_EVENT_FREE_HEAP_OFFSET], &freeHeap, 4);
+  memcpy(&_payload[STATUS_EVENT_MAX_FREE_BLOCK_OFFSET], &maxFreeBlock, 4);
+  _payload[STATUS_EVENT_FRAGMENTATION_OFFSET] = fragmentation;
+  memcpy(&_payload[STATUS_EVENT_FREE_STACK_OFFSET], &stack, 2);
+}
+
+void StatusEvent::metricSnapshot(uint32_t timestamp, uint8_t firstSlot, const uint16_t * slots) {
+  reset();
+  _payload[STATUS_EVENT_TYPE_OFFSET] = STATUS_EVENT_TYPE_METRIC;
+  memcpy(&_payload[STATUS_EVENT_TIMESTAMP_OFFSET], &timestamp, 4);
+  _payload[STATUS_EVENT_METRIC_FIRST_SLOT_OFFSET] = firstSlot;
+  memcpy(&_payload[STATUS_EVENT_METRIC_SLOTS_OFFSET], slots, STATUS_EVENT_METRIC_SLOT_COUNT * 2);
+}
+
 void StatusEvent::write(byte * buffer) {
   memcpy(buffer, _payload, STATUS_EVENT_SIZE);
   reset();
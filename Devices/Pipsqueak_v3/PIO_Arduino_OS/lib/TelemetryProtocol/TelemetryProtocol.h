@@ -15,6 +15,11 @@
 #define STATUS_EVENT_TYPE_ERROR 6
 #define STATUS_EVENT_TYPE_HEATER 4
 #define STATUS_EVENT_TYPE_CHILLER 7
+#define STATUS_EVENT_TYPE_TUNING 8
+#define STATUS_EVENT_TYPE_LATENCY 9
+#define STATUS_EVENT_TYPE_BOOT 10
+#define STATUS_EVENT_TYPE_MEMORY 11
+#define STATUS_EVENT_TYPE_METRIC 12
 #define STATUS_EVENT_TIMESTAMP_OFFSET 1
 #define STATUS_EVENT_TEMPERATURE_OFFSET 5
 #define STATUS_EVENT_SETPOINT_OFFSET 5
@@ -23,6 +28,32 @@
 #define STATUS_EVENT_RECOVERY_DURATION_OFFSET 10
 #define STATUS_EVENT_ERROR_TYPE_OFFSET 5
 #define STATUS_EVENT_ERROR_CODE_OFFSET 6
+#define STATUS_EVENT_ULTIMATE_GAIN_OFFSET 5
+#define STATUS_EVENT_ULTIMATE_PERIOD_OFFSET 9
+#define STATUS_EVENT_TUNING_OUTCOME_OFFSET 13
+#define STATUS_EVENT_LATENCY_SLOT_OFFSET 5
+#define STATUS_EVENT_LATENCY_COUNT_OFFSET 6
+#define STATUS_EVENT_LATENCY_MAX_CYCLES_OFFSET 10
+#define STATUS_EVENT_LATENCY_MEDIAN_BUCKET_OFFSET 14
+#define STATUS_EVENT_LATENCY_TAIL_BUCKET_OFFSET 15
+#define STATUS_EVENT_RESET_REASON_OFFSET 5
+#define STATUS_EVENT_WARM_BOOT_OFFSET 6
+#define STATUS_EVENT_CONTROL_START_OFFSET 7
+#define STATUS_EVENT_DOWNTIME_OFFSET 11
+#define STATUS_EVENT_FREE_HEAP_OFFSET 5
+#define STATUS_EVENT_MAX_FREE_BLOCK_OFFSET 9
+#define STATUS_EVENT_FRAGMENTATION_OFFSET 13
+#define STATUS_EVENT_FREE_STACK_OFFSET 14
+#define STATUS_EVENT_METRIC_FIRST_SLOT_OFFSET 5
+#define STATUS_EVENT_METRIC_SLOTS_OFFSET 6
+
+// boot event: how much state survived the reset (see WarmBoot.h)
+#define STATUS_EVENT_BOOT_COLD 0
+#define STATUS_EVENT_BOOT_WARM_STALE 1
+#define STATUS_EVENT_BOOT_WARM 2
+
+// metric event: how many 16-bit snapshot slots one carries
+#define STATUS_EVENT_METRIC_SLOT_COUNT 5
 
 // Uncomment for detailed debug statements
 // #define DEBUG_TELEMETRY_PROTOCOL true
@@ -99,6 +130,96 @@ class StatusEvent {
       uint32_t recoveryDuration
     );
 
+    /**
+     * Sets up this event as an autotuning result event.
+     *
+     * timestamp: the Unix timestamp at the end of the experiment
+     * ultimateGain: the estimated ultimate gain, in heater power
+     *               fraction per degree Celsius; NAN if unknown
+     * ultimatePeriod: the estimated ultimate period in seconds; 0 if
+     *                 unknown
+     * outcome: how the experiment ended (see AutotuneOutcome in
+     *          RelayAutotune.h)
+     */
+    void tuningResult(
+      uint32_t timestamp,
+      float ultimateGain,
+      uint32_t ultimatePeriod,
+      uint8_t outcome
+    );
+
+    /**
+     * Sets up this event as a latency histogram summary event.
+     *
+     * timestamp: the Unix timestamp at the end of the reporting period
+     * slot: the profiled code path (see Profiler.h)
+     * count: how many times the code path ran during the period
+     * maxCycles: the longest run, in CPU cycles
+     * medianBucket: log2 of the median run's CPU cycles, rounded down
+     * tailBucket: log2 of the 99th percentile run's CPU cycles,
+     *             rounded down
+     */
+    void latencyHistogram(
+      uint32_t timestamp,
+      uint8_t slot,
+      uint32_t count,
+      uint32_t maxCycles,
+      uint8_t medianBucket,
+      uint8_t tailBucket
+    );
+
+    /**
+     * Sets up this event as a boot timing event.
+     *
+     * timestamp: the Unix timestamp at which control started
+     * resetReason: rst_info.reason for the boot
+     * warmBoot: STATUS_EVENT_BOOT_COLD if no state survived the
+     *           reset, STATUS_EVENT_BOOT_WARM_STALE if only the
+     *           sensor addresses, WiFi access point and learned gains
+     *           did, STATUS_EVENT_BOOT_WARM if all of it did
+     * millisToControl: ms from boot until the controller first acted
+     *                  on valid readings
+     * downtime: ms between the last state saved before the reset and
+     *           the boot; 0 if cold
+     */
+    void bootTiming(
+      uint32_t timestamp,
+      uint8_t resetReason,
+      uint8_t warmBoot,
+      uint32_t millisToControl,
+      uint32_t downtime
+    );
+
+    /**
+     * Sets up this event as a memory low-water event.
+     *
+     * timestamp: the Unix timestamp at the end of the reporting period
+     * freeHeap: the least free heap sampled during the period, bytes
+     * maxFreeBlock: the smallest largest free heap block sampled
+     *               during the period, bytes
+     * fragmentation: the highest heap fragmentation sampled during
+     *                the period, 0-100%
+     * freeStack: the least of the loop's stack never used during the
+     *            period, bytes; saturates at 65535
+     */
+    void memoryLowWater(
+      uint32_t timestamp,
+      uint32_t freeHeap,
+      uint32_t maxFreeBlock,
+      uint8_t fragmentation,
+      uint32_t freeStack
+    );
+
+    /**
+     * Sets up this event as a metric snapshot event.
+     *
+     * timestamp: the Unix timestamp at the end of the reporting period
+     * firstSlot: the index of the first slot carried in the snapshot
+     *            of every metric (see Metrics.h)
+     * slots: STATUS_EVENT_METRIC_SLOT_COUNT slots of the snapshot
+     */
+    void metricSnapshot(uint32_t timestamp, uint8_t firstSlot, const uint16_t * slots);
+
     /**
      * Writes the current event state to a buffer in the appropriate
      * 16-byte layout called out by the telemetry protocol for the
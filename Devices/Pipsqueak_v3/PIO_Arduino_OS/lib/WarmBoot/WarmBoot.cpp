@@ -0,0 +1,87 @@
+#include "WarmBoot.h"
+#include <RtcStore.h>
+
+extern "C" {
+  #include <user_interface.h>
+}
+
+static_assert(
+  RTC_STORE_WARM_BOOT + RTC_STORE_HEADER_BLOCKS + (sizeof(WarmBootRecord) + RTC_STORE_BLOCK_SIZE - 1) / RTC_STORE_BLOCK_SIZE <= RTC_STORE_BLOCK_COUNT,
+  "WarmBootRecord does not fit in RTC memory"
+);
+
+WarmBoot::WarmBoot()
+:
+  _restored { false },
+  _downtime { 0 },
+  _restoredMillis { 0 }
+{
+  clear(0);
+}
+
+void WarmBoot::clear(uint32_t deviceID) {
+  memset(&_record, 0, sizeof(_record));
+  _record.version = WARM_BOOT_VERSION;
+  _record.deviceID = deviceID;
+  _record.boardTemperature = NAN;
+  _record.remoteTemperature = NAN;
+  _record.ambientTemperature = NAN;
+}
+
+void WarmBoot::restore(uint32_t resetReason, uint32_t deviceID) {
+  _restored = false;
+  _restoredMillis = millis();
+  // Power-on, the reset pin and deep sleep all mean the hardware
+  // may have changed, or that the record is deliberately stale
+  bool softReset =
+    resetReason == REASON_WDT_RST ||
+    resetReason == REASON_EXCEPTION_RST ||
+    resetReason == REASON_SOFT_WDT_RST ||
+    resetReason == REASON_SOFT_RESTART;
+  if (
+    !softReset ||
+    !RtcStore::read(RTC_STORE_WARM_BOOT, &_record, sizeof(_record)) ||
+    _record.version != WARM_BOOT_VERSION ||
+    _record.deviceID != deviceID
+  ) {
+    clear(deviceID);
+    return;
+  }
+
+  // The RTC timer period is in us, as a fixed-point number with 12 fractional bits
+  uint64_t elapsedMicros = ((uint64_t) (system_get_rtc_time() - _record.rtcTime) * system_rtc_clock_cali_proc()) >> 12;
+  _downtime = (uint32_t) min(elapsedMicros / 1000, (uint64_t) UINT32_MAX);
+  _restored = true;
+}
+
+bool WarmBoot::isRestored() {
+  return _restored;
+}
+
+bool WarmBoot::isRecent() {
+  return _restored && _downtime <= WARM_BOOT_MAX_AGE;
+}
+
+uint32_t WarmBoot::getDowntime() {
+  return _downtime;
+}
+
+uint32_t WarmBoot::getUnixTime() {
+  if (!isRecent() || !(_record.flags & WARM_BOOT_FLAG_CLOCK)) return 0;
+  return _record.unixTime + (_downtime + (millis() - _restoredMillis) + 500) / 1000;
+}
+
+WarmBootRecord * WarmBoot::getRecord() {
+  return &_record;
+}
+
+void WarmBoot::save(uint32_t unixTime) {
+  _record.rtcTime = system_get_rtc_time();
+  _record.unixTime = unixTime;
+  if (unixTime) {
+    _record.flags |= WARM_BOOT_FLAG_CLOCK;
+  } else {
+    _record.flags &= ~WARM_BOOT_FLAG_CLOCK;
+  }
+  RtcStore::write(RTC_STORE_WARM_BOOT, &_record, sizeof(_record));
+}
@@ -0,0 +1,119 @@
+#ifndef WarmBoot_h
+#define WarmBoot_h
+
+#include <Arduino.h>
+
+// bumped whenever the meaning of WarmBootRecord changes
+#define WARM_BOOT_VERSION 1
+
+// state older than this is only partially restored
+#define WARM_BOOT_MAX_AGE 60000 // ms
+
+// how often PipsqueakState saves the record
+#define WARM_BOOT_SAVE_INTERVAL 1000 // ms
+
+#define WARM_BOOT_ADDRESS_SIZE 8
+#define WARM_BOOT_BSSID_SIZE 6
+
+// WarmBootRecord flags: which of the optional parts are valid
+#define WARM_BOOT_FLAG_CLOCK 0x01
+#define WARM_BOOT_FLAG_WIFI 0x02
+#define WARM_BOOT_FLAG_CONTROLLER 0x04
+
+/**
+ * State that lets a Pipsqueak skip rediscovery after a soft reset.
+ * Each module fills in its own part as it runs. Plain data, so
+ * that it may be kept in RTC memory as is.
+ */
+struct WarmBootRecord {
+  uint8_t version;
+  uint8_t flags;
+  uint8_t wifiChannel;
+  uint8_t reserved;
+  uint32_t deviceID;
+  uint32_t rtcTime;    // RTC timer ticks when saved
+  uint32_t unixTime;   // when saved, if WARM_BOOT_FLAG_CLOCK
+  uint8_t wifiBssid[WARM_BOOT_BSSID_SIZE];
+  uint8_t reserved2[2];
+  uint8_t remoteSensorAddress[WARM_BOOT_ADDRESS_SIZE];  // all zeros if none
+  uint8_t ambientSensorAddress[WARM_BOOT_ADDRESS_SIZE]; // all zeros if none
+  float boardTemperature;
+  float remoteTemperature;
+  float ambientTemperature;
+  uint32_t recoveryRemaining; // ms until the controller may act
+  uint32_t periodRemaining;   // ms until the next PID control period
+  float integral;
+  float heatingGain;
+  float chillingGain;
+};
+
+/**
+ * Keeps a WarmBootRecord in RTC memory, which survives watchdog
+ * resets, exceptions and restarts, so that the Pipsqueak resumes
+ * control within a couple of seconds of one rather than
+ * rediscovering its sensors, WiFi access point and the time.
+ *
+ * The record is restored only after such a soft reset, only if it
+ * is intact, and only if it was saved by the same device and
+ * firmware record version. The time spent between the last save
+ * and the restore is measured with the RTC timer, which keeps
+ * running through soft resets. State that goes stale (the clock,
+ * the latest readings and the controller's phase) is only used
+ * if the record was saved within WARM_BOOT_MAX_AGE ms.
+ */
+class WarmBoot {
+  public:
+    WarmBoot();
+
+    /**
+     * Restores the record saved before the reset, if any.
+     * Invoke once, early in setup().
+     */
+    void restore(uint32_t resetReason, uint32_t deviceID);
+
+    /**
+     * Indicates whether a record was restored. If not, the record
+     * is blank.
+     */
+    bool isRestored();
+
+    /**
+     * Indicates whether a record was restored and saved within
+     * WARM_BOOT_MAX_AGE ms.
+     */
+    bool isRecent();
+
+    /**
+     * Returns the ms between the last save and the restore.
+     */
+    uint32_t getDowntime();
+
+    /**
+     * Returns the current Unix time, extrapolated from the clock
+     * when the record was saved, or 0 if the record isn't recent
+     * or the clock wasn't synchronized.
+     */
+    uint32_t getUnixTime();
+
+    /**
+     * The record restored upon boot, which the modules then keep
+     * up to date for the next boot.
+     */
+    WarmBootRecord * getRecord();
+
+    /**
+     * Writes the record to RTC memory, stamped with the RTC timer
+     * and the given Unix time (0 if the clock isn't synchronized).
+     */
+    void save(uint32_t unixTime);
+
+  private:
+    WarmBootRecord _record;
+    bool _restored;
+    uint32_t _downtime;
+    uint32_t _restoredMillis;
+
+    void clear(uint32_t deviceID);
+};
+
+#endif // WarmBoot_h
@@ -0,0 +1,95 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+/**
+ * Enough of the Arduino API and esp8266 core for every library in
+ * lib/ to compile and run on the host (platform = native). Time is
+ * virtual, and pins, flash, RTC memory and the reset reason are
+ * simulated in RAM; see ArduinoNative.h for the controls.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define INPUT_PULLUP 0x02
+
+// Wemos D1 Mini pin names
+#define D0 16
+#define D1 5
+#define D2 4
+#define D3 0
+#define D4 2
+#define D5 14
+#define D6 12
+#define D7 13
+#define D8 15
+
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+#define ICACHE_FLASH_ATTR
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+
+#define PI 3.1415926535897932384626433832795
+#define RANDOM_REG32 ((uint32_t) rand())
+
+using std::min;
+using std::max;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+uint32_t millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+class String : public std::string {
+  public:
+    String() : std::string() {}
+    String(const char * value) : std::string(value) {}
+    String(const std::string & value) : std::string(value) {}
+};
+
+/**
+ * Writes to stdout; reads from input queued with
+ * ArduinoNative::setSerialInput().
+ */
+class HardwareSerial {
+  public:
+    void begin(unsigned long baud);
+    size_t print(const char * value);
+    size_t print(int value);
+    size_t println(const char * value = "");
+    size_t printf(const char * format, ...) __attribute__((format(printf, 2, 3)));
+    size_t write(const uint8_t * buffer, size_t size);
+    int available();
+    int availableForWrite();
+    int read();
+    void flush();
+};
+
+extern HardwareSerial Serial;
+
+#include <Esp.h>
+#include <IPAddress.h>
+
+#endif // Arduino_h
@@ -0,0 +1,440 @@
+#include <Arduino.h>
+#include <ArduinoNative.h>
+#include <core_esp8266_waveform.h>
+
+#define NATIVE_PIN_COUNT 17
+#define NATIVE_CHIP_ID 0x00C0FFEE
+// The esp8266 core maps flash to this address
+#define FLASH_MAP_ADDR 0x40200000
+// RTC memory holds this, repeated, after a power cut
+#define RTC_MEMORY_NOISE 0xA5
+// us per RTC clock tick, as a 12-bit fixed-point fraction
+#define RTC_CLOCK_PERIOD (5 << 12)
+
+struct Waveform {
+  bool active;
+  uint64_t startMicros;
+  uint32_t highMicros;
+  uint32_t lowMicros;
+  uint32_t runMicros;
+};
+
+static uint64_t virtualMicros = 0;
+static uint64_t (*backgroundTask)() = NULL;
+static uint8_t pinStates[NATIVE_PIN_COUNT] = { 0 };
+static uint8_t pinModes[NATIVE_PIN_COUNT] = { 0 };
+static Waveform waveforms[NATIVE_PIN_COUNT] = {};
+static std::string serialInput;
+static uint8_t cpuFreq = SYS_CPU_80MHZ;
+static rst_info resetInfo = { REASON_DEFAULT_RST, 0, 0, 0, 0, 0, 0 };
+static bool restarted = false;
+static uint32_t freeHeap = NATIVE_FREE_HEAP;
+static uint32_t maxFreeBlock = NATIVE_FREE_HEAP;
+static uint32_t contStackDepth = 0;
+static uint32_t contStackPeak = 0;
+static uint64_t deepSleepMicros = 0;
+static uint32_t bootCount = 0;
+static uint32_t rtcClockBase = 0;
+static uint8_t rtcMemory[NATIVE_RTC_MEMORY_SIZE];
+static bool rtcMemoryValid = false;
+static uint8_t * flash = NULL;
+static uint32_t flashEraseCount = 0;
+static uint32_t flashWriteCount = 0;
+static uint32_t failingFlashAddress = 0;
+static size_t failingFlashSize = 0;
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// The linker symbol the esp8266 core's EEPROM library locates its
+// sector by; sector-aligned so that the sector maps one to one.
+extern "C" {
+  alignas(SPI_FLASH_SEC_SIZE) uint32_t _EEPROM_start;
+}
+
+// Virtual time ///////////////////////////////////////////////////////////////////////////////////
+
+uint32_t millis() {
+  return (uint32_t) (virtualMicros / 1000);
+}
+
+unsigned long micros() {
+  return (uint32_t) virtualMicros;
+}
+
+// Runs the background task at each time it falls due on the way
+static void idleUntil(uint64_t target) {
+  while (backgroundTask) {
+    uint64_t next = backgroundTask();
+    if (next > target) break;
+    virtualMicros = max(next, virtualMicros);
+  }
+  virtualMicros = target;
+}
+
+void delay(unsigned long ms) {
+  idleUntil(virtualMicros + (uint64_t) ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  idleUntil(virtualMicros + us);
+}
+
+void yield() {
+  if (backgroundTask) backgroundTask();
+}
+
+void ArduinoNative::advanceMicros(uint64_t us) {
+  virtualMicros += us;
+}
+
+void ArduinoNative::advanceMillis(uint32_t ms) {
+  virtualMicros += (uint64_t) ms * 1000;
+}
+
+void ArduinoNative::setMicros(uint64_t us) {
+  virtualMicros = us;
+}
+
+uint64_t ArduinoNative::getMicros() {
+  return virtualMicros;
+}
+
+void ArduinoNative::setBackgroundTask(uint64_t (*task)()) {
+  backgroundTask = task;
+}
+
+// GPIO ///////////////////////////////////////////////////////////////////////////////////////////
+
+// Waveforms are evaluated lazily, against the virtual clock
+static uint8_t evaluatePin(uint8_t pin) {
+  if (pin >= NATIVE_PIN_COUNT) return LOW;
+  Waveform * waveform = &waveforms[pin];
+  if (waveform->active) {
+    uint64_t elapsed = virtualMicros - waveform->startMicros;
+    if (waveform->runMicros && elapsed >= waveform->runMicros) {
+      // The core drives the pin low when a waveform expires
+      waveform->active = false;
+      pinStates[pin] = LOW;
+    } else {
+      pinStates[pin] = (elapsed % ((uint64_t) waveform->highMicros + waveform->lowMicros)) < waveform->highMicros ? HIGH : LOW;
+    }
+  }
+  return pinStates[pin];
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < NATIVE_PIN_COUNT) pinModes[pin] = mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin >= NATIVE_PIN_COUNT) return;
+  waveforms[pin].active = false;
+  pinStates[pin] = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+  return evaluatePin(pin);
+}
+
+// The core converts each time to CPU cycles, and compares those as
+// signed 32-bit values
+static bool isWaveformTimeValid(uint32_t us) {
+  return (uint64_t) us * cpuFreq <= INT32_MAX;
+}
+
+int startWaveform(uint8_t pin, uint32_t timeHighUS, uint32_t timeLowUS, uint32_t runTimeUS, int8_t alignPhase, uint32_t phaseOffsetUS, bool autoPwm) {
+  if (pin >= NATIVE_PIN_COUNT || timeHighUS + timeLowUS == 0) return false;
+  if (!isWaveformTimeValid(timeHighUS) || !isWaveformTimeValid(timeLowUS) || !isWaveformTimeValid(runTimeUS)) return false;
+  waveforms[pin] = { true, virtualMicros, timeHighUS, timeLowUS, runTimeUS };
+  return true;
+}
+
+int stopWaveform(uint8_t pin) {
+  if (pin >= NATIVE_PIN_COUNT) return false;
+  evaluatePin(pin);
+  waveforms[pin].active = false;
+  return true;
+}
+
+uint8_t ArduinoNative::getPinState(uint8_t pin) {
+  return evaluatePin(pin);
+}
+
+uint8_t ArduinoNative::getPinMode(uint8_t pin) {
+  return pin < NATIVE_PIN_COUNT ? pinModes[pin] : INPUT;
+}
+
+// Serial /////////////////////////////////////////////////////////////////////////////////////////
+
+void HardwareSerial::begin(unsigned long baud) {
+}
+
+size_t HardwareSerial::print(const char * value) {
+  return fputs(value, stdout) < 0 ? 0 : strlen(value);
+}
+
+size_t HardwareSerial::print(int value) {
+  return this->printf("%d", value);
+}
+
+size_t HardwareSerial::println(const char * value) {
+  return print(value) + print("\n");
+}
+
+size_t HardwareSerial::printf(const char * format, ...) {
+  va_list args;
+  va_start(args, format);
+  int written = vprintf(format, args);
+  va_end(args);
+  return written < 0 ? 0 : written;
+}
+
+size_t HardwareSerial::write(const uint8_t * buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
+
+int HardwareSerial::available() {
+  return serialInput.size();
+}
+
+// As much as the esp8266's UART transmit FIFO holds
+int HardwareSerial::availableForWrite() {
+  return 128;
+}
+
+int HardwareSerial::read() {
+  if (serialInput.empty()) return -1;
+  uint8_t value = serialInput[0];
+  serialInput.erase(0, 1);
+  return value;
+}
+
+void HardwareSerial::flush() {
+  fflush(stdout);
+}
+
+void ArduinoNative::setSerialInput(const char * input) {
+  serialInput += input;
+}
+
+// ESP ////////////////////////////////////////////////////////////////////////////////////////////
+
+void EspClass::restart() {
+  restarted = true;
+}
+
+rst_info * EspClass::getResetInfoPtr() {
+  return &resetInfo;
+}
+
+uint32_t EspClass::getCycleCount() {
+  return (uint32_t) (virtualMicros * cpuFreq);
+}
+
+uint32_t EspClass::getChipId() {
+  return NATIVE_CHIP_ID;
+}
+
+uint8_t EspClass::getCpuFreqMHz() {
+  return cpuFreq;
+}
+
+uint32_t EspClass::getFreeHeap() {
+  return freeHeap;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize() {
+  return maxFreeBlock;
+}
+
+// As umm_malloc's metric: 100 - 100 * sqrt(sum of squares of the
+// free blocks) / the free heap
+uint8_t EspClass::getHeapFragmentation() {
+  if (freeHeap == 0) return 0;
+  double rest = freeHeap - maxFreeBlock;
+  double root = sqrt((double) maxFreeBlock * maxFreeBlock + rest * rest);
+  return (uint8_t) (100 - (uint32_t) (root * 100 / freeHeap));
+}
+
+uint32_t EspClass::getFreeContStack() {
+  return NATIVE_CONT_STACK_SIZE - contStackPeak;
+}
+
+void EspClass::resetFreeContStack() {
+  contStackPeak = contStackDepth;
+}
+
+void EspClass::deepSleep(uint64_t time_us, RFMode mode) {
+  // On the device, deepSleep() never returns; the caller will
+  // usually carry on to the end of loop() and wait there.
+  deepSleepMicros = time_us > 0 ? time_us : 1;
+}
+
+uint8_t system_get_cpu_freq() {
+  return cpuFreq;
+}
+
+bool system_update_cpu_freq(uint8_t freq) {
+  if (freq != SYS_CPU_80MHZ && freq != SYS_CPU_160MHZ) return false;
+  cpuFreq = freq;
+  return true;
+}
+
+void ArduinoNative::setHeap(uint32_t heap, uint32_t block) {
+  freeHeap = heap;
+  maxFreeBlock = min(block, heap);
+}
+
+void ArduinoNative::setContStackDepth(uint32_t depth) {
+  contStackDepth = min(depth, (uint32_t) NATIVE_CONT_STACK_SIZE);
+  contStackPeak = max(contStackPeak, contStackDepth);
+}
+
+void ArduinoNative::setResetReason(uint32_t reason) {
+  resetInfo.reason = reason;
+}
+
+bool ArduinoNative::restartRequested() {
+  return restarted;
+}
+
+uint64_t ArduinoNative::getDeepSleepMicros() {
+  return deepSleepMicros;
+}
+
+void ArduinoNative::reboot(uint32_t reason) {
+  if (reason == REASON_DEFAULT_RST) {
+    // A power cut: RTC memory and the RTC clock are lost too
+    rtcMemoryValid = false;
+    rtcClockBase = 0;
+  } else {
+    rtcClockBase = system_get_rtc_time() + (uint32_t) (deepSleepMicros * 4096 / RTC_CLOCK_PERIOD);
+  }
+  virtualMicros = 0;
+  memset(pinStates, 0, sizeof(pinStates));
+  memset(pinModes, 0, sizeof(pinModes));
+  memset(waveforms, 0, sizeof(waveforms));
+  serialInput.clear();
+  cpuFreq = SYS_CPU_80MHZ;
+  memset(&resetInfo, 0, sizeof(resetInfo));
+  resetInfo.reason = reason;
+  restarted = false;
+  freeHeap = NATIVE_FREE_HEAP;
+  maxFreeBlock = NATIVE_FREE_HEAP;
+  contStackDepth = 0;
+  contStackPeak = 0;
+  deepSleepMicros = 0;
+  bootCount += 1;
+}
+
+uint32_t ArduinoNative::getBootCount() {
+  return bootCount;
+}
+
+// RTC ////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint8_t * getRtcMemory() {
+  if (!rtcMemoryValid) {
+    memset(rtcMemory, RTC_MEMORY_NOISE, sizeof(rtcMemory));
+    rtcMemoryValid = true;
+  }
+  return rtcMemory;
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t * data, size_t size) {
+  if (offset * 4 > NATIVE_RTC_MEMORY_SIZE || size > NATIVE_RTC_MEMORY_SIZE - offset * 4) return false;
+  memcpy(data, getRtcMemory() + offset * 4, size);
+  return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t * data, size_t size) {
+  if (offset * 4 > NATIVE_RTC_MEMORY_SIZE || size > NATIVE_RTC_MEMORY_SIZE - offset * 4) return false;
+  memcpy(getRtcMemory() + offset * 4, data, size);
+  return true;
+}
+
+uint32_t system_get_rtc_time() {
+  return rtcClockBase + (uint32_t) (virtualMicros * 4096 / RTC_CLOCK_PERIOD);
+}
+
+uint32_t system_rtc_clock_cali_proc() {
+  return RTC_CLOCK_PERIOD;
+}
+
+// Flash //////////////////////////////////////////////////////////////////////////////////////////
+
+uint8_t * ArduinoNative::getFlash() {
+  if (flash == NULL) {
+    flash = (uint8_t *) malloc(NATIVE_FLASH_SIZE);
+    memset(flash, 0xFF, NATIVE_FLASH_SIZE);
+  }
+  return flash;
+}
+
+void ArduinoNative::eraseFlash() {
+  memset(getFlash(), 0xFF, NATIVE_FLASH_SIZE);
+  flashEraseCount = 0;
+  flashWriteCount = 0;
+  failingFlashSize = 0;
+}
+
+void ArduinoNative::failFlash(uint32_t address, size_t size) {
+  failingFlashAddress = address;
+  failingFlashSize = size;
+}
+
+uint32_t ArduinoNative::getFlashEraseCount() {
+  return flashEraseCount;
+}
+
+uint32_t ArduinoNative::getFlashWriteCount() {
+  return flashWriteCount;
+}
+
+// The EEPROM sector's address is derived from where _EEPROM_start
+// lands in host memory; map it onto NATIVE_EEPROM_SECTOR.
+static uint32_t mapFlashAddress(uint32_t address) {
+  uint32_t eepromAddress = (uint32_t) (uintptr_t) &_EEPROM_start - FLASH_MAP_ADDR;
+  if (address - eepromAddress < SPI_FLASH_SEC_SIZE) {
+    return NATIVE_EEPROM_SECTOR * SPI_FLASH_SEC_SIZE + (address - eepromAddress);
+  }
+  return address;
+}
+
+static bool isFlashAccessValid(uint32_t address, size_t size) {
+  return (address | size) % 4 == 0 && address <= NATIVE_FLASH_SIZE && size <= NATIVE_FLASH_SIZE - address;
+}
+
+// Erases and writes within the range failFlash() was given fail;
+// reads still succeed
+static bool isFlashFailing(uint32_t address, size_t size) {
+  return address < failingFlashAddress + failingFlashSize && failingFlashAddress < address + size;
+}
+
+bool EspClass::flashEraseSector(uint32_t sector) {
+  uint32_t address = mapFlashAddress(sector * SPI_FLASH_SEC_SIZE);
+  if (!isFlashAccessValid(address, SPI_FLASH_SEC_SIZE)) return false;
+  if (isFlashFailing(address, SPI_FLASH_SEC_SIZE)) return false;
+  memset(ArduinoNative::getFlash() + address, 0xFF, SPI_FLASH_SEC_SIZE);
+  flashEraseCount += 1;
+  return true;
+}
+
+bool EspClass::flashRead(uint32_t address, uint32_t * data, size_t size) {
+  address = mapFlashAddress(address);
+  if (!isFlashAccessValid(address, size)) return false;
+  memcpy(data, ArduinoNative::getFlash() + address, size);
+  return true;
+}
+
+bool EspClass::flashWrite(uint32_t address, const uint32_t * data, size_t size) {
+  address = mapFlashAddress(address);
+  if (!isFlashAccessValid(address, size)) return false;
+  if (isFlashFailing(address, size)) return false;
+  // Writes can only clear bits; only an erase sets them
+  uint8_t * target = ArduinoNative::getFlash() + address;
+  for (size_t i = 0; i < size; i++) target[i] &= ((const uint8_t *) data)[i];
+  flashWriteCount += 1;
+  return true;
+}
@@ -0,0 +1,119 @@
+#ifndef ArduinoNative_h
+#define ArduinoNative_h
+
+#include <Arduino.h>
+
+// RTC user memory, as on the esp8266
+#define NATIVE_RTC_MEMORY_SIZE 512
+// 4 MB, as on the ESP-12S
+#define NATIVE_FLASH_SIZE 0x400000
+// The sector the EEPROM is emulated in, as in the 4m2m layout
+#define NATIVE_EEPROM_SECTOR 0x3FB
+// Free heap, typically, once WiFi is up
+#define NATIVE_FREE_HEAP 40000
+// The loop's stack, as in the esp8266 core's cont.h
+#define NATIVE_CONT_STACK_SIZE 4096
+
+/**
+ * Host-side controls for the native (Linux) Arduino shims.
+ *
+ * Time is virtual: millis(), micros(), ESP.getCycleCount() and
+ * system_get_rtc_time() only advance when delay() is invoked or a
+ * test advances the clock, which makes timing-dependent logic
+ * repeatable. As on the device, simulated peripherals that call
+ * back asynchronously do so from within delay() and yield(). Flash
+ * starts erased and RTC memory starts as noise, as after a power
+ * cut; both survive reboot().
+ */
+namespace ArduinoNative {
+  /** Advances the virtual clock by the given number of microseconds. */
+  void advanceMicros(uint64_t us);
+
+  /** Advances the virtual clock by the given number of milliseconds. */
+  void advanceMillis(uint32_t ms);
+
+  /** Sets the virtual clock, in microseconds since boot. */
+  void setMicros(uint64_t us);
+
+  /** Returns the virtual clock in microseconds since boot. */
+  uint64_t getMicros();
+
+  /**
+   * Registers the function delay() and yield() service, as the
+   * esp8266 core services the SDK's tasks. It runs whatever is due
+   * at the current virtual time and returns the virtual time, in
+   * microseconds since boot, when something next falls due, or
+   * UINT64_MAX if nothing is pending. delay() stops the clock at
+   * each of those times on its way. The advance and set methods
+   * above move the clock without servicing it.
+   */
+  void setBackgroundTask(uint64_t (*task)());
+
+  /** Returns the last value written to the given pin. */
+  uint8_t getPinState(uint8_t pin);
+
+  /** Returns the last mode set for the given pin. */
+  uint8_t getPinMode(uint8_t pin);
+
+  /** Queues input for Serial.read(). */
+  void setSerialInput(const char * input);
+
+  /**
+   * Sets the free heap and the largest free block reported by ESP.
+   * Fragmentation is reported as if the free heap were two blocks:
+   * the largest and the rest. Both start at NATIVE_FREE_HEAP.
+   */
+  void setHeap(uint32_t freeHeap, uint32_t maxFreeBlock);
+
+  /**
+   * Sets how deep the loop's stack reaches, in bytes. As on the
+   * device, ESP.getFreeContStack() reports the least free since
+   * ESP.resetFreeContStack(), which forgets all but the current
+   * depth.
+   */
+  void setContStackDepth(uint32_t depth);
+
+  /** Sets the reset reason reported by ESP.getResetInfoPtr(). */
+  void setResetReason(uint32_t reason);
+
+  /** Indicates whether ESP.restart() has been invoked since boot. */
+  bool restartRequested();
+
+  /**
+   * Returns the duration of the deep sleep requested since boot,
+   * in microseconds, or 0 if none was.
+   */
+  uint64_t getDeepSleepMicros();
+
+  /**
+   * Simulates a reset for the given reason: the virtual clock,
+   * pins, serial input, the heap, the stack and the restart and
+   * deep sleep requests start over, while flash keeps its contents. RTC memory and
+   * the RTC clock survive all but REASON_DEFAULT_RST, a power
+   * cut, and the RTC clock counts through deep sleep.
+   */
+  void reboot(uint32_t reason);
+
+  /** Returns the number of times reboot() has been invoked. */
+  uint32_t getBootCount();
+
+  /** Erases the whole of flash, and clears any failFlash() range. */
+  void eraseFlash();
+
+  /**
+   * Makes erases and writes overlapping the given range of flash
+   * fail, as worn-out sectors would, until eraseFlash().
+   */
+  void failFlash(uint32_t address, size_t size);
+
+  /** Returns the number of sectors erased since eraseFlash(). */
+  uint32_t getFlashEraseCount();
+
+  /** Returns the number of writes since eraseFlash(). */
+  uint32_t getFlashWriteCount();
+
+  /** Returns the simulated flash, NATIVE_FLASH_SIZE bytes. */
+  uint8_t * getFlash();
+}
+
+#endif // ArduinoNative_h
@@ -0,0 +1,41 @@
+#ifndef Esp_h
+#define Esp_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <user_interface.h>
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+enum RFMode { RF_DEFAULT = 0, RF_CAL = 1, RF_NO_CAL = 2, RF_DISABLED = 4 };
+#define WAKE_RF_DEFAULT RF_DEFAULT
+#define WAKE_RF_DISABLED RF_DISABLED
+
+/**
+ * The esp8266 core's ESP object. Flash and RTC memory are held in
+ * RAM; deepSleep() and restart() are recorded rather than acted on.
+ * The heap and the loop's stack report what the test sets.
+ */
+class EspClass {
+  public:
+    void restart();
+    rst_info * getResetInfoPtr();
+    uint32_t getCycleCount();
+    uint32_t getChipId();
+    uint8_t getCpuFreqMHz();
+    uint32_t getFreeHeap();
+    uint32_t getMaxFreeBlockSize();
+    uint8_t getHeapFragmentation();
+    uint32_t getFreeContStack();
+    void resetFreeContStack();
+    bool rtcUserMemoryRead(uint32_t offset, uint32_t * data, size_t size);
+    bool rtcUserMemoryWrite(uint32_t offset, uint32_t * data, size_t size);
+    bool flashEraseSector(uint32_t sector);
+    bool flashRead(uint32_t address, uint32_t * data, size_t size);
+    bool flashWrite(uint32_t address, const uint32_t * data, size_t size);
+    void deepSleep(uint64_t time_us, RFMode mode = RF_DEFAULT);
+};
+
+extern EspClass ESP;
+
+#endif // Esp_h
@@ -0,0 +1,24 @@
+#ifndef IPAddress_h
+#define IPAddress_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+class IPAddress {
+  public:
+    IPAddress() { memset(_octets, 0, 4); }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { _octets[0] = a; _octets[1] = b; _octets[2] = c; _octets[3] = d; }
+    IPAddress(const uint8_t * octets) { memcpy(_octets, octets, 4); }
+    uint8_t operator[](int index) const { return _octets[index]; }
+    String toString() const {
+      char buffer[16];
+      snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", _octets[0], _octets[1], _octets[2], _octets[3]);
+      return String(buffer);
+    }
+
+  private:
+    uint8_t _octets[4];
+};
+
+#endif // IPAddress_h
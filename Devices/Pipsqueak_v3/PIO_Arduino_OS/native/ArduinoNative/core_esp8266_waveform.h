@@ -0,0 +1,12 @@
+#ifndef core_esp8266_waveform_h
+#define core_esp8266_waveform_h
+
+#include <stdint.h>
+
+// Native stand-ins for the esp8266 core's waveform generator. The
+// waveform is evaluated lazily against virtual time. Times the core
+// couldn't count in signed 32-bit CPU cycles are refused.
+int startWaveform(uint8_t pin, uint32_t timeHighUS, uint32_t timeLowUS, uint32_t runTimeUS = 0, int8_t alignPhase = -1, uint32_t phaseOffsetUS = 0, bool autoPwm = false);
+int stopWaveform(uint8_t pin);
+
+#endif // core_esp8266_waveform_h
@@ -0,0 +1,9 @@
+#ifndef flash_hal_h
+#define flash_hal_h
+
+// As in the 4m2m layout: a 2 MB filesystem region ending a sector
+// short of the EEPROM's
+#define FS_PHYS_ADDR 0x200000
+#define FS_PHYS_SIZE 0x1FA000
+
+#endif // flash_hal_h
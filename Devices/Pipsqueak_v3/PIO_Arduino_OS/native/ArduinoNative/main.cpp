@@ -0,0 +1,11 @@
+// The Arduino core calls setup() once and loop() forever; tests
+// finish within their first loop(), so one call of each suffices.
+
+void setup();
+void loop();
+
+int main() {
+  setup();
+  loop();
+  return 0;
+}
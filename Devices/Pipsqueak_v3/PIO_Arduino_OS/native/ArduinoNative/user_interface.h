@@ -0,0 +1,38 @@
+#ifndef user_interface_h
+#define user_interface_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum rst_reason {
+  REASON_DEFAULT_RST = 0,
+  REASON_WDT_RST = 1,
+  REASON_EXCEPTION_RST = 2,
+  REASON_SOFT_WDT_RST = 3,
+  REASON_SOFT_RESTART = 4,
+  REASON_DEEP_SLEEP_AWAKE = 5,
+  REASON_EXT_SYS_RST = 6
+};
+
+struct rst_info {
+  uint32_t reason;
+  uint32_t exccause;
+  uint32_t epc1;
+  uint32_t epc2;
+  uint32_t epc3;
+  uint32_t excvaddr;
+  uint32_t depc;
+};
+
+#define SYS_CPU_80MHZ 80
+#define SYS_CPU_160MHZ 160
+
+uint8_t system_get_cpu_freq();
+bool system_update_cpu_freq(uint8_t freq);
+
+// In RTC clock ticks, which run at about 5 us apiece
+uint32_t system_get_rtc_time();
+// The length of an RTC clock tick in us, as a 12-bit fixed-point fraction
+uint32_t system_rtc_clock_cali_proc();
+
+#endif // user_interface_h
@@ -0,0 +1,40 @@
+#include "DeviceFixture.h"
+#include <ArduinoNative.h>
+#include <ConfigImage.h>
+
+void DeviceFixture::provision(uint32_t deviceID) {
+  ConfigImage image;
+  memset(&image, 0, sizeof(image));
+  image.deviceID = deviceID;
+  image.setpoint = 20.0;
+  image.hostIP[0] = 192;
+  image.hostIP[1] = 168;
+  image.hostIP[2] = 1;
+  image.hostIP[3] = 10;
+  image.hostPort = 9001;
+  strcpy(image.wifiSSID, "pipsqueak");
+  strcpy(image.wifiPassword, "password");
+  memcpy(image.secretKey, DEVICE_FIXTURE_SECRET_KEY, CONFIG_IMAGE_SECRET_KEY_SIZE);
+  ConfigImageFormat::seal(&image);
+  memcpy(ArduinoNative::getFlash() + NATIVE_EEPROM_SECTOR * SPI_FLASH_SEC_SIZE, &image, sizeof(image));
+}
+
+void DeviceFixture::boot(PipsqueakDevice * device, uint32_t deviceID) {
+  provision(deviceID);
+  device->state = new PipsqueakState();
+  device->state->setup();
+  device->hmac = new Hmac(device->state->getConfig()->getSecretKey());
+  device->client = new PipsqueakClient(device->state, device->hmac);
+  device->client->setup();
+  device->scheduler = new Scheduler();
+  device->state->schedule(device->scheduler);
+  device->client->schedule(device->scheduler);
+}
+
+void DeviceFixture::shutDown(PipsqueakDevice * device) {
+  delete device->scheduler;
+  delete device->client;
+  delete device->hmac;
+  delete device->state;
+  device->state = NULL;
+}
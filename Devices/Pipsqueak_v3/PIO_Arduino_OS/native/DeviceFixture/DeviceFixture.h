@@ -0,0 +1,48 @@
+#ifndef DeviceFixture_h
+#define DeviceFixture_h
+
+#include <stdint.h>
+#include <PipsqueakState.h>
+#include <PipsqueakClient.h>
+#include <Scheduler.h>
+#include <Hmac.h>
+
+// the key every fixture device is provisioned with; register it
+// with the server under each device's ID
+#define DEVICE_FIXTURE_SECRET_KEY "ThisIsATopSecret32ByteValuePad32"
+
+/**
+ * What main.cpp sets up for the network: the state, the client
+ * and the scheduler they run on.
+ */
+struct PipsqueakDevice {
+  PipsqueakState * state;
+  Hmac * hmac;
+  PipsqueakClient * client;
+  Scheduler * scheduler;
+};
+
+/**
+ * Provisions and boots devices for tests that run PipsqueakState
+ * and PipsqueakClient against ReferenceServer over the simulated
+ * network. Devices share the one simulated flash, so each is
+ * provisioned just before it boots.
+ */
+namespace DeviceFixture {
+  /**
+   * Writes the configuration image the initializer would have,
+   * with the given device ID, to the EEPROM sector.
+   */
+  void provision(uint32_t deviceID);
+
+  /**
+   * Provisions the device, then constructs, sets up and schedules
+   * its state and client, as main.cpp does.
+   */
+  void boot(PipsqueakDevice * device, uint32_t deviceID);
+
+  /** Deletes what boot() constructed. */
+  void shutDown(PipsqueakDevice * device);
+}
+
+#endif // DeviceFixture_h
@@ -0,0 +1,75 @@
+#include "EEPROM.h"
+
+// The esp8266 core maps flash to this address
+#define FLASH_MAP_ADDR 0x40200000
+
+extern "C" uint32_t _EEPROM_start;
+
+EEPROMClass EEPROM;
+
+EEPROMClass::EEPROMClass()
+:
+  _sector { ((uint32_t) (uintptr_t) &_EEPROM_start - FLASH_MAP_ADDR) / SPI_FLASH_SEC_SIZE },
+  _data { NULL },
+  _size { 0 },
+  _dirty { false }
+{
+}
+
+void EEPROMClass::begin(size_t size) {
+  if (size == 0) return;
+  if (size > SPI_FLASH_SEC_SIZE) size = SPI_FLASH_SEC_SIZE;
+  size = (size + 3) & ~((size_t) 3);
+
+  // Allocated with new[], as the core does, so that a heap trap
+  // catches it
+  delete[] _data;
+  _data = new uint8_t[size];
+  _size = size;
+  _dirty = false;
+  ESP.flashRead(_sector * SPI_FLASH_SEC_SIZE, (uint32_t *) _data, _size);
+}
+
+uint8_t EEPROMClass::read(int address) {
+  if (address < 0 || (size_t) address >= _size) return 0;
+  return _data[address];
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+  if (address < 0 || (size_t) address >= _size) return;
+  if (_data[address] != value) {
+    _data[address] = value;
+    _dirty = true;
+  }
+}
+
+bool EEPROMClass::commit() {
+  if (_size == 0) return false;
+  if (!_dirty) return true;
+  if (!ESP.flashEraseSector(_sector)) return false;
+  if (!ESP.flashWrite(_sector * SPI_FLASH_SEC_SIZE, (const uint32_t *) _data, _size)) return false;
+  _dirty = false;
+  return true;
+}
+
+bool EEPROMClass::end() {
+  bool committed = commit();
+  delete[] _data;
+  _data = NULL;
+  _size = 0;
+  _dirty = false;
+  return committed;
+}
+
+uint8_t * EEPROMClass::getDataPtr() {
+  _dirty = true;
+  return _data;
+}
+
+const uint8_t * EEPROMClass::getConstDataPtr() const {
+  return _data;
+}
+
+size_t EEPROMClass::length() {
+  return _size;
+}
@@ -0,0 +1,47 @@
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <Arduino.h>
+
+/**
+ * The esp8266 core's EEPROM emulation: a RAM copy of a flash
+ * sector, read by begin() and written back by commit() and end().
+ */
+class EEPROMClass {
+  public:
+    EEPROMClass();
+
+    void begin(size_t size);
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    bool commit();
+    bool end();
+    uint8_t * getDataPtr();
+    const uint8_t * getConstDataPtr() const;
+    size_t length();
+
+    template<typename T> T & get(int address, T & value) {
+      if (address < 0 || address + sizeof(T) > _size) return value;
+      memcpy(&value, _data + address, sizeof(T));
+      return value;
+    }
+
+    template<typename T> const T & put(int address, const T & value) {
+      if (address < 0 || address + sizeof(T) > _size) return value;
+      if (memcmp(_data + address, &value, sizeof(T)) != 0) {
+        memcpy(_data + address, &value, sizeof(T));
+        _dirty = true;
+      }
+      return value;
+    }
+
+  private:
+    uint32_t _sector;
+    uint8_t * _data;
+    size_t _size;
+    bool _dirty;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // EEPROM_h
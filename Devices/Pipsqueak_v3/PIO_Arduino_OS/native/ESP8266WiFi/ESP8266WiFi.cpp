@@ -0,0 +1,102 @@
+#include "ESP8266WiFi.h"
+#include "NativeWiFi.h"
+#include <ArduinoNative.h>
+
+#define NATIVE_WIFI_CHANNEL 6
+
+static bool available = true;
+static uint32_t connectCount = 0;
+static uint32_t associationMillis = 0;
+// when the access point last came into range
+static uint32_t availableMillis = 0;
+static uint8_t bssid[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+ESP8266WiFiClass WiFi;
+
+ESP8266WiFiClass::ESP8266WiFiClass()
+:
+  _mode { WIFI_STA },
+  _sleepMode { WIFI_MODEM_SLEEP },
+  _connected { false },
+  _associatedMillis { 0 },
+  _bootCount { 0 }
+{
+}
+
+bool ESP8266WiFiClass::mode(WiFiMode_t mode) {
+  checkReboot();
+  _mode = mode;
+  if (mode == WIFI_OFF) _connected = false;
+  return true;
+}
+
+WiFiMode_t ESP8266WiFiClass::getMode() {
+  checkReboot();
+  return _mode;
+}
+
+int ESP8266WiFiClass::begin(const char * ssid, const char * password, int32_t channel, const uint8_t * bssid, bool connect) {
+  checkReboot();
+  connectCount += 1;
+  if (_mode == WIFI_OFF) _mode = WIFI_STA;
+  // The SDK keeps trying until disconnect()
+  _connected = true;
+  _associatedMillis = millis() + associationMillis;
+  if (!available) return WL_CONNECT_FAILED;
+  return isConnected() ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool ESP8266WiFiClass::disconnect(bool wifiOff) {
+  checkReboot();
+  _connected = false;
+  if (wifiOff) _mode = WIFI_OFF;
+  return true;
+}
+
+bool ESP8266WiFiClass::isConnected() {
+  checkReboot();
+  if (!_connected || !available) return false;
+  return (int32_t) (millis() - _associatedMillis) >= 0 && millis() - availableMillis >= associationMillis;
+}
+
+int32_t ESP8266WiFiClass::channel() {
+  return NATIVE_WIFI_CHANNEL;
+}
+
+uint8_t * ESP8266WiFiClass::BSSID() {
+  return bssid;
+}
+
+bool ESP8266WiFiClass::setSleepMode(WiFiSleepType_t type, uint8_t listenInterval) {
+  checkReboot();
+  _sleepMode = type;
+  return true;
+}
+
+WiFiSleepType_t ESP8266WiFiClass::getSleepMode() {
+  checkReboot();
+  return _sleepMode;
+}
+
+void ESP8266WiFiClass::checkReboot() {
+  if (_bootCount != ArduinoNative::getBootCount()) {
+    _bootCount = ArduinoNative::getBootCount();
+    _mode = WIFI_STA;
+    _sleepMode = WIFI_MODEM_SLEEP;
+    _connected = false;
+    availableMillis = 0;
+  }
+}
+
+void NativeWiFi::setAvailable(bool value) {
+  if (value && !available) availableMillis = millis();
+  available = value;
+}
+
+void NativeWiFi::setAssociationMillis(uint32_t ms) {
+  associationMillis = ms;
+}
+
+uint32_t NativeWiFi::getConnectCount() {
+  return connectCount;
+}
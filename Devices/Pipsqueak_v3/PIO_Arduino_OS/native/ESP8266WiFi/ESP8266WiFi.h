@@ -0,0 +1,47 @@
+#ifndef ESP8266WiFi_h
+#define ESP8266WiFi_h
+
+#include <Arduino.h>
+
+enum WiFiMode { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 };
+typedef WiFiMode WiFiMode_t;
+enum WiFiSleepType { WIFI_NONE_SLEEP = 0, WIFI_LIGHT_SLEEP = 1, WIFI_MODEM_SLEEP = 2 };
+typedef WiFiSleepType WiFiSleepType_t;
+
+// As wl_status_t
+#define WL_CONNECTED 3
+#define WL_CONNECT_FAILED 4
+#define WL_DISCONNECTED 7
+
+/**
+ * Connects once the access point is in range and the association
+ * time has passed, as NativeWiFi says. Disconnected again after
+ * ArduinoNative::reboot().
+ */
+class ESP8266WiFiClass {
+  public:
+    ESP8266WiFiClass();
+
+    bool mode(WiFiMode_t mode);
+    WiFiMode_t getMode();
+    int begin(const char * ssid, const char * password = NULL, int32_t channel = 0, const uint8_t * bssid = NULL, bool connect = true);
+    bool disconnect(bool wifiOff = false);
+    bool isConnected();
+    int32_t channel();
+    uint8_t * BSSID();
+    bool setSleepMode(WiFiSleepType_t type, uint8_t listenInterval = 0);
+    WiFiSleepType_t getSleepMode();
+
+  private:
+    WiFiMode_t _mode;
+    WiFiSleepType_t _sleepMode;
+    bool _connected;
+    uint32_t _associatedMillis;
+    uint32_t _bootCount;
+
+    void checkReboot();
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif // ESP8266WiFi_h
@@ -0,0 +1,28 @@
+#ifndef NativeWiFi_h
+#define NativeWiFi_h
+
+#include <stdint.h>
+
+/**
+ * Host-side controls for the native WiFi shim.
+ */
+namespace NativeWiFi {
+  /**
+   * Sets whether the access point is in range. If not, any
+   * connection is dropped, and begin() keeps trying until it comes
+   * back, as the SDK does. Available by default.
+   */
+  void setAvailable(bool available);
+
+  /**
+   * Sets how long it takes to associate with the access point
+   * after begin(), or after it comes back in range, in ms;
+   * isConnected() is false until then. 0 by default.
+   */
+  void setAssociationMillis(uint32_t ms);
+
+  /** Returns the number of times WiFi.begin() has been invoked. */
+  uint32_t getConnectCount();
+}
+
+#endif // NativeWiFi_h
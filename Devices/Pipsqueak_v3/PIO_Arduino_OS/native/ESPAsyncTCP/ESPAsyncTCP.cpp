@@ -0,0 +1,461 @@
+#include "ESPAsyncTCP.h"
+#include "NativeAsyncTCP.h"
+#include <ArduinoNative.h>
+#include <map>
+#include <vector>
+
+// ERR_ABRT in lwIP: retransmissions exhausted
+#define NATIVE_ABORT_ERROR -13
+// ERR_RST in lwIP: reset by the peer, or nothing listening
+#define NATIVE_RESET_ERROR -14
+// TCP_SND_BUF in lwIP
+#define NATIVE_SEND_SPACE 5744
+// ASYNC_MAX_ACK_TIME in ESPAsyncTCP
+#define NATIVE_ACK_TIMEOUT 5000 // ms
+// lwIP's initial retransmission timeout, doubling up to the limit
+#define NATIVE_RTO 1000 // ms
+#define NATIVE_RTO_LIMIT 60000 // ms
+// TCP_SYNMAXRTX and TCP_MAXRTX in lwIP
+#define NATIVE_SYN_RETRANSMIT_LIMIT 6
+#define NATIVE_RETRANSMIT_LIMIT 12
+
+enum EventType {
+  // At the client
+  EVENT_CONNECTED,
+  EVENT_FAILED,
+  EVENT_TIMEOUT,
+  EVENT_RESPONSE,  // followed by the server's FIN
+  // At the server
+  EVENT_SYN,
+  EVENT_ARRIVAL,
+  EVENT_SERVED,    // the response is written, and the connection ended
+  EVENT_IDLE,      // the socket timeout, if no request has arrived
+  EVENT_FIN,       // the client has closed or reset the connection
+};
+
+struct Event {
+  AsyncClient * client;  // NULL once the client is destroyed
+  uint32_t session;
+  EventType type;
+  int8_t error;
+  std::vector<uint8_t> data;
+};
+
+static const NativeAsyncTCP::Conditions DEFAULT_CONDITIONS = { 40, 20, 0, 0, 0, false };
+
+// A connection the server has accepted, by session
+struct Connection {
+  bool heard;  // the request has arrived
+};
+
+// Pending segments, by virtual time in us
+static std::multimap<uint64_t, Event> events;
+static std::map<uint32_t, Connection> connections;
+static uint32_t sessionCount = 0;
+static NativeAsyncTCP::Server * server = NULL;
+static NativeAsyncTCP::Conditions conditions = DEFAULT_CONDITIONS;
+static uint32_t randomState = 1;
+static uint32_t bootCount = 0;
+static uint32_t connectCount = 0;
+static uint32_t responseCount = 0;
+static uint32_t retransmitCount = 0;
+static uint32_t timeoutCount = 0;
+static uint32_t abortCount = 0;
+static uint32_t socketTimeoutCount = 0;
+
+// Simulation ////////////////////////////////////////////////////////////////////////////////////
+
+// xorshift32: the same draws on every host
+static uint32_t draw() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static bool chance(uint8_t percent) {
+  return percent > 0 && draw() % 100 < percent;
+}
+
+static uint64_t latency() {
+  return ((uint64_t) conditions.latencyMillis + draw() % (conditions.jitterMillis + 1)) * 1000;
+}
+
+// Sends a segment, retransmitting each time it's lost. Returns true
+// if it gets through, false if the sender gives up; either way,
+// delay is how long, in us, that took beyond the one-way latency.
+static bool transmit(uint8_t retransmitLimit, bool deaf, uint64_t * delay) {
+  uint64_t rto = NATIVE_RTO;
+  *delay = 0;
+  for (uint8_t retransmits = 0; ; retransmits++) {
+    if (!deaf && !chance(conditions.lossPercent)) return true;
+    *delay += rto * 1000;
+    if (retransmits == retransmitLimit) return false;
+    retransmitCount += 1;
+    rto = min(rto * 2, (uint64_t) NATIVE_RTO_LIMIT);
+  }
+}
+
+static void schedule(uint64_t due, AsyncClient * client, uint32_t session, EventType type, int8_t error = 0, const uint8_t * data = NULL, size_t size = 0) {
+  Event event = { client, session, type, error, std::vector<uint8_t>(data, data + size) };
+  events.emplace(due, std::move(event));
+}
+
+static bool isAtServer(EventType type) {
+  return type >= EVENT_SYN;
+}
+
+// The server lets go of the connection
+static void release(uint32_t session) {
+  connections.erase(session);
+  if (server) server->close();
+}
+
+// A reboot drops every connection, as the network stack starts over;
+// the server's end of each is reset in time
+static void checkReboot() {
+  if (bootCount != ArduinoNative::getBootCount()) {
+    bootCount = ArduinoNative::getBootCount();
+    events.clear();
+    while (!connections.empty()) release(connections.begin()->first);
+  }
+}
+
+// The handshake has reached the server
+static void accept(uint64_t now, const Event * event) {
+  if (server == NULL || !server->open()) {
+    // Accepted by the host, and closed by the server at once
+    schedule(now + latency(), event->client, event->session, EVENT_FAILED, NATIVE_RESET_ERROR);
+    return;
+  }
+  connections[event->session] = { false };
+  uint32_t socketTimeout = server->getSocketTimeoutMillis();
+  if (socketTimeout > 0) schedule(now + socketTimeout * 1000ULL, event->client, event->session, EVENT_IDLE);
+}
+
+// The request has reached the server, which answers and closes
+static void serve(uint64_t now, const Event * event) {
+  auto connection = connections.find(event->session);
+  if (connection == connections.end() || server == NULL) {
+    // Gone from the server, which resets the connection
+    schedule(now + latency(), event->client, event->session, EVENT_FAILED, NATIVE_RESET_ERROR);
+    return;
+  }
+  connection->second.heard = true;
+  uint8_t response[NATIVE_RESPONSE_LIMIT];
+  uint32_t serviceMicros = 0;
+  size_t size = server->respond(event->data.data(), event->data.size(), response, &serviceMicros);
+  uint64_t socketTimeout = server->getSocketTimeoutMillis() * 1000ULL;
+  if (socketTimeout > 0 && serviceMicros >= socketTimeout) {
+    // Waiting on the response counts as idle
+    socketTimeoutCount += 1;
+    schedule(now + socketTimeout, event->client, event->session, EVENT_SERVED);
+    return;
+  }
+  schedule(now + serviceMicros, event->client, event->session, EVENT_SERVED, 0, response, size);
+}
+
+// The server writes its response, if it has one, and ends the
+// connection; without one, it destroys the connection
+static void respond(uint64_t now, const Event * event) {
+  if (connections.count(event->session) == 0) return;
+  release(event->session);
+  if (event->data.empty()) {
+    schedule(now + latency(), event->client, event->session, EVENT_FAILED, NATIVE_RESET_ERROR);
+    return;
+  }
+  uint64_t delay;
+  if (!transmit(NATIVE_RETRANSMIT_LIMIT, false, &delay)) {
+    // The server gives up and resets the connection
+    schedule(now + delay + latency(), event->client, event->session, EVENT_FAILED, NATIVE_RESET_ERROR);
+    return;
+  }
+  schedule(now + delay + latency(), event->client, event->session, EVENT_RESPONSE, 0, event->data.data(), event->data.size());
+}
+
+// Serves a server-side event
+static void serviceServer(uint64_t now, const Event * event) {
+  switch (event->type) {
+    case EVENT_SYN:
+      accept(now, event);
+      break;
+    case EVENT_ARRIVAL:
+      serve(now, event);
+      break;
+    case EVENT_SERVED:
+      respond(now, event);
+      break;
+    case EVENT_IDLE: {
+      auto connection = connections.find(event->session);
+      if (connection == connections.end() || connection->second.heard) break;
+      socketTimeoutCount += 1;
+      release(event->session);
+      schedule(now + latency(), event->client, event->session, EVENT_FAILED, NATIVE_RESET_ERROR);
+      break;
+    }
+    case EVENT_FIN:
+      if (connections.count(event->session) > 0) release(event->session);
+      break;
+    default:
+      break;
+  }
+}
+
+// AsyncClient ///////////////////////////////////////////////////////////////////////////////////
+
+AsyncClient::AsyncClient()
+:
+  _connectArg { NULL },
+  _disconnectArg { NULL },
+  _dataArg { NULL },
+  _errorArg { NULL },
+  _timeoutArg { NULL },
+  _connecting { false },
+  _connected { false },
+  _halfOpen { false },
+  _session { 0 }
+{
+}
+
+AsyncClient::~AsyncClient() {
+  hangUp();
+  // What's on its way to the server still gets there
+  for (auto it = events.begin(); it != events.end();) {
+    if (it->second.client != this) {
+      ++it;
+    } else if (isAtServer(it->second.type)) {
+      it->second.client = NULL;
+      ++it;
+    } else {
+      it = events.erase(it);
+    }
+  }
+}
+
+void AsyncClient::onConnect(AcConnectHandler callback, void * arg) {
+  _connectCallback = callback;
+  _connectArg = arg;
+}
+
+void AsyncClient::onDisconnect(AcConnectHandler callback, void * arg) {
+  _disconnectCallback = callback;
+  _disconnectArg = arg;
+}
+
+void AsyncClient::onData(AcDataHandler callback, void * arg) {
+  _dataCallback = callback;
+  _dataArg = arg;
+}
+
+void AsyncClient::onError(AcErrorHandler callback, void * arg) {
+  _errorCallback = callback;
+  _errorArg = arg;
+}
+
+void AsyncClient::onTimeout(AcTimeoutHandler callback, void * arg) {
+  _timeoutCallback = callback;
+  _timeoutArg = arg;
+}
+
+bool AsyncClient::connect(IPAddress ip, uint16_t port) {
+  checkReboot();
+  if (_connecting || _connected) return false;
+  ArduinoNative::setBackgroundTask(&AsyncClient::service);
+  connectCount += 1;
+  _session = ++sessionCount;
+  _connecting = true;
+  _halfOpen = false;
+
+  uint64_t now = ArduinoNative::getMicros();
+  if (server == NULL || conditions.refused) {
+    schedule(now + 2 * latency(), this, _session, EVENT_FAILED, NATIVE_RESET_ERROR);
+    return true;
+  }
+  uint64_t delay;
+  if (!transmit(NATIVE_SYN_RETRANSMIT_LIMIT, false, &delay)) {
+    schedule(now + delay, this, _session, EVENT_FAILED, NATIVE_ABORT_ERROR);
+    return true;
+  }
+  _halfOpen = chance(conditions.halfOpenPercent);
+  uint64_t handshake = ((uint64_t) conditions.connectMillis + draw() % (conditions.jitterMillis + 1)) * 1000;
+  // A half-open connection's server has gone, and hears nothing
+  if (!_halfOpen) schedule(now + delay + handshake / 2, this, _session, EVENT_SYN);
+  schedule(now + delay + handshake, this, _session, EVENT_CONNECTED);
+  return true;
+}
+
+void AsyncClient::close(bool now) {
+  // Whatever is still in transit to the client is dropped
+  hangUp();
+  _session = ++sessionCount;
+  _connecting = false;
+  if (_connected) {
+    _connected = false;
+    if (_disconnectCallback) _disconnectCallback(_disconnectArg, this);
+  }
+}
+
+bool AsyncClient::canSend() {
+  return _connected;
+}
+
+size_t AsyncClient::space() {
+  return _connected ? NATIVE_SEND_SPACE : 0;
+}
+
+size_t AsyncClient::write(const char * data, size_t size) {
+  if (!_connected || size == 0) return 0;
+  uint64_t now = ArduinoNative::getMicros();
+  uint64_t delay;
+  if (!transmit(NATIVE_RETRANSMIT_LIMIT, _halfOpen, &delay)) {
+    if (delay >= NATIVE_ACK_TIMEOUT * 1000) schedule(now + NATIVE_ACK_TIMEOUT * 1000, this, _session, EVENT_TIMEOUT);
+    schedule(now + delay, this, _session, EVENT_FAILED, NATIVE_ABORT_ERROR);
+    return size;
+  }
+  uint64_t arrival = delay + latency();
+  if (arrival + latency() >= NATIVE_ACK_TIMEOUT * 1000) schedule(now + NATIVE_ACK_TIMEOUT * 1000, this, _session, EVENT_TIMEOUT);
+  schedule(now + arrival, this, _session, EVENT_ARRIVAL, 0, (const uint8_t *) data, size);
+  return size;
+}
+
+size_t AsyncClient::ack(size_t len) {
+  return len;
+}
+
+const char * AsyncClient::errorToString(int8_t error) {
+  switch (error) {
+    case NATIVE_ABORT_ERROR: return "Connection aborted";
+    case NATIVE_RESET_ERROR: return "Connection reset";
+    default: return "UNKNOWN";
+  }
+}
+
+// Lets the server know, a latency later, that the client has closed
+// or reset the connection
+void AsyncClient::hangUp() {
+  if (connections.count(_session) > 0) {
+    schedule(ArduinoNative::getMicros() + latency(), this, _session, EVENT_FIN);
+  }
+}
+
+void AsyncClient::fail(int8_t error) {
+  abortCount += 1;
+  hangUp();
+  _session = ++sessionCount;
+  _connecting = false;
+  _connected = false;
+  if (_errorCallback) _errorCallback(_errorArg, this, error);
+  if (_disconnectCallback) _disconnectCallback(_disconnectArg, this);
+}
+
+void AsyncClient::receive(const uint8_t * data, size_t size) {
+  uint32_t session = _session;
+  if (size > 0) {
+    responseCount += 1;
+    if (_dataCallback) _dataCallback(_dataArg, this, (void *) data, size);
+  }
+  // The server's FIN, unless the data callback closed first
+  if (_session != session) return;
+  _session = ++sessionCount;
+  _connected = false;
+  if (_disconnectCallback) _disconnectCallback(_disconnectArg, this);
+}
+
+uint64_t AsyncClient::service() {
+  checkReboot();
+  uint64_t now = ArduinoNative::getMicros();
+  while (!events.empty() && events.begin()->first <= now) {
+    Event event = std::move(events.begin()->second);
+    events.erase(events.begin());
+    AsyncClient * client = event.client;
+    bool closed = client == NULL || event.session != client->_session;
+    if (isAtServer(event.type)) {
+      // A client that closed while connecting resets the connection
+      // as soon as the server accepts it
+      if (event.type != EVENT_SYN || !closed) serviceServer(now, &event);
+      continue;
+    }
+    if (closed) continue;
+    switch (event.type) {
+      case EVENT_CONNECTED:
+        client->_connecting = false;
+        client->_connected = true;
+        if (client->_connectCallback) client->_connectCallback(client->_connectArg, client);
+        break;
+      case EVENT_FAILED:
+        client->fail(event.error);
+        break;
+      case EVENT_TIMEOUT:
+        timeoutCount += 1;
+        if (client->_timeoutCallback) client->_timeoutCallback(client->_timeoutArg, client, NATIVE_ACK_TIMEOUT);
+        break;
+      case EVENT_RESPONSE:
+        client->receive(event.data.data(), event.data.size());
+        break;
+      default:
+        break;
+    }
+  }
+  return events.empty() ? UINT64_MAX : events.begin()->first;
+}
+
+// Controls //////////////////////////////////////////////////////////////////////////////////////
+
+void NativeAsyncTCP::setServer(Server * value) {
+  // A new server starts with no connections
+  server = value;
+  connections.clear();
+}
+
+void NativeAsyncTCP::setConditions(const Conditions & value) {
+  conditions = value;
+}
+
+const NativeAsyncTCP::Conditions * NativeAsyncTCP::getConditions() {
+  return &conditions;
+}
+
+void NativeAsyncTCP::seed(uint32_t seed) {
+  randomState = seed != 0 ? seed : 1;
+}
+
+void NativeAsyncTCP::reset() {
+  events.clear();
+  connections.clear();
+  conditions = DEFAULT_CONDITIONS;
+  randomState = 1;
+  connectCount = 0;
+  responseCount = 0;
+  retransmitCount = 0;
+  timeoutCount = 0;
+  abortCount = 0;
+  socketTimeoutCount = 0;
+}
+
+uint32_t NativeAsyncTCP::getConnectCount() {
+  return connectCount;
+}
+
+uint32_t NativeAsyncTCP::getResponseCount() {
+  return responseCount;
+}
+
+uint32_t NativeAsyncTCP::getRetransmitCount() {
+  return retransmitCount;
+}
+
+uint32_t NativeAsyncTCP::getTimeoutCount() {
+  return timeoutCount;
+}
+
+uint32_t NativeAsyncTCP::getAbortCount() {
+  return abortCount;
+}
+
+uint32_t NativeAsyncTCP::getSocketTimeoutCount() {
+  return socketTimeoutCount;
+}
+
+uint32_t NativeAsyncTCP::getOpenConnectionCount() {
+  return connections.size();
+}
@@ -0,0 +1,61 @@
+#ifndef ESPAsyncTCP_h
+#define ESPAsyncTCP_h
+
+#include <Arduino.h>
+#include <functional>
+
+class AsyncClient;
+
+typedef std::function<void(void *, AsyncClient *)> AcConnectHandler;
+typedef std::function<void(void *, AsyncClient *, void * data, size_t len)> AcDataHandler;
+typedef std::function<void(void *, AsyncClient *, int8_t error)> AcErrorHandler;
+typedef std::function<void(void *, AsyncClient *, uint32_t time)> AcTimeoutHandler;
+
+/**
+ * The parts of ESPAsyncTCP's AsyncClient in use, connected to the
+ * simulated network and server in NativeAsyncTCP.h. Errors are
+ * followed by a disconnection, and a server's response by its
+ * closing the connection, as with ESPAsyncTCP; an ack timeout is
+ * reported but leaves the connection open. Closing or destroying a
+ * client lets the server know a latency later.
+ */
+class AsyncClient {
+  public:
+    AsyncClient();
+    ~AsyncClient();
+    void onConnect(AcConnectHandler callback, void * arg = NULL);
+    void onDisconnect(AcConnectHandler callback, void * arg = NULL);
+    void onData(AcDataHandler callback, void * arg = NULL);
+    void onError(AcErrorHandler callback, void * arg = NULL);
+    void onTimeout(AcTimeoutHandler callback, void * arg = NULL);
+    bool connect(IPAddress ip, uint16_t port);
+    void close(bool now = false);
+    bool canSend();
+    size_t space();
+    size_t write(const char * data, size_t size);
+    size_t ack(size_t len);
+    const char * errorToString(int8_t error);
+
+  private:
+    AcConnectHandler _connectCallback;
+    void * _connectArg;
+    AcConnectHandler _disconnectCallback;
+    void * _disconnectArg;
+    AcDataHandler _dataCallback;
+    void * _dataArg;
+    AcErrorHandler _errorCallback;
+    void * _errorArg;
+    AcTimeoutHandler _timeoutCallback;
+    void * _timeoutArg;
+    bool _connecting;
+    bool _connected;
+    bool _halfOpen;
+    uint32_t _session;
+
+    void hangUp();
+    void fail(int8_t error);
+    void receive(const uint8_t * data, size_t size);
+    static uint64_t service();
+};
+
+#endif // ESPAsyncTCP_h
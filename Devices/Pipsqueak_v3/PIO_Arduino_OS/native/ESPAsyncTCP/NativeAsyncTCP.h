@@ -0,0 +1,115 @@
+#ifndef NativeAsyncTCP_h
+#define NativeAsyncTCP_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The largest response a server may write, one TCP MSS
+#define NATIVE_RESPONSE_LIMIT 1460
+
+/**
+ * Host-side controls for the simulated network behind AsyncClient.
+ *
+ * Each segment travels under the conditions in force when it is
+ * sent. A handshake takes connectMillis; data takes latencyMillis,
+ * plus up to jitterMillis, each way. Each segment is lost with
+ * lossPercent probability and retransmitted after a timeout that
+ * doubles with each attempt, until the connection is aborted. A
+ * half-open connection is established, but its peer has gone, so
+ * nothing sent over it is ever acknowledged.
+ *
+ * Callbacks arrive in virtual time, from delay() and yield(), as
+ * they would from lwIP. Loss and half-open connections are drawn
+ * from a seeded generator, so a run repeats exactly.
+ */
+namespace NativeAsyncTCP {
+  struct Conditions {
+    uint32_t connectMillis;   // handshake, when nothing is lost
+    uint32_t latencyMillis;   // one way
+    uint32_t jitterMillis;    // added to the latency, uniformly
+    uint8_t lossPercent;      // of segments, each way
+    uint8_t halfOpenPercent;  // of connections
+    bool refused;             // nothing listening: connections are reset
+  };
+
+  /**
+   * The far end of every connection. Each segment written arrives
+   * whole, and the server ends the connection once it has written
+   * its response, or destroys it if it has none.
+   */
+  class Server {
+    public:
+      virtual ~Server() {}
+
+      /**
+       * A connection has been accepted. Returning false closes it
+       * at once, as a server at its connection limit does.
+       */
+      virtual bool open() { return true; }
+
+      /**
+       * A request has arrived. Writes the response, at most
+       * NATIVE_RESPONSE_LIMIT bytes, and returns its size, or 0 if
+       * there is none. Sets serviceMicros to how long the response
+       * takes to write, from now.
+       */
+      virtual size_t respond(const uint8_t * request, size_t size, uint8_t * response, uint32_t * serviceMicros) = 0;
+
+      /** A connection open() accepted has closed, at either end. */
+      virtual void close() {}
+
+      /**
+       * Returns how long a connection may sit idle, in ms, before
+       * the server destroys it, or 0 for no limit. As with
+       * socket.setTimeout() in Node.js, waiting on the response
+       * counts as idle.
+       */
+      virtual uint32_t getSocketTimeoutMillis() { return 0; }
+  };
+
+  /**
+   * Sets the server connections reach; with none, they are refused.
+   * Connections the last server had open are forgotten.
+   */
+  void setServer(Server * server);
+
+  /** Sets the conditions for segments sent from now on. */
+  void setConditions(const Conditions & conditions);
+
+  /** Returns the conditions in force. */
+  const Conditions * getConditions();
+
+  /** Reseeds the generator loss and half-open connections are drawn from. */
+  void seed(uint32_t seed);
+
+  /**
+   * Drops every segment in transit without a callback, as
+   * ArduinoNative::reboot() also does, and restores the default
+   * conditions (a 40 ms handshake, 20 ms each way, nothing lost),
+   * the seed and the counters.
+   */
+  void reset();
+
+  /** Returns the number of connection attempts. */
+  uint32_t getConnectCount();
+
+  /** Returns the number of responses delivered to a client. */
+  uint32_t getResponseCount();
+
+  /** Returns the number of segments retransmitted. */
+  uint32_t getRetransmitCount();
+
+  /** Returns the number of ack timeouts reported. */
+  uint32_t getTimeoutCount();
+
+  /** Returns the number of connections reset or aborted. */
+  uint32_t getAbortCount();
+
+  /** Returns the number of connections the server destroyed for sitting idle. */
+  uint32_t getSocketTimeoutCount();
+
+  /** Returns the number of connections open at the server. */
+  uint32_t getOpenConnectionCount();
+}
+
+#endif // NativeAsyncTCP_h
@@ -0,0 +1,40 @@
+#ifndef NativeOneWire_h
+#define NativeOneWire_h
+
+#include <stdint.h>
+
+/**
+ * Simulated DS18B20 devices attached to the native OneWire bus.
+ *
+ * The simulation works at the level of OneWire time slots, so
+ * ROM searches, match/skip ROM, conversions and scratchpad
+ * reads and writes all behave as they would on real hardware
+ * (without the timing).
+ */
+namespace NativeOneWire {
+  /** Attaches a simulated DS18B20 with the given 8-byte ROM address. */
+  void attach(const uint8_t * address, float temperature);
+
+  /** Detaches a simulated device. */
+  void detach(const uint8_t * address);
+
+  /** Detaches all simulated devices. */
+  void clear();
+
+  /** Updates the temperature a simulated device will report. */
+  void setTemperature(const uint8_t * address, float temperature);
+
+  /** Corrupts the CRC of the next n scratchpad reads of a device. */
+  void corruptReads(const uint8_t * address, uint8_t count);
+
+  /** Returns the number of reset pulses issued since the last clear(). */
+  uint32_t getResetCount();
+
+  /** Returns the number of time slots (bits) used since the last clear(). */
+  uint32_t getSlotCount();
+
+  /** Fills in a valid DS18B20 ROM address (family code and CRC) from a serial number. */
+  void makeAddress(uint8_t * address, uint32_t serial);
+}
+
+#endif // NativeOneWire_h
@@ -0,0 +1,339 @@
+#include "OneWire.h"
+#include "NativeOneWire.h"
+#include <string.h>
+#include <math.h>
+
+#define NATIVE_ONE_WIRE_DEVICE_LIMIT 8
+
+#define COMMAND_SEARCH_ROM          0xF0
+#define COMMAND_MATCH_ROM           0x55
+#define COMMAND_SKIP_ROM            0xCC
+#define COMMAND_BEGIN_CONVERSION    0x44
+#define COMMAND_READ_SCRATCHPAD     0xBE
+#define COMMAND_WRITE_SCRATCHPAD    0x4E
+#define COMMAND_COPY_SCRATCHPAD     0x48
+
+enum BusPhase { Idle, RomCommand, MatchRom, SearchRom, FunctionCommand, ReadScratchpad, WriteScratchpad };
+
+struct SimulatedDevice {
+  bool attached;
+  uint8_t address[8];
+  float temperature;
+  uint8_t scratchpad[9];
+  uint8_t corruptReads;
+  bool selected;
+};
+
+static SimulatedDevice devices[NATIVE_ONE_WIRE_DEVICE_LIMIT];
+static BusPhase phase = Idle;
+static uint8_t byteCursor = 0;
+static uint8_t matchAddress[8];
+static uint8_t searchBit = 0;
+static uint8_t searchSlot = 0;
+static uint32_t resetCount = 0;
+static uint32_t slotCount = 0;
+
+static uint8_t dallasCrc8(const uint8_t * addr, uint8_t len) {
+  uint8_t crc = 0;
+  while (len--) {
+    uint8_t inbyte = *addr++;
+    for (uint8_t i = 8; i; i--) {
+      uint8_t mix = (crc ^ inbyte) & 0x01;
+      crc >>= 1;
+      if (mix) crc ^= 0x8C;
+      inbyte >>= 1;
+    }
+  }
+  return crc;
+}
+
+static SimulatedDevice * findDevice(const uint8_t * address) {
+  for (size_t i = 0; i < NATIVE_ONE_WIRE_DEVICE_LIMIT; i++) {
+    if (devices[i].attached && memcmp(devices[i].address, address, 8) == 0) return &devices[i];
+  }
+  return NULL;
+}
+
+static void initializeScratchpad(SimulatedDevice * device) {
+  memset(device->scratchpad, 0, 9);
+  device->scratchpad[0] = 0x50; // 85 C power-on value
+  device->scratchpad[1] = 0x05;
+  device->scratchpad[2] = 0x4B;
+  device->scratchpad[3] = 0x46;
+  device->scratchpad[4] = 0x7F;
+  device->scratchpad[8] = dallasCrc8(device->scratchpad, 8);
+}
+
+static void convert(SimulatedDevice * device) {
+  int16_t raw = (int16_t) lroundf(device->temperature * 16.0f);
+  uint8_t config = device->scratchpad[4];
+  // Lower resolutions leave undefined low bits; clear them as the sensor would
+  if (config == 0x1F) raw &= ~0x07;
+  else if (config == 0x3F) raw &= ~0x03;
+  else if (config == 0x5F) raw &= ~0x01;
+  device->scratchpad[0] = raw & 0xFF;
+  device->scratchpad[1] = (raw >> 8) & 0xFF;
+  device->scratchpad[8] = dallasCrc8(device->scratchpad, 8);
+}
+
+static uint8_t addressBit(const SimulatedDevice * device, uint8_t bit) {
+  return (device->address[bit / 8] >> (bit % 8)) & 0x01;
+}
+
+void NativeOneWire::attach(const uint8_t * address, float temperature) {
+  if (findDevice(address)) return;
+  for (size_t i = 0; i < NATIVE_ONE_WIRE_DEVICE_LIMIT; i++) {
+    if (!devices[i].attached) {
+      memset(&devices[i], 0, sizeof(SimulatedDevice));
+      devices[i].attached = true;
+      memcpy(devices[i].address, address, 8);
+      devices[i].temperature = temperature;
+      initializeScratchpad(&devices[i]);
+      return;
+    }
+  }
+}
+
+void NativeOneWire::detach(const uint8_t * address) {
+  SimulatedDevice * device = findDevice(address);
+  if (device) device->attached = false;
+}
+
+void NativeOneWire::clear() {
+  memset(devices, 0, sizeof(devices));
+  phase = Idle;
+  resetCount = 0;
+  slotCount = 0;
+}
+
+void NativeOneWire::setTemperature(const uint8_t * address, float temperature) {
+  SimulatedDevice * device = findDevice(address);
+  if (device) device->temperature = temperature;
+}
+
+void NativeOneWire::corruptReads(const uint8_t * address, uint8_t count) {
+  SimulatedDevice * device = findDevice(address);
+  if (device) device->corruptReads = count;
+}
+
+uint32_t NativeOneWire::getResetCount() {
+  return resetCount;
+}
+
+uint32_t NativeOneWire::getSlotCount() {
+  return slotCount;
+}
+
+void NativeOneWire::makeAddress(uint8_t * address, uint32_t serial) {
+  memset(address, 0, 8);
+  address[0] = 0x28;
+  memcpy(&address[1], &serial, 4);
+  address[7] = dallasCrc8(address, 7);
+}
+
+// OneWire ////////////////////////////////////////////////////////////////////////////////////////
+
+OneWire::OneWire() : _pin { 0 } {
+  reset_search();
+}
+
+OneWire::OneWire(uint8_t pin) {
+  begin(pin);
+}
+
+void OneWire::begin(uint8_t pin) {
+  _pin = pin;
+  reset_search();
+}
+
+uint8_t OneWire::reset(void) {
+  resetCount += 1;
+  phase = RomCommand;
+  byteCursor = 0;
+  bool present = false;
+  for (size_t i = 0; i < NATIVE_ONE_WIRE_DEVICE_LIMIT; i++) {
+    devices[i].selected = devices[i].attached;
+    present = present || devices[i].attached;
+  }
+  return present ? 1 : 0;
+}
+
+void OneWire::select(const uint8_t rom[8]) {
+  write(COMMAND_MATCH_ROM);
+  for (uint8_t i = 0; i < 8; i++) write(rom[i]);
+}
+
+void OneWire::skip(void) {
+  write(COMMAND_SKIP_ROM);
+}
+
+void OneWire::write(uint8_t v, uint8_t power) {
+  slotCount += 8;
+  switch (phase) {
+    case RomCommand:
+      if (v == COMMAND_MATCH_ROM) {
+        phase = MatchRom;
+        byteCursor = 0;
+      } else if (v == COMMAND_SKIP_ROM) {
+        phase = FunctionCommand;
+      } else if (v == COMMAND_SEARCH_ROM) {
+        phase = SearchRom;
+        searchBit = 0;
+        searchSlot = 0;
+      } else {
+        phase = Idle;
+      }
+      break;
+    case MatchRom:
+      matchAddress[byteCursor++] = v;
+      if (byteCursor == 8) {
+        for (size_t i = 0; i < NATIVE_ONE_WIRE_DEVICE_LIMIT; i++) {
+          devices[i].selected = devices[i].attached && memcmp(devices[i].address, matchAddress, 8) == 0;
+        }
+        phase = FunctionCommand;
+      }
+      break;
+    case FunctionCommand:
+      byteCursor = 0;
+      if (v == COMMAND_BEGIN_CONVERSION) {
+        for (size_t i = 0; i < NATIVE_ONE_WIRE_DEVICE_LIMIT; i++) {
+          if (devices[i].selected) convert(&devices[i]);
+        }
+        phase = Idle;
+      } else if (v == COMMAND_READ_SCRATCHPAD) {
+        phase = ReadScratchpad;
+      } else if (v == COMMAND_WRITE_SCRATCHPAD) {
+        phase = WriteScratchpad;
+      } else {
+        phase = Idle;
+      }
+      break;
+    case WriteScratchpad:
+      for (size_t i = 0; i < NATIVE_ONE_WIRE_DEVICE_LIMIT; i++) {
+        if (!devices[i].selected) continue;
+        devices[i].scratchpad[2 + byteCursor] = v;
+        devices[i].scratchpad[8] = dallasCrc8(devices[i].scratchpad, 8);
+      }
+      byteCursor += 1;
+      if (byteCursor == 3) phase = Idle;
+      break;
+    default:
+      break;
+  }
+}
+
+uint8_t OneWire::read(void) {
+  slotCount += 8;
+  if (phase != ReadScratchpad || byteCursor >= 9) return 0xFF;
+  uint8_t value = 0xFF;
+  for (size_t i = 0; i < NATIVE_ONE_WIRE_DEVICE_LIMIT; i++) {
+    if (!devices[i].selected) continue;
+    uint8_t deviceValue = devices[i].scratchpad[byteCursor];
+    if (byteCursor == 8 && devices[i].corruptReads > 0) {
+      devices[i].corruptReads -= 1;
+      deviceValue ^= 0xFF;
+    }
+    value &= deviceValue;
+  }
+  byteCursor += 1;
+  return value;
+}
+
+void OneWire::write_bit(uint8_t v) {
+  slotCount += 1;
+  if (phase != SearchRom) return;
+  for (size_t i = 0; i < NATIVE_ONE_WIRE_DEVICE_LIMIT; i++) {
+    if (devices[i].selected && addressBit(&devices[i], searchBit) != (v ? 1 : 0)) {
+      devices[i].selected = false;
+    }
+  }
+  searchBit += 1;
+  searchSlot = 0;
+  if (searchBit == 64) phase = FunctionCommand;
+}
+
+uint8_t OneWire::read_bit(void) {
+  slotCount += 1;
+  if (phase != SearchRom) return 1;
+  // Wired-AND of the participating devices' address bit (first slot)
+  // or its complement (second slot)
+  uint8_t value = 1;
+  for (size_t i = 0; i < NATIVE_ONE_WIRE_DEVICE_LIMIT; i++) {
+    if (!devices[i].selected) continue;
+    uint8_t bit = addressBit(&devices[i], searchBit);
+    value &= searchSlot == 0 ? bit : (bit ^ 0x01);
+  }
+  searchSlot = (searchSlot + 1) % 2;
+  return value;
+}
+
+void OneWire::depower(void) {
+}
+
+void OneWire::reset_search() {
+  memset(_romNo, 0, 8);
+  _lastDiscrepancy = 0;
+  _lastDeviceFlag = false;
+}
+
+bool OneWire::search(uint8_t * newAddr, bool search_mode) {
+  uint8_t idBitNumber = 1;
+  uint8_t lastZero = 0;
+  uint8_t romByteNumber = 0;
+  uint8_t romByteMask = 1;
+  bool searchResult = false;
+
+  if (!_lastDeviceFlag) {
+    if (!reset()) {
+      reset_search();
+      return false;
+    }
+    write(search_mode ? COMMAND_SEARCH_ROM : 0xEC);
+    do {
+      uint8_t idBit = read_bit();
+      uint8_t cmpIdBit = read_bit();
+      uint8_t direction;
+      if (idBit == 1 && cmpIdBit == 1) break;
+      if (idBit != cmpIdBit) {
+        direction = idBit;
+      } else {
+        if (idBitNumber < _lastDiscrepancy) {
+          direction = (_romNo[romByteNumber] & romByteMask) > 0;
+        } else {
+          direction = idBitNumber == _lastDiscrepancy;
+        }
+        if (direction == 0) lastZero = idBitNumber;
+      }
+      if (direction == 1) {
+        _romNo[romByteNumber] |= romByteMask;
+      } else {
+        _romNo[romByteNumber] &= ~romByteMask;
+      }
+      write_bit(direction);
+      idBitNumber++;
+      romByteMask <<= 1;
+      if (romByteMask == 0) {
+        romByteNumber++;
+        romByteMask = 1;
+      }
+    } while (romByteNumber < 8);
+
+    if (idBitNumber >= 65) {
+      _lastDiscrepancy = lastZero;
+      if (_lastDiscrepancy == 0) _lastDeviceFlag = true;
+      searchResult = true;
+    }
+  }
+
+  if (!searchResult || !_romNo[0]) {
+    reset_search();
+    searchResult = false;
+  } else {
+    memcpy(newAddr, _romNo, 8);
+  }
+  return searchResult;
+}
+
+uint8_t OneWire::crc8(const uint8_t * addr, uint8_t len) {
+  return dallasCrc8(addr, len);
+}
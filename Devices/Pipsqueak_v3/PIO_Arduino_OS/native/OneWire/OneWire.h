@@ -0,0 +1,34 @@
+#ifndef OneWire_h
+#define OneWire_h
+
+#include <stdint.h>
+
+/**
+ * Paul Stoffregen's OneWire API, over a bus of simulated DS18B20s;
+ * see NativeOneWire.h.
+ */
+class OneWire {
+  public:
+    OneWire();
+    OneWire(uint8_t pin);
+    void begin(uint8_t pin);
+    uint8_t reset(void);
+    void select(const uint8_t rom[8]);
+    void skip(void);
+    void write(uint8_t v, uint8_t power = 0);
+    uint8_t read(void);
+    void write_bit(uint8_t v);
+    uint8_t read_bit(void);
+    void depower(void);
+    void reset_search();
+    bool search(uint8_t * newAddr, bool search_mode = true);
+    static uint8_t crc8(const uint8_t * addr, uint8_t len);
+
+  private:
+    uint8_t _pin;
+    uint8_t _romNo[8];
+    uint8_t _lastDiscrepancy;
+    bool _lastDeviceFlag;
+};
+
+#endif // OneWire_h
@@ -0,0 +1,249 @@
+#include "ReferenceServer.h"
+#include <ArduinoNative.h>
+#include <TimeProtocol.h>
+#include <SetpointProtocol.h>
+#include <TelemetryProtocol.h>
+#include <RebootProtocol.h>
+#include <ProfileProtocol.h>
+#include <CrashDumpProtocol.h>
+#include <algorithm>
+
+ReferenceServer::ReferenceServer(uint32_t unixTime)
+:
+  _unixTime { unixTime },
+  _startMicros { ArduinoNative::getMicros() },
+  _setpoint { 20.0 },
+  _rateLimit { 0 },
+  _connectionLimit { 0 },
+  _socketTimeout { 0 },
+  _serviceMicros { 0 },
+  _busyUntilMicros { 0 },
+  _connectionCount { 0 },
+  _peakConnectionCount { 0 },
+  _refusalCount { 0 },
+  _rejectionCount { 0 },
+  _dropCount { 0 }
+{
+  memset(_requestCounts, 0, sizeof(_requestCounts));
+  memset(_eventCounts, 0, sizeof(_eventCounts));
+}
+
+ReferenceServer::~ReferenceServer() {
+  for (auto & device : _devices) delete device.second.hmac;
+}
+
+void ReferenceServer::registerDevice(uint32_t deviceID, const byte * secretKey) {
+  Device device = { new Hmac(secretKey), 0, false };
+  _devices[deviceID] = device;
+}
+
+void ReferenceServer::setSetpoint(float setpoint) {
+  _setpoint = setpoint;
+}
+
+void ReferenceServer::setRateLimit(uint32_t intervalMillis) {
+  _rateLimit = intervalMillis;
+}
+
+void ReferenceServer::setConnectionLimit(uint16_t connectionLimit) {
+  _connectionLimit = connectionLimit;
+}
+
+void ReferenceServer::setSocketTimeout(uint32_t timeoutMillis) {
+  _socketTimeout = timeoutMillis;
+}
+
+void ReferenceServer::setServiceMicros(uint32_t serviceMicros) {
+  _serviceMicros = serviceMicros;
+}
+
+uint32_t ReferenceServer::now() {
+  return _unixTime + (uint32_t) ((ArduinoNative::getMicros() - _startMicros) / 1000000);
+}
+
+bool ReferenceServer::open() {
+  if (_connectionLimit > 0 && _connectionCount >= _connectionLimit) {
+    _refusalCount += 1;
+    return false;
+  }
+  _connectionCount += 1;
+  _peakConnectionCount = max(_peakConnectionCount, _connectionCount);
+  return true;
+}
+
+void ReferenceServer::close() {
+  if (_connectionCount > 0) _connectionCount -= 1;
+}
+
+uint32_t ReferenceServer::getSocketTimeoutMillis() {
+  return _socketTimeout;
+}
+
+size_t ReferenceServer::respond(const uint8_t * request, size_t size, uint8_t * response, uint32_t * serviceMicros) {
+  // Each request waits for those ahead of it
+  uint64_t arrivalMicros = ArduinoNative::getMicros();
+  _busyUntilMicros = max(_busyUntilMicros, arrivalMicros) + _serviceMicros;
+  *serviceMicros = (uint32_t) (_busyUntilMicros - arrivalMicros);
+
+  size_t expectedSize = getExpectedSize(request, size);
+  uint32_t deviceID;
+  memcpy(&deviceID, &request[REQUEST_DEVICE_ID_OFFSET], 4);
+  auto found = _devices.find(deviceID);
+  if (expectedSize == 0 || size != expectedSize || found == _devices.end()) {
+    _dropCount += 1;
+    return 0;
+  }
+  Device * device = &found->second;
+  uint8_t protocolID = request[REQUEST_PROTOCOL_ID_OFFSET];
+  _requestCounts[protocolID] += 1;
+
+  size_t responseSize = getResponseSize(protocolID);
+  uint32_t timestamp = now();
+  memset(response, 0, responseSize);
+  response[RESPONSE_PROTOCOL_ID_OFFSET] = protocolID;
+  memcpy(&response[RESPONSE_TIMESTAMP_OFFSET], &timestamp, 4);
+  memcpy(&response[RESPONSE_CHALLENGE_OFFSET], &request[REQUEST_CHALLENGE_OFFSET], 4);
+
+  uint8_t status = inspect(device, request, size);
+  if (status == 0) status = accept(request, response);
+  if (status != 0) _rejectionCount += 1;
+  response[RESPONSE_STATUS_CODE_OFFSET] = status;
+  device->hmac->generate(response, responseSize - HMAC_SIZE, &response[responseSize - HMAC_SIZE]);
+  _latencies.push_back(*serviceMicros);
+  return responseSize;
+}
+
+uint32_t ReferenceServer::getRequestCount(uint8_t protocolID) {
+  return protocolID < REFERENCE_SERVER_PROTOCOL_COUNT ? _requestCounts[protocolID] : 0;
+}
+
+uint32_t ReferenceServer::getRejectionCount() {
+  return _rejectionCount;
+}
+
+uint32_t ReferenceServer::getDropCount() {
+  return _dropCount;
+}
+
+uint32_t ReferenceServer::getRefusalCount() {
+  return _refusalCount;
+}
+
+uint16_t ReferenceServer::getPeakConnectionCount() {
+  return _peakConnectionCount;
+}
+
+uint32_t ReferenceServer::getLatencyPercentile(uint8_t percentile) {
+  if (_latencies.empty()) return 0;
+  std::vector<uint32_t> latencies(_latencies);
+  size_t rank = min((size_t) (latencies.size() * percentile / 100), latencies.size() - 1);
+  std::nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+  return latencies[rank];
+}
+
+uint32_t ReferenceServer::getEventCount(uint8_t eventType) {
+  return _eventCounts[eventType];
+}
+
+uint32_t ReferenceServer::getErrorEventCount(ErrorType errorType, int8_t errorCode) {
+  auto found = _errorEventCounts.find((uint16_t) ((uint8_t) errorType << 8 | (uint8_t) errorCode));
+  return found == _errorEventCounts.end() ? 0 : found->second;
+}
+
+// The size the request's header says it should be, or 0 if it
+// can't be any
+size_t ReferenceServer::getExpectedSize(const uint8_t * request, size_t size) {
+  if (size < REQUEST_BASE_SIZE) return 0;
+  uint32_t messageSize;
+  uint16_t chunkSize;
+  switch (request[REQUEST_PROTOCOL_ID_OFFSET]) {
+    case TIME_PROTOCOL_ID:
+    case SETPOINT_PROTOCOL_ID:
+    case PROFILE_PROTOCOL_ID:
+      return REQUEST_BASE_SIZE;
+    case TELEMETRY_PROTOCOL_ID:
+      if (request[TELEMETRY_REQUEST_COUNT_OFFSET] > TELEMETRY_REQUEST_EVENT_COUNT_LIMIT) return 0;
+      return TELEMETRY_REQUEST_BASE_SIZE + request[TELEMETRY_REQUEST_COUNT_OFFSET] * TELEMETRY_REQUEST_EVENT_SIZE;
+    case REPORT_REBOOT_PROTOCOL_ID:
+      memcpy(&messageSize, &request[REPORT_REBOOT_REQUEST_MESSAGE_SIZE_OFFSET], 4);
+      if (messageSize > REPORT_REBOOT_REQUEST_MESSAGE_SIZE_LIMIT) return 0;
+      return REPORT_REBOOT_REQUEST_BASE_SIZE + messageSize;
+    case CRASH_DUMP_PROTOCOL_ID:
+      memcpy(&chunkSize, &request[CRASH_DUMP_REQUEST_CHUNK_SIZE_OFFSET], 2);
+      if (chunkSize > CRASH_DUMP_REQUEST_CHUNK_SIZE_LIMIT) return 0;
+      return CRASH_DUMP_REQUEST_BASE_SIZE + chunkSize;
+    default:
+      return 0;
+  }
+}
+
+size_t ReferenceServer::getResponseSize(uint8_t protocolID) {
+  return protocolID == PROFILE_PROTOCOL_ID ? PROFILE_RESPONSE_SIZE : RESPONSE_BASE_SIZE;
+}
+
+// Checks what every protocol has in common, returning the status code
+uint8_t ReferenceServer::inspect(Device * device, const uint8_t * request, size_t size) {
+  if (!device->hmac->validate(request, size - HMAC_SIZE, &request[size - HMAC_SIZE])) {
+    return STATUS_MASK_AUTHENTICATION;
+  }
+
+  // Only the requests let through count toward the limit
+  if (_rateLimit > 0 && device->heard && millis() - device->lastRequestMillis < _rateLimit) {
+    return STATUS_MASK_RATE_LIMITED;
+  }
+  device->lastRequestMillis = millis();
+  device->heard = true;
+
+  // A device asks the time when its clock can't be trusted
+  if (request[REQUEST_PROTOCOL_ID_OFFSET] == TIME_PROTOCOL_ID) return 0;
+  uint32_t timestamp;
+  memcpy(&timestamp, &request[REQUEST_TIMESTAMP_OFFSET], 4);
+  if ((int32_t) (now() - timestamp) > REFERENCE_SERVER_MAX_AGE) return STATUS_MASK_CLOCK_SYNC_BEHIND;
+  if ((int32_t) (timestamp - now()) > REFERENCE_SERVER_MAX_LEAD) return STATUS_MASK_CLOCK_SYNC_AHEAD;
+  return 0;
+}
+
+// Acts on an authentic, timely request, filling in the response's
+// protocol-specific fields, and returns the status code
+uint8_t ReferenceServer::accept(const uint8_t * request, uint8_t * response) {
+  switch (request[REQUEST_PROTOCOL_ID_OFFSET]) {
+    case SETPOINT_PROTOCOL_ID:
+      memcpy(&response[SETPOINT_RESPONSE_SETPOINT_OFFSET], &_setpoint, 4);
+      return 0;
+    case TELEMETRY_PROTOCOL_ID: {
+      uint8_t count = request[TELEMETRY_REQUEST_COUNT_OFFSET];
+      const uint8_t * events = &request[TELEMETRY_REQUEST_EVENTS_BUFFER_OFFSET];
+      for (uint8_t i = 0; i < count; i++) {
+        switch (events[i * TELEMETRY_REQUEST_EVENT_SIZE + STATUS_EVENT_TYPE_OFFSET]) {
+          case STATUS_EVENT_TYPE_TEMPERATURE:
+          case STATUS_EVENT_TYPE_SETPOINT:
+          case STATUS_EVENT_TYPE_HEATER:
+          case STATUS_EVENT_TYPE_ERROR:
+          case STATUS_EVENT_TYPE_CHILLER:
+          case STATUS_EVENT_TYPE_TUNING:
+          case STATUS_EVENT_TYPE_LATENCY:
+          case STATUS_EVENT_TYPE_BOOT:
+          case STATUS_EVENT_TYPE_MEMORY:
+          case STATUS_EVENT_TYPE_METRIC:
+            break;
+          default:
+            return STATUS_MASK_UNKNOWN_EVENT_TYPE;
+        }
+      }
+      for (uint8_t i = 0; i < count; i++) {
+        const uint8_t * event = &events[i * TELEMETRY_REQUEST_EVENT_SIZE];
+        _eventCounts[event[STATUS_EVENT_TYPE_OFFSET]] += 1;
+        if (event[STATUS_EVENT_TYPE_OFFSET] == STATUS_EVENT_TYPE_ERROR) {
+          _errorEventCounts[(uint16_t) (event[STATUS_EVENT_ERROR_TYPE_OFFSET] << 8 | event[STATUS_EVENT_ERROR_CODE_OFFSET])] += 1;
+        }
+      }
+      memcpy(&response[TELEMETRY_RESPONSE_SETPOINT_OFFSET], &_setpoint, 4);
+      return 0;
+    }
+    default:
+      // Time and reboot responses carry nothing more; neither does a
+      // crash dump acknowledgement, nor a profile response with ID 0,
+      // which cancels any profile running
+      return 0;
+  }
+}
@@ -0,0 +1,150 @@
+#ifndef ReferenceServer_h
+#define ReferenceServer_h
+
+#include <Arduino.h>
+#include <NativeAsyncTCP.h>
+#include <Hmac.h>
+#include <Errors.h>
+#include <map>
+#include <vector>
+
+// requests timestamped more than this far behind the server's
+// clock, or ahead of it, are rejected as out of sync
+#define REFERENCE_SERVER_MAX_AGE 3 // s
+#define REFERENCE_SERVER_MAX_LEAD 1 // s
+
+// protocol IDs run from 0 to this, less one
+#define REFERENCE_SERVER_PROTOCOL_COUNT 6
+
+/**
+ * An in-process server that speaks the Pipsqueak Protocol, for
+ * PipsqueakClient to talk to over the simulated network in
+ * NativeAsyncTCP.h. It answers the time, setpoint, telemetry,
+ * reboot, profile and crash dump protocols as the README of each
+ * specifies, and signs every response with the device's key.
+ *
+ * As CiderServer does, it closes the connection without answering
+ * a malformed request or one from an unregistered device. A request
+ * with a bad HMAC, one out of sync with the server's clock (time
+ * requests excepted) or one sent too soon after the device's last
+ * is rejected with the status code saying so.
+ *
+ * It can be held to CiderServer's limits: a cap on open
+ * connections, a socket timeout, and the time it spends on each
+ * request, one at a time, as a single Node.js process does.
+ *
+ * It tallies what it hears, so that a test can tell what the
+ * devices got through, and how long they waited on it.
+ */
+class ReferenceServer : public NativeAsyncTCP::Server {
+  public:
+    /**
+     * Constructor.
+     *
+     * unixTime: the server's clock, as of now in virtual time
+     */
+    ReferenceServer(uint32_t unixTime);
+    ~ReferenceServer();
+
+    /** Registers a device, with the key its requests are signed with. */
+    void registerDevice(uint32_t deviceID, const byte * secretKey);
+
+    /** Sets the setpoint handed out in setpoint and telemetry responses. */
+    void setSetpoint(float setpoint);
+
+    /**
+     * Sets the least time allowed between a device's requests;
+     * any sooner are rejected as rate limited. 0, the default,
+     * disables rate limiting.
+     */
+    void setRateLimit(uint32_t intervalMillis);
+
+    /**
+     * Sets the most connections open at once, as net.Server's
+     * maxConnections does; any more are closed as soon as they're
+     * accepted. 0, the default, sets no limit.
+     */
+    void setConnectionLimit(uint16_t connectionLimit);
+
+    /**
+     * Sets how long a connection may sit idle before it's destroyed.
+     * 0, the default, sets no limit.
+     */
+    void setSocketTimeout(uint32_t timeoutMillis);
+
+    /**
+     * Sets how long each request takes to handle. Requests queue
+     * for the server's attention, so under load a response takes
+     * longer than this. 0 by default.
+     */
+    void setServiceMicros(uint32_t serviceMicros);
+
+    /** Returns the server's clock. */
+    uint32_t now();
+
+    bool open();
+    size_t respond(const uint8_t * request, size_t size, uint8_t * response, uint32_t * serviceMicros);
+    void close();
+    uint32_t getSocketTimeoutMillis();
+
+    /** Returns the number of well-formed requests for the given protocol. */
+    uint32_t getRequestCount(uint8_t protocolID);
+
+    /** Returns the number of requests answered with a non-zero status code. */
+    uint32_t getRejectionCount();
+
+    /** Returns the number of connections closed without an answer. */
+    uint32_t getDropCount();
+
+    /** Returns the number of connections closed for being over the limit. */
+    uint32_t getRefusalCount();
+
+    /** Returns the most connections that were open at once. */
+    uint16_t getPeakConnectionCount();
+
+    /**
+     * Returns the given percentile of the time taken to answer a
+     * request, from its arrival to the response, in us; 0 if none
+     * has been answered.
+     */
+    uint32_t getLatencyPercentile(uint8_t percentile);
+
+    /** Returns the number of status events of the given type accepted. */
+    uint32_t getEventCount(uint8_t eventType);
+
+    /** Returns the number of error status events accepted with the given type and code. */
+    uint32_t getErrorEventCount(ErrorType errorType, int8_t errorCode);
+
+  private:
+    struct Device {
+      Hmac * hmac;
+      uint32_t lastRequestMillis;
+      bool heard;
+    };
+
+    uint32_t _unixTime;
+    uint64_t _startMicros;
+    float _setpoint;
+    uint32_t _rateLimit;
+    uint16_t _connectionLimit;
+    uint32_t _socketTimeout;
+    uint32_t _serviceMicros;
+    uint64_t _busyUntilMicros;
+    uint16_t _connectionCount;
+    uint16_t _peakConnectionCount;
+    uint32_t _refusalCount;
+    std::vector<uint32_t> _latencies;
+    std::map<uint32_t, Device> _devices;
+    uint32_t _requestCounts[REFERENCE_SERVER_PROTOCOL_COUNT];
+    uint32_t _rejectionCount;
+    uint32_t _dropCount;
+    uint32_t _eventCounts[256];
+    std::map<uint16_t, uint32_t> _errorEventCounts;
+
+    size_t getExpectedSize(const uint8_t * request, size_t size);
+    size_t getResponseSize(uint8_t protocolID);
+    uint8_t inspect(Device * device, const uint8_t * request, size_t size);
+    uint8_t accept(const uint8_t * request, uint8_t * response);
+};
+
+#endif // ReferenceServer_h
@@ -0,0 +1,31 @@
+#include "TimeLib.h"
+#include <Arduino.h>
+#include <ArduinoNative.h>
+
+static time_t baseTime = 0;
+static uint64_t baseMicros = 0;
+static uint32_t bootCount = 0;
+
+static void checkReboot() {
+  if (bootCount != ArduinoNative::getBootCount()) {
+    bootCount = ArduinoNative::getBootCount();
+    baseTime = 0;
+    baseMicros = 0;
+  }
+}
+
+time_t now() {
+  checkReboot();
+  return baseTime + (time_t) ((ArduinoNative::getMicros() - baseMicros) / 1000000);
+}
+
+void setTime(time_t t) {
+  checkReboot();
+  baseTime = t;
+  baseMicros = ArduinoNative::getMicros();
+}
+
+timeStatus_t timeStatus() {
+  checkReboot();
+  return baseTime != 0 ? timeSet : timeNotSet;
+}
@@ -0,0 +1,17 @@
+#ifndef TimeLib_h
+#define TimeLib_h
+
+#include <time.h>
+
+typedef enum { timeNotSet, timeNeedsSync, timeSet } timeStatus_t;
+
+/**
+ * The parts of Paul Stoffregen's Time library in use: a Unix clock
+ * kept on millis(), so on virtual time. Unset again after
+ * ArduinoNative::reboot(), as after a reset.
+ */
+time_t now();
+void setTime(time_t t);
+timeStatus_t timeStatus();
+
+#endif // TimeLib_h
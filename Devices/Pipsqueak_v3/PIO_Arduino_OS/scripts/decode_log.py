@@ -0,0 +1,89 @@
+"""
+Formats the binary log a Pipsqueak streams over Serial.
+
+Typing `log` into the serial monitor turns streaming on. Each record
+then arrives as a line of hex words, "#L" first, as BinaryLog.h lays
+them out. This script reads those lines from the files given, or
+standard input, e.g. a capture made with `pio device monitor
+--filter log2file`, and prints each record as its format in
+lib/BinaryLog/LogFormats.h would have. Other lines pass through.
+
+    python scripts/decode_log.py device-monitor-*.log
+"""
+
+import os
+import re
+import struct
+import sys
+
+FORMATS_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "lib", "BinaryLog", "LogFormats.h")
+
+FORMAT = re.compile(r'X\((\w+),\s*(\d+),\s*"((?:[^"\\]|\\.)*)"\)')
+CONVERSION = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|z)?([diuxXcfeEgG%])")
+
+
+def load_formats(path):
+    """Format strings by ID, from the X-macro in LogFormats.h."""
+    formats = {}
+    with open(path) as header:
+        for match in FORMAT.finditer(header.read()):
+            formats[int(match.group(2))] = (match.group(1), match.group(3).encode().decode("unicode_escape"))
+    return formats
+
+
+def format_record(format_string, arguments):
+    """Applies a printf format to 32-bit argument words."""
+    arguments = list(arguments)
+    expected = sum(1 for match in CONVERSION.finditer(format_string) if match.group(2) != "%")
+    if expected != len(arguments):
+        return None
+
+    def convert(match):
+        flags, conversion = match.group(1), match.group(2)
+        if conversion == "%":
+            return "%"
+        word = arguments.pop(0)
+        if conversion in "di":
+            value = struct.unpack("<i", struct.pack("<I", word))[0]
+        elif conversion in "feEgG":
+            value = struct.unpack("<f", struct.pack("<I", word))[0]
+        else:
+            value = word
+        return ("%" + flags + conversion) % value
+
+    return CONVERSION.sub(convert, format_string)
+
+
+def decode(line, formats):
+    words = [int(word, 16) for word in line.split()[1:]]
+    if len(words) < 2:
+        return "undecodable: " + line
+    header, millis, arguments = words[0], words[1], words[2:]
+    format_id, count, dropped = header >> 16, header >> 8 & 0xFF, header & 0xFF
+    text = []
+    if dropped:
+        text.append("%10u ... %u%s records dropped" % (millis, dropped, "+" if dropped == 0xFF else ""))
+    if count != len(arguments) or format_id not in formats:
+        text.append("%10u unknown record %u: %s" % (millis, format_id, " ".join("%08x" % word for word in arguments)))
+        return "\n".join(text)
+    name, format_string = formats[format_id]
+    formatted = format_record(format_string, arguments)
+    if formatted is None:
+        formatted = "%s: expected other arguments than %s" % (name, " ".join("%08x" % word for word in arguments))
+    text.append("%10u %s" % (millis, formatted))
+    return "\n".join(text)
+
+
+def main(paths):
+    formats = load_formats(FORMATS_PATH)
+    files = [open(path) for path in paths] if paths else [sys.stdin]
+    for stream in files:
+        for line in stream:
+            line = line.rstrip("\r\n")
+            # log2file captures prefix each line with a timestamp
+            start = line.find("#L")
+            print(decode(line[start:], formats) if start >= 0 else line)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
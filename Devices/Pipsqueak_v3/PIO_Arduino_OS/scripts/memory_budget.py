@@ -0,0 +1,99 @@
+"""
+Reports how much DRAM, IRAM and flash each library takes, after each
+link of the firmware.
+
+Registered as a post script of the device environment. It has the
+linker write a map, then attributes each input section in it to the
+archive its object came from (lib<Name>.a, as PlatformIO builds each
+library) or to src, and to a region by its address in the esp8266's
+memory map. Initialized data is counted in DRAM, where it lives, but
+is copied from flash too.
+
+The report is printed, and written as JSON to memory_budget.json in
+the build directory, so that builds can be compared.
+"""
+
+import json
+import os
+import re
+
+Import("env")  # noqa: F821 (SCons)
+
+# name, first address, end address, capacity in bytes (None: the sketch's)
+REGIONS = (
+    ("dram", 0x3FFE8000, 0x40000000, 0x14000),
+    ("iram", 0x40100000, 0x40108000, 0x8000),
+    ("flash", 0x40200000, 0x40300000, None),
+)
+
+# warns of a region fuller than this
+FULL_PERCENT = 90
+
+# an input section: name (absent when wrapped onto its own line),
+# address, size and the object it came from
+SECTION = re.compile(r"^ (\S+)?\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+ARCHIVE = re.compile(r"lib([^/\\]+)\.a\(")
+
+MAP_PATH = os.path.join(env.subst("$BUILD_DIR"), "firmware.map")
+env.Append(LINKFLAGS=["-Wl,-Map," + MAP_PATH])
+
+
+def owner(source):
+    """The library an input section's object belongs to."""
+    archive = ARCHIVE.search(source)
+    if archive:
+        return archive.group(1)
+    if "/src/" in source.replace("\\", "/"):
+        return "src"
+    return os.path.basename(source)
+
+
+def region(address):
+    for name, start, end, _ in REGIONS:
+        if start <= address < end:
+            return name
+    return None
+
+
+def parse(path):
+    """Bytes per library per region, from a GNU ld map file."""
+    usage = {}
+    with open(path) as map_file:
+        lines = iter(map_file)
+        for line in lines:
+            if line.startswith("Linker script and memory map"):
+                break
+        for line in lines:
+            match = SECTION.match(line.rstrip("\n"))
+            if not match or match.group(1) == "*fill*":
+                continue
+            size = int(match.group(3), 16)
+            where = region(int(match.group(2), 16))
+            if size == 0 or where is None:
+                continue
+            library = usage.setdefault(owner(match.group(4)), {name: 0 for name, _, _, _ in REGIONS})
+            library[where] += size
+    return usage
+
+
+def report(source, target, env):
+    usage = parse(MAP_PATH)
+    capacities = {name: capacity for name, _, _, capacity in REGIONS}
+    capacities["flash"] = int(env.BoardConfig().get("upload.maximum_size", 1044464))
+    totals = {name: sum(library[name] for library in usage.values()) for name, _, _, _ in REGIONS}
+
+    print("%-28s %8s %8s %8s" % ("library", "dram", "iram", "flash"))
+    for name, library in sorted(usage.items(), key=lambda item: -sum(item[1].values())):
+        print("%-28s %8d %8d %8d" % (name, library["dram"], library["iram"], library["flash"]))
+    print("%-28s %8d %8d %8d" % ("total", totals["dram"], totals["iram"], totals["flash"]))
+    for name, _, _, _ in REGIONS:
+        percent = 100.0 * totals[name] / capacities[name]
+        print("%-5s %7d of %7d bytes (%.1f%%)" % (name, totals[name], capacities[name], percent))
+        if percent > FULL_PERCENT:
+            print("Warning: %s is over %d%% full" % (name, FULL_PERCENT))
+
+    with open(os.path.join(env.subst("$BUILD_DIR"), "memory_budget.json"), "w") as json_file:
+        json.dump({"capacity": capacities, "total": totals, "libraries": usage}, json_file, indent=2, sort_keys=True)
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report)
@@ -5,6 +5,35 @@
 #include <PipsqueakIndicators.h>
 #include <PipsqueakSensors.h>
 #include <PipsqueakController.h>
+#include <PowerManager.h>
+#include <MemoryMonitor.h>
+#include <PipsqueakMonitor.h>
+#include <Scheduler.h>
+#include <Profiler.h>
+#include <BinaryLog.h>
+#include <Metrics.h>
+#include <TimeLib.h>
+#include <new>
+
+#define CONSOLE_TASK_INTERVAL 250 // ms
+#define CONSOLE_LINE_LIMIT 32
+#define LOG_TASK_INTERVAL 20 // ms
+// "#L", then 9 characters per word and a newline
+#define LOG_LINE_LIMIT (2 + 9 * BINARY_LOG_RECORD_LIMIT + 1)
+
+// Static storage for a module constructed in setup(), once what it
+// depends on is ready, so that no module lives on the heap
+#define MODULE_STORAGE(type, name) alignas(type) static byte name[sizeof(type)]
+
+MODULE_STORAGE(PipsqueakState, stateStorage);
+MODULE_STORAGE(PipsqueakMonitor, monitorStorage);
+MODULE_STORAGE(Hmac, hmacStorage);
+MODULE_STORAGE(PipsqueakClient, clientStorage);
+MODULE_STORAGE(PipsqueakIndicators, indicatorsStorage);
+MODULE_STORAGE(PipsqueakSensors, sensorsStorage);
+MODULE_STORAGE(PipsqueakController, controllerStorage);
+MODULE_STORAGE(PowerManager, powerStorage);
+MODULE_STORAGE(MemoryMonitor, memoryStorage);
 
 Hmac * hmac;
 PipsqueakState * state;
@@ -12,38 +41,322 @@ PipsqueakClient * client;
 PipsqueakIndicators * indicators;
 PipsqueakSensors * sensors;
 PipsqueakController * controller;
+PowerManager * power = NULL;
+MemoryMonitor * memory = NULL;
+PipsqueakMonitor * monitor = NULL;
+Scheduler scheduler;
+char consoleLine[CONSOLE_LINE_LIMIT];
+size_t consoleLineLength = 0;
+bool logStreaming = false;
+TaskID logTask;
+
+#ifdef TRAP_HEAP_ALLOCATIONS
+// Built in the pipsqueak_v3_heap_trap environment, which has the
+// linker route operator new and new[] through these. Armed at the
+// end of setup(); any allocation after that aborts with a stack
+// trace the exception decoder can name the caller from. lwIP still
+// allocates packet buffers with malloc(), so only new is trapped.
+static bool heapTrapArmed = false;
+
+static void trapHeapAllocation(size_t size) {
+  if (!heapTrapArmed) return;
+  Serial.printf("\nHeap allocation of %u bytes after setup()\n", size);
+  abort();
+}
+
+extern "C" {
+  void * __real__Znwj(size_t size);
+  void * __real__Znaj(size_t size);
+
+  void * __wrap__Znwj(size_t size) {
+    trapHeapAllocation(size);
+    return __real__Znwj(size);
+  }
+
+  void * __wrap__Znaj(size_t size) {
+    trapHeapAllocation(size);
+    return __real__Znaj(size);
+  }
+}
+#endif
+
+// Prints each profiled code path's run count, longest run and the
+// upper bounds of its median and 99th percentile buckets, followed
+// by the histogram's non-empty buckets
+void dumpProfiler() {
+  float cyclesPerMicro = ESP.getCpuFreqMHz();
+  Serial.printf("%-24s %10s %10s %10s %10s\n", "code path", "runs", "max us", "p50 us <", "p99 us <");
+  for (uint8_t slot = 0; slot < PROFILER_SLOT_COUNT; slot++) {
+    Serial.printf(
+      "%-24s %10u %10.1f %10.1f %10.1f\n",
+      Profiler::getName(slot),
+      Profiler::getCount(slot),
+      Profiler::getMaxCycles(slot) / cyclesPerMicro,
+      (2UL << Profiler::getPercentileBucket(slot, 50)) / cyclesPerMicro,
+      (2UL << Profiler::getPercentileBucket(slot, 99)) / cyclesPerMicro
+    );
+    for (uint8_t bucket = 0; bucket < PROFILER_BUCKET_COUNT; bucket++) {
+      uint32_t count = Profiler::getBucketCount(slot, bucket);
+      if (count > 0) Serial.printf("  2^%u: %u", bucket, count);
+    }
+    Serial.println();
+  }
+}
+
+// Prints each metric since the last report: counters' counts and
+// totals since boot, gauges' values and peaks, histograms' buckets
+void dumpMetrics() {
+  Serial.printf("%-28s %10s %10s\n", "metric", "period", "boot/peak");
+  for (uint8_t metric = 0; metric < METRIC_COUNT; metric++) {
+    if (Metrics::getKind(metric) != MetricHistogram) {
+      Serial.printf("%-28s %10u %10u\n", Metrics::getName(metric), Metrics::getValue(metric), Metrics::getExtent(metric));
+      continue;
+    }
+    Serial.printf("%-28s", Metrics::getName(metric));
+    for (uint8_t bucket = 0; bucket < METRIC_BUCKET_COUNT; bucket++) {
+      uint32_t bound = Metrics::getBucketBound(metric, bucket);
+      if (bound == UINT32_MAX) {
+        Serial.printf("  rest: %u", Metrics::getBucketCount(metric, bucket));
+      } else {
+        Serial.printf("  <%u: %u", bound, Metrics::getBucketCount(metric, bucket));
+      }
+    }
+    Serial.println();
+  }
+}
+
+// Prints the current power mode, and the share of the uptime spent
+// in each mode and with the CPU running tasks
+void dumpPower() {
+  if (!power) {
+    Serial.println("power: not running");
+    return;
+  }
+  const char * modeNames[POWER_MODE_COUNT] = { "awake", "modem sleep", "light sleep" };
+  float uptime = millis();
+  Serial.printf("mode: %s\n", modeNames[power->getMode()]);
+  for (uint8_t mode = 0; mode < POWER_MODE_COUNT; mode++) {
+    Serial.printf("%-12s %5.1f%%\n", modeNames[mode], 100 * power->getModeMillis((PowerMode) mode) / uptime);
+  }
+  Serial.printf("%-12s %5.1f%%\n", "cpu busy", 100 * power->getAwakeMillis() / uptime);
+}
+
+// Prints the reset reason, how much state survived it, and how
+// long the controller took to start acting on valid readings
+void dumpBoot() {
+  WarmBoot * warmBoot = state->getWarmBoot();
+  Serial.printf("reset reason: %u\n", ESP.getResetInfoPtr()->reason);
+  Serial.printf("warm boot: %s\n", warmBoot->isRecent() ? "yes" : warmBoot->isRestored() ? "stale" : "no");
+  if (warmBoot->isRestored()) Serial.printf("downtime: %u ms\n", warmBoot->getDowntime());
+  if (state->getMillisToControlStart()) {
+    Serial.printf("time to control: %u ms\n", state->getMillisToControlStart());
+  } else {
+    Serial.println("time to control: not yet");
+  }
+}
+
+// Prints the disciplined time, how far from the server's it may be,
+// and the estimated drift of the crystal
+void dumpClock() {
+  ClockDiscipline * clock = state->getClockDiscipline();
+  if (!clock->isSynchronized()) {
+    Serial.println("clock: not synchronized");
+    return;
+  }
+  uint32_t localMillis = millis();
+  Serial.printf("clock: %u.%03u, now() %lu\n", clock->getUnixTime(localMillis), clock->getMillisIntoSecond(localMillis), now());
+  Serial.printf("error bound: %u ms\n", clock->getErrorBound(localMillis));
+  Serial.printf("drift: %.1f +/- %.1f ppm over %u samples\n", clock->getDrift() * 1e6, clock->getDriftUncertainty() * 1e6, clock->getSampleCount());
+}
+
+// Prints the heap and the loop's stack now, and their low-water
+// marks since the last report and since boot
+void dumpMemory() {
+  if (!memory) {
+    Serial.println("memory: not monitored");
+    return;
+  }
+  const MemoryLowWater * marks[2] = { memory->getPeriodLowWater(), memory->getBootLowWater() };
+  Serial.printf("%-10s %10s %10s %6s %10s\n", "", "free heap", "max block", "frag", "free stack");
+  Serial.printf("%-10s %10u %10u %5u%% %10u\n", "now", ESP.getFreeHeap(), ESP.getMaxFreeBlockSize(), ESP.getHeapFragmentation(), ESP.getFreeContStack());
+  for (uint8_t i = 0; i < 2; i++) {
+    if (marks[i]->sampleCount == 0) continue;
+    Serial.printf("%-10s %10u %10u %5u%% %10u\n", i == 0 ? "this hour" : "since boot", marks[i]->freeHeap, marks[i]->maxFreeBlock, marks[i]->fragmentation, marks[i]->freeStack);
+  }
+}
+
+void dumpCrash() {
+  CrashDump * crashDump = state->getCrashDump();
+  if (crashDump->getSize() == 0) {
+    Serial.println("crash: no dump");
+    return;
+  }
+  const CrashDumpHeader * header = crashDump->getHeader();
+  Serial.printf("crash: dump %u, %u bytes, %s\n", header->dumpID, header->size, crashDump->isPending() ? "pending upload" : "uploaded");
+  Serial.printf("reason:%u exccause:%u epc1:0x%08x excvaddr:0x%08x at %u ms, unix time %u\n", header->reason, header->exccause, header->epc1, header->excvaddr, header->uptimeMillis, header->unixTime);
+  Serial.printf("stack: %u bytes from 0x%08x; %u profiler runs, active slots 0x%02x; %u errors\n", header->stackSize, header->stackPointer, header->profilerCount, header->activeSlots, header->recordCount);
+}
+
+// While streaming is on, writes the binary log's records to Serial
+// as hex words, as many as the transmit FIFO has room for, for
+// scripts/decode_log.py to format. Dormant otherwise, so as not to
+// keep the CPU awake.
+void drainLog(void * context) {
+  if (!logStreaming) return;
+  scheduler.wakeIn(logTask, LOG_TASK_INTERVAL);
+  uint32_t record[BINARY_LOG_RECORD_LIMIT];
+  char line[LOG_LINE_LIMIT];
+  while (BinaryLog::getSize() > 0 && Serial.availableForWrite() >= LOG_LINE_LIMIT) {
+    size_t size = BinaryLog::read(record);
+    size_t length = sprintf(line, "#L");
+    for (size_t i = 0; i < size; i++) length += sprintf(&line[length], " %08x", record[i]);
+    line[length++] = '\n';
+    Serial.write((const uint8_t *) line, length);
+  }
+}
+
+// Turns streaming the binary log on or off, listing the scheduler's
+// tasks, which overrun records name by number
+void toggleLog() {
+  logStreaming = !logStreaming;
+  Serial.printf("log: streaming %s, %u records dropped\n", logStreaming ? "on" : "off", BinaryLog::getDropCount());
+  if (!logStreaming) return;
+  scheduler.wake(logTask);
+  for (TaskID task = 0; task < (TaskID) scheduler.getTaskCount(); task++) {
+    Serial.printf("log: task %d is %s\n", task, scheduler.getName(task));
+  }
+}
+
+// Reads newline-terminated commands from Serial: "profiler" dumps
+// the profiler's histograms, "power" the power manager's counters,
+// "boot" the boot timing, "clock" the clock discipline, "memory" the
+// memory monitor's low-water marks, "metrics" the metrics, "crash"
+// the stored crash dump; "log" turns streaming the binary log on or off
+void console(void * context) {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\r') continue;
+    if (c != '\n') {
+      if (consoleLineLength < CONSOLE_LINE_LIMIT - 1) consoleLine[consoleLineLength++] = c;
+      continue;
+    }
+    consoleLine[consoleLineLength] = '\0';
+    consoleLineLength = 0;
+    if (strcmp(consoleLine, "profiler") == 0) {
+      dumpProfiler();
+    } else if (strcmp(consoleLine, "power") == 0) {
+      dumpPower();
+    } else if (strcmp(consoleLine, "boot") == 0) {
+      dumpBoot();
+    } else if (strcmp(consoleLine, "clock") == 0) {
+      dumpClock();
+    } else if (strcmp(consoleLine, "memory") == 0) {
+      dumpMemory();
+    } else if (strcmp(consoleLine, "metrics") == 0) {
+      dumpMetrics();
+    } else if (strcmp(consoleLine, "crash") == 0) {
+      dumpCrash();
+    } else if (strcmp(consoleLine, "log") == 0) {
+      toggleLog();
+    } else if (consoleLine[0] != '\0') {
+      Serial.printf("Unknown command: %s\n", consoleLine);
+    }
+  }
+}
+
+// With no usable configuration image, there is nothing to control
+// with or report to: holds the heater and chiller off, blinks the
+// fault on the indicators and serves the console until the device
+// is initialized, since restarting would only find the same image
+void failSafe() {
+  PipsqueakConfig * config = state->getConfig();
+  pinMode(config->getSignalEnablePin(), OUTPUT);
+  digitalWrite(config->getSignalEnablePin(), LOW);
+  pinMode(config->getHeaterPin(), OUTPUT);
+  digitalWrite(config->getHeaterPin(), LOW);
+  pinMode(config->getChillerPin(), OUTPUT);
+  digitalWrite(config->getChillerPin(), LOW);
+  Serial.printf("\nConfiguration image unusable (status %u): run the initializer\n", config->getImageStatus());
+
+  indicators = new (indicatorsStorage) PipsqueakIndicators(state);
+  indicators->setup();
+  indicators->schedule(&scheduler);
+  scheduler.every("console", CONSOLE_TASK_INTERVAL, console, NULL);
+  logTask = scheduler.once("log", drainLog, NULL);
+}
 
 void setup() {
   Serial.begin(57600);
-  delay(1000);
-  Serial.println();
 
-  state = new PipsqueakState();
+  state = new (stateStorage) PipsqueakState();
   state->setup();
+  if (!state->getConfig()->isUsable()) {
+    failSafe();
+    return;
+  }
+
+  // A monitor samples upon waking, then goes back to sleep unless
+  // it's time to report its batch
+  if (state->getConfig()->isMonitorModeEnabled()) {
+    monitor = new (monitorStorage) PipsqueakMonitor(state);
+    monitor->setup();
+    if (!monitor->isFlushDue()) monitor->sleep();
+  }
+
+  // Gives a serial monitor time to attach, except after a soft
+  // reset, when control resumes at once
+  if (!state->getWarmBoot()->isRestored()) delay(1000);
+  Serial.println();
 
-  hmac = new Hmac(state->getConfig()->getSecretKey());
+  hmac = new (hmacStorage) Hmac(state->getConfig()->getSecretKey());
 
-  client = new PipsqueakClient(state, hmac);
+  client = new (clientStorage) PipsqueakClient(state, hmac);
   client->setup();
 
-  indicators = new PipsqueakIndicators(state);
+  indicators = new (indicatorsStorage) PipsqueakIndicators(state);
   indicators->setup();
 
-  sensors = new PipsqueakSensors(state);
-  sensors->setup();
+  if (!monitor) {
+    sensors = new (sensorsStorage) PipsqueakSensors(state);
+    sensors->setup();
+
+    controller = new (controllerStorage) PipsqueakController(state);
+    controller->setup();
+
+    // Enables powering up the control pins
+    pinMode(state->getConfig()->getSignalEnablePin(), OUTPUT);
+    digitalWrite(state->getConfig()->getSignalEnablePin(), HIGH);
+  }
+
+  power = new (powerStorage) PowerManager(state);
+  memory = new (memoryStorage) MemoryMonitor(state);
+
+  state->schedule(&scheduler);
+  client->schedule(&scheduler);
+  indicators->schedule(&scheduler);
+  if (monitor) {
+    monitor->schedule(&scheduler);
+  } else {
+    sensors->schedule(&scheduler);
+    controller->schedule(&scheduler);
+  }
+  scheduler.every("console", CONSOLE_TASK_INTERVAL, console, NULL);
+  logTask = scheduler.once("log", drainLog, NULL);
+  memory->schedule(&scheduler);
+  power->schedule(&scheduler);
 
-  controller = new PipsqueakController(state);
-  controller->setup();
+  // Reports each task's first overrun; the counts accumulate in the scheduler
+  scheduler.onOverrun([](TaskID task, void * context) {
+    if (scheduler.getOverrunCount(task) == 1) {
+      state->recordError(ErrorType::Pipsqueak, SCHEDULER_OVERRUN_ERROR);
+    }
+  }, NULL);
 
-  // Enables powering up the control pins
-  pinMode(state->getConfig()->getSignalEnablePin(), OUTPUT);
-  digitalWrite(state->getConfig()->getSignalEnablePin(), HIGH);
+  #ifdef TRAP_HEAP_ALLOCATIONS
+  heapTrapArmed = true;
+  #endif
 }
 
 void loop() {
-  state->loop();
-  client->loop();
-  indicators->loop();
-  sensors->loop();
-  controller->loop();
+  scheduler.loop();
 }
@@ -0,0 +1,90 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <BinaryLog.h>
+
+void test_empty() {
+  uint32_t record[BINARY_LOG_RECORD_LIMIT];
+  BinaryLog::reset();
+  TEST_ASSERT_EQUAL(0, BinaryLog::getSize());
+  TEST_ASSERT_EQUAL(0, BinaryLog::read(record));
+  TEST_ASSERT_EQUAL(0, BinaryLog::getDropCount());
+}
+
+void test_records() {
+  uint32_t record[BINARY_LOG_RECORD_LIMIT];
+  float setpoint = 18.5;
+  uint32_t setpointBits;
+  memcpy(&setpointBits, &setpoint, 4);
+
+  BinaryLog::reset();
+  BinaryLog::write(LOG_CONTROLLER_STOPPED);
+  BinaryLog::write(LOG_STATE_SETPOINT, 20.0f, setpoint);
+  BinaryLog::write(LOG_STATE_ERROR, (int8_t) -3, true);
+  TEST_ASSERT_EQUAL(10, BinaryLog::getSize());
+
+  TEST_ASSERT_EQUAL(2, BinaryLog::read(record));
+  TEST_ASSERT_EQUAL_HEX32((uint32_t) LOG_CONTROLLER_STOPPED << 16, record[0]);
+  TEST_ASSERT_EQUAL(millis(), record[1]);
+
+  // Floats as their bits
+  TEST_ASSERT_EQUAL(4, BinaryLog::read(record));
+  TEST_ASSERT_EQUAL_HEX32((uint32_t) LOG_STATE_SETPOINT << 16 | 2 << 8, record[0]);
+  TEST_ASSERT_EQUAL_HEX32(0x41A00000, record[2]);
+  TEST_ASSERT_EQUAL_HEX32(setpointBits, record[3]);
+
+  // Signed integers sign-extended
+  TEST_ASSERT_EQUAL(4, BinaryLog::read(record));
+  TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFD, record[2]);
+  TEST_ASSERT_EQUAL(1, record[3]);
+
+  TEST_ASSERT_EQUAL(0, BinaryLog::getSize());
+  TEST_ASSERT_EQUAL(0, BinaryLog::read(record));
+}
+
+void test_drops_oldest() {
+  uint32_t record[BINARY_LOG_RECORD_LIMIT];
+  BinaryLog::reset();
+
+  // Records of four words wrap around the ring, dropping the oldest
+  uint32_t count = BINARY_LOG_RING_WORDS / 4 + 3;
+  for (uint32_t i = 0; i < count; i++) BinaryLog::write(LOG_SENSORS_RESTORED, i, 0);
+  TEST_ASSERT_EQUAL(BINARY_LOG_RING_WORDS, BinaryLog::getSize());
+  TEST_ASSERT_EQUAL(3, BinaryLog::getDropCount());
+
+  // The oldest left counts those dropped before it
+  TEST_ASSERT_EQUAL(4, BinaryLog::read(record));
+  TEST_ASSERT_EQUAL(3, record[0] & 0xFF);
+  TEST_ASSERT_EQUAL(3, record[2]);
+  for (uint32_t i = 4; i < count; i++) {
+    TEST_ASSERT_EQUAL(4, BinaryLog::read(record));
+    TEST_ASSERT_EQUAL(0, record[0] & 0xFF);
+    TEST_ASSERT_EQUAL(i, record[2]);
+  }
+  TEST_ASSERT_EQUAL(0, BinaryLog::getSize());
+
+  // Records of mixed sizes make room for a larger one
+  for (uint32_t i = 0; i < BINARY_LOG_RING_WORDS / 2; i++) BinaryLog::write(LOG_CONTROLLER_STOPPED);
+  BinaryLog::write(LOG_CLIENT_CONNECTING, 10, 0, 0, 1, 3000);
+  TEST_ASSERT_EQUAL(BINARY_LOG_RING_WORDS - 1, BinaryLog::getSize());
+  TEST_ASSERT_EQUAL(7, BinaryLog::getDropCount());
+  TEST_ASSERT_EQUAL(2, BinaryLog::read(record));
+  TEST_ASSERT_EQUAL(4, record[0] & 0xFF);
+
+  BinaryLog::reset();
+  TEST_ASSERT_EQUAL(0, BinaryLog::getSize());
+  TEST_ASSERT_EQUAL(0, BinaryLog::getDropCount());
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_empty);
+  RUN_TEST(test_records);
+  RUN_TEST(test_drops_oldest);
+  UNITY_END();
+}
@@ -0,0 +1,249 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <ArduinoNative.h>
+#include <NativeAsyncTCP.h>
+#include <NativeWiFi.h>
+#include <ReferenceServer.h>
+#include <DeviceFixture.h>
+#include <TimeLib.h>
+
+// Runs PipsqueakState and PipsqueakClient, as main.cpp wires them,
+// against ReferenceServer over the simulated network in
+// NativeAsyncTCP.h, and measures how a backlog of status events
+// drains under each scenario's faults. Prints one line of JSON per
+// scenario to Serial (stdout); the lines are also appended to the
+// file named by $SIMULATION_OUTPUT, if set.
+//
+//   pio test -e native -f client_network
+//
+// Time is virtual and every fault is drawn from a seeded generator,
+// so a scenario plays out the same way on every run; an hour of
+// network trouble takes a few seconds.
+
+#define DEVICE_ID 127
+#define SERVER_TIME 1600000000
+#define SIMULATION_SEED 2463534242
+#define ASSOCIATION_MILLIS 2000 // ms
+// Long enough for the clock to sync and the state's initialization
+// window to close, so that the backlog drains from a steady state
+#define SETTLE_MILLIS 20000 // ms
+#define BACKLOG_EVENTS 512
+#define DRAIN_LIMIT 3600000 // ms
+#define PHASE_LIMIT 4
+#define JSON_BUFFER_SIZE 1024
+
+/**
+ * From atMillis after the backlog is queued, the network runs under
+ * these conditions, the access point is in range or not, and the
+ * server rate limits each device to a request every rateLimit ms.
+ */
+struct Phase {
+  uint32_t atMillis;
+  NativeAsyncTCP::Conditions conditions;
+  bool wifi;
+  uint32_t rateLimit;
+};
+
+struct Scenario {
+  const char * name;
+  uint8_t phaseCount;
+  Phase phases[PHASE_LIMIT];
+};
+
+struct ScenarioResult {
+  bool drained;
+  uint32_t drainMillis;
+  uint32_t delivered;        // backlog events the server accepted
+  uint32_t dropped;          // backlog events lost on the device
+  uint32_t connects;
+  uint32_t responses;
+  uint32_t rejections;
+  uint32_t errorEvents;
+  uint32_t retransmits;
+  uint32_t timeouts;
+  uint32_t aborts;
+};
+
+// Network conditions: handshake, latency and jitter (ms), loss and
+// half-open connections (%), and whether the server refuses them
+#define CLEAN_NETWORK { 40, 20, 0, 0, 0, false }
+#define SLOW_NETWORK { 400, 300, 500, 0, 0, false }
+#define LOSSY_NETWORK { 40, 20, 10, 10, 0, false }
+#define STALE_NETWORK { 40, 20, 0, 0, 100, false }
+#define REFUSED_NETWORK { 40, 20, 0, 0, 0, true }
+
+static const Scenario scenarios[] = {
+  { "clean", 1, { { 0, CLEAN_NETWORK, true, 0 } } },
+  { "slow", 1, { { 0, SLOW_NETWORK, true, 0 } } },
+  { "lossy", 1, { { 0, LOSSY_NETWORK, true, 0 } } },
+  { "half_open", 2, { { 0, STALE_NETWORK, true, 0 }, { 60000, CLEAN_NETWORK, true, 0 } } },
+  { "rate_limited", 1, { { 0, CLEAN_NETWORK, true, 2000 } } },
+  { "server_outage", 2, { { 0, REFUSED_NETWORK, true, 0 }, { 60000, CLEAN_NETWORK, true, 0 } } },
+  { "wifi_outage", 2, { { 0, CLEAN_NETWORK, false, 0 }, { 60000, CLEAN_NETWORK, true, 0 } } },
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+static ScenarioResult results[SCENARIO_COUNT];
+static ReferenceServer * server;
+static PipsqueakDevice device;
+
+// Powers up a freshly provisioned device on a clean network
+static void boot() {
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  ArduinoNative::eraseFlash();
+  NativeAsyncTCP::reset();
+  NativeAsyncTCP::seed(SIMULATION_SEED);
+  NativeWiFi::setAvailable(true);
+  NativeWiFi::setAssociationMillis(ASSOCIATION_MILLIS);
+
+  server = new ReferenceServer(SERVER_TIME);
+  server->registerDevice(DEVICE_ID, (const byte *) DEVICE_FIXTURE_SECRET_KEY);
+  NativeAsyncTCP::setServer(server);
+  DeviceFixture::boot(&device, DEVICE_ID);
+}
+
+static void shutDown() {
+  NativeAsyncTCP::setServer(NULL);
+  DeviceFixture::shutDown(&device);
+  delete server;
+}
+
+static bool isDrained() {
+  return !device.state->hasStatusEvents() && !device.client->getTelemetryRequest()->isPopulated();
+}
+
+static void runFor(uint32_t durationMillis) {
+  uint32_t start = millis();
+  while (millis() - start < durationMillis) device.scheduler->loop();
+}
+
+static void run(const Scenario * scenario, ScenarioResult * result) {
+  boot();
+  runFor(SETTLE_MILLIS);
+  TEST_ASSERT_TRUE_MESSAGE(device.state->isClockSynchronized(), scenario->name);
+  TEST_ASSERT_TRUE_MESSAGE(isDrained(), scenario->name);
+
+  uint32_t temperatureEvents = server->getEventCount(STATUS_EVENT_TYPE_TEMPERATURE);
+  uint32_t errorEvents = server->getEventCount(STATUS_EVENT_TYPE_ERROR);
+  uint32_t rejections = server->getRejectionCount();
+  uint32_t connects = NativeAsyncTCP::getConnectCount();
+  uint32_t responses = NativeAsyncTCP::getResponseCount();
+  uint32_t retransmits = NativeAsyncTCP::getRetransmitCount();
+  uint32_t timeouts = NativeAsyncTCP::getTimeoutCount();
+  uint32_t aborts = NativeAsyncTCP::getAbortCount();
+
+  for (uint32_t i = 0; i < BACKLOG_EVENTS; i++) {
+    device.state->recordTemperatureObservation(now() - BACKLOG_EVENTS + i, 18.5 + i * 0.0625);
+  }
+
+  uint32_t start = millis();
+  uint8_t phase = 0;
+  result->drained = false;
+  while (millis() - start < DRAIN_LIMIT) {
+    while (phase < scenario->phaseCount && millis() - start >= scenario->phases[phase].atMillis) {
+      NativeAsyncTCP::setConditions(scenario->phases[phase].conditions);
+      NativeWiFi::setAvailable(scenario->phases[phase].wifi);
+      server->setRateLimit(scenario->phases[phase].rateLimit);
+      phase += 1;
+    }
+    device.scheduler->loop();
+    if (phase == scenario->phaseCount && isDrained()) {
+      result->drained = true;
+      break;
+    }
+  }
+
+  result->drainMillis = millis() - start;
+  result->delivered = server->getEventCount(STATUS_EVENT_TYPE_TEMPERATURE) - temperatureEvents;
+  result->dropped = BACKLOG_EVENTS - result->delivered;
+  result->errorEvents = server->getEventCount(STATUS_EVENT_TYPE_ERROR) - errorEvents;
+  result->rejections = server->getRejectionCount() - rejections;
+  result->connects = NativeAsyncTCP::getConnectCount() - connects;
+  result->responses = NativeAsyncTCP::getResponseCount() - responses;
+  result->retransmits = NativeAsyncTCP::getRetransmitCount() - retransmits;
+  result->timeouts = NativeAsyncTCP::getTimeoutCount() - timeouts;
+  result->aborts = NativeAsyncTCP::getAbortCount() - aborts;
+  shutDown();
+}
+
+// Output /////////////////////////////////////////////////////////////////////////////////////////
+
+// Error events are what recordErrors() adds for each failed request;
+// amplification is how many the backlog cost per event delivered
+static size_t writeJson(char * buffer, size_t size, const char * name, const ScenarioResult * result) {
+  float seconds = result->drainMillis / 1000.0;
+  return snprintf(buffer, size,
+    "{\"suite\":\"client_network\",\"scenario\":\"%s\",\"seed\":%u,\"backlog\":%u,\"drained\":%s,"
+    "\"drainMillis\":%u,\"delivered\":%u,\"dropped\":%u,\"eventsPerSecond\":%.1f,"
+    "\"requests\":%u,\"responses\":%u,\"requestsPerEvent\":%.3f,\"rejections\":%u,"
+    "\"errorEvents\":%u,\"amplification\":%.3f,\"retransmits\":%u,\"timeouts\":%u,\"aborts\":%u}",
+    name, (unsigned) SIMULATION_SEED, (unsigned) BACKLOG_EVENTS, result->drained ? "true" : "false",
+    (unsigned) result->drainMillis, (unsigned) result->delivered, (unsigned) result->dropped,
+    seconds > 0 ? result->delivered / seconds : 0,
+    (unsigned) result->connects, (unsigned) result->responses,
+    result->delivered > 0 ? (float) result->connects / result->delivered : 0,
+    (unsigned) result->rejections, (unsigned) result->errorEvents,
+    result->delivered > 0 ? (float) result->errorEvents / result->delivered : 0,
+    (unsigned) result->retransmits, (unsigned) result->timeouts, (unsigned) result->aborts);
+}
+
+static void report() {
+  static char json[JSON_BUFFER_SIZE];
+  const char * path = getenv("SIMULATION_OUTPUT");
+  FILE * file = NULL;
+  if (path != NULL) {
+    file = fopen(path, "w");
+    TEST_ASSERT_NOT_NULL(file);
+  }
+  for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+    size_t length = writeJson(json, sizeof(json), scenarios[i].name, &results[i]);
+    TEST_ASSERT_TRUE(length < sizeof(json));
+    Serial.println(json);
+    if (file != NULL) fprintf(file, "%s\n", json);
+  }
+  if (file != NULL) fclose(file);
+}
+
+// Tests //////////////////////////////////////////////////////////////////////////////////////////
+
+void test_scenarios() {
+  for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+    run(&scenarios[i], &results[i]);
+  }
+}
+
+void test_clean_network_drains_without_errors() {
+  ScenarioResult * result = &results[0];
+  TEST_ASSERT_TRUE(result->drained);
+  TEST_ASSERT_EQUAL(0, result->dropped);
+  TEST_ASSERT_EQUAL(0, result->errorEvents);
+  TEST_ASSERT_EQUAL(0, result->rejections);
+  TEST_ASSERT_EQUAL(0, result->aborts);
+  // Every request carries a full batch, bar the last
+  uint32_t batches = (BACKLOG_EVENTS + TELEMETRY_REQUEST_EVENT_COUNT_LIMIT - 1) / TELEMETRY_REQUEST_EVENT_COUNT_LIMIT;
+  TEST_ASSERT_EQUAL(batches, result->connects);
+}
+
+void test_every_scenario_drains() {
+  for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+    TEST_ASSERT_TRUE_MESSAGE(results[i].drained, scenarios[i].name);
+    TEST_ASSERT_EQUAL_MESSAGE(0, results[i].dropped, scenarios[i].name);
+  }
+}
+
+void test_report() {
+  report();
+}
+
+void setup() {
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_scenarios);
+  RUN_TEST(test_clean_network_drains_without_errors);
+  RUN_TEST(test_every_scenario_drains);
+  RUN_TEST(test_report);
+  UNITY_END();
+}
@@ -0,0 +1,145 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <ClockDiscipline.h>
+
+#define SERVER_EPOCH 1700000000437LL // ms, deliberately not on a second boundary
+
+// A server whose clock runs drift faster than millis(), answering
+// after a round trip of 40-120 ms, stamped part way through it.
+// Requests go out up to a second late, as they do on the device.
+struct SimulatedServer {
+  float drift;
+  int64_t jump;
+  uint32_t seed;
+
+  int64_t getTimeMillis(uint32_t localMillis, uint32_t startMillis) {
+    uint32_t elapsed = localMillis - startMillis;
+    return SERVER_EPOCH + jump + elapsed + (int64_t) (elapsed * (double) drift);
+  }
+
+  uint32_t random(uint32_t limit) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % limit;
+  }
+
+  ClockSampleResult sync(ClockDiscipline * clock, uint32_t sentMillis, uint32_t startMillis) {
+    sentMillis += random(1000);
+    uint32_t roundTrip = 40 + random(80);
+    uint32_t stampMillis = sentMillis + random(roundTrip);
+    uint32_t serverTime = (uint32_t) (getTimeMillis(stampMillis, startMillis) / 1000);
+    return clock->addSample(serverTime, sentMillis, sentMillis + roundTrip);
+  }
+};
+
+static int64_t absolute(int64_t value) {
+  return value < 0 ? -value : value;
+}
+
+void test_first_sample_steps() {
+  ClockDiscipline clock;
+  TEST_ASSERT_FALSE(clock.isSynchronized());
+  TEST_ASSERT_TRUE(clock.isSyncDue(0));
+
+  TEST_ASSERT_EQUAL(CLOCK_SAMPLE_STEPPED, clock.addSample(1700000000, 5000, 5100));
+  TEST_ASSERT_TRUE(clock.isSynchronized());
+  // Midway through the second the server reported, as of the midpoint of the round trip
+  TEST_ASSERT_EQUAL(1700000000, clock.getUnixTime(5100));
+  TEST_ASSERT_EQUAL(549, clock.getMillisIntoSecond(5100));
+  TEST_ASSERT_EQUAL(551, clock.getErrorBound(5100));
+  TEST_ASSERT_FALSE(clock.isSyncDue(5100));
+}
+
+void test_slow_round_trip_rejected() {
+  ClockDiscipline clock;
+  TEST_ASSERT_EQUAL(CLOCK_SAMPLE_REJECTED, clock.addSample(1700000000, 5000, 5000 + CLOCK_MAX_ROUND_TRIP + 1));
+  TEST_ASSERT_FALSE(clock.isSynchronized());
+}
+
+void test_offset_and_drift_converge() {
+  ClockDiscipline clock;
+  SimulatedServer server = { 30e-6, 0, 1 };
+  // Across the millis() rollover, too
+  uint32_t start = 0xFFF00000;
+  int64_t previous = 0;
+  for (uint32_t minute = 0; minute < 12 * 60; minute++) {
+    uint32_t sent = start + minute * 60000;
+    ClockSampleResult result = server.sync(&clock, sent, start);
+    TEST_ASSERT_NOT_EQUAL(CLOCK_SAMPLE_REJECTED, result);
+    if (minute > 0) {
+      TEST_ASSERT_EQUAL(CLOCK_SAMPLE_SLEWED, result);
+      // Slewed, never stepped, at no more than CLOCK_SLEW_RATE
+      int64_t elapsed = clock.getTimeMillis(sent + 1200) - previous;
+      TEST_ASSERT_TRUE(elapsed >= 60000 * (1 - CLOCK_MAX_DRIFT - CLOCK_SLEW_RATE) - 1);
+      TEST_ASSERT_TRUE(elapsed <= 60000 * (1 + CLOCK_MAX_DRIFT + CLOCK_SLEW_RATE) + 1);
+    }
+    previous = clock.getTimeMillis(sent + 1200);
+  }
+
+  uint32_t last = start + (12 * 60 - 1) * 60000 + 1200;
+  int64_t error = absolute(clock.getTimeMillis(last) - server.getTimeMillis(last, start));
+  TEST_ASSERT_TRUE(error < 100);
+  TEST_ASSERT_TRUE(error <= clock.getErrorBound(last));
+  TEST_ASSERT_FLOAT_WITHIN(10e-6, 30e-6, clock.getDrift());
+  TEST_ASSERT_TRUE(clock.getDriftUncertainty() < 20e-6);
+  TEST_ASSERT_EQUAL(CLOCK_SAMPLE_COUNT, clock.getSampleCount());
+}
+
+void test_syncs_fall_due_hours_apart() {
+  ClockDiscipline clock;
+  SimulatedServer server = { -45e-6, 0, 7 };
+  uint32_t sent = 1000;
+  server.sync(&clock, sent, 0);
+  // With only the one sample, the drift could be anything up to CLOCK_MAX_DRIFT
+  uint32_t due = sent + 2000;
+  while (!clock.isSyncDue(due)) due += 1000;
+  TEST_ASSERT_TRUE(due - sent < 3600000);
+
+  // Sync whenever due, as the client does
+  for (size_t i = 0; i < 40; i++) {
+    sent = due;
+    server.sync(&clock, sent, 0);
+    due += 2000;
+    while (!clock.isSyncDue(due)) due += 1000;
+    int64_t error = absolute(clock.getTimeMillis(due) - server.getTimeMillis(due, 0));
+    TEST_ASSERT_TRUE(error <= CLOCK_ERROR_LIMIT);
+  }
+  TEST_ASSERT_TRUE(due - sent > 4 * 3600000);
+}
+
+void test_server_jump_steps() {
+  ClockDiscipline clock;
+  SimulatedServer server = { 0, 0, 3 };
+  for (uint32_t minute = 0; minute < 120; minute++) server.sync(&clock, minute * 60000, 0);
+
+  server.jump = 10000;
+  uint32_t sent = 120 * 60000;
+  TEST_ASSERT_EQUAL(CLOCK_SAMPLE_STEPPED, server.sync(&clock, sent, 0));
+  TEST_ASSERT_EQUAL(1, clock.getSampleCount());
+  TEST_ASSERT_TRUE(absolute(clock.getTimeMillis(sent + 1200) - server.getTimeMillis(sent + 1200, 0)) < 700);
+}
+
+void test_reset() {
+  ClockDiscipline clock;
+  clock.addSample(1700000000, 5000, 5100);
+  clock.reset();
+  TEST_ASSERT_FALSE(clock.isSynchronized());
+  TEST_ASSERT_EQUAL(0, clock.getSampleCount());
+  TEST_ASSERT_EQUAL(CLOCK_SAMPLE_STEPPED, clock.addSample(1700000100, 9000, 9100));
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_first_sample_steps);
+  RUN_TEST(test_slow_round_trip_rejected);
+  RUN_TEST(test_offset_and_drift_converge);
+  RUN_TEST(test_syncs_fall_due_hours_apart);
+  RUN_TEST(test_server_jump_steps);
+  RUN_TEST(test_reset);
+  UNITY_END();
+}
@@ -0,0 +1,179 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <ConfigImage.h>
+
+static uint8_t raw[CONFIG_IMAGE_SIZE];
+static ConfigImage image;
+
+static const uint8_t boardAddress[CONFIG_IMAGE_ADDRESS_SIZE] = { 0x28, 1, 2, 3, 4, 5, 6, 7 };
+
+void writeImage() {
+  memset(&image, 0, sizeof(image));
+  image.flags = CONFIG_FLAG_BOARD_SENSOR | CONFIG_FLAG_PID_CONTROL;
+  image.writeCount = 3;
+  image.deviceID = 42;
+  image.setpoint = 18.5;
+  image.hostPort = 9001;
+  strcpy(image.wifiSSID, "ssid");
+  strcpy(image.wifiPassword, "password");
+  image.heaterPin = 15;
+  image.chillerPin = 14;
+  memcpy(image.boardSensorAddress, boardAddress, sizeof(boardAddress));
+  ConfigImageFormat::seal(&image);
+  memset(raw, 0, sizeof(raw));
+  memcpy(raw, &image, sizeof(image));
+}
+
+// As the version 3 initializer wrote it
+void writeV3Image(uint8_t heaterPinCount) {
+  memset(raw, 0, sizeof(raw));
+  raw[0] = CONFIG_IMAGE_MARKER;
+  raw[1] = 3;
+  raw[2] = CONFIG_FLAG_BOARD_SENSOR;
+  uint32_t writeCount = 2;
+  uint32_t deviceID = 42;
+  float setpoint = 18.5;
+  uint16_t hostPort = 9001;
+  memcpy(&raw[4], &writeCount, 4);
+  memcpy(&raw[8], &deviceID, 4);
+  memcpy(&raw[12], &setpoint, 4);
+  raw[16] = 10;
+  raw[19] = 1;
+  memcpy(&raw[20], &hostPort, 2);
+  strcpy((char *) &raw[22], "ssid");
+  strcpy((char *) &raw[54], "password");
+  raw[150] = 5;
+  memcpy(&raw[152], boardAddress, sizeof(boardAddress));
+  raw[160] = 4;
+  raw[169] = 13;
+  raw[170] = 12;
+  raw[171] = heaterPinCount;
+  for (uint8_t i = 0; i < heaterPinCount; i++) raw[172 + i] = 15 + i;
+  raw[172 + heaterPinCount] = 1;
+  raw[173 + heaterPinCount] = 14;
+  float proportionalGain = 2.5;
+  uint32_t controlPeriod = 30000;
+  memcpy(&raw[192], &proportionalGain, 4);
+  memcpy(&raw[204], &controlPeriod, 4);
+}
+
+void test_crc32() {
+  // The standard check value, whole and carried on in two parts
+  const char * check = "123456789";
+  TEST_ASSERT_EQUAL_HEX32(0xCBF43926, ConfigImageFormat::crc32(check, 9));
+  TEST_ASSERT_EQUAL_HEX32(0xCBF43926, ConfigImageFormat::crc32(&check[4], 5, ConfigImageFormat::crc32(check, 4)));
+}
+
+void test_round_trip() {
+  writeImage();
+  ConfigImage parsed;
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_VALID, ConfigImageFormat::parse(raw, &parsed));
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_VERSION, parsed.version);
+  TEST_ASSERT_EQUAL(sizeof(ConfigImage), parsed.size);
+  TEST_ASSERT_EQUAL(42, parsed.deviceID);
+  TEST_ASSERT_EQUAL_FLOAT(18.5, parsed.setpoint);
+  TEST_ASSERT_EQUAL_STRING("password", parsed.wifiPassword);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(boardAddress, parsed.boardSensorAddress, sizeof(boardAddress));
+  TEST_ASSERT_EQUAL_MEMORY(&image, &parsed, sizeof(image));
+}
+
+void test_blank() {
+  ConfigImage parsed;
+  memset(raw, 0, sizeof(raw));
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_BLANK, ConfigImageFormat::parse(raw, &parsed));
+  memset(raw, 0xFF, sizeof(raw));
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_BLANK, ConfigImageFormat::parse(raw, &parsed));
+}
+
+void test_corrupt() {
+  ConfigImage parsed;
+  writeImage();
+  raw[offsetof(ConfigImage, setpoint)] ^= 0x01;
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_CORRUPT, ConfigImageFormat::parse(raw, &parsed));
+  TEST_ASSERT_EQUAL(0, parsed.deviceID);
+
+  writeImage();
+  uint16_t size = CONFIG_IMAGE_SIZE + 1;
+  memcpy(&raw[2], &size, 2);
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_CORRUPT, ConfigImageFormat::parse(raw, &parsed));
+}
+
+void test_unsupported() {
+  ConfigImage parsed;
+  writeImage();
+  raw[1] = 2;
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_UNSUPPORTED, ConfigImageFormat::parse(raw, &parsed));
+}
+
+void test_newer_version_read_as_prefix() {
+  // A future version appends a field, growing the image
+  writeImage();
+  uint16_t size = sizeof(ConfigImage) + 4;
+  uint32_t appended = 0xCAFEF00D;
+  memcpy(&raw[sizeof(ConfigImage)], &appended, 4);
+  raw[1] = CONFIG_IMAGE_VERSION + 1;
+  memcpy(&raw[2], &size, 2);
+  uint32_t crc = ConfigImageFormat::crc32(&raw[CONFIG_IMAGE_HEADER_SIZE], size - CONFIG_IMAGE_HEADER_SIZE);
+  memcpy(&raw[4], &crc, 4);
+
+  ConfigImage parsed;
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_VALID, ConfigImageFormat::parse(raw, &parsed));
+  TEST_ASSERT_EQUAL(42, parsed.deviceID);
+  TEST_ASSERT_EQUAL(14, parsed.chillerPin);
+}
+
+void test_migrate_from_v3() {
+  writeV3Image(1);
+  ConfigImage parsed;
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_MIGRATED, ConfigImageFormat::parse(raw, &parsed));
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_VERSION, parsed.version);
+  TEST_ASSERT_EQUAL(CONFIG_FLAG_BOARD_SENSOR, parsed.flags);
+  TEST_ASSERT_EQUAL(2, parsed.writeCount);
+  TEST_ASSERT_EQUAL(42, parsed.deviceID);
+  TEST_ASSERT_EQUAL_FLOAT(18.5, parsed.setpoint);
+  TEST_ASSERT_EQUAL(10, parsed.hostIP[0]);
+  TEST_ASSERT_EQUAL(1, parsed.hostIP[3]);
+  TEST_ASSERT_EQUAL(9001, parsed.hostPort);
+  TEST_ASSERT_EQUAL_STRING("ssid", parsed.wifiSSID);
+  TEST_ASSERT_EQUAL_STRING("password", parsed.wifiPassword);
+  TEST_ASSERT_EQUAL(5, parsed.enablePin);
+  TEST_ASSERT_EQUAL(4, parsed.oneWirePin);
+  TEST_ASSERT_EQUAL(13, parsed.redIndicatorPin);
+  TEST_ASSERT_EQUAL(12, parsed.greenIndicatorPin);
+  TEST_ASSERT_EQUAL(15, parsed.heaterPin);
+  TEST_ASSERT_EQUAL(14, parsed.chillerPin);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(boardAddress, parsed.boardSensorAddress, sizeof(boardAddress));
+  TEST_ASSERT_EQUAL_FLOAT(2.5, parsed.proportionalGain);
+  TEST_ASSERT_EQUAL(30000, parsed.controlPeriod);
+
+  // The migrated image is sealed, ready to be written back
+  memcpy(raw, &parsed, sizeof(parsed));
+  ConfigImage reparsed;
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_VALID, ConfigImageFormat::parse(raw, &reparsed));
+  TEST_ASSERT_EQUAL_MEMORY(&parsed, &reparsed, sizeof(parsed));
+}
+
+void test_v3_with_several_heaters_is_corrupt() {
+  writeV3Image(2);
+  ConfigImage parsed;
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_CORRUPT, ConfigImageFormat::parse(raw, &parsed));
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_crc32);
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_blank);
+  RUN_TEST(test_corrupt);
+  RUN_TEST(test_unsupported);
+  RUN_TEST(test_newer_version_read_as_prefix);
+  RUN_TEST(test_migrate_from_v3);
+  RUN_TEST(test_v3_with_several_heaters_is_corrupt);
+  UNITY_END();
+}
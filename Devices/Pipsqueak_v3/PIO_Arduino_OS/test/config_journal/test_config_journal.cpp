@@ -0,0 +1,228 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <ConfigJournal.h>
+
+#define TEST_SECTOR_COUNT 3
+
+/**
+ * Flash in RAM that, like NOR flash, only clears bits on write, and
+ * that can be made to fail partway through, as a power cut would.
+ */
+class TestFlash : public JournalFlash {
+  public:
+    uint8_t data[TEST_SECTOR_COUNT][CONFIG_JOURNAL_SECTOR_SIZE];
+    int writesLeft = -1; // fail all writes after this many; -1 never
+    size_t eraseCount = 0;
+
+    void reset() {
+      memset(data, 0xFF, sizeof(data));
+      writesLeft = -1;
+      eraseCount = 0;
+    }
+
+    size_t getSectorCount() {
+      return TEST_SECTOR_COUNT;
+    }
+
+    bool erase(size_t sector) {
+      memset(data[sector], 0xFF, CONFIG_JOURNAL_SECTOR_SIZE);
+      eraseCount += 1;
+      return true;
+    }
+
+    bool read(size_t sector, uint32_t offset, uint32_t * buffer, size_t size) {
+      memcpy(buffer, &data[sector][offset], size);
+      return true;
+    }
+
+    bool write(size_t sector, uint32_t offset, const uint32_t * buffer, size_t size) {
+      const uint8_t * bytes = (const uint8_t *) buffer;
+      // A write that fails leaves half of it behind
+      size_t count = size;
+      if (writesLeft == 0) count = size / 2;
+      for (size_t i = 0; i < count; i++) data[sector][offset + i] &= bytes[i];
+      if (writesLeft == 0) return false;
+      if (writesLeft > 0) writesLeft -= 1;
+      return true;
+    }
+};
+
+// Too big for the esp8266's stack
+static TestFlash flash;
+
+struct Tuning {
+  float proportionalGain;
+  float integralGain;
+  float derivativeGain;
+  uint32_t controlPeriod;
+};
+
+void test_empty() {
+  flash.reset();
+  ConfigJournal journal(&flash);
+  float setpoint = 20.0;
+  TEST_ASSERT_TRUE(journal.begin(0x1234));
+  TEST_ASSERT_TRUE(journal.isReady());
+  TEST_ASSERT_FALSE(journal.read(0, &setpoint, sizeof(setpoint)));
+  TEST_ASSERT_EQUAL_FLOAT(20.0, setpoint);
+  TEST_ASSERT_EQUAL(1, journal.getEraseCount());
+  TEST_ASSERT_EQUAL(CONFIG_JOURNAL_SECTOR_SIZE - CONFIG_JOURNAL_SECTOR_HEADER_SIZE, journal.getFreeSpace());
+}
+
+void test_write_survives_reboot() {
+  flash.reset();
+  ConfigJournal journal(&flash);
+  Tuning tuning = { 2.5, 0.01, 0, 30000 };
+  float setpoint = 18.5;
+  journal.begin(0x1234);
+  TEST_ASSERT_TRUE(journal.write(0, &setpoint, sizeof(setpoint)));
+  TEST_ASSERT_TRUE(journal.write(1, &tuning, sizeof(tuning)));
+  setpoint = 19.0;
+  TEST_ASSERT_TRUE(journal.write(0, &setpoint, sizeof(setpoint)));
+
+  ConfigJournal rebooted(&flash);
+  Tuning restored;
+  float restoredSetpoint;
+  TEST_ASSERT_TRUE(rebooted.begin(0x1234));
+  TEST_ASSERT_TRUE(rebooted.read(0, &restoredSetpoint, sizeof(restoredSetpoint)));
+  TEST_ASSERT_EQUAL_FLOAT(19.0, restoredSetpoint);
+  TEST_ASSERT_TRUE(rebooted.read(1, &restored, sizeof(restored)));
+  TEST_ASSERT_EQUAL_FLOAT(2.5, restored.proportionalGain);
+  TEST_ASSERT_EQUAL(30000, restored.controlPeriod);
+  TEST_ASSERT_FALSE(rebooted.read(1, &restoredSetpoint, sizeof(restoredSetpoint)));
+  TEST_ASSERT_EQUAL(journal.getFreeSpace(), rebooted.getFreeSpace());
+  TEST_ASSERT_EQUAL(1, flash.eraseCount);
+}
+
+void test_unchanged_value_not_appended() {
+  flash.reset();
+  ConfigJournal journal(&flash);
+  float setpoint = 18.5;
+  journal.begin(0x1234);
+  journal.write(0, &setpoint, sizeof(setpoint));
+  journal.write(0, &setpoint, sizeof(setpoint));
+  TEST_ASSERT_EQUAL(1, journal.getAppendCount());
+  TEST_ASSERT_FALSE(journal.write(CONFIG_JOURNAL_KEY_LIMIT, &setpoint, sizeof(setpoint)));
+}
+
+void test_compaction() {
+  flash.reset();
+  ConfigJournal journal(&flash);
+  Tuning tuning = { 2.5, 0.01, 0, 30000 };
+  uint8_t profile[200];
+  memset(profile, 7, sizeof(profile));
+  journal.begin(0x1234);
+  journal.write(1, &tuning, sizeof(tuning));
+  journal.write(2, profile, sizeof(profile));
+
+  // About 320 setpoints fit in a sector beside the others
+  float setpoint;
+  for (int i = 0; i < 4000; i++) {
+    setpoint = 10.0 + i * 0.01;
+    TEST_ASSERT_TRUE(journal.write(0, &setpoint, sizeof(setpoint)));
+  }
+  TEST_ASSERT_EQUAL(4002, journal.getAppendCount());
+  TEST_ASSERT_TRUE(flash.eraseCount >= 13);
+  TEST_ASSERT_TRUE(flash.eraseCount <= 14);
+  TEST_ASSERT_EQUAL(flash.eraseCount, journal.getEraseCount());
+
+  ConfigJournal rebooted(&flash);
+  Tuning restored;
+  uint8_t restoredProfile[200];
+  float restoredSetpoint;
+  rebooted.begin(0x1234);
+  TEST_ASSERT_TRUE(rebooted.read(0, &restoredSetpoint, sizeof(restoredSetpoint)));
+  TEST_ASSERT_EQUAL_FLOAT(setpoint, restoredSetpoint);
+  TEST_ASSERT_TRUE(rebooted.read(1, &restored, sizeof(restored)));
+  TEST_ASSERT_EQUAL_FLOAT(0.01, restored.integralGain);
+  TEST_ASSERT_TRUE(rebooted.read(2, restoredProfile, sizeof(restoredProfile)));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(profile, restoredProfile, sizeof(profile));
+}
+
+void test_new_base_discards_journal() {
+  flash.reset();
+  ConfigJournal journal(&flash);
+  float setpoint = 18.5;
+  journal.begin(0x1234);
+  journal.write(0, &setpoint, sizeof(setpoint));
+
+  ConfigJournal reinitialized(&flash);
+  float restored = 20.0;
+  TEST_ASSERT_TRUE(reinitialized.begin(0x5678));
+  TEST_ASSERT_FALSE(reinitialized.read(0, &restored, sizeof(restored)));
+  TEST_ASSERT_EQUAL(2, reinitialized.getEraseCount());
+
+  ConfigJournal rebooted(&flash);
+  TEST_ASSERT_TRUE(rebooted.begin(0x5678));
+  TEST_ASSERT_FALSE(rebooted.read(0, &restored, sizeof(restored)));
+}
+
+void test_torn_record_ignored() {
+  flash.reset();
+  ConfigJournal journal(&flash);
+  float setpoint = 18.5;
+  journal.begin(0x1234);
+  journal.write(0, &setpoint, sizeof(setpoint));
+  setpoint = 19.0;
+  flash.writesLeft = 0;
+  TEST_ASSERT_FALSE(journal.write(0, &setpoint, sizeof(setpoint)));
+  flash.writesLeft = -1;
+
+  ConfigJournal rebooted(&flash);
+  float restored;
+  rebooted.begin(0x1234);
+  TEST_ASSERT_TRUE(rebooted.read(0, &restored, sizeof(restored)));
+  TEST_ASSERT_EQUAL_FLOAT(18.5, restored);
+
+  // The next write moves on to a fresh sector
+  TEST_ASSERT_TRUE(rebooted.write(0, &setpoint, sizeof(setpoint)));
+  TEST_ASSERT_TRUE(rebooted.read(0, &restored, sizeof(restored)));
+  TEST_ASSERT_EQUAL_FLOAT(19.0, restored);
+  TEST_ASSERT_EQUAL(2, flash.eraseCount);
+}
+
+void test_interrupted_compaction_keeps_previous_sector() {
+  flash.reset();
+  ConfigJournal journal(&flash);
+  Tuning tuning = { 2.5, 0.01, 0, 30000 };
+  journal.begin(0x1234);
+  journal.write(1, &tuning, sizeof(tuning));
+  float setpoint = 0;
+  while (journal.getFreeSpace() >= 12) {
+    setpoint += 1;
+    journal.write(0, &setpoint, sizeof(setpoint));
+  }
+
+  // Power fails after the tuning is copied, before the new setpoint
+  float lost = setpoint + 1;
+  flash.writesLeft = 1;
+  TEST_ASSERT_FALSE(journal.write(0, &lost, sizeof(lost)));
+  flash.writesLeft = -1;
+
+  ConfigJournal rebooted(&flash);
+  Tuning restoredTuning;
+  float restored;
+  rebooted.begin(0x1234);
+  TEST_ASSERT_TRUE(rebooted.read(0, &restored, sizeof(restored)));
+  TEST_ASSERT_EQUAL_FLOAT(setpoint, restored);
+  TEST_ASSERT_TRUE(rebooted.read(1, &restoredTuning, sizeof(restoredTuning)));
+  TEST_ASSERT_EQUAL(30000, restoredTuning.controlPeriod);
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_empty);
+  RUN_TEST(test_write_survives_reboot);
+  RUN_TEST(test_unchanged_value_not_appended);
+  RUN_TEST(test_compaction);
+  RUN_TEST(test_new_base_discards_journal);
+  RUN_TEST(test_torn_record_ignored);
+  RUN_TEST(test_interrupted_compaction_keeps_previous_sector);
+  UNITY_END();
+}
@@ -0,0 +1,147 @@
+#include <Arduino.h>
+#include <ArduinoNative.h>
+#include <unity.h>
+#include <new>
+#include <PipsqueakConfig.h>
+#include <flash_hal.h>
+
+#define DEVICE_ID 42
+#define JOURNAL_ADDRESS (FS_PHYS_ADDR + FS_PHYS_SIZE - JOURNAL_SECTOR_COUNT * SPI_FLASH_SEC_SIZE)
+#define JOURNAL_SIZE (JOURNAL_SECTOR_COUNT * SPI_FLASH_SEC_SIZE)
+
+// Counts allocations by new, as the heap trap firmware aborts on
+// them after setup()
+static size_t heapAllocations = 0;
+
+void * operator new(size_t size) {
+  heapAllocations += 1;
+  void * block = malloc(size);
+  if (block == NULL) throw std::bad_alloc();
+  return block;
+}
+
+void * operator new[](size_t size) {
+  heapAllocations += 1;
+  void * block = malloc(size);
+  if (block == NULL) throw std::bad_alloc();
+  return block;
+}
+
+void operator delete(void * block) noexcept {
+  free(block);
+}
+
+void operator delete[](void * block) noexcept {
+  free(block);
+}
+
+static const ProfileSegment segments[2] = {
+  { 1600000000, 18.0, 0 },
+  { 1600086400, 20.0, 0.5 }
+};
+
+static void provision() {
+  ConfigImage image;
+  memset(&image, 0, sizeof(image));
+  image.deviceID = DEVICE_ID;
+  image.setpoint = 20.0;
+  image.hostPort = 8266;
+  ConfigImageFormat::seal(&image);
+  memcpy(ArduinoNative::getFlash() + NATIVE_EEPROM_SECTOR * SPI_FLASH_SEC_SIZE, &image, sizeof(image));
+}
+
+static ConfigImage readImage() {
+  ConfigImage image;
+  ConfigImageFormat::parse(ArduinoNative::getFlash() + NATIVE_EEPROM_SECTOR * SPI_FLASH_SEC_SIZE, &image);
+  return image;
+}
+
+// With the journal worn out, changes fall back to rewriting the
+// image, which has to stay off the heap
+void test_persist_when_journal_fails() {
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  ArduinoNative::eraseFlash();
+  provision();
+  PipsqueakConfig config;
+  config.setup();
+  ArduinoNative::failFlash(JOURNAL_ADDRESS, JOURNAL_SIZE);
+
+  size_t allocations = heapAllocations;
+  config.setTemperatureSetpoint(18.5);
+  TEST_ASSERT_TRUE(config.setProfile(7, 2, segments));
+  TEST_ASSERT_EQUAL(allocations, heapAllocations);
+  TEST_ASSERT_EQUAL(2, readImage().writeCount);
+
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  PipsqueakConfig rebooted;
+  rebooted.setup();
+  TEST_ASSERT_EQUAL(DEVICE_ID, rebooted.getDeviceID());
+  TEST_ASSERT_EQUAL(8266, rebooted.getHostPort());
+  TEST_ASSERT_EQUAL_FLOAT(18.5, rebooted.getTemperatureSetpoint());
+  TEST_ASSERT_EQUAL(7, rebooted.getProfile()->getProfileID());
+  TEST_ASSERT_EQUAL(2, rebooted.getProfile()->getSegmentCount());
+  TEST_ASSERT_EQUAL(1600086400, rebooted.getProfile()->getSegment(1)->start);
+  TEST_ASSERT_EQUAL_FLOAT(0.5, rebooted.getProfile()->getSegment(1)->rampRate);
+}
+
+// The journal, while it works, leaves the image alone
+void test_journal_spares_image() {
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  ArduinoNative::eraseFlash();
+  provision();
+  PipsqueakConfig config;
+  config.setup();
+
+  config.setTemperatureSetpoint(18.5);
+  TEST_ASSERT_EQUAL(0, readImage().writeCount);
+
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  PipsqueakConfig rebooted;
+  rebooted.setup();
+  TEST_ASSERT_EQUAL_FLOAT(18.5, rebooted.getTemperatureSetpoint());
+}
+
+// A bad image leaves the config unusable, rather than restarting
+// the device in a loop, and the board's wiring is assumed so that
+// the outputs can be held off
+void test_unusable_image() {
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  ArduinoNative::eraseFlash();
+  PipsqueakConfig blank;
+  blank.setup();
+  TEST_ASSERT_FALSE(blank.isUsable());
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_BLANK, blank.getImageStatus());
+  TEST_ASSERT_FALSE(ArduinoNative::restartRequested());
+  TEST_ASSERT_EQUAL(BOARD_SIGNAL_ENABLE_PIN, blank.getSignalEnablePin());
+  TEST_ASSERT_EQUAL(BOARD_HEATER_PIN, blank.getHeaterPin());
+  TEST_ASSERT_EQUAL(BOARD_CHILLER_PIN, blank.getChillerPin());
+  TEST_ASSERT_EQUAL(BOARD_RED_INDICATOR_PIN, blank.getRedIndicatorPin());
+  TEST_ASSERT_EQUAL(BOARD_GREEN_INDICATOR_PIN, blank.getGreenIndicatorPin());
+
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  provision();
+  ArduinoNative::getFlash()[NATIVE_EEPROM_SECTOR * SPI_FLASH_SEC_SIZE + CONFIG_IMAGE_HEADER_SIZE] ^= 0xFF;
+  PipsqueakConfig corrupt;
+  corrupt.setup();
+  TEST_ASSERT_FALSE(corrupt.isUsable());
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_CORRUPT, corrupt.getImageStatus());
+  TEST_ASSERT_FALSE(ArduinoNative::restartRequested());
+
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  ArduinoNative::eraseFlash();
+  provision();
+  PipsqueakConfig valid;
+  valid.setup();
+  TEST_ASSERT_TRUE(valid.isUsable());
+}
+
+void setup() {
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_persist_when_journal_fails);
+  RUN_TEST(test_journal_spares_image);
+  RUN_TEST(test_unusable_image);
+  UNITY_END();
+}
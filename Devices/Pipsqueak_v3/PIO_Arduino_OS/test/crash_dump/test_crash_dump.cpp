@@ -0,0 +1,173 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <CrashDump.h>
+
+/**
+ * A sector of flash in RAM that, like NOR flash, only clears bits
+ * on write, and that can be made to fail partway through a dump.
+ */
+class TestFlash : public JournalFlash {
+  public:
+    uint8_t data[CONFIG_JOURNAL_SECTOR_SIZE];
+    int writesLeft = -1; // fail all writes after this many; -1 never
+
+    void reset() {
+      memset(data, 0xFF, sizeof(data));
+      writesLeft = -1;
+    }
+
+    size_t getSectorCount() {
+      return 1;
+    }
+
+    bool erase(size_t sector) {
+      memset(data, 0xFF, CONFIG_JOURNAL_SECTOR_SIZE);
+      return true;
+    }
+
+    bool read(size_t sector, uint32_t offset, uint32_t * buffer, size_t size) {
+      memcpy(buffer, &data[offset], size);
+      return true;
+    }
+
+    bool write(size_t sector, uint32_t offset, const uint32_t * buffer, size_t size) {
+      if (writesLeft == 0) return false;
+      if (writesLeft > 0) writesLeft -= 1;
+      const uint8_t * bytes = (const uint8_t *) buffer;
+      for (size_t i = 0; i < size; i++) data[offset + i] &= bytes[i];
+      return true;
+    }
+};
+
+static TestFlash flash;
+static uint32_t stack[1024];
+
+static CrashDumpContext context() {
+  CrashDumpContext context = {
+    2, 28, 0x40208110, 0, 0, 0x00000004, 0,
+    0x3FFFFD00, 0x3FFFFFB0, 3600123, 1700000000
+  };
+  return context;
+}
+
+void test_blank_flash() {
+  flash.reset();
+  CrashDump dump(&flash);
+  TEST_ASSERT_TRUE(dump.begin());
+  TEST_ASSERT_FALSE(dump.isPending());
+  TEST_ASSERT_EQUAL(0, dump.getDumpID());
+  TEST_ASSERT_EQUAL(0, dump.getSize());
+  uint32_t word;
+  TEST_ASSERT_FALSE(dump.read(0, &word, 4));
+  TEST_ASSERT_FALSE(dump.markUploaded());
+}
+
+void test_capture_survives_reboot() {
+  flash.reset();
+  for (size_t i = 0; i < 1024; i++) stack[i] = 0x40200000 + i;
+  Profiler::enter(PROFILER_SLOT_CLIENT_LOOP);
+  Profiler::record(PROFILER_SLOT_HMAC_COMPUTE, 5000);
+
+  CrashDump crashed(&flash);
+  crashed.begin();
+  for (uint32_t i = 0; i < CRASH_DUMP_RECORD_LIMIT + 2; i++) crashed.addRecord(1, (int8_t) -i, 1000 * i);
+  CrashDumpContext registers = context();
+  // Only so much of the stack is kept
+  TEST_ASSERT_TRUE(crashed.capture(&registers, stack, sizeof(stack)));
+  TEST_ASSERT_TRUE(crashed.isPending());
+
+  CrashDump dump(&flash);
+  TEST_ASSERT_TRUE(dump.begin());
+  TEST_ASSERT_TRUE(dump.isPending());
+  TEST_ASSERT_EQUAL(1, dump.getDumpID());
+  size_t profilerCount = Profiler::getRecentCount();
+  size_t expectedSize = sizeof(CrashDumpHeader) + CRASH_DUMP_STACK_LIMIT +
+    profilerCount * CRASH_DUMP_PROFILER_RUN_SIZE + CRASH_DUMP_RECORD_LIMIT * CRASH_DUMP_RECORD_SIZE;
+  TEST_ASSERT_EQUAL(expectedSize, dump.getSize());
+
+  const CrashDumpHeader * header = dump.getHeader();
+  TEST_ASSERT_EQUAL(CRASH_DUMP_MAGIC, header->magic);
+  TEST_ASSERT_EQUAL(sizeof(CrashDumpHeader), header->headerSize);
+  TEST_ASSERT_EQUAL(28, header->exccause);
+  TEST_ASSERT_EQUAL(0x40208110, header->epc1);
+  TEST_ASSERT_EQUAL(3600123, header->uptimeMillis);
+  TEST_ASSERT_EQUAL(1700000000, header->unixTime);
+  TEST_ASSERT_EQUAL(CRASH_DUMP_STACK_LIMIT, header->stackSize);
+  TEST_ASSERT_EQUAL(CRASH_DUMP_RECORD_LIMIT, header->recordCount);
+  TEST_ASSERT_TRUE(header->activeSlots & (1 << PROFILER_SLOT_CLIENT_LOOP));
+
+  // Stack from the stack pointer up, then the newest profiler run
+  // last, then the errors, oldest first
+  uint32_t word;
+  TEST_ASSERT_TRUE(dump.read(sizeof(CrashDumpHeader), &word, 4));
+  TEST_ASSERT_EQUAL(0x40200000, word);
+  uint32_t offset = sizeof(CrashDumpHeader) + CRASH_DUMP_STACK_LIMIT + (profilerCount - 1) * CRASH_DUMP_PROFILER_RUN_SIZE;
+  ProfilerRun run;
+  TEST_ASSERT_TRUE(dump.read(offset, (uint32_t *) &run, sizeof(run)));
+  TEST_ASSERT_EQUAL(PROFILER_SLOT_HMAC_COMPUTE, run.slot);
+  TEST_ASSERT_EQUAL(5000, run.cycles);
+  CrashDumpRecord record;
+  offset += CRASH_DUMP_PROFILER_RUN_SIZE;
+  TEST_ASSERT_TRUE(dump.read(offset, (uint32_t *) &record, sizeof(record)));
+  TEST_ASSERT_EQUAL(2000, record.millis);
+  TEST_ASSERT_EQUAL(-2, record.code);
+  TEST_ASSERT_FALSE(dump.read(dump.getSize() - 4, (uint32_t *) &record, sizeof(record)));
+  TEST_ASSERT_FALSE(dump.read(2, &word, 4));
+}
+
+void test_uploaded_dump_keeps_its_id() {
+  flash.reset();
+  CrashDump crashed(&flash);
+  crashed.begin();
+  CrashDumpContext registers = context();
+  crashed.capture(&registers, stack, 64);
+  TEST_ASSERT_TRUE(crashed.markUploaded());
+  TEST_ASSERT_FALSE(crashed.isPending());
+
+  CrashDump dump(&flash);
+  dump.begin();
+  TEST_ASSERT_FALSE(dump.isPending());
+  TEST_ASSERT_EQUAL(1, dump.getDumpID());
+
+  // The next crash follows on
+  TEST_ASSERT_TRUE(dump.capture(&registers, stack, 64));
+  CrashDump next(&flash);
+  next.begin();
+  TEST_ASSERT_TRUE(next.isPending());
+  TEST_ASSERT_EQUAL(2, next.getDumpID());
+}
+
+void test_torn_or_corrupt_dump_ignored() {
+  flash.reset();
+  CrashDump crashed(&flash);
+  crashed.begin();
+  CrashDumpContext registers = context();
+  flash.writesLeft = 1;
+  TEST_ASSERT_FALSE(crashed.capture(&registers, stack, 256));
+  CrashDump torn(&flash);
+  TEST_ASSERT_TRUE(torn.begin());
+  TEST_ASSERT_FALSE(torn.isPending());
+
+  flash.writesLeft = -1;
+  crashed.capture(&registers, stack, 256);
+  flash.data[sizeof(CrashDumpHeader) + 10] ^= 0x01;
+  CrashDump corrupt(&flash);
+  TEST_ASSERT_TRUE(corrupt.begin());
+  TEST_ASSERT_FALSE(corrupt.isPending());
+  TEST_ASSERT_EQUAL(0, corrupt.getSize());
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_blank_flash);
+  RUN_TEST(test_capture_survives_reboot);
+  RUN_TEST(test_uploaded_dump_keeps_its_id);
+  RUN_TEST(test_torn_or_corrupt_dump_ignored);
+  UNITY_END();
+}
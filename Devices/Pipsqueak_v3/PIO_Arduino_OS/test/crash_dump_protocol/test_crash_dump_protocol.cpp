@@ -0,0 +1,127 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <Hmac.h>
+#include <Errors.h>
+#include <CrashDumpProtocol.h>
+
+#define SECRET_KEY "ThisIsATopSecret32ByteValuePad32"
+#define DEVICE_ID 127
+#define MOCK_NOW 1234567898
+#define CHALLENGE 3876543210
+#define MOCK_LATER 1234567900
+
+#define DUMP_ID 3
+#define DUMP_SIZE 2380
+#define CHUNK_OFFSET 256
+
+static const byte CHUNK[8] = { 0xDE, 0xAD, 0xBE, 0xEF, 0x01, 0x02, 0x03, 0x04 };
+
+void test_constructor() {
+  CrashDumpRequest * subject = new CrashDumpRequest(DEVICE_ID, new Hmac((const byte *) &SECRET_KEY));
+  TEST_ASSERT_FALSE(subject->isPopulated());
+  TEST_ASSERT_FALSE(subject->isInFlight());
+  TEST_ASSERT_FALSE(subject->getResponse()->isInUse());
+  TEST_ASSERT_EQUAL(64, subject->getSize());
+  TEST_ASSERT_EQUAL(0, subject->getDumpID());
+  TEST_ASSERT_EQUAL(0, subject->getChunkSize());
+  const byte expectedHeader[4] = { 0x05, 0x7F, 0x00, 0x00 };
+  TEST_ASSERT_EQUAL_MEMORY(expectedHeader, subject->getBuffer(), 4);
+}
+
+void test_setChunk() {
+  CrashDumpRequest * subject = new CrashDumpRequest(DEVICE_ID, new Hmac((const byte *) &SECRET_KEY));
+  subject->setChunk(DUMP_ID, DUMP_SIZE, CHUNK_OFFSET, CHUNK, sizeof(CHUNK));
+  TEST_ASSERT_TRUE(subject->isPopulated());
+  TEST_ASSERT_FALSE(subject->isInFlight());
+  TEST_ASSERT_EQUAL(72, subject->getSize());
+  TEST_ASSERT_EQUAL(DUMP_ID, subject->getDumpID());
+  TEST_ASSERT_EQUAL(CHUNK_OFFSET, subject->getChunkOffset());
+  TEST_ASSERT_EQUAL(8, subject->getChunkSize());
+  const byte expectedFields[14] = {
+    0x03, 0x00, 0x00, 0x00, 0x4C, 0x09, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x00, 0x08, 0x00
+  };
+  TEST_ASSERT_EQUAL_MEMORY(expectedFields, &subject->getBuffer()[14], 14);
+  TEST_ASSERT_EQUAL_MEMORY(CHUNK, &subject->getBuffer()[32], 8);
+}
+
+void test_setChunk_truncates() {
+  CrashDumpRequest * subject = new CrashDumpRequest(DEVICE_ID, new Hmac((const byte *) &SECRET_KEY));
+  static byte chunk[CRASH_DUMP_REQUEST_CHUNK_SIZE_LIMIT + 4];
+  subject->setChunk(DUMP_ID, DUMP_SIZE, 0, chunk, sizeof(chunk));
+  TEST_ASSERT_EQUAL(CRASH_DUMP_REQUEST_CHUNK_SIZE_LIMIT, subject->getChunkSize());
+  TEST_ASSERT_EQUAL(CRASH_DUMP_REQUEST_MAX_SIZE, subject->getSize());
+}
+
+void test_ready() {
+  CrashDumpRequest * subject = new CrashDumpRequest(DEVICE_ID, new Hmac((const byte *) &SECRET_KEY));
+  subject->setChunk(DUMP_ID, DUMP_SIZE, CHUNK_OFFSET, CHUNK, sizeof(CHUNK));
+  subject->ready(MOCK_NOW, CHALLENGE);
+  TEST_ASSERT_TRUE(subject->isInFlight());
+  TEST_ASSERT_TRUE(subject->getResponse()->isInUse());
+  TEST_ASSERT_EQUAL(72, subject->getSize());
+  const byte expectedRequest[72] = {
+    0x05, 0x7F, 0x00, 0x00, 0x00, 0xDA, 0x02, 0x96,
+    0x49, 0x00, 0xEA, 0x5A, 0x0F, 0xE7, 0x03, 0x00,
+    0x00, 0x00, 0x4C, 0x09, 0x00, 0x00, 0x00, 0x01,
+    0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xDE, 0xAD, 0xBE, 0xEF, 0x01, 0x02, 0x03, 0x04,
+    0x88, 0x38, 0x31, 0x9A, 0x2D, 0x3F, 0x68, 0x36,
+    0x7D, 0x88, 0x13, 0xAE, 0xDE, 0x1F, 0xF3, 0x08,
+    0x1F, 0x5E, 0x93, 0xBC, 0xA8, 0xB7, 0xA5, 0x7D,
+    0x45, 0x5A, 0x19, 0x54, 0x57, 0x64, 0xB8, 0x47
+  };
+  TEST_ASSERT_EQUAL_MEMORY(expectedRequest, subject->getBuffer(), 72);
+}
+
+void test_reset() {
+  CrashDumpRequest * subject = new CrashDumpRequest(DEVICE_ID, new Hmac((const byte *) &SECRET_KEY));
+  subject->setChunk(DUMP_ID, DUMP_SIZE, CHUNK_OFFSET, CHUNK, sizeof(CHUNK));
+  subject->ready(MOCK_NOW, CHALLENGE);
+  subject->reset();
+  TEST_ASSERT_FALSE(subject->isPopulated());
+  TEST_ASSERT_FALSE(subject->isInFlight());
+  TEST_ASSERT_EQUAL(64, subject->getSize());
+  TEST_ASSERT_EQUAL(0, subject->getDumpID());
+  const byte zeros[104] = { 0 };
+  TEST_ASSERT_EQUAL_MEMORY(zeros, &subject->getBuffer()[5], 99);
+}
+
+void test_response() {
+  CrashDumpRequest * subject = new CrashDumpRequest(DEVICE_ID, new Hmac((const byte *) &SECRET_KEY));
+  subject->setChunk(DUMP_ID, DUMP_SIZE, CHUNK_OFFSET, CHUNK, sizeof(CHUNK));
+  subject->ready(MOCK_NOW, CHALLENGE);
+  byte response[64] = {
+    0x05, 0xDC, 0x02, 0x96, 0x49, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xEA, 0x5A, 0x0F, 0xE7, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x4D, 0xEF, 0xAB, 0x11, 0x26, 0x00, 0x3F, 0xBC,
+    0xD4, 0x4D, 0x05, 0x52, 0xA1, 0x7D, 0x17, 0x2B,
+    0x87, 0x93, 0x21, 0x9A, 0x9C, 0x6A, 0xD0, 0x1C,
+    0xC4, 0x56, 0x04, 0x5D, 0x21, 0xAA, 0x0E, 0x46
+  };
+  subject->getResponse()->receiveBytes(response, 64);
+  TEST_ASSERT_TRUE(subject->getResponse()->isComplete());
+  subject->getResponse()->ready(0);
+  TEST_ASSERT_TRUE(subject->getResponse()->isReady());
+  TEST_ASSERT_FALSE(subject->getResponse()->hasErrors());
+  TEST_ASSERT_EQUAL(MOCK_LATER, subject->getResponse()->getTimestamp());
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+  RUN_TEST(test_constructor);
+  RUN_TEST(test_setChunk);
+  RUN_TEST(test_setChunk_truncates);
+  RUN_TEST(test_ready);
+  RUN_TEST(test_reset);
+  RUN_TEST(test_response);
+  UNITY_END();
+}
+
+void loop() {
+}
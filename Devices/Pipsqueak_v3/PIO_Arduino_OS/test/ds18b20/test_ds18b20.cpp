@@ -0,0 +1,167 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <ArduinoNative.h>
+#include <NativeOneWire.h>
+#include <DS18B20.h>
+
+// Native only: runs against the simulated bus in native/OneWire
+
+#define PIN_ONE_WIRE D3
+#define READING_TTL 30000 // ms
+
+static OneWire oneWire(PIN_ONE_WIRE);
+
+static void attach(byte * address, uint32_t serial, float temperature) {
+  NativeOneWire::makeAddress(address, serial);
+  NativeOneWire::attach(address, temperature);
+}
+
+// Starts a conversion, waits it out in virtual time and reads it
+static void sense(DS18B20 * sensor) {
+  sensor->startSensing();
+  ArduinoNative::advanceMillis(sensor->getMillisUntilReady());
+  TEST_ASSERT_TRUE(sensor->isReadyToRead());
+  TEST_ASSERT_TRUE(sensor->read());
+}
+
+void test_detect() {
+  NativeOneWire::clear();
+  byte first[DS18B20_ADDRESS_SIZE];
+  byte second[DS18B20_ADDRESS_SIZE];
+  attach(first, 1, 20.0);
+  attach(second, 2, 21.0);
+
+  byte found[2 * DS18B20_ADDRESS_SIZE];
+  TEST_ASSERT_EQUAL(2, DS18B20::detect(&oneWire, found, 2));
+  bool firstFound = memcmp(found, first, DS18B20_ADDRESS_SIZE) == 0 || memcmp(found + DS18B20_ADDRESS_SIZE, first, DS18B20_ADDRESS_SIZE) == 0;
+  bool secondFound = memcmp(found, second, DS18B20_ADDRESS_SIZE) == 0 || memcmp(found + DS18B20_ADDRESS_SIZE, second, DS18B20_ADDRESS_SIZE) == 0;
+  TEST_ASSERT_TRUE(firstFound);
+  TEST_ASSERT_TRUE(secondFound);
+
+  // More than fit are counted
+  TEST_ASSERT_EQUAL(2, DS18B20::detect(&oneWire, found, 1));
+
+  // An address failing its CRC is skipped
+  byte corrupt[DS18B20_ADDRESS_SIZE];
+  NativeOneWire::makeAddress(corrupt, 3);
+  corrupt[7] ^= 0x5A;
+  NativeOneWire::attach(corrupt, 22.0);
+  TEST_ASSERT_EQUAL(2, DS18B20::detect(&oneWire, found, 2));
+}
+
+void test_conversion_takes_time() {
+  NativeOneWire::clear();
+  byte address[DS18B20_ADDRESS_SIZE];
+  attach(address, 3, 20.0);
+  DS18B20 sensor(&oneWire, address, 11, READING_TTL);
+
+  sensor.startSensing();
+  TEST_ASSERT_TRUE(sensor.isSensing());
+  TEST_ASSERT_FALSE(sensor.isReadyToRead());
+  TEST_ASSERT_EQUAL(375, sensor.getMillisUntilReady());
+  ArduinoNative::advanceMillis(374);
+  TEST_ASSERT_FALSE(sensor.isReadyToRead());
+  ArduinoNative::advanceMillis(1);
+  TEST_ASSERT_TRUE(sensor.isReadyToRead());
+  TEST_ASSERT_TRUE(sensor.read());
+  TEST_ASSERT_FALSE(sensor.isSensing());
+}
+
+void test_readings_at_resolution() {
+  NativeOneWire::clear();
+  byte address[DS18B20_ADDRESS_SIZE];
+  attach(address, 4, 20.3);
+  // The sensor powers up at 12 bits; the constructor reconfigures it
+  DS18B20 sensor(&oneWire, address, 11, READING_TTL);
+
+  sense(&sensor);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 20.25, sensor.getLastReading());
+  // Not yet trusted
+  TEST_ASSERT_TRUE(isnan(sensor.getTemperature()));
+  sense(&sensor);
+  sense(&sensor);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 20.25, sensor.getTemperature());
+
+  NativeOneWire::setTemperature(address, 25.0);
+  sense(&sensor);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 25.0, sensor.getTemperature());
+}
+
+void test_configured_by_read() {
+  NativeOneWire::clear();
+  byte address[DS18B20_ADDRESS_SIZE];
+  attach(address, 8, 20.3);
+  // Attached without blocking, though the sensor powers up at 12 bits
+  DS18B20 sensor(&oneWire, address, 11, READING_TTL, true);
+  TEST_ASSERT_EQUAL(0, NativeOneWire::getResetCount());
+
+  // The first read finds it misconfigured and corrects it, once
+  sensor.startSensing();
+  ArduinoNative::advanceMillis(sensor.getMillisUntilReady());
+  uint32_t resets = NativeOneWire::getResetCount();
+  TEST_ASSERT_TRUE(sensor.read());
+  TEST_ASSERT_EQUAL(3, NativeOneWire::getResetCount() - resets);
+  TEST_ASSERT_TRUE(isnan(sensor.getLastReading()));
+
+  sense(&sensor);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 20.25, sensor.getLastReading());
+}
+
+void test_crc_failures_retried() {
+  NativeOneWire::clear();
+  byte address[DS18B20_ADDRESS_SIZE];
+  attach(address, 5, 18.0);
+  DS18B20 sensor(&oneWire, address, 12, READING_TTL);
+
+  NativeOneWire::corruptReads(address, 2);
+  sensor.startSensing();
+  ArduinoNative::advanceMillis(sensor.getMillisUntilReady());
+  TEST_ASSERT_FALSE(sensor.read());
+  TEST_ASSERT_FALSE(sensor.read());
+  TEST_ASSERT_TRUE(sensor.read());
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 18.0, sensor.getLastReading());
+}
+
+void test_readings_expire() {
+  NativeOneWire::clear();
+  byte address[DS18B20_ADDRESS_SIZE];
+  attach(address, 6, 19.5);
+  DS18B20 sensor(&oneWire, address, 9, READING_TTL);
+  for (size_t i = 0; i < 3; i++) sense(&sensor);
+  TEST_ASSERT_FLOAT_WITHIN(0.001, 19.5, sensor.getTemperature());
+
+  ArduinoNative::advanceMillis(READING_TTL + 1);
+  TEST_ASSERT_TRUE(isnan(sensor.getTemperature()));
+}
+
+void test_unplugged_sensor() {
+  NativeOneWire::clear();
+  byte address[DS18B20_ADDRESS_SIZE];
+  attach(address, 7, 22.0);
+  DS18B20 sensor(&oneWire, address, 10, READING_TTL);
+  NativeOneWire::detach(address);
+
+  sensor.startSensing();
+  ArduinoNative::advanceMillis(sensor.getMillisUntilReady());
+  // Retried, then given up on
+  size_t attempts = 1;
+  while (!sensor.read()) attempts++;
+  TEST_ASSERT_TRUE(attempts > 1);
+  TEST_ASSERT_FALSE(sensor.isSensing());
+  TEST_ASSERT_TRUE(isnan(sensor.getLastReading()));
+}
+
+void setup() {
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_detect);
+  RUN_TEST(test_conversion_takes_time);
+  RUN_TEST(test_readings_at_resolution);
+  RUN_TEST(test_configured_by_read);
+  RUN_TEST(test_crc_failures_retried);
+  RUN_TEST(test_readings_expire);
+  RUN_TEST(test_unplugged_sensor);
+  UNITY_END();
+}
@@ -0,0 +1,131 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <FermentationProfile.h>
+
+#define PROFILE_ID 42
+#define HOUR 3600
+#define START 1600000000
+
+// Hold at 18C, ramp to 21C at 0.5C/h (6 hours), then crash to 2C
+const ProfileSegment SEGMENTS[3] = {
+  { START, 18.0, 0 },
+  { START + (48 * HOUR), 21.0, 0.5 },
+  { START + (120 * HOUR), 2.0, 0 }
+};
+
+void test_empty() {
+  FermentationProfile profile;
+
+  TEST_ASSERT_FALSE(profile.isLoaded());
+  TEST_ASSERT_EQUAL_UINT32(0, profile.getProfileID());
+  TEST_ASSERT_FLOAT_IS_NAN(profile.evaluate(START));
+}
+
+void test_before_start() {
+  FermentationProfile profile;
+
+  TEST_ASSERT_TRUE(profile.load(PROFILE_ID, 3, SEGMENTS));
+  TEST_ASSERT_TRUE(profile.isLoaded());
+  TEST_ASSERT_EQUAL_UINT32(PROFILE_ID, profile.getProfileID());
+  TEST_ASSERT_EQUAL_UINT8(3, profile.getSegmentCount());
+  TEST_ASSERT_FLOAT_IS_NAN(profile.evaluate(START - 1));
+}
+
+void test_hold() {
+  FermentationProfile profile;
+  profile.load(PROFILE_ID, 3, SEGMENTS);
+
+  TEST_ASSERT_EQUAL_FLOAT(18.0, profile.evaluate(START));
+  TEST_ASSERT_EQUAL_FLOAT(18.0, profile.evaluate(START + (48 * HOUR) - 1));
+}
+
+void test_ramp() {
+  FermentationProfile profile;
+  profile.load(PROFILE_ID, 3, SEGMENTS);
+
+  TEST_ASSERT_EQUAL_FLOAT(18.0, profile.evaluate(START + (48 * HOUR)));
+  TEST_ASSERT_EQUAL_FLOAT(18.5, profile.evaluate(START + (49 * HOUR)));
+  TEST_ASSERT_EQUAL_FLOAT(19.5, profile.evaluate(START + (51 * HOUR)));
+  TEST_ASSERT_EQUAL_FLOAT(21.0, profile.evaluate(START + (54 * HOUR)));
+  TEST_ASSERT_EQUAL_FLOAT(21.0, profile.evaluate(START + (100 * HOUR)));
+}
+
+void test_quantization() {
+  FermentationProfile profile;
+  profile.load(PROFILE_ID, 3, SEGMENTS);
+
+  // 7.5 minutes into a 0.5C/h ramp is 18.0625C; 10 minutes is 18.0833C
+  TEST_ASSERT_EQUAL_FLOAT(18.0625, profile.evaluate(START + (48 * HOUR) + 450));
+  TEST_ASSERT_EQUAL_FLOAT(18.0625, profile.evaluate(START + (48 * HOUR) + 600));
+}
+
+void test_step_and_final_hold() {
+  FermentationProfile profile;
+  profile.load(PROFILE_ID, 3, SEGMENTS);
+
+  TEST_ASSERT_EQUAL_FLOAT(2.0, profile.evaluate(START + (120 * HOUR)));
+  TEST_ASSERT_EQUAL_FLOAT(2.0, profile.evaluate(START + (1000 * HOUR)));
+}
+
+void test_ramp_interrupted_by_next_segment() {
+  // The second segment starts before the first segment's ramp completes
+  const ProfileSegment segments[3] = {
+    { START, 20.0, 0 },
+    { START + HOUR, 10.0, 1.0 },
+    { START + (3 * HOUR), 20.0, 2.0 }
+  };
+  FermentationProfile profile;
+  profile.load(PROFILE_ID, 3, segments);
+
+  TEST_ASSERT_EQUAL_FLOAT(18.0, profile.evaluate(START + (3 * HOUR)));
+  TEST_ASSERT_EQUAL_FLOAT(19.0, profile.evaluate(START + (3 * HOUR) + 1800));
+  TEST_ASSERT_EQUAL_FLOAT(20.0, profile.evaluate(START + (4 * HOUR)));
+}
+
+void test_invalid_profiles_rejected() {
+  const ProfileSegment unordered[2] = { { START, 18.0, 0 }, { START, 20.0, 0 } };
+  const ProfileSegment negativeRamp[1] = { { START, 18.0, -1.0 } };
+  const ProfileSegment nanTarget[1] = { { START, NAN, 0 } };
+  FermentationProfile profile;
+  profile.load(PROFILE_ID, 3, SEGMENTS);
+
+  TEST_ASSERT_FALSE(profile.load(PROFILE_ID + 1, 2, unordered));
+  TEST_ASSERT_FALSE(profile.load(PROFILE_ID + 1, 1, negativeRamp));
+  TEST_ASSERT_FALSE(profile.load(PROFILE_ID + 1, 1, nanTarget));
+  TEST_ASSERT_FALSE(profile.load(PROFILE_ID + 1, PROFILE_SEGMENT_LIMIT + 1, SEGMENTS));
+  // The previous profile remains in place
+  TEST_ASSERT_EQUAL_UINT32(PROFILE_ID, profile.getProfileID());
+  TEST_ASSERT_EQUAL_UINT8(3, profile.getSegmentCount());
+}
+
+void test_cancellation() {
+  FermentationProfile profile;
+  profile.load(PROFILE_ID, 3, SEGMENTS);
+  TEST_ASSERT_TRUE(profile.load(PROFILE_ID, 0, SEGMENTS));
+  TEST_ASSERT_FALSE(profile.isLoaded());
+
+  profile.load(PROFILE_ID, 3, SEGMENTS);
+  TEST_ASSERT_TRUE(profile.load(0, 3, SEGMENTS));
+  TEST_ASSERT_FALSE(profile.isLoaded());
+  TEST_ASSERT_FLOAT_IS_NAN(profile.evaluate(START));
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_empty);
+  RUN_TEST(test_before_start);
+  RUN_TEST(test_hold);
+  RUN_TEST(test_ramp);
+  RUN_TEST(test_quantization);
+  RUN_TEST(test_step_and_final_hold);
+  RUN_TEST(test_ramp_interrupted_by_next_segment);
+  RUN_TEST(test_invalid_profiles_rejected);
+  RUN_TEST(test_cancellation);
+  UNITY_END();
+}
@@ -0,0 +1,357 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <ArduinoNative.h>
+#include <NativeAsyncTCP.h>
+#include <NativeWiFi.h>
+#include <ReferenceServer.h>
+#include <DeviceFixture.h>
+
+// Soaks one server with a fleet of devices: hundreds of
+// PipsqueakState and PipsqueakClient pairs, each with its own
+// scheduler and simulated sensors, against ReferenceServer held to
+// CiderServer's limits (5 connections, a 1 s socket timeout, and
+// one request handled at a time). Each scenario varies the fleet's
+// size and event rate, or adds a reboot storm or an outage, and
+// prints one line of JSON to Serial (stdout) with the server's
+// latency percentiles, the connections it refused and timed out,
+// and how the devices' backlogs of status events grew. The lines
+// are also written to the file named by $SIMULATION_OUTPUT, if set.
+//
+//   pio test -e native -f fleet_soak
+//
+// The devices share one virtual clock, one access point and one
+// flash: each is provisioned just before it boots, and one booting
+// after the first 15 s finds its initialization window closed, so
+// it reports CLOCK_SYNC_ERROR until its first time response.
+
+#define FIRST_DEVICE_ID 1000
+#define SERVER_TIME 1600000000
+#define SIMULATION_SEED 2463534242
+// CiderServer's maxConnections and socketTimeoutMs
+#define SERVER_CONNECTION_LIMIT 5
+#define SERVER_SOCKET_TIMEOUT 1000 // ms
+// An HMAC and a database round trip per request
+#define SERVER_SERVICE_TIME 5000 // us
+// Devices are powered up over this long, rather than all at once
+#define FLEET_BOOT_WINDOW 30000 // ms
+#define FLEET_LIMIT 400
+#define SOAK_MILLIS 600000 // ms
+// How often the fleet's schedulers run, and its backlog is sampled
+#define FLEET_SLICE 10 // ms
+#define SAMPLE_INTERVAL 1000 // ms
+// Outages and reboot storms start here, after the fleet settles
+#define DISRUPTION_MILLIS 120000 // ms
+#define JSON_BUFFER_SIZE 1024
+// ERR_RST in lwIP, as the native AsyncClient reports it
+#define TCP_RESET_ERROR -14
+
+enum Disruption {
+  DISRUPTION_NONE,
+  DISRUPTION_REBOOT_STORM,  // every device reboots within 5 s
+  DISRUPTION_SERVER_OUTAGE, // connections refused for 60 s
+  DISRUPTION_WIFI_OUTAGE,   // the access point is gone for 60 s
+};
+
+#define REBOOT_STORM_WINDOW 5000 // ms
+#define OUTAGE_MILLIS 60000 // ms
+// After a disruption, the fleet is back to, and stays at, no more
+// than this many events queued per device within RECOVERY_LIMIT
+#define RECOVERED_DEVICE_BACKLOG 2
+#define RECOVERY_LIMIT 120000 // ms
+
+struct Scenario {
+  const char * name;
+  uint16_t devices;
+  uint32_t readingInterval; // ms between each device's temperature readings
+  Disruption disruption;
+};
+
+struct ScenarioResult {
+  uint32_t requests;
+  uint32_t responses;
+  uint32_t refusals;
+  uint32_t socketTimeouts;
+  uint32_t rejections;
+  uint16_t peakConnections;
+  uint32_t p50Micros;
+  uint32_t p90Micros;
+  uint32_t p99Micros;
+  uint32_t maxMicros;
+  uint32_t delivered;        // temperature events the server accepted
+  uint32_t errorEvents;
+  uint32_t connectionFailures;
+  uint32_t brokenPipes;
+  uint32_t connectionLosses;
+  uint32_t resets;           // ERR_RST from the TCP stack
+  uint32_t settledBacklog;   // events queued fleet-wide as the disruption starts
+  uint32_t peakBacklog;
+  uint32_t peakDeviceBacklog;
+  uint32_t finalBacklog;
+  uint32_t recoveryMillis;   // from the end of the disruption; UINT32_MAX if not by the end
+};
+
+/**
+ * One device: what main.cpp would set up, and when its sensors next
+ * read and it next boots.
+ */
+struct Device : PipsqueakDevice {
+  uint32_t deviceID;
+  uint32_t bootMillis;
+  uint32_t nextReadingMillis;
+  uint32_t readingCount;
+};
+
+static const Scenario scenarios[] = {
+  { "steady_100", 100, 60000, DISRUPTION_NONE },
+  { "steady_400", 400, 60000, DISRUPTION_NONE },
+  { "busy_200", 200, 5000, DISRUPTION_NONE },
+  { "reboot_storm_200", 200, 60000, DISRUPTION_REBOOT_STORM },
+  { "server_outage_200", 200, 60000, DISRUPTION_SERVER_OUTAGE },
+  { "wifi_outage_200", 200, 60000, DISRUPTION_WIFI_OUTAGE },
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+static const NativeAsyncTCP::Conditions LAN = { 4, 2, 2, 0, 0, false };
+static const NativeAsyncTCP::Conditions REFUSED = { 4, 2, 2, 0, 0, true };
+
+static ScenarioResult results[SCENARIO_COUNT];
+static Device devices[FLEET_LIMIT];
+static ReferenceServer * server;
+
+static void boot(Device * device) {
+  DeviceFixture::boot(device, device->deviceID);
+  // The sensors answer at once
+  device->state->setBoardSensorDetected(true);
+  device->state->setBoardTemperature(25.0);
+  device->state->setRemoteSensorDetected(true);
+  device->state->setRemoteTemperature(18.5);
+}
+
+// A new temperature every reading, so that each is reported
+static void read(Device * device, uint32_t readingInterval) {
+  device->readingCount += 1;
+  device->state->setRemoteTemperature(18.5 + (device->readingCount % 2) * 0.0625);
+  device->nextReadingMillis += readingInterval;
+}
+
+static uint32_t getBacklog(uint16_t deviceCount, uint32_t * peakDeviceBacklog) {
+  uint32_t backlog = 0;
+  for (uint16_t i = 0; i < deviceCount; i++) {
+    if (devices[i].state == NULL) continue;
+    uint32_t deviceBacklog = devices[i].state->getStatusEventCount();
+    backlog += deviceBacklog;
+    *peakDeviceBacklog = max(*peakDeviceBacklog, deviceBacklog);
+  }
+  return backlog;
+}
+
+static uint32_t getDisruptionEnd(const Scenario * scenario) {
+  switch (scenario->disruption) {
+    case DISRUPTION_REBOOT_STORM:
+      return DISRUPTION_MILLIS + REBOOT_STORM_WINDOW;
+    case DISRUPTION_SERVER_OUTAGE:
+    case DISRUPTION_WIFI_OUTAGE:
+      return DISRUPTION_MILLIS + OUTAGE_MILLIS;
+    default:
+      return DISRUPTION_MILLIS;
+  }
+}
+
+static void disrupt(const Scenario * scenario, uint32_t elapsed) {
+  bool outage = elapsed >= DISRUPTION_MILLIS && elapsed < DISRUPTION_MILLIS + OUTAGE_MILLIS;
+  switch (scenario->disruption) {
+    case DISRUPTION_SERVER_OUTAGE:
+      NativeAsyncTCP::setConditions(outage ? REFUSED : LAN);
+      break;
+    case DISRUPTION_WIFI_OUTAGE:
+      NativeWiFi::setAvailable(!outage);
+      break;
+    default:
+      break;
+  }
+}
+
+static void run(const Scenario * scenario, ScenarioResult * result) {
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  ArduinoNative::eraseFlash();
+  NativeAsyncTCP::reset();
+  NativeAsyncTCP::seed(SIMULATION_SEED);
+  NativeAsyncTCP::setConditions(LAN);
+  NativeWiFi::setAvailable(true);
+  NativeWiFi::setAssociationMillis(0);
+
+  server = new ReferenceServer(SERVER_TIME);
+  server->setConnectionLimit(SERVER_CONNECTION_LIMIT);
+  server->setSocketTimeout(SERVER_SOCKET_TIMEOUT);
+  server->setServiceMicros(SERVER_SERVICE_TIME);
+  NativeAsyncTCP::setServer(server);
+
+  uint16_t deviceCount = scenario->devices;
+  for (uint16_t i = 0; i < deviceCount; i++) {
+    Device * device = &devices[i];
+    device->deviceID = FIRST_DEVICE_ID + i;
+    device->state = NULL;
+    device->bootMillis = (uint32_t) ((uint64_t) FLEET_BOOT_WINDOW * i / deviceCount);
+    device->readingCount = 0;
+    server->registerDevice(device->deviceID, (const byte *) DEVICE_FIXTURE_SECRET_KEY);
+  }
+
+  memset(result, 0, sizeof(ScenarioResult));
+  result->recoveryMillis = UINT32_MAX;
+  uint32_t disruptionEnd = getDisruptionEnd(scenario);
+  uint32_t lastSample = 0;
+  bool stormed = false;
+  while (millis() < SOAK_MILLIS) {
+    uint32_t elapsed = millis();
+    disrupt(scenario, elapsed);
+    if (scenario->disruption == DISRUPTION_REBOOT_STORM && !stormed && elapsed >= DISRUPTION_MILLIS) {
+      stormed = true;
+      for (uint16_t i = 0; i < deviceCount; i++) {
+        devices[i].bootMillis = DISRUPTION_MILLIS + (uint32_t) ((uint64_t) REBOOT_STORM_WINDOW * i / deviceCount);
+      }
+    }
+    for (uint16_t i = 0; i < deviceCount; i++) {
+      Device * device = &devices[i];
+      if (elapsed >= device->bootMillis) {
+        if (device->state != NULL) DeviceFixture::shutDown(device);
+        boot(device);
+        device->bootMillis = UINT32_MAX;
+        device->nextReadingMillis = elapsed + scenario->readingInterval;
+      }
+      if (device->state == NULL) continue;
+      if (elapsed >= device->nextReadingMillis) read(device, scenario->readingInterval);
+      device->scheduler->runDue();
+    }
+    if (elapsed - lastSample >= SAMPLE_INTERVAL) {
+      lastSample = elapsed;
+      uint32_t backlog = getBacklog(deviceCount, &result->peakDeviceBacklog);
+      result->peakBacklog = max(result->peakBacklog, backlog);
+      if (result->settledBacklog == 0 && elapsed >= DISRUPTION_MILLIS) result->settledBacklog = backlog;
+      // Recovered from the first sample the backlog then stays down
+      if (elapsed >= disruptionEnd) {
+        if (backlog > RECOVERED_DEVICE_BACKLOG * deviceCount) {
+          result->recoveryMillis = UINT32_MAX;
+        } else if (result->recoveryMillis == UINT32_MAX) {
+          result->recoveryMillis = elapsed - disruptionEnd;
+        }
+      }
+    }
+    delay(FLEET_SLICE);
+  }
+
+  uint32_t peakDeviceBacklog = 0;
+  result->finalBacklog = getBacklog(deviceCount, &peakDeviceBacklog);
+  result->requests = NativeAsyncTCP::getConnectCount();
+  result->responses = NativeAsyncTCP::getResponseCount();
+  result->socketTimeouts = NativeAsyncTCP::getSocketTimeoutCount();
+  result->refusals = server->getRefusalCount();
+  result->rejections = server->getRejectionCount();
+  result->peakConnections = server->getPeakConnectionCount();
+  result->p50Micros = server->getLatencyPercentile(50);
+  result->p90Micros = server->getLatencyPercentile(90);
+  result->p99Micros = server->getLatencyPercentile(99);
+  result->maxMicros = server->getLatencyPercentile(100);
+  result->delivered = server->getEventCount(STATUS_EVENT_TYPE_TEMPERATURE);
+  result->errorEvents = server->getEventCount(STATUS_EVENT_TYPE_ERROR);
+  result->connectionFailures = server->getErrorEventCount(ErrorType::Pipsqueak, NETWORK_ERROR_CONNECTION_FAILED);
+  result->brokenPipes = server->getErrorEventCount(ErrorType::Pipsqueak, NETWORK_ERROR_BROKEN_PIPE);
+  result->connectionLosses = server->getErrorEventCount(ErrorType::Pipsqueak, NETWORK_ERROR_CONNECTION_LOST);
+  result->resets = server->getErrorEventCount(ErrorType::TcpStack, TCP_RESET_ERROR);
+
+  for (uint16_t i = 0; i < deviceCount; i++) {
+    if (devices[i].state != NULL) DeviceFixture::shutDown(&devices[i]);
+  }
+  NativeAsyncTCP::setServer(NULL);
+  delete server;
+}
+
+// Output /////////////////////////////////////////////////////////////////////////////////////////
+
+static size_t writeJson(char * buffer, size_t size, const Scenario * scenario, const ScenarioResult * result) {
+  return snprintf(buffer, size,
+    "{\"suite\":\"fleet_soak\",\"scenario\":\"%s\",\"seed\":%u,\"devices\":%u,\"readingMillis\":%u,"
+    "\"soakMillis\":%u,\"connectionLimit\":%u,\"socketTimeoutMillis\":%u,\"serviceMicros\":%u,"
+    "\"requests\":%u,\"responses\":%u,\"refusals\":%u,\"socketTimeouts\":%u,\"rejections\":%u,"
+    "\"peakConnections\":%u,\"latencyMillis\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f},"
+    "\"delivered\":%u,\"errorEvents\":%u,\"connectionFailures\":%u,\"brokenPipes\":%u,"
+    "\"connectionLosses\":%u,\"resets\":%u,\"backlog\":{\"settled\":%u,\"peak\":%u,\"peakDevice\":%u,"
+    "\"final\":%u},\"recoveryMillis\":%d}",
+    scenario->name, (unsigned) SIMULATION_SEED, scenario->devices, (unsigned) scenario->readingInterval,
+    (unsigned) SOAK_MILLIS, SERVER_CONNECTION_LIMIT, SERVER_SOCKET_TIMEOUT, SERVER_SERVICE_TIME,
+    (unsigned) result->requests, (unsigned) result->responses, (unsigned) result->refusals,
+    (unsigned) result->socketTimeouts, (unsigned) result->rejections, result->peakConnections,
+    result->p50Micros / 1000.0, result->p90Micros / 1000.0, result->p99Micros / 1000.0, result->maxMicros / 1000.0,
+    (unsigned) result->delivered, (unsigned) result->errorEvents, (unsigned) result->connectionFailures,
+    (unsigned) result->brokenPipes, (unsigned) result->connectionLosses, (unsigned) result->resets,
+    (unsigned) result->settledBacklog, (unsigned) result->peakBacklog, (unsigned) result->peakDeviceBacklog,
+    (unsigned) result->finalBacklog, result->recoveryMillis == UINT32_MAX ? -1 : (int) result->recoveryMillis);
+}
+
+static void report() {
+  static char json[JSON_BUFFER_SIZE];
+  const char * path = getenv("SIMULATION_OUTPUT");
+  FILE * file = NULL;
+  if (path != NULL) {
+    file = fopen(path, "w");
+    TEST_ASSERT_NOT_NULL(file);
+  }
+  for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+    size_t length = writeJson(json, sizeof(json), &scenarios[i], &results[i]);
+    TEST_ASSERT_TRUE(length < sizeof(json));
+    Serial.println(json);
+    if (file != NULL) fprintf(file, "%s\n", json);
+  }
+  if (file != NULL) fclose(file);
+}
+
+// Tests //////////////////////////////////////////////////////////////////////////////////////////
+
+void test_scenarios() {
+  for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+    TEST_ASSERT_TRUE(scenarios[i].devices <= FLEET_LIMIT);
+    run(&scenarios[i], &results[i]);
+  }
+}
+
+void test_server_holds_to_its_limits() {
+  for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+    TEST_ASSERT_TRUE(results[i].peakConnections <= SERVER_CONNECTION_LIMIT);
+    TEST_ASSERT_EQUAL(0, results[i].rejections);
+  }
+}
+
+void test_steady_fleet_keeps_up() {
+  for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+    if (scenarios[i].disruption != DISRUPTION_NONE) continue;
+    ScenarioResult * result = &results[i];
+    // What's queued at the end is at most a reading or two per device
+    TEST_ASSERT_TRUE(result->finalBacklog <= RECOVERED_DEVICE_BACKLOG * scenarios[i].devices);
+    TEST_ASSERT_EQUAL(0, result->socketTimeouts);
+  }
+}
+
+void test_fleet_recovers_from_disruptions() {
+  for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+    if (scenarios[i].disruption == DISRUPTION_NONE) continue;
+    TEST_ASSERT_TRUE_MESSAGE(results[i].recoveryMillis <= RECOVERY_LIMIT, scenarios[i].name);
+    TEST_ASSERT_TRUE_MESSAGE(results[i].finalBacklog <= RECOVERED_DEVICE_BACKLOG * scenarios[i].devices, scenarios[i].name);
+  }
+}
+
+void test_report() {
+  report();
+}
+
+void setup() {
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_scenarios);
+  RUN_TEST(test_server_holds_to_its_limits);
+  RUN_TEST(test_steady_fleet_keeps_up);
+  RUN_TEST(test_fleet_recovers_from_disruptions);
+  RUN_TEST(test_report);
+  UNITY_END();
+}
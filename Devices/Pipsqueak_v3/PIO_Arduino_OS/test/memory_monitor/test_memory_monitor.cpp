@@ -0,0 +1,81 @@
+#include <Arduino.h>
+#include <ArduinoNative.h>
+#include <unity.h>
+#include <MemoryMonitor.h>
+
+// Sampling and resetting don't touch PipsqueakState
+static MemoryMonitor * boot() {
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  return new MemoryMonitor(NULL);
+}
+
+void test_no_samples() {
+  MemoryMonitor * monitor = boot();
+  TEST_ASSERT_EQUAL(0, monitor->getPeriodLowWater()->sampleCount);
+  TEST_ASSERT_EQUAL(0, monitor->getBootLowWater()->sampleCount);
+  delete monitor;
+}
+
+void test_heap_low_water() {
+  MemoryMonitor * monitor = boot();
+  ArduinoNative::setHeap(30000, 30000);
+  monitor->sample();
+  ArduinoNative::setHeap(20000, 8000);
+  monitor->sample();
+  ArduinoNative::setHeap(25000, 25000);
+  monitor->sample();
+
+  const MemoryLowWater * lowWater = monitor->getPeriodLowWater();
+  TEST_ASSERT_EQUAL(3, lowWater->sampleCount);
+  TEST_ASSERT_EQUAL(20000, lowWater->freeHeap);
+  TEST_ASSERT_EQUAL(8000, lowWater->maxFreeBlock);
+  // two blocks of 8000 and 12000: 100 - 100 * sqrt(8000^2 + 12000^2) / 20000
+  TEST_ASSERT_EQUAL(28, lowWater->fragmentation);
+  TEST_ASSERT_EQUAL(20000, monitor->getBootLowWater()->freeHeap);
+  TEST_ASSERT_EQUAL(28, monitor->getBootLowWater()->fragmentation);
+  delete monitor;
+}
+
+void test_stack_low_water() {
+  MemoryMonitor * monitor = boot();
+  ArduinoNative::setContStackDepth(1500);
+  ArduinoNative::setContStackDepth(600);
+  monitor->sample();
+  TEST_ASSERT_EQUAL(NATIVE_CONT_STACK_SIZE - 1500, monitor->getPeriodLowWater()->freeStack);
+
+  // The stack is repainted below its current depth
+  monitor->reset();
+  monitor->sample();
+  TEST_ASSERT_EQUAL(NATIVE_CONT_STACK_SIZE - 600, monitor->getPeriodLowWater()->freeStack);
+  TEST_ASSERT_EQUAL(NATIVE_CONT_STACK_SIZE - 1500, monitor->getBootLowWater()->freeStack);
+  delete monitor;
+}
+
+void test_reset_keeps_boot_marks() {
+  MemoryMonitor * monitor = boot();
+  ArduinoNative::setHeap(10000, 4000);
+  monitor->sample();
+  monitor->reset();
+  TEST_ASSERT_EQUAL(0, monitor->getPeriodLowWater()->sampleCount);
+
+  ArduinoNative::setHeap(35000, 35000);
+  monitor->sample();
+  TEST_ASSERT_EQUAL(35000, monitor->getPeriodLowWater()->freeHeap);
+  TEST_ASSERT_EQUAL(0, monitor->getPeriodLowWater()->fragmentation);
+  TEST_ASSERT_EQUAL(2, monitor->getBootLowWater()->sampleCount);
+  TEST_ASSERT_EQUAL(10000, monitor->getBootLowWater()->freeHeap);
+  TEST_ASSERT_EQUAL(4000, monitor->getBootLowWater()->maxFreeBlock);
+  delete monitor;
+}
+
+void setup() {
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_no_samples);
+  RUN_TEST(test_heap_low_water);
+  RUN_TEST(test_stack_low_water);
+  RUN_TEST(test_reset_keeps_boot_marks);
+  UNITY_END();
+}
@@ -0,0 +1,127 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <Metrics.h>
+
+void test_counters() {
+  Metrics::reset();
+  uint32_t total = Metrics::getExtent(METRIC_BYTES_SENT);
+  Metrics::increment(METRIC_BYTES_SENT, 100);
+  Metrics::increment(METRIC_BYTES_SENT, 28);
+  Metrics::increment(METRIC_REQUESTS_SENT);
+  TEST_ASSERT_EQUAL(128, Metrics::getValue(METRIC_BYTES_SENT));
+  TEST_ASSERT_EQUAL(total + 128, Metrics::getExtent(METRIC_BYTES_SENT));
+  TEST_ASSERT_TRUE(Metrics::isActive(METRIC_BYTES_SENT));
+  TEST_ASSERT_FALSE(Metrics::isActive(METRIC_HEATER_PULSES));
+  TEST_ASSERT_EQUAL(MetricCounter, Metrics::getKind(METRIC_BYTES_SENT));
+  TEST_ASSERT_EQUAL_STRING("client.bytesSent", Metrics::getName(METRIC_BYTES_SENT));
+
+  // A new period keeps the total
+  Metrics::reset();
+  TEST_ASSERT_EQUAL(0, Metrics::getValue(METRIC_BYTES_SENT));
+  TEST_ASSERT_EQUAL(total + 128, Metrics::getExtent(METRIC_BYTES_SENT));
+  TEST_ASSERT_FALSE(Metrics::isActive(METRIC_BYTES_SENT));
+}
+
+void test_gauges() {
+  Metrics::reset();
+  Metrics::set(METRIC_STATUS_QUEUE_DEPTH, 3);
+  Metrics::set(METRIC_STATUS_QUEUE_DEPTH, 12);
+  Metrics::set(METRIC_STATUS_QUEUE_DEPTH, 5);
+  TEST_ASSERT_EQUAL(5, Metrics::getValue(METRIC_STATUS_QUEUE_DEPTH));
+  TEST_ASSERT_EQUAL(12, Metrics::getExtent(METRIC_STATUS_QUEUE_DEPTH));
+  TEST_ASSERT_EQUAL(MetricGauge, Metrics::getKind(METRIC_STATUS_QUEUE_DEPTH));
+
+  // The peak starts over from the value
+  Metrics::reset();
+  TEST_ASSERT_EQUAL(5, Metrics::getValue(METRIC_STATUS_QUEUE_DEPTH));
+  TEST_ASSERT_EQUAL(5, Metrics::getExtent(METRIC_STATUS_QUEUE_DEPTH));
+  TEST_ASSERT_TRUE(Metrics::isActive(METRIC_STATUS_QUEUE_DEPTH));
+}
+
+void test_histograms() {
+  Metrics::reset();
+  TEST_ASSERT_FALSE(Metrics::isActive(METRIC_ROUND_TRIP));
+  Metrics::observe(METRIC_ROUND_TRIP, 0);
+  Metrics::observe(METRIC_ROUND_TRIP, 249);
+  Metrics::observe(METRIC_ROUND_TRIP, 250);
+  Metrics::observe(METRIC_ROUND_TRIP, 3999);
+  Metrics::observe(METRIC_ROUND_TRIP, UINT32_MAX);
+  TEST_ASSERT_TRUE(Metrics::isActive(METRIC_ROUND_TRIP));
+  TEST_ASSERT_EQUAL(2, Metrics::getBucketCount(METRIC_ROUND_TRIP, 0));
+  TEST_ASSERT_EQUAL(1, Metrics::getBucketCount(METRIC_ROUND_TRIP, 1));
+  TEST_ASSERT_EQUAL(1, Metrics::getBucketCount(METRIC_ROUND_TRIP, 2));
+  TEST_ASSERT_EQUAL(1, Metrics::getBucketCount(METRIC_ROUND_TRIP, 3));
+  TEST_ASSERT_EQUAL(0, Metrics::getBucketCount(METRIC_ROUND_TRIP, METRIC_BUCKET_COUNT));
+  TEST_ASSERT_EQUAL(250, Metrics::getBucketBound(METRIC_ROUND_TRIP, 0));
+  TEST_ASSERT_EQUAL(UINT32_MAX, Metrics::getBucketBound(METRIC_ROUND_TRIP, METRIC_BUCKET_COUNT - 1));
+
+  Metrics::reset();
+  TEST_ASSERT_EQUAL(0, Metrics::getBucketCount(METRIC_ROUND_TRIP, 0));
+  TEST_ASSERT_FALSE(Metrics::isActive(METRIC_ROUND_TRIP));
+}
+
+void test_mismatched_updates() {
+  Metrics::reset();
+  Metrics::increment(METRIC_ROUND_TRIP);
+  Metrics::increment(METRIC_STATUS_QUEUE_DEPTH);
+  Metrics::set(METRIC_REQUESTS_SENT, 7);
+  Metrics::observe(METRIC_REQUESTS_SENT, 7);
+  Metrics::increment(METRIC_COUNT);
+  TEST_ASSERT_FALSE(Metrics::isActive(METRIC_ROUND_TRIP));
+  TEST_ASSERT_EQUAL(5, Metrics::getValue(METRIC_STATUS_QUEUE_DEPTH));
+  TEST_ASSERT_EQUAL(0, Metrics::getValue(METRIC_REQUESTS_SENT));
+  TEST_ASSERT_FALSE(Metrics::isActive(METRIC_COUNT));
+  TEST_ASSERT_NULL(Metrics::getName(METRIC_COUNT));
+}
+
+void test_snapshot() {
+  Metrics::reset();
+  // 13 counters, two of them wide, a gauge and a histogram
+  TEST_ASSERT_EQUAL(21, Metrics::getSnapshotSize());
+
+  Metrics::increment(METRIC_REQUESTS_SENT, 70000);
+  Metrics::increment(METRIC_BYTES_SENT, 0x00012345);
+  Metrics::observe(METRIC_ROUND_TRIP, 100);
+  Metrics::set(METRIC_STATUS_QUEUE_DEPTH, 0);
+  Metrics::set(METRIC_STATUS_QUEUE_DEPTH, 9);
+  Metrics::set(METRIC_STATUS_QUEUE_DEPTH, 4);
+  Metrics::increment(METRIC_FLASH_ERASES, 2);
+
+  uint16_t slots[5];
+  TEST_ASSERT_EQUAL(5, Metrics::readSnapshot(0, slots, 5));
+  // A counter saturates; a wide one takes two slots, low word first
+  const uint16_t first[5] = { 0xFFFF, 0x2345, 0x0001, 0, 0 };
+  TEST_ASSERT_EQUAL_MEMORY(first, slots, sizeof(first));
+
+  // Requests sent, bytes sent and received, failures, retries and
+  // drops take slots 0-7, so the histogram's buckets take 8-11
+  Metrics::readSnapshot(8, slots, 4);
+  TEST_ASSERT_EQUAL(1, slots[0]);
+  TEST_ASSERT_EQUAL(0, slots[1]);
+
+  // The gauge's value and peak follow the last counter before it
+  Metrics::readSnapshot(17, slots, 2);
+  TEST_ASSERT_EQUAL(4, slots[0]);
+  TEST_ASSERT_EQUAL(9, slots[1]);
+
+  // Past the end, slots are zeroed
+  TEST_ASSERT_EQUAL(2, Metrics::readSnapshot(19, slots, 5));
+  const uint16_t last[5] = { 0, 2, 0, 0, 0 };
+  TEST_ASSERT_EQUAL_MEMORY(last, slots, sizeof(last));
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_counters);
+  RUN_TEST(test_gauges);
+  RUN_TEST(test_histograms);
+  RUN_TEST(test_mismatched_updates);
+  RUN_TEST(test_snapshot);
+  UNITY_END();
+}
@@ -0,0 +1,79 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <MonitorBatch.h>
+
+void test_empty() {
+  MonitorBatch batch;
+  uint8_t unknown[MONITOR_BATCH_ADDRESS_SIZE] = { 0 };
+  TEST_ASSERT_EQUAL(0, batch.getSampleCount());
+  TEST_ASSERT_FALSE(batch.isFull());
+  TEST_ASSERT_EQUAL(0, batch.getClock());
+  TEST_ASSERT_EQUAL(0, batch.getWakeCount());
+  TEST_ASSERT_TRUE(isnan(batch.getTemperature(0)));
+  TEST_ASSERT_EQUAL(0, batch.getTimestamp(0, 1600000000));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(unknown, batch.getSensorAddress(), MONITOR_BATCH_ADDRESS_SIZE);
+}
+
+void test_timestamps() {
+  MonitorBatch batch;
+  batch.append(18.0);
+  batch.advance(60000);
+  batch.append(18.5);
+  batch.advance(61500);
+  batch.append(19.0);
+  batch.advance(500);
+  TEST_ASSERT_EQUAL(3, batch.getSampleCount());
+  TEST_ASSERT_EQUAL(122000, batch.getClock());
+  TEST_ASSERT_EQUAL_FLOAT(18.0, batch.getTemperature(0));
+  TEST_ASSERT_EQUAL_FLOAT(19.0, batch.getTemperature(2));
+  TEST_ASSERT_EQUAL(1600000000 - 122, batch.getTimestamp(0, 1600000000));
+  TEST_ASSERT_EQUAL(1600000000 - 62, batch.getTimestamp(1, 1600000000));
+  TEST_ASSERT_EQUAL(1600000000, batch.getTimestamp(2, 1600000000));
+}
+
+void test_overflow_drops_oldest() {
+  MonitorBatch batch;
+  for (int i = 0; i < MONITOR_BATCH_LIMIT; i++) {
+    batch.append(i);
+    batch.advance(1000);
+  }
+  TEST_ASSERT_TRUE(batch.isFull());
+  batch.append(100.0);
+  TEST_ASSERT_TRUE(batch.isFull());
+  TEST_ASSERT_EQUAL(MONITOR_BATCH_LIMIT, batch.getSampleCount());
+  TEST_ASSERT_EQUAL_FLOAT(1.0, batch.getTemperature(0));
+  TEST_ASSERT_EQUAL_FLOAT(100.0, batch.getTemperature(MONITOR_BATCH_LIMIT - 1));
+  TEST_ASSERT_EQUAL(1000 - MONITOR_BATCH_LIMIT + 1, batch.getTimestamp(0, 1000));
+}
+
+void test_clear_keeps_wakes_and_address() {
+  MonitorBatch batch;
+  uint8_t address[MONITOR_BATCH_ADDRESS_SIZE] = { 0x28, 1, 2, 3, 4, 5, 6, 7 };
+  batch.setSensorAddress(address);
+  batch.countWake();
+  batch.countWake();
+  batch.append(18.0);
+  batch.advance(60000);
+  batch.clear();
+  TEST_ASSERT_EQUAL(0, batch.getSampleCount());
+  TEST_ASSERT_EQUAL(0, batch.getClock());
+  TEST_ASSERT_EQUAL(2, batch.getWakeCount());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(address, batch.getSensorAddress(), MONITOR_BATCH_ADDRESS_SIZE);
+  batch.resetWakeCount();
+  TEST_ASSERT_EQUAL(0, batch.getWakeCount());
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_empty);
+  RUN_TEST(test_timestamps);
+  RUN_TEST(test_overflow_drops_oldest);
+  RUN_TEST(test_clear_keeps_wakes_and_address);
+  UNITY_END();
+}
@@ -0,0 +1,125 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <PidLoop.h>
+
+void test_proportional() {
+  PidLoop pid(0.5, 0, 0, -1.0, 1.0);
+
+  TEST_ASSERT_EQUAL_FLOAT(0.5, pid.update(20.0, 19.0, 30.0));
+  TEST_ASSERT_EQUAL_FLOAT(-0.25, pid.update(20.0, 20.5, 30.0));
+}
+
+void test_output_limits() {
+  PidLoop pid(0.5, 0, 0, -1.0, 1.0);
+
+  TEST_ASSERT_EQUAL_FLOAT(1.0, pid.update(20.0, 10.0, 30.0));
+  TEST_ASSERT_EQUAL_FLOAT(-1.0, pid.update(20.0, 30.0, 30.0));
+}
+
+void test_integral() {
+  PidLoop pid(0, 0.001, 0, -1.0, 1.0);
+
+  TEST_ASSERT_EQUAL_FLOAT(0.03, pid.update(20.0, 19.0, 30.0));
+  TEST_ASSERT_EQUAL_FLOAT(0.06, pid.update(20.0, 19.0, 30.0));
+  TEST_ASSERT_EQUAL_FLOAT(0.045, pid.update(20.0, 20.5, 30.0));
+}
+
+void test_anti_windup() {
+  PidLoop pid(0.5, 0.001, 0, -1.0, 1.0);
+
+  // A long stretch in saturation must not accumulate integral
+  for (size_t i = 0; i < 100; i++) pid.update(20.0, 15.0, 30.0);
+  TEST_ASSERT_EQUAL_FLOAT(0.0, pid.getIntegral());
+
+  // So the output leaves saturation as soon as the error reverses
+  TEST_ASSERT_EQUAL_FLOAT(-0.265, pid.update(20.0, 20.5, 30.0));
+}
+
+void test_integral_recovers_from_saturation() {
+  PidLoop pid(0.5, 0.001, 0, -1.0, 1.0);
+
+  pid.update(20.0, 19.5, 30.0);
+  pid.update(20.0, 15.0, 30.0);
+  // Error pushing back out of saturation is still integrated
+  TEST_ASSERT_EQUAL_FLOAT(0.015, pid.getIntegral());
+  pid.update(20.0, 21.0, 30.0);
+  TEST_ASSERT_EQUAL_FLOAT(-0.015, pid.getIntegral());
+}
+
+void test_derivative_on_measurement() {
+  PidLoop pid(0, 0, 10.0, -1.0, 1.0);
+
+  // No derivative on the first update
+  TEST_ASSERT_EQUAL_FLOAT(0.0, pid.update(20.0, 19.0, 30.0));
+  // Rising 0.3 degrees in 30 seconds opposes further heating
+  TEST_ASSERT_EQUAL_FLOAT(-0.1, pid.update(20.0, 19.3, 30.0));
+  // A setpoint change alone doesn't kick the output
+  TEST_ASSERT_EQUAL_FLOAT(0.0, pid.update(25.0, 19.3, 30.0));
+}
+
+void test_reset() {
+  PidLoop pid(0, 0.001, 10.0, -1.0, 1.0);
+
+  pid.update(20.0, 19.0, 30.0);
+  pid.update(20.0, 19.0, 30.0);
+  pid.reset();
+  TEST_ASSERT_EQUAL_FLOAT(0.0, pid.getIntegral());
+  TEST_ASSERT_EQUAL_FLOAT(0.0, pid.getOutput());
+  // The stale measurement is not differentiated against
+  TEST_ASSERT_EQUAL_FLOAT(0.0, pid.update(20.0, 20.0, 30.0));
+}
+
+void test_set_integral() {
+  PidLoop pid(0, 0.001, 10.0, -1.0, 1.0);
+
+  pid.setIntegral(0.25);
+  TEST_ASSERT_EQUAL_FLOAT(0.25, pid.getIntegral());
+  // The restored integral carries the output until the error accumulates
+  TEST_ASSERT_EQUAL_FLOAT(0.25, pid.update(20.0, 20.0, 30.0));
+  pid.setIntegral(2.0);
+  TEST_ASSERT_EQUAL_FLOAT(1.0, pid.getIntegral());
+  pid.setIntegral(NAN);
+  TEST_ASSERT_EQUAL_FLOAT(1.0, pid.getIntegral());
+}
+
+void test_set_gains() {
+  PidLoop pid(0.5, 0.001, 0, -1.0, 1.0);
+
+  pid.update(20.0, 19.0, 30.0);
+  pid.setGains(1.0, 0.002, 5.0);
+  TEST_ASSERT_EQUAL_FLOAT(1.0, pid.getKp());
+  TEST_ASSERT_EQUAL_FLOAT(0.002, pid.getKi());
+  TEST_ASSERT_EQUAL_FLOAT(5.0, pid.getKd());
+  // The accumulated integral carries over
+  TEST_ASSERT_EQUAL_FLOAT(0.03, pid.getIntegral());
+}
+
+void test_feed_forward() {
+  PidLoop pid(0.5, 0.001, 0, -1.0, 1.0);
+
+  TEST_ASSERT_EQUAL_FLOAT(0.83, pid.update(20.0, 19.0, 30.0, 0.3));
+  // Saturation counts the feed-forward term, so the integral holds
+  TEST_ASSERT_EQUAL_FLOAT(1.0, pid.update(20.0, 19.0, 30.0, 0.6));
+  TEST_ASSERT_EQUAL_FLOAT(0.03, pid.getIntegral());
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_proportional);
+  RUN_TEST(test_output_limits);
+  RUN_TEST(test_integral);
+  RUN_TEST(test_anti_windup);
+  RUN_TEST(test_integral_recovers_from_saturation);
+  RUN_TEST(test_derivative_on_measurement);
+  RUN_TEST(test_reset);
+  RUN_TEST(test_set_integral);
+  RUN_TEST(test_set_gains);
+  RUN_TEST(test_feed_forward);
+  UNITY_END();
+}
@@ -0,0 +1,149 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <Hmac.h>
+#include <Errors.h>
+#include <ProfileProtocol.h>
+
+#define SECRET_KEY "ThisIsATopSecret32ByteValuePad32"
+#define DEVICE_ID 127
+#define MOCK_NOW 1234567898
+#define CHALLENGE 3876543210
+#define MOCK_LATER 1234567900
+
+void test_constructor() {
+  ProfileRequest * subject = new ProfileRequest(DEVICE_ID, new Hmac((const byte *) &SECRET_KEY));
+  TEST_ASSERT_TRUE(subject->isPopulated());
+  TEST_ASSERT_FALSE(subject->isInFlight());
+  TEST_ASSERT_FALSE(subject->getResponse()->isInUse());
+  TEST_ASSERT_FALSE(subject->getResponse()->isComplete());
+  TEST_ASSERT_FALSE(subject->getResponse()->isReady());
+  TEST_ASSERT_EQUAL(64, subject->getSize());
+  const byte expectedRequest[64] = {
+    0x04, 0x7F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+  };
+  TEST_ASSERT_EQUAL_MEMORY(expectedRequest, subject->getBuffer(), 64);
+}
+
+void test_ready() {
+  ProfileRequest * subject = new ProfileRequest(DEVICE_ID, new Hmac((const byte *) &SECRET_KEY));
+  subject->ready(MOCK_NOW, CHALLENGE);
+  TEST_ASSERT_TRUE(subject->isPopulated());
+  TEST_ASSERT_TRUE(subject->isInFlight());
+  TEST_ASSERT_TRUE(subject->getResponse()->isInUse());
+  TEST_ASSERT_FALSE(subject->getResponse()->isComplete());
+  TEST_ASSERT_FALSE(subject->getResponse()->isReady());
+  const byte expectedRequest[64] = {
+    0x04, 0x7F, 0x00, 0x00, 0x00, 0xDA, 0x02, 0x96,
+    0x49, 0x00, 0xEA, 0x5A, 0x0F, 0xE7, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x1F, 0xE2, 0xF1, 0x46, 0xD4, 0xB0, 0x45, 0x37,
+    0xAC, 0xE1, 0x5F, 0xB5, 0x2F, 0x7E, 0x91, 0xFE,
+    0x74, 0x87, 0x39, 0x89, 0x17, 0x43, 0xA5, 0x42,
+    0x81, 0x7A, 0x2E, 0xCD, 0x74, 0x87, 0xBE, 0x13
+  };
+  TEST_ASSERT_EQUAL_MEMORY(expectedRequest, subject->getBuffer(), 64);
+}
+
+void test_reset() {
+  ProfileRequest * subject = new ProfileRequest(DEVICE_ID, new Hmac((const byte *) &SECRET_KEY));
+  subject->ready(MOCK_NOW, CHALLENGE);
+  subject->reset();
+  TEST_ASSERT_TRUE(subject->isPopulated());
+  TEST_ASSERT_FALSE(subject->isInFlight());
+  TEST_ASSERT_FALSE(subject->getResponse()->isInUse());
+  TEST_ASSERT_FALSE(subject->getResponse()->isComplete());
+  TEST_ASSERT_FALSE(subject->getResponse()->isReady());
+}
+
+void test_response() {
+  ProfileRequest * subject = new ProfileRequest(DEVICE_ID, new Hmac((const byte *) &SECRET_KEY));
+  subject->ready(MOCK_NOW, CHALLENGE);
+  TEST_ASSERT_TRUE(subject->getResponse()->isInUse());
+  byte response[256] = {
+    0x04, 0xDC, 0x02, 0x96, 0x49, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xEA, 0x5A, 0x0F, 0xE7, 0x2A, 0x00,
+    0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x40, 0x80, 0x96, 0x49, 0x00, 0x00, 0x90, 0x41,
+    0x00, 0x00, 0x00, 0x00, 0x40, 0x23, 0x99, 0x49,
+    0x00, 0x00, 0xA8, 0x41, 0x00, 0x00, 0x00, 0x3F,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x25, 0x51, 0xBD, 0x6C, 0xBB, 0x55, 0xE2, 0xA3,
+    0x28, 0x64, 0x3F, 0xC6, 0xA2, 0xCC, 0x88, 0x15,
+    0x26, 0x05, 0x6F, 0x8B, 0x23, 0xE1, 0xE7, 0x30,
+    0xEC, 0x01, 0xFA, 0x17, 0x3A, 0xD7, 0xA1, 0x06
+  };
+  subject->getResponse()->receiveBytes(&response[0], 128);
+  TEST_ASSERT_FALSE(subject->getResponse()->isComplete());
+  subject->getResponse()->receiveBytes(&response[128], 128);
+  TEST_ASSERT_TRUE(subject->getResponse()->isComplete());
+  subject->getResponse()->ready(0);
+  TEST_ASSERT_TRUE(subject->getResponse()->isReady());
+  TEST_ASSERT_FALSE(subject->getResponse()->hasErrors());
+  TEST_ASSERT_EQUAL(MOCK_LATER, subject->getResponse()->getTimestamp());
+  TEST_ASSERT_EQUAL_UINT32(42, subject->getResponse()->getProfileID());
+  TEST_ASSERT_EQUAL_UINT8(2, subject->getResponse()->getSegmentCount());
+  TEST_ASSERT_EQUAL_UINT32(1234600000, subject->getResponse()->getSegmentStart(0));
+  TEST_ASSERT_EQUAL_FLOAT(18.0, subject->getResponse()->getSegmentTarget(0));
+  TEST_ASSERT_EQUAL_FLOAT(0.0, subject->getResponse()->getSegmentRampRate(0));
+  TEST_ASSERT_EQUAL_UINT32(1234772800, subject->getResponse()->getSegmentStart(1));
+  TEST_ASSERT_EQUAL_FLOAT(21.0, subject->getResponse()->getSegmentTarget(1));
+  TEST_ASSERT_EQUAL_FLOAT(0.5, subject->getResponse()->getSegmentRampRate(1));
+}
+
+void test_truncated_response() {
+  ProfileRequest * subject = new ProfileRequest(DEVICE_ID, new Hmac((const byte *) &SECRET_KEY));
+  subject->ready(MOCK_NOW, CHALLENGE);
+  // A server that doesn't know the protocol might answer with a base-size response
+  byte response[64];
+  memset(response, 0, 64);
+  response[0] = PROFILE_PROTOCOL_ID;
+  subject->getResponse()->receiveBytes(response, 64);
+  subject->getResponse()->ready(0);
+  TEST_ASSERT_TRUE(subject->getResponse()->hasErrors());
+  TEST_ASSERT_EQUAL(RESPONSE_ERROR_TRUNCATED_RESPONSE, subject->getResponse()->getErrorCode(0));
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+  RUN_TEST(test_constructor);
+  RUN_TEST(test_ready);
+  RUN_TEST(test_reset);
+  RUN_TEST(test_response);
+  RUN_TEST(test_truncated_response);
+  UNITY_END();
+}
+
+void loop() {
+}
@@ -0,0 +1,100 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <Profiler.h>
+
+#define SLOT PROFILER_SLOT_HMAC_COMPUTE
+
+void test_empty() {
+  Profiler::reset();
+  TEST_ASSERT_EQUAL(0, Profiler::getCount(SLOT));
+  TEST_ASSERT_EQUAL(0, Profiler::getMaxCycles(SLOT));
+  TEST_ASSERT_EQUAL(0, Profiler::getPercentileBucket(SLOT, 50));
+  TEST_ASSERT_EQUAL(0, Profiler::getPercentileBucket(SLOT, 99));
+}
+
+void test_buckets() {
+  Profiler::reset();
+  Profiler::record(SLOT, 0);
+  Profiler::record(SLOT, 1);
+  Profiler::record(SLOT, 1023);
+  Profiler::record(SLOT, 1024);
+  Profiler::record(SLOT, 2047);
+  Profiler::record(SLOT, UINT32_MAX);
+  TEST_ASSERT_EQUAL(6, Profiler::getCount(SLOT));
+  TEST_ASSERT_EQUAL(UINT32_MAX, Profiler::getMaxCycles(SLOT));
+  TEST_ASSERT_EQUAL(2, Profiler::getBucketCount(SLOT, 0));
+  TEST_ASSERT_EQUAL(1, Profiler::getBucketCount(SLOT, 9));
+  TEST_ASSERT_EQUAL(2, Profiler::getBucketCount(SLOT, 10));
+  TEST_ASSERT_EQUAL(1, Profiler::getBucketCount(SLOT, PROFILER_BUCKET_COUNT - 1));
+  TEST_ASSERT_EQUAL(0, Profiler::getBucketCount(SLOT, PROFILER_BUCKET_COUNT));
+}
+
+void test_percentiles() {
+  Profiler::reset();
+  for (int i = 0; i < 98; i++) Profiler::record(SLOT, 100);
+  Profiler::record(SLOT, 5000);
+  Profiler::record(SLOT, 70000);
+  TEST_ASSERT_EQUAL(6, Profiler::getPercentileBucket(SLOT, 50));
+  TEST_ASSERT_EQUAL(6, Profiler::getPercentileBucket(SLOT, 98));
+  TEST_ASSERT_EQUAL(12, Profiler::getPercentileBucket(SLOT, 99));
+  TEST_ASSERT_EQUAL(16, Profiler::getPercentileBucket(SLOT, 100));
+  TEST_ASSERT_EQUAL(70000, Profiler::getMaxCycles(SLOT));
+}
+
+void test_slots_are_independent() {
+  Profiler::reset();
+  Profiler::record(PROFILER_SLOT_STATE_LOOP, 100);
+  Profiler::record(PROFILER_SLOT_STATE_LOOP, 200);
+  Profiler::record(PROFILER_SLOT_CLIENT_LOOP, 300);
+  Profiler::record(PROFILER_SLOT_COUNT, 400);
+  TEST_ASSERT_EQUAL(2, Profiler::getCount(PROFILER_SLOT_STATE_LOOP));
+  TEST_ASSERT_EQUAL(200, Profiler::getMaxCycles(PROFILER_SLOT_STATE_LOOP));
+  TEST_ASSERT_EQUAL(1, Profiler::getCount(PROFILER_SLOT_CLIENT_LOOP));
+  TEST_ASSERT_EQUAL(0, Profiler::getCount(PROFILER_SLOT_COUNT));
+  TEST_ASSERT_EQUAL_STRING("state.loop", Profiler::getName(PROFILER_SLOT_STATE_LOOP));
+  TEST_ASSERT_EQUAL_STRING("response.ready", Profiler::getName(PROFILER_SLOT_RESPONSE_READY));
+  TEST_ASSERT_NULL(Profiler::getName(PROFILER_SLOT_COUNT));
+
+  Profiler::reset();
+  TEST_ASSERT_EQUAL(0, Profiler::getCount(PROFILER_SLOT_STATE_LOOP));
+  TEST_ASSERT_EQUAL(0, Profiler::getMaxCycles(PROFILER_SLOT_STATE_LOOP));
+}
+
+void test_recent_runs() {
+  Profiler::enter(PROFILER_SLOT_CLIENT_LOOP);
+  Profiler::enter(PROFILER_SLOT_HMAC_COMPUTE);
+  TEST_ASSERT_EQUAL(0x22, Profiler::getActiveSlots());
+  Profiler::record(PROFILER_SLOT_HMAC_COMPUTE, 5000);
+  TEST_ASSERT_EQUAL(0x02, Profiler::getActiveSlots());
+  TEST_ASSERT_EQUAL(PROFILER_SLOT_HMAC_COMPUTE, Profiler::getRecent(0).slot);
+  TEST_ASSERT_EQUAL(5000, Profiler::getRecent(0).cycles);
+  Profiler::record(PROFILER_SLOT_CLIENT_LOOP, 9000);
+  TEST_ASSERT_EQUAL(0, Profiler::getActiveSlots());
+
+  for (uint32_t i = 0; i < PROFILER_RECENT_COUNT + 3; i++) Profiler::record(PROFILER_SLOT_STATE_LOOP, i);
+  Profiler::record(PROFILER_SLOT_COUNT, 400);
+  TEST_ASSERT_EQUAL(PROFILER_RECENT_COUNT, Profiler::getRecentCount());
+  TEST_ASSERT_EQUAL(PROFILER_RECENT_COUNT + 2, Profiler::getRecent(0).cycles);
+  TEST_ASSERT_EQUAL(3, Profiler::getRecent(PROFILER_RECENT_COUNT - 1).cycles);
+  TEST_ASSERT_EQUAL(0, Profiler::getRecent(PROFILER_RECENT_COUNT).cycles);
+
+  // Kept through the hourly reset of the histograms
+  Profiler::reset();
+  TEST_ASSERT_EQUAL(PROFILER_RECENT_COUNT, Profiler::getRecentCount());
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_empty);
+  RUN_TEST(test_buckets);
+  RUN_TEST(test_percentiles);
+  RUN_TEST(test_slots_are_independent);
+  RUN_TEST(test_recent_runs);
+  UNITY_END();
+}
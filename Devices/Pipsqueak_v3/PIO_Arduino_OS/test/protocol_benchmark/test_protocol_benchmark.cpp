@@ -0,0 +1,353 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <Hmac.h>
+#include <TelemetryProtocol.h>
+
+// Micro-benchmarks of a telemetry exchange's hot path, at the batch
+// sizes the client sends. Prints one line of JSON to Serial (stdout
+// on the host) for regression tracking; on the host, the JSON is
+// also written to the file named by $BENCHMARK_OUTPUT, if set.
+//
+//   pio test -e native -f protocol_benchmark
+//   pio test -e pipsqueak_v3 -f protocol_benchmark
+//
+// Times come from ESP.getCycleCount() on the device and from the
+// host's monotonic clock natively, since the native millis() and
+// cycle count are virtual. Heap allocations are counted on the host
+// only, by replacing operator new; the esp8266 core defines its own.
+
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "dev"
+#endif
+
+#ifdef ARDUINO_ARCH_ESP8266
+#define BENCHMARK_ITERATIONS 200
+#define BENCHMARK_PLATFORM "esp8266"
+#else
+#define BENCHMARK_ITERATIONS 20000
+#define BENCHMARK_PLATFORM "native"
+#endif
+
+#define SECRET_KEY "ThisIsATopSecret32ByteValuePad32"
+#define DEVICE_ID 127
+#define MOCK_NOW 1234567898
+#define CHALLENGE 3876543210
+#define BENCHMARK_RESULT_LIMIT 16
+#define JSON_BUFFER_SIZE 3072
+
+#ifndef ARDUINO_ARCH_ESP8266
+#include <chrono>
+#include <new>
+
+static size_t allocations = 0;
+
+void * operator new(size_t size) {
+  allocations += 1;
+  void * pointer = malloc(size > 0 ? size : 1);
+  if (pointer == NULL) throw std::bad_alloc();
+  return pointer;
+}
+
+void * operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void * pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void * pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete(void * pointer, size_t size) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void * pointer, size_t size) noexcept {
+  free(pointer);
+}
+#endif
+
+struct BenchmarkResult {
+  const char * name;
+  uint8_t events;
+  uint32_t iterations;
+  double nsPerOp;
+  double cyclesPerOp; // device only
+  uint32_t bytesCopiedPerOp;
+  uint32_t bytesHashedPerOp;
+  int32_t allocationsPerOp; // host only; -1 if not counted
+};
+
+/**
+ * The state a benchmark's setup and operation steps share.
+ */
+struct BenchmarkContext {
+  TelemetryRequest * request;
+  StatusEvent statusEvent;
+  byte eventBuffer[STATUS_EVENT_SIZE];
+  byte signedResponse[TELEMETRY_RESPONSE_SIZE];
+  uint8_t events;
+};
+
+typedef void (*BenchmarkStep)(BenchmarkContext * context);
+
+static BenchmarkResult results[BENCHMARK_RESULT_LIMIT];
+static size_t resultCount = 0;
+static Hmac hmac((const byte *) SECRET_KEY);
+static TelemetryRequest request(DEVICE_ID, &hmac);
+static BenchmarkContext context = { &request };
+
+static uint32_t readClock() {
+  #ifdef ARDUINO_ARCH_ESP8266
+  return ESP.getCycleCount();
+  #else
+  return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+  #endif
+}
+
+// Times a batch of iterations between one pair of clock reads, so
+// the cost of reading the clock is spread across the batch rather
+// than dwarfing a cheap operation. In ns on the host; in cycles on
+// the device.
+static uint32_t timeBatch(BenchmarkStep setup, BenchmarkStep operation) {
+  uint32_t start = readClock();
+  for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    if (setup) setup(&context);
+    if (operation) operation(&context);
+    // Keep the device's watchdog fed between iterations
+    if (i % 16 == 0) yield();
+  }
+  return readClock() - start;
+}
+
+// The operation's mean cost: a batch of setups alone is timed and
+// taken off a batch of setups and operations, so the setup steps
+// must cost the same whatever state they find. The operations run
+// last, leaving the state the tests check.
+static double measure(BenchmarkStep setup, BenchmarkStep operation) {
+  int64_t elapsed = -(int64_t) timeBatch(setup, NULL);
+  elapsed += timeBatch(setup, operation);
+  return (double) elapsed / BENCHMARK_ITERATIONS;
+}
+
+static void run(const char * name, uint8_t events, BenchmarkStep setup, BenchmarkStep operation, uint32_t bytesCopied, uint32_t bytesHashed) {
+  if (resultCount >= BENCHMARK_RESULT_LIMIT) return;
+  context.events = events;
+
+  #ifndef ARDUINO_ARCH_ESP8266
+  if (setup) setup(&context);
+  size_t allocationsBefore = allocations;
+  operation(&context);
+  int32_t allocationsPerOp = (int32_t) (allocations - allocationsBefore);
+  #else
+  int32_t allocationsPerOp = -1;
+  #endif
+
+  double elapsed = measure(setup, operation);
+
+  BenchmarkResult * result = &results[resultCount++];
+  result->name = name;
+  result->events = events;
+  result->iterations = BENCHMARK_ITERATIONS;
+  #ifdef ARDUINO_ARCH_ESP8266
+  result->cyclesPerOp = elapsed;
+  result->nsPerOp = elapsed * 1000.0 / ESP.getCpuFreqMHz();
+  #else
+  result->cyclesPerOp = 0;
+  result->nsPerOp = elapsed;
+  #endif
+  result->bytesCopiedPerOp = bytesCopied;
+  result->bytesHashedPerOp = bytesHashed;
+  result->allocationsPerOp = allocationsPerOp;
+}
+
+// Steps /////////////////////////////////////////////////////////////////////////////////////////
+
+static void serializeEvents(BenchmarkContext * context) {
+  for (uint8_t i = 0; i < context->events; i++) {
+    context->statusEvent.temperatureObservation(MOCK_NOW - i, 18.5 + i * 0.0625);
+    context->statusEvent.write(context->eventBuffer);
+  }
+}
+
+static void resetRequest(BenchmarkContext * context) {
+  context->request->reset();
+}
+
+static void addEvents(BenchmarkContext * context) {
+  for (uint8_t i = 0; i < context->events; i++) {
+    context->statusEvent.temperatureObservation(MOCK_NOW - i, 18.5 + i * 0.0625);
+    context->request->addStatusEvent(&context->statusEvent);
+  }
+}
+
+static void retryRequest(BenchmarkContext * context) {
+  context->request->failed();
+}
+
+static void readyRequest(BenchmarkContext * context) {
+  context->request->ready(MOCK_NOW, CHALLENGE);
+}
+
+static void awaitResponse(BenchmarkContext * context) {
+  Response * response = context->request->getResponse();
+  response->reset();
+  response->setChallenge(CHALLENGE);
+}
+
+static void receiveResponse(BenchmarkContext * context) {
+  // One segment, as lwIP usually delivers a response this small
+  context->request->getResponse()->receiveBytes(context->signedResponse, TELEMETRY_RESPONSE_SIZE);
+}
+
+static void awaitAndReceiveResponse(BenchmarkContext * context) {
+  awaitResponse(context);
+  receiveResponse(context);
+}
+
+static void readyResponse(BenchmarkContext * context) {
+  context->request->getResponse()->ready(1);
+}
+
+static void signResponse() {
+  byte * response = context.signedResponse;
+  memset(response, 0, TELEMETRY_RESPONSE_SIZE);
+  response[RESPONSE_PROTOCOL_ID_OFFSET] = TELEMETRY_PROTOCOL_ID;
+  uint32_t timestamp = MOCK_NOW + 1;
+  memcpy(&response[RESPONSE_TIMESTAMP_OFFSET], &timestamp, 4);
+  uint32_t challenge = CHALLENGE;
+  memcpy(&response[RESPONSE_CHALLENGE_OFFSET], &challenge, 4);
+  hmac.generate(response, RESPONSE_HEADER_SIZE, &response[RESPONSE_HEADER_SIZE]);
+}
+
+// Output /////////////////////////////////////////////////////////////////////////////////////////
+
+static size_t writeJson(char * buffer, size_t size) {
+  size_t length = snprintf(buffer, size, "{\"suite\":\"protocol\",\"firmware\":\"%s\",\"platform\":\"%s\",",
+    FIRMWARE_VERSION, BENCHMARK_PLATFORM);
+  #ifdef ARDUINO_ARCH_ESP8266
+  if (length < size) length += snprintf(buffer + length, size - length, "\"cpuMHz\":%u,", (unsigned) ESP.getCpuFreqMHz());
+  #endif
+  if (length < size) length += snprintf(buffer + length, size - length, "\"results\":[");
+  for (size_t i = 0; i < resultCount && length < size; i++) {
+    BenchmarkResult * result = &results[i];
+    length += snprintf(buffer + length, size - length,
+      "%s{\"name\":\"%s\",\"events\":%u,\"iterations\":%u,\"nsPerOp\":%.1f,",
+      i == 0 ? "" : ",", result->name, result->events, (unsigned) result->iterations, result->nsPerOp);
+    if (length >= size) break;
+    #ifdef ARDUINO_ARCH_ESP8266
+    length += snprintf(buffer + length, size - length, "\"cyclesPerOp\":%.0f,", result->cyclesPerOp);
+    if (length >= size) break;
+    #endif
+    length += snprintf(buffer + length, size - length, "\"bytesCopiedPerOp\":%u,\"bytesHashedPerOp\":%u,\"allocationsPerOp\":",
+      (unsigned) result->bytesCopiedPerOp, (unsigned) result->bytesHashedPerOp);
+    if (length >= size) break;
+    if (result->allocationsPerOp < 0) {
+      length += snprintf(buffer + length, size - length, "null}");
+    } else {
+      length += snprintf(buffer + length, size - length, "%d}", (int) result->allocationsPerOp);
+    }
+  }
+  if (length < size) length += snprintf(buffer + length, size - length, "]}");
+  return length;
+}
+
+static void report() {
+  static char json[JSON_BUFFER_SIZE];
+  size_t length = writeJson(json, sizeof(json));
+  TEST_ASSERT_TRUE(length < sizeof(json));
+  Serial.println(json);
+
+  #ifndef ARDUINO_ARCH_ESP8266
+  const char * path = getenv("BENCHMARK_OUTPUT");
+  if (path != NULL) {
+    FILE * file = fopen(path, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    fprintf(file, "%s\n", json);
+    fclose(file);
+  }
+  #endif
+}
+
+// Tests //////////////////////////////////////////////////////////////////////////////////////////
+
+static const uint8_t batchSizes[] = { 1, 8, 32 };
+
+void test_status_event_serialization() {
+  for (uint8_t events : batchSizes) {
+    run("status_event_write", events, NULL, serializeEvents, events * STATUS_EVENT_SIZE, 0);
+  }
+}
+
+void test_add_status_event() {
+  for (uint8_t events : batchSizes) {
+    run("add_status_event", events, resetRequest, addEvents, events * STATUS_EVENT_SIZE, 0);
+    TEST_ASSERT_EQUAL(events, request.getBuffer()[TELEMETRY_REQUEST_COUNT_OFFSET]);
+  }
+}
+
+void test_request_ready() {
+  for (uint8_t events : batchSizes) {
+    resetRequest(&context);
+    context.events = events;
+    addEvents(&context);
+    size_t hashed = request.getSize() - HMAC_SIZE;
+    // failed() keeps the events, so that every ready() signs a
+    // request of the batch's size
+    run("request_ready", events, retryRequest, readyRequest, 4 + 4 + HMAC_SIZE, hashed);
+    TEST_ASSERT_TRUE(request.isInFlight());
+    TEST_ASSERT_EQUAL(REQUEST_BASE_SIZE + events * STATUS_EVENT_SIZE, request.getSize());
+  }
+}
+
+void test_response_receive_bytes() {
+  signResponse();
+  run("response_receive_bytes", 0, awaitResponse, receiveResponse, TELEMETRY_RESPONSE_SIZE, 0);
+  TEST_ASSERT_TRUE(request.getResponse()->isComplete());
+}
+
+void test_response_ready() {
+  signResponse();
+  run("response_ready", 0, awaitAndReceiveResponse, readyResponse, TELEMETRY_RESPONSE_SIZE, RESPONSE_HEADER_SIZE);
+  // Every iteration validated an authentic response
+  TEST_ASSERT_TRUE(request.getResponse()->isAuthentic());
+  TEST_ASSERT_FALSE(request.getResponse()->hasErrors());
+}
+
+void test_every_operation_timed() {
+  for (size_t i = 0; i < resultCount; i++) {
+    TEST_ASSERT_TRUE_MESSAGE(results[i].nsPerOp > 0, results[i].name);
+  }
+}
+
+void test_no_allocations() {
+  for (size_t i = 0; i < resultCount; i++) {
+    TEST_ASSERT_TRUE(results[i].allocationsPerOp <= 0);
+  }
+}
+
+void test_report() {
+  report();
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_status_event_serialization);
+  RUN_TEST(test_add_status_event);
+  RUN_TEST(test_request_ready);
+  RUN_TEST(test_response_receive_bytes);
+  RUN_TEST(test_response_ready);
+  RUN_TEST(test_every_operation_timed);
+  RUN_TEST(test_no_allocations);
+  RUN_TEST(test_report);
+  UNITY_END();
+}
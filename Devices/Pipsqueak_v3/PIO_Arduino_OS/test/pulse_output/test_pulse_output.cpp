@@ -0,0 +1,93 @@
+#include <Arduino.h>
+#include <ArduinoNative.h>
+#include <unity.h>
+#include <core_esp8266_waveform.h>
+#include <PulseOutput.h>
+
+// Native only: runs against the waveform generator in native/ArduinoNative
+
+#define PIN_OUTPUT 15
+
+// Percent of the next period the pin spends high, sampled each ms
+static uint32_t sampleDuty(uint32_t period) {
+  uint32_t high = 0;
+  for (uint32_t i = 0; i < period; i++) {
+    if (ArduinoNative::getPinState(PIN_OUTPUT) == HIGH) high++;
+    ArduinoNative::advanceMillis(1);
+  }
+  return high * 100 / period;
+}
+
+void test_generator_refuses_times_it_cannot_count() {
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  // 2^31 cycles at 80 MHz is 26.8 s
+  TEST_ASSERT_TRUE(startWaveform(PIN_OUTPUT, 1000, 1000, 26000000));
+  TEST_ASSERT_FALSE(startWaveform(PIN_OUTPUT, 1000, 1000, 30000000));
+  TEST_ASSERT_FALSE(startWaveform(PIN_OUTPUT, 30000000, 0, 0));
+  stopWaveform(PIN_OUTPUT);
+}
+
+void test_short_pulse_ends_on_timer() {
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  PulseOutput output;
+  output.setup(PIN_OUTPUT);
+  TEST_ASSERT_TRUE(output.start(1000));
+  TEST_ASSERT_EQUAL(HIGH, ArduinoNative::getPinState(PIN_OUTPUT));
+  // Without isActive() being checked
+  ArduinoNative::advanceMillis(1000);
+  TEST_ASSERT_EQUAL(LOW, ArduinoNative::getPinState(PIN_OUTPUT));
+  TEST_ASSERT_FALSE(output.isActive());
+}
+
+void test_long_pulse_at_full_power() {
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  PulseOutput output;
+  output.setup(PIN_OUTPUT);
+  // The longest control period autotuning sets
+  TEST_ASSERT_TRUE(output.start(120000));
+  for (uint32_t t = 0; t < 120000; t += 100) {
+    TEST_ASSERT_TRUE(output.isActive());
+    TEST_ASSERT_EQUAL(HIGH, ArduinoNative::getPinState(PIN_OUTPUT));
+    ArduinoNative::advanceMillis(100);
+  }
+  TEST_ASSERT_FALSE(output.isActive());
+  TEST_ASSERT_EQUAL(LOW, ArduinoNative::getPinState(PIN_OUTPUT));
+}
+
+void test_long_pulse_at_partial_power() {
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  PulseOutput output;
+  output.setup(PIN_OUTPUT);
+  TEST_ASSERT_TRUE(output.start(30000, 40));
+  TEST_ASSERT_EQUAL(40, sampleDuty(PULSE_OUTPUT_PWM_PERIOD));
+  // Past where the generator's count would have overflowed
+  ArduinoNative::advanceMillis(27000);
+  TEST_ASSERT_TRUE(output.isActive());
+  TEST_ASSERT_EQUAL(40, sampleDuty(PULSE_OUTPUT_PWM_PERIOD));
+  ArduinoNative::advanceMillis(30000 - 27000 - 2 * PULSE_OUTPUT_PWM_PERIOD);
+  TEST_ASSERT_FALSE(output.isActive());
+  TEST_ASSERT_EQUAL(LOW, ArduinoNative::getPinState(PIN_OUTPUT));
+}
+
+void test_stop() {
+  ArduinoNative::reboot(REASON_DEFAULT_RST);
+  PulseOutput output;
+  output.setup(PIN_OUTPUT);
+  TEST_ASSERT_TRUE(output.start(60000, 100));
+  output.stop();
+  TEST_ASSERT_FALSE(output.isActive());
+  TEST_ASSERT_EQUAL(LOW, ArduinoNative::getPinState(PIN_OUTPUT));
+}
+
+void setup() {
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_generator_refuses_times_it_cannot_count);
+  RUN_TEST(test_short_pulse_ends_on_timer);
+  RUN_TEST(test_long_pulse_at_full_power);
+  RUN_TEST(test_long_pulse_at_partial_power);
+  RUN_TEST(test_stop);
+  UNITY_END();
+}
@@ -0,0 +1,211 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <RelayAutotune.h>
+#include <PidLoop.h>
+
+#define SETPOINT 20.0
+#define HYSTERESIS 0.125
+#define SAMPLE_INTERVAL 10000 // ms
+
+/**
+ * A first-order-plus-dead-time vessel: the temperature approaches
+ * ambient + gain * output with the given time constant, after the
+ * given dead time.
+ */
+class Vessel {
+  public:
+    Vessel(float temperature, float ambient, float gain, float timeConstant, uint32_t deadTime)
+    :
+      _temperature { temperature },
+      _ambient { ambient },
+      _gain { gain },
+      _timeConstant { timeConstant },
+      _delaySamples { deadTime / SAMPLE_INTERVAL },
+      _cursor { 0 }
+    {
+      for (size_t i = 0; i < 64; i++) _outputs[i] = 0;
+    }
+
+    float step(float output) {
+      _outputs[_cursor] = output;
+      float delayed = _outputs[(_cursor + 64 - _delaySamples) % 64];
+      _cursor = (_cursor + 1) % 64;
+      float target = _ambient + _gain * delayed;
+      _temperature += (target - _temperature) * (SAMPLE_INTERVAL / 1000.0) / _timeConstant;
+      return _temperature;
+    }
+
+  private:
+    float _temperature;
+    float _ambient;
+    float _gain;
+    float _timeConstant;
+    size_t _delaySamples;
+    size_t _cursor;
+    float _outputs[64];
+};
+
+void test_starts_idle() {
+  RelayAutotune autotune(1.0, 0.0, HYSTERESIS);
+
+  TEST_ASSERT_FALSE(autotune.isRunning());
+  TEST_ASSERT_EQUAL(AutotuneIdle, autotune.getOutcome());
+  TEST_ASSERT_EQUAL_FLOAT(0.0, autotune.update(SETPOINT, 0));
+}
+
+void test_relay_switching() {
+  RelayAutotune autotune(1.0, 0.0, HYSTERESIS);
+  autotune.start(SETPOINT, 0);
+
+  TEST_ASSERT_EQUAL_FLOAT(1.0, autotune.update(19.0, 1000));
+  // Within the band, the relay holds its state
+  TEST_ASSERT_EQUAL_FLOAT(1.0, autotune.update(20.1, 2000));
+  TEST_ASSERT_EQUAL_FLOAT(0.0, autotune.update(20.2, 3000));
+  TEST_ASSERT_EQUAL_FLOAT(0.0, autotune.update(19.9, 4000));
+  TEST_ASSERT_EQUAL_FLOAT(1.0, autotune.update(19.8, 5000));
+  TEST_ASSERT_TRUE(autotune.isRunning());
+}
+
+void test_sine_limit_cycle() {
+  RelayAutotune autotune(1.0, 0.0, HYSTERESIS);
+  autotune.start(SETPOINT, 0);
+
+  // Feed a 0.5 degree, one hour oscillation as if it were the response
+  uint32_t period = 3600000;
+  uint32_t t = 0;
+  while (autotune.isRunning() && t < 10 * period) {
+    autotune.update(SETPOINT + 0.5 * sinf(2 * PI * t / period), t);
+    t += SAMPLE_INTERVAL;
+  }
+
+  TEST_ASSERT_EQUAL(AutotuneSucceeded, autotune.getOutcome());
+  TEST_ASSERT_UINT32_WITHIN(SAMPLE_INTERVAL, period, autotune.getUltimatePeriod());
+  float expectedGain = 4 * 0.5 / (PI * sqrtf(0.25 - HYSTERESIS * HYSTERESIS));
+  TEST_ASSERT_FLOAT_WITHIN(0.01, expectedGain, autotune.getUltimateGain());
+  TEST_ASSERT_FLOAT_WITHIN(0.01, expectedGain / 2.2, autotune.getProportionalGain());
+  TEST_ASSERT_EQUAL_UINT32(AUTOTUNE_MAX_CONTROL_PERIOD, autotune.getControlPeriod());
+}
+
+void test_vessel_converges() {
+  RelayAutotune autotune(1.0, 0.0, HYSTERESIS);
+  // 10 degrees of heating headroom, 40 minute time constant, 2 minute dead time
+  Vessel vessel(18.0, 12.0, 10.0, 2400, 120000);
+  autotune.start(SETPOINT, 0);
+
+  float output = 0;
+  uint32_t t = 0;
+  while (autotune.isRunning()) {
+    output = autotune.update(vessel.step(output), t);
+    t += SAMPLE_INTERVAL;
+  }
+
+  TEST_ASSERT_EQUAL(AutotuneSucceeded, autotune.getOutcome());
+  TEST_ASSERT_GREATER_THAN(0, autotune.getUltimatePeriod());
+  TEST_ASSERT_GREATER_THAN(0, autotune.getProportionalGain());
+  TEST_ASSERT_GREATER_THAN(0, autotune.getIntegralGain());
+  TEST_ASSERT_GREATER_THAN(0, autotune.getDerivativeGain());
+  uint32_t controlPeriod = autotune.getControlPeriod();
+  TEST_ASSERT_TRUE(controlPeriod >= AUTOTUNE_MIN_CONTROL_PERIOD && controlPeriod <= AUTOTUNE_MAX_CONTROL_PERIOD);
+}
+
+void test_gains_hold_vessel_at_setpoint() {
+  RelayAutotune autotune(1.0, 0.0, HYSTERESIS);
+  Vessel vessel(18.0, 12.0, 10.0, 2400, 120000);
+  autotune.start(SETPOINT, 0);
+
+  float output = 0;
+  uint32_t t = 0;
+  while (autotune.isRunning()) {
+    output = autotune.update(vessel.step(output), t);
+    t += SAMPLE_INTERVAL;
+  }
+  TEST_ASSERT_EQUAL(AutotuneSucceeded, autotune.getOutcome());
+
+  // Close the loop as the controller does: the gains as stored, an
+  // output from full chill to full heat, held for each control period
+  PidLoop pid(autotune.getProportionalGain(), autotune.getIntegralGain(), autotune.getDerivativeGain(), -1.0, 1.0);
+  uint32_t controlPeriod = autotune.getControlPeriod();
+  float temperature = vessel.step(output);
+  float worstError = 0;
+  uint32_t sinceUpdate = controlPeriod;
+  for (uint32_t elapsed = 0; elapsed < 24 * 3600000; elapsed += SAMPLE_INTERVAL) {
+    if (sinceUpdate >= controlPeriod) {
+      output = pid.update(SETPOINT, temperature, sinceUpdate / 1000.0);
+      sinceUpdate = 0;
+    }
+    temperature = vessel.step(output);
+    sinceUpdate += SAMPLE_INTERVAL;
+    // Judge the final 6 hours, once the loop has had time to settle
+    if (elapsed >= 18 * 3600000) worstError = max(worstError, fabsf(temperature - SETPOINT));
+  }
+
+  TEST_ASSERT_FLOAT_WITHIN(0.25, 0.0, worstError);
+}
+
+void test_times_out_without_crossing() {
+  RelayAutotune autotune(1.0, 0.0, HYSTERESIS);
+  autotune.start(SETPOINT, 0);
+
+  // Not enough heat to ever reach the setpoint
+  uint32_t t = 0;
+  while (autotune.isRunning() && t <= AUTOTUNE_HALF_CYCLE_TIMEOUT + SAMPLE_INTERVAL) {
+    autotune.update(18.0, t);
+    t += SAMPLE_INTERVAL;
+  }
+
+  TEST_ASSERT_EQUAL(AutotuneTimedOut, autotune.getOutcome());
+  TEST_ASSERT_EQUAL_FLOAT(0.0, autotune.update(18.0, t));
+}
+
+void test_refused_when_resting_above_band() {
+  RelayAutotune autotune(1.0, 0.0, HYSTERESIS);
+
+  // A heater can't bring a vessel below a warmer room's temperature
+  autotune.start(SETPOINT, 0, SETPOINT + 2.0);
+  TEST_ASSERT_FALSE(autotune.isRunning());
+  TEST_ASSERT_EQUAL(AutotuneRefused, autotune.getOutcome());
+  TEST_ASSERT_EQUAL_FLOAT(0.0, autotune.update(SETPOINT, 1000));
+
+  autotune.start(SETPOINT, 0, SETPOINT - HYSTERESIS);
+  TEST_ASSERT_EQUAL(AutotuneRefused, autotune.getOutcome());
+
+  autotune.start(SETPOINT, 0, SETPOINT - 2.0);
+  TEST_ASSERT_TRUE(autotune.isRunning());
+}
+
+void test_abort() {
+  RelayAutotune autotune(1.0, 0.0, HYSTERESIS);
+  autotune.start(SETPOINT, 0);
+  autotune.abort();
+
+  TEST_ASSERT_FALSE(autotune.isRunning());
+  TEST_ASSERT_EQUAL(AutotuneAborted, autotune.getOutcome());
+}
+
+void test_nan_aborts() {
+  RelayAutotune autotune(1.0, 0.0, HYSTERESIS);
+  autotune.start(SETPOINT, 0);
+
+  TEST_ASSERT_EQUAL_FLOAT(0.0, autotune.update(NAN, 1000));
+  TEST_ASSERT_EQUAL(AutotuneAborted, autotune.getOutcome());
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_starts_idle);
+  RUN_TEST(test_relay_switching);
+  RUN_TEST(test_sine_limit_cycle);
+  RUN_TEST(test_vessel_converges);
+  RUN_TEST(test_gains_hold_vessel_at_setpoint);
+  RUN_TEST(test_times_out_without_crossing);
+  RUN_TEST(test_refused_when_resting_above_band);
+  RUN_TEST(test_abort);
+  RUN_TEST(test_nan_aborts);
+  UNITY_END();
+}
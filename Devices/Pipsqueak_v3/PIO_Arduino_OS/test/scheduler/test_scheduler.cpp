@@ -0,0 +1,161 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <Scheduler.h>
+
+uint32_t runs[SCHEDULER_TASK_LIMIT + 1];
+uint32_t overruns;
+
+void count(void * context) {
+  runs[(size_t) context] += 1;
+}
+
+void block(void * context) {
+  runs[(size_t) context] += 1;
+  delay(50);
+}
+
+void countOverrun(TaskID task, void * context) {
+  overruns += 1;
+}
+
+void runFor(Scheduler * scheduler, uint32_t duration) {
+  uint32_t start = millis();
+  while (millis() - start < duration) scheduler->loop();
+}
+
+void reset() {
+  memset(runs, 0, sizeof(runs));
+  overruns = 0;
+}
+
+void test_periodic() {
+  reset();
+  Scheduler scheduler;
+  TaskID fast = scheduler.every("fast", 20, count, (void *) 0);
+  TaskID slow = scheduler.every("slow", 100, count, (void *) 1);
+
+  runFor(&scheduler, 500);
+
+  TEST_ASSERT_UINT32_WITHIN(1, 25, runs[0]);
+  TEST_ASSERT_UINT32_WITHIN(1, 5, runs[1]);
+  TEST_ASSERT_EQUAL_UINT32(runs[0], scheduler.getRunCount(fast));
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.getOverrunCount(slow));
+  TEST_ASSERT_EQUAL_STRING("slow", scheduler.getName(slow));
+}
+
+void test_idle_until_deadline() {
+  reset();
+  Scheduler scheduler;
+  scheduler.every("task", 100, count, (void *) 0);
+
+  TEST_ASSERT_UINT32_WITHIN(1, 100, scheduler.runDue());
+  TEST_ASSERT_EQUAL_UINT32(1, runs[0]);
+  delay(40);
+  TEST_ASSERT_UINT32_WITHIN(1, 60, scheduler.runDue());
+  TEST_ASSERT_EQUAL_UINT32(1, runs[0]);
+}
+
+void test_one_shot() {
+  reset();
+  Scheduler scheduler;
+  TaskID task = scheduler.once("once", count, (void *) 0);
+
+  runFor(&scheduler, 50);
+  TEST_ASSERT_EQUAL_UINT32(0, runs[0]);
+
+  scheduler.wakeIn(task, 30);
+  runFor(&scheduler, 20);
+  TEST_ASSERT_EQUAL_UINT32(0, runs[0]);
+  runFor(&scheduler, 50);
+  TEST_ASSERT_EQUAL_UINT32(1, runs[0]);
+
+  // Wakes before the task runs coalesce
+  scheduler.wake(task);
+  scheduler.wake(task);
+  scheduler.runDue();
+  TEST_ASSERT_EQUAL_UINT32(2, runs[0]);
+}
+
+void test_wake_ahead_of_deadline() {
+  reset();
+  Scheduler scheduler;
+  TaskID task = scheduler.every("task", 1000, count, (void *) 0);
+  scheduler.runDue();
+
+  scheduler.wake(task);
+  scheduler.runDue();
+  TEST_ASSERT_EQUAL_UINT32(2, runs[0]);
+  // The period is undisturbed
+  TEST_ASSERT_UINT32_WITHIN(1, 1000, scheduler.runDue());
+}
+
+void test_cancel() {
+  reset();
+  Scheduler scheduler;
+  TaskID task = scheduler.every("task", 10, count, (void *) 0);
+  scheduler.cancel(task);
+
+  runFor(&scheduler, 50);
+  TEST_ASSERT_EQUAL_UINT32(0, runs[0]);
+}
+
+void test_overrun() {
+  reset();
+  Scheduler scheduler;
+  scheduler.onOverrun(countOverrun, NULL);
+  TaskID blocking = scheduler.every("blocking", 100, block, (void *) 0);
+  TaskID victim = scheduler.every("victim", 10, count, (void *) 1);
+
+  runFor(&scheduler, 300);
+
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.getOverrunCount(blocking));
+  TEST_ASSERT_GREATER_OR_EQUAL(2, scheduler.getOverrunCount(victim));
+  TEST_ASSERT_EQUAL_UINT32(scheduler.getOverrunCount(victim), overruns);
+  TEST_ASSERT_GREATER_OR_EQUAL(40, scheduler.getMaxLateness(victim));
+  TEST_ASSERT_GREATER_OR_EQUAL(50000, scheduler.getMaxDuration(blocking));
+  // Missed activations are skipped rather than run back to back
+  TEST_ASSERT_LESS_THAN(30, runs[1]);
+}
+
+void test_task_limit() {
+  Scheduler scheduler;
+  for (size_t i = 0; i < SCHEDULER_TASK_LIMIT; i++) {
+    TEST_ASSERT_EQUAL_INT8(i, scheduler.once("task", count, (void *) i));
+  }
+  TEST_ASSERT_EQUAL_INT8(SCHEDULER_NO_TASK, scheduler.once("task", count, (void *) SCHEDULER_TASK_LIMIT));
+  TEST_ASSERT_EQUAL_UINT32(SCHEDULER_TASK_LIMIT, scheduler.getTaskCount());
+}
+
+void test_idle_slice() {
+  reset();
+  Scheduler scheduler;
+  scheduler.every("task", 100, count, (void *) 0);
+  scheduler.every("busy", 100, block, (void *) 1);
+  scheduler.setIdleSlice(SCHEDULER_IDLE_LIMIT);
+
+  runFor(&scheduler, 1000);
+
+  // Slices end at the next deadline, so no activations are missed
+  TEST_ASSERT_UINT32_WITHIN(1, 10, runs[0]);
+  TEST_ASSERT_UINT32_WITHIN(1, 10, runs[1]);
+  TEST_ASSERT_UINT32_WITHIN(60, 500, scheduler.getIdleMillis());
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_periodic);
+  RUN_TEST(test_idle_until_deadline);
+  RUN_TEST(test_one_shot);
+  RUN_TEST(test_wake_ahead_of_deadline);
+  RUN_TEST(test_cancel);
+  RUN_TEST(test_overrun);
+  RUN_TEST(test_task_limit);
+  RUN_TEST(test_idle_slice);
+  UNITY_END();
+}
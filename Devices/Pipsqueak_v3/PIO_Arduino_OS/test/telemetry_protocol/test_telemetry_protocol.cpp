@@ -176,6 +176,72 @@ void test_response() {
   TEST_ASSERT_EQUAL(MOCK_LATER, subject->getResponse()->getTimestamp());
 }
 
+void test_tuning_result_event() {
+  StatusEvent * statusEvent = new StatusEvent();
+  byte actual[STATUS_EVENT_SIZE];
+  statusEvent->tuningResult(MOCK_NOW, 1.5, 1080, 2);
+  statusEvent->write(actual);
+  const byte expected[STATUS_EVENT_SIZE] = {
+    0x08, 0xDA, 0x02, 0x96, 0x49, 0x00, 0x00, 0xC0,
+    0x3F, 0x38, 0x04, 0x00, 0x00, 0x02, 0x00, 0x00
+  };
+  TEST_ASSERT_EQUAL_MEMORY(expected, actual, STATUS_EVENT_SIZE);
+  delete statusEvent;
+}
+
+void test_latency_histogram_event() {
+  StatusEvent * statusEvent = new StatusEvent();
+  byte actual[STATUS_EVENT_SIZE];
+  statusEvent->latencyHistogram(MOCK_NOW, 5, 1000, 0x00012345, 9, 14);
+  statusEvent->write(actual);
+  const byte expected[STATUS_EVENT_SIZE] = {
+    0x09, 0xDA, 0x02, 0x96, 0x49, 0x05, 0xE8, 0x03,
+    0x00, 0x00, 0x45, 0x23, 0x01, 0x00, 0x09, 0x0E
+  };
+  TEST_ASSERT_EQUAL_MEMORY(expected, actual, STATUS_EVENT_SIZE);
+  delete statusEvent;
+}
+
+void test_boot_timing_event() {
+  StatusEvent * statusEvent = new StatusEvent();
+  byte actual[STATUS_EVENT_SIZE];
+  statusEvent->bootTiming(MOCK_NOW, 3, STATUS_EVENT_BOOT_WARM, 1500, 0x00012345);
+  statusEvent->write(actual);
+  const byte expected[STATUS_EVENT_SIZE] = {
+    0x0A, 0xDA, 0x02, 0x96, 0x49, 0x03, 0x02, 0xDC,
+    0x05, 0x00, 0x00, 0x45, 0x23, 0x01, 0x00, 0x00
+  };
+  TEST_ASSERT_EQUAL_MEMORY(expected, actual, STATUS_EVENT_SIZE);
+  delete statusEvent;
+}
+
+void test_memory_low_water_event() {
+  StatusEvent * statusEvent = new StatusEvent();
+  byte actual[STATUS_EVENT_SIZE];
+  statusEvent->memoryLowWater(MOCK_NOW, 0x00009C40, 0x00007D00, 23, 0x00012345);
+  statusEvent->write(actual);
+  const byte expected[STATUS_EVENT_SIZE] = {
+    0x0B, 0xDA, 0x02, 0x96, 0x49, 0x40, 0x9C, 0x00,
+    0x00, 0x00, 0x7D, 0x00, 0x00, 0x17, 0xFF, 0xFF
+  };
+  TEST_ASSERT_EQUAL_MEMORY(expected, actual, STATUS_EVENT_SIZE);
+  delete statusEvent;
+}
+
+void test_metric_snapshot_event() {
+  StatusEvent * statusEvent = new StatusEvent();
+  byte actual[STATUS_EVENT_SIZE];
+  const uint16_t slots[STATUS_EVENT_METRIC_SLOT_COUNT] = { 0x0102, 3, 0, 0xFFFF, 0x1234 };
+  statusEvent->metricSnapshot(MOCK_NOW, 15, slots);
+  statusEvent->write(actual);
+  const byte expected[STATUS_EVENT_SIZE] = {
+    0x0C, 0xDA, 0x02, 0x96, 0x49, 0x0F, 0x02, 0x01,
+    0x03, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0x34, 0x12
+  };
+  TEST_ASSERT_EQUAL_MEMORY(expected, actual, STATUS_EVENT_SIZE);
+  delete statusEvent;
+}
+
 void setup() {
   #ifdef ARDUINO
   delay(2000);
@@ -186,6 +252,11 @@ void setup() {
   RUN_TEST(test_failed);
   RUN_TEST(test_reset);
   RUN_TEST(test_response);
+  RUN_TEST(test_tuning_result_event);
+  RUN_TEST(test_latency_histogram_event);
+  RUN_TEST(test_boot_timing_event);
+  RUN_TEST(test_memory_low_water_event);
+  RUN_TEST(test_metric_snapshot_event);
   UNITY_END();
 }
 
@@ -0,0 +1,241 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <PidLoop.h>
+#include <FeedForward.h>
+
+#define HOUR 3600 // s
+
+// Mirrors PipsqueakController's PID mode
+#define CONTROL_PERIOD 30 // s
+#define PID_KP 0.5
+#define PID_KI 0.0005
+#define PID_KD 20.0
+#define FILTER_WEIGHT 0.2
+#define HEATER_MINIMUM_POWER 5 // percent
+#define CHILLER_MINIMUM_PULSE_DURATION 1 // s
+#define CHILLER_RECOVERY_DURATION 60 // s
+#define FEED_FORWARD_TIME_CONSTANT 86400 // s
+#define FEED_FORWARD_GAIN_LIMIT 0.5
+#define BOARD_SELF_HEATING 3.0 // degrees C, as assumed by the device
+
+// A one gallon ferment in a loosely insulated vessel. The heater
+// and chiller each warm or cool a small mass in contact with the
+// vessel, which delays their effect on the must.
+#define MUST_HEAT_CAPACITY 16000 // J/K
+#define VESSEL_LOSS 2.0 // W/K
+#define ELEMENT_HEAT_CAPACITY 800 // J/K
+#define ELEMENT_COUPLING 8.0 // W/K
+#define HEATER_POWER 60.0 // W
+#define CHILLER_POWER 100.0 // W
+#define ACTUAL_SELF_HEATING 3.5 // degrees C, a little off the device's assumption
+
+#define SIMULATION_DURATION (96 * HOUR)
+#define WARMUP_DURATION (24 * HOUR)
+
+struct Result {
+  float maxExcursion;
+  float rmsExcursion;
+  uint32_t heaterPulses;
+  uint32_t chillerPulses;
+  float heatingGain;
+  float chillingGain;
+};
+
+/**
+ * The room swings 3 degrees either side of 17C over each day,
+ * and a window left open on the third night drops it a further
+ * 4 degrees for 8 hours.
+ */
+float ambientAt(uint32_t t) {
+  float ambient = 17 + 3 * cosf(2 * PI * ((float) t - 15 * HOUR) / (24 * HOUR));
+  if (t > 54 * HOUR && t < 62 * HOUR) ambient -= 4;
+  return ambient;
+}
+
+/**
+ * Runs the vessel under PID control, one second at a time, and
+ * reports on the excursions and pulses after the warmup period.
+ *
+ * feedForward: whether to add the feed-forward term
+ * boardSensor: whether the board temperature is available
+ * fermentHeat: heat produced by the yeast, W
+ */
+Result simulate(float setpoint, bool feedForward, bool boardSensor, float fermentHeat) {
+  PidLoop pid(PID_KP, PID_KI, PID_KD, -1.0, 1.0);
+  FeedForward feed(FEED_FORWARD_TIME_CONSTANT, FEED_FORWARD_GAIN_LIMIT);
+  float must = setpoint;
+  float heater = setpoint;
+  float chiller = setpoint;
+  float filteredTemperature = NAN;
+  float filteredAmbient = NAN;
+  float heaterPower = 0;
+  bool heating = false;
+  bool chilling = false;
+  uint32_t pulseEnd = 0;
+  uint32_t lastToggled = 0;
+  uint32_t recoveryDuration = 0;
+  uint32_t lastControlPeriod = 0;
+  double squaredExcursions = 0;
+  Result result = { 0, 0, 0, 0, 0, 0 };
+
+  for (uint32_t t = 0; t < SIMULATION_DURATION; t++) {
+    float ambient = ambientAt(t);
+    heater += ((heating ? heaterPower : 0) - ELEMENT_COUPLING * (heater - must)) / ELEMENT_HEAT_CAPACITY;
+    chiller += ((chilling ? -CHILLER_POWER : 0) - ELEMENT_COUPLING * (chiller - must)) / ELEMENT_HEAT_CAPACITY;
+    must += (
+      ELEMENT_COUPLING * (heater - must) +
+      ELEMENT_COUPLING * (chiller - must) -
+      VESSEL_LOSS * (must - ambient) +
+      fermentHeat
+    ) / MUST_HEAT_CAPACITY;
+
+    // 12-bit remote sensor, 9-bit board sensor
+    float remoteReading = roundf(must / 0.0625) * 0.0625;
+    float boardReading = roundf((ambient + ACTUAL_SELF_HEATING) / 0.5) * 0.5;
+    float ambientEstimate = boardSensor ? boardReading - BOARD_SELF_HEATING : NAN;
+    if (isnan(filteredTemperature)) {
+      filteredTemperature = remoteReading;
+      filteredAmbient = ambientEstimate;
+    } else {
+      filteredTemperature += FILTER_WEIGHT * (remoteReading - filteredTemperature);
+      filteredAmbient += FILTER_WEIGHT * (ambientEstimate - filteredAmbient);
+    }
+
+    if (t >= WARMUP_DURATION) {
+      float excursion = fabsf(must - setpoint);
+      result.maxExcursion = max(result.maxExcursion, excursion);
+      squaredExcursions += excursion * excursion;
+    }
+
+    if ((heating || chilling) && t >= pulseEnd) {
+      heating = false;
+      chilling = false;
+      lastToggled = t;
+    }
+    if (heating || chilling || t - lastControlPeriod < CONTROL_PERIOD) continue;
+    lastControlPeriod = t;
+
+    float feedForwardTerm = feedForward ? feed.compute(setpoint, filteredAmbient) : 0;
+    float output = pid.update(setpoint, filteredTemperature, CONTROL_PERIOD, feedForwardTerm);
+    if (feedForward) feed.learn(output, setpoint, filteredTemperature, filteredAmbient, CONTROL_PERIOD);
+
+    if (output > 0) {
+      uint8_t percentPower = (uint8_t) roundf(output * 100);
+      if (percentPower >= HEATER_MINIMUM_POWER) {
+        heating = true;
+        heaterPower = HEATER_POWER * percentPower / 100;
+        pulseEnd = t + CONTROL_PERIOD;
+        recoveryDuration = 0;
+        if (t >= WARMUP_DURATION) result.heaterPulses += 1;
+      }
+    } else if (output < 0 && t - lastToggled >= recoveryDuration) {
+      float pulseDuration = -output * CONTROL_PERIOD;
+      if (pulseDuration >= CHILLER_MINIMUM_PULSE_DURATION / 2.0) {
+        chilling = true;
+        pulseEnd = t + max((uint32_t) roundf(pulseDuration), (uint32_t) CHILLER_MINIMUM_PULSE_DURATION);
+        recoveryDuration = CHILLER_RECOVERY_DURATION;
+        if (t >= WARMUP_DURATION) result.chillerPulses += 1;
+      }
+    }
+  }
+
+  result.rmsExcursion = sqrt(squaredExcursions / (SIMULATION_DURATION - WARMUP_DURATION));
+  result.heatingGain = feed.getHeatingGain();
+  result.chillingGain = feed.getChillingGain();
+  return result;
+}
+
+void test_learns_heat_loss() {
+  Result result = simulate(20.0, true, true, 0);
+
+  // Holding the setpoint takes VESSEL_LOSS / HEATER_POWER output per
+  // degree of gradient; the error in the self-heating assumption
+  // skews the estimate a little
+  TEST_ASSERT_FLOAT_WITHIN(0.005, VESSEL_LOSS / HEATER_POWER, result.heatingGain);
+  TEST_ASSERT_EQUAL_FLOAT(0, result.chillingGain);
+}
+
+// The heater or chiller carrying the load pulses in almost every
+// control period either way, so the total barely moves; what feed
+// forward saves is pulses of the other one correcting overshoot.
+void assertComparablePulses(Result feedback, Result feedForward) {
+  uint32_t feedbackPulses = feedback.heaterPulses + feedback.chillerPulses;
+  uint32_t feedForwardPulses = feedForward.heaterPulses + feedForward.chillerPulses;
+  TEST_ASSERT_LESS_OR_EQUAL(feedbackPulses + feedbackPulses / 100, feedForwardPulses);
+}
+
+void test_smaller_excursions_when_heating() {
+  Result feedback = simulate(20.0, false, true, 0);
+  Result feedForward = simulate(20.0, true, true, 0);
+
+  TEST_ASSERT_LESS_THAN(feedback.maxExcursion / 2, feedForward.maxExcursion);
+  TEST_ASSERT_LESS_THAN(feedback.rmsExcursion, feedForward.rmsExcursion);
+  TEST_ASSERT_LESS_THAN(feedback.chillerPulses / 2, feedForward.chillerPulses);
+  assertComparablePulses(feedback, feedForward);
+}
+
+void test_smaller_excursions_when_chilling() {
+  Result feedback = simulate(12.0, false, true, 0);
+  Result feedForward = simulate(12.0, true, true, 0);
+
+  TEST_ASSERT_LESS_THAN(feedback.maxExcursion / 2, feedForward.maxExcursion);
+  TEST_ASSERT_LESS_THAN(feedback.rmsExcursion, feedForward.rmsExcursion);
+  TEST_ASSERT_LESS_THAN(feedback.heaterPulses, feedForward.heaterPulses);
+  assertComparablePulses(feedback, feedForward);
+}
+
+void test_exothermic_ferment() {
+  // The yeast produce more heat than the room takes away, so the
+  // chiller runs even though the setpoint is above ambient. The
+  // yeast's share of the load is left to the integral term.
+  Result feedback = simulate(18.0, false, true, 12.0);
+  Result feedForward = simulate(18.0, true, true, 12.0);
+
+  TEST_ASSERT_LESS_THAN(feedback.maxExcursion / 2, feedForward.maxExcursion);
+  TEST_ASSERT_LESS_THAN(feedback.rmsExcursion, feedForward.rmsExcursion);
+  TEST_ASSERT_LESS_THAN(feedback.heaterPulses, feedForward.heaterPulses);
+  assertComparablePulses(feedback, feedForward);
+}
+
+void test_no_ambient_temperature() {
+  Result feedback = simulate(20.0, false, false, 0);
+  Result feedForward = simulate(20.0, true, false, 0);
+
+  // Without an ambient temperature there is nothing to feed forward
+  TEST_ASSERT_EQUAL_FLOAT(0, feedForward.heatingGain);
+  TEST_ASSERT_EQUAL_FLOAT(feedback.maxExcursion, feedForward.maxExcursion);
+  TEST_ASSERT_EQUAL_UINT32(feedback.heaterPulses, feedForward.heaterPulses);
+  TEST_ASSERT_EQUAL_UINT32(feedback.chillerPulses, feedForward.chillerPulses);
+}
+
+void test_compute() {
+  FeedForward feed(FEED_FORWARD_TIME_CONSTANT, FEED_FORWARD_GAIN_LIMIT);
+  feed.setGains(0.05, 0.1);
+
+  TEST_ASSERT_EQUAL_FLOAT(0.25, feed.compute(20.0, 15.0));
+  TEST_ASSERT_EQUAL_FLOAT(-0.5, feed.compute(20.0, 25.0));
+  TEST_ASSERT_EQUAL_FLOAT(0, feed.compute(20.0, NAN));
+
+  // Measurements far from the setpoint and steady gradients teach nothing
+  feed.learn(0.5, 20.0, 19.0, 15.0, CONTROL_PERIOD);
+  for (int i = 0; i < 100; i++) feed.learn(0.5, 20.0, 20.0, 15.0, CONTROL_PERIOD);
+  TEST_ASSERT_EQUAL_FLOAT(0.05, feed.getHeatingGain());
+  TEST_ASSERT_EQUAL_FLOAT(0.1, feed.getChillingGain());
+}
+
+void setup() {
+  #ifdef ARDUINO
+  delay(2000);
+  #endif
+  UNITY_BEGIN();
+}
+
+void loop() {
+  RUN_TEST(test_learns_heat_loss);
+  RUN_TEST(test_smaller_excursions_when_heating);
+  RUN_TEST(test_smaller_excursions_when_chilling);
+  RUN_TEST(test_exothermic_ferment);
+  RUN_TEST(test_no_ambient_temperature);
+  RUN_TEST(test_compute);
+  UNITY_END();
+}
@@ -112,6 +112,39 @@ void test_response() {
   TEST_ASSERT_EQUAL(ErrorType::None, subject->getResponse()->getErrorType(0));
   TEST_ASSERT_EQUAL(ERROR_NONE, subject->getResponse()->getErrorCode(0));
   TEST_ASSERT_EQUAL(MOCK_LATER, subject->getResponse()->getTimestamp());
+  TEST_ASSERT_TRUE(subject->getResponse()->isAuthentic());
+}
+
+void test_rejected_response_is_authentic() {
+  TimeRequest * subject = new TimeRequest(DEVICE_ID, new Hmac((const byte *) &SECRET_KEY));
+  subject->ready(MOCK_NOW, CHALLENGE);
+  // Signed by the server, with STATUS_MASK_CLOCK_SYNC_BEHIND set
+  byte response[64] = {
+    0x00, 0xDC, 0x02, 0x96, 0x49, 0x00, 0x00, 0x00,
+    0x00, 0x01, 0xEA, 0x5A, 0x0F, 0xE7, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xDB, 0x37, 0x61, 0x31, 0x02, 0xAD, 0xB3, 0x89,
+    0x83, 0x5F, 0xF6, 0x7F, 0x21, 0x0B, 0xB0, 0x3B,
+    0xAE, 0x1F, 0x94, 0xAA, 0xC0, 0xF8, 0xAA, 0xBE,
+    0xE8, 0x2C, 0x78, 0x55, 0x63, 0x1E, 0xBF, 0xA5
+  };
+  subject->getResponse()->receiveBytes(&response[0], 64);
+  subject->getResponse()->ready(0);
+  TEST_ASSERT_TRUE(subject->getResponse()->hasErrors());
+  TEST_ASSERT_EQUAL(REQUEST_ERROR_CLOCK_SYNC_BEHIND, subject->getResponse()->getErrorCode(0));
+  TEST_ASSERT_TRUE(subject->getResponse()->isAuthentic());
+  TEST_ASSERT_EQUAL(MOCK_LATER, subject->getResponse()->getTimestamp());
+
+  // The same rejection, tampered with in transit
+  subject->reset();
+  subject->ready(MOCK_NOW, CHALLENGE);
+  response[1] = 0xDD;
+  subject->getResponse()->receiveBytes(&response[0], 64);
+  subject->getResponse()->ready(0);
+  TEST_ASSERT_EQUAL(RESPONSE_ERROR_AUTHENTICATION, subject->getResponse()->getErrorCode(0));
+  TEST_ASSERT_EQUAL(1, subject->getResponse()->errorCount());
+  TEST_ASSERT_FALSE(subject->getResponse()->isAuthentic());
 }
 
 void setup() {
@@ -124,6 +157,7 @@ void setup() {
   RUN_TEST(test_failed);
   RUN_TEST(test_reset);
   RUN_TEST(test_response);
+  RUN_TEST(test_rejected_response_is_authentic);
   UNITY_END();
 }
 
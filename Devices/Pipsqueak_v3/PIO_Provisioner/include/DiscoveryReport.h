@@ -0,0 +1,19 @@
+#ifndef DiscoveryReport_h
+#define DiscoveryReport_h
+
+// The discovery step repeats its outcome on serial, once a second,
+// until the OS is flashed over it:
+//
+//   PIPSQUEAK DISCOVERY <deviceID> OK <board sensor address>
+//   PIPSQUEAK DISCOVERY <deviceID> FAILED <reason>
+//
+// The address is printed as 16 hex digits, or "none" if the device
+// has no board sensor.
+#define DISCOVERY_REPORT_PREFIX "PIPSQUEAK DISCOVERY"
+#define DISCOVERY_REPORT_OK "OK"
+#define DISCOVERY_REPORT_FAILED "FAILED"
+
+#define DISCOVERY_BAUD 57600
+#define DISCOVERY_REPORT_INTERVAL 1000 // ms
+
+#endif // DiscoveryReport_h
@@ -0,0 +1,182 @@
+#include "FleetFlasher.h"
+#include <DiscoveryReport.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <sstream>
+
+static std::string hex(uint32_t value) {
+  char buffer[12];
+  snprintf(buffer, sizeof(buffer), "0x%X", value);
+  return buffer;
+}
+
+static bool isZero(const uint8_t * bytes, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    if (bytes[i] != 0) return false;
+  }
+  return true;
+}
+
+static void report(const FleetDevice & device, const std::string & message) {
+  // One write per line, so that lines from concurrent devices don't interleave
+  std::string line = "device " + std::to_string(device.image.deviceID) + " (" + device.serialPort + "): " + message + "\n";
+  fputs(line.c_str(), stdout);
+  fflush(stdout);
+}
+
+FleetFlasher::FleetFlasher(const FlasherOptions & options)
+:
+  _options(options)
+{}
+
+size_t FleetFlasher::flash(const std::vector<FleetDevice> & devices) {
+  std::map<pid_t, const FleetDevice *> running;
+  size_t failures = 0;
+  size_t next = 0;
+  while (next < devices.size() || !running.empty()) {
+    if (next < devices.size() && running.size() < _options.jobs) {
+      const FleetDevice & device = devices[next++];
+      if (device.serialPort.empty()) continue;
+      fflush(stdout);
+      pid_t pid = fork();
+      if (pid == 0) _exit(flashDevice(device) ? 0 : 1);
+      if (pid < 0) {
+        report(device, "failed to start");
+        failures += 1;
+        continue;
+      }
+      running[pid] = &device;
+      continue;
+    }
+
+    int status;
+    pid_t pid = wait(&status);
+    if (pid < 0) break;
+    if (!running.count(pid)) continue;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failures += 1;
+    running.erase(pid);
+  }
+  return failures;
+}
+
+std::string FleetFlasher::getImagePath(const std::string & directory, uint32_t deviceID) {
+  return directory + "/pipsqueak-" + std::to_string(deviceID) + ".bin";
+}
+
+bool FleetFlasher::flashDevice(const FleetDevice & device) {
+  uint32_t deviceID = device.image.deviceID;
+  std::string imagePath = getImagePath(_options.imageDirectory, deviceID);
+  std::string logPath = _options.imageDirectory + "/pipsqueak-" + std::to_string(deviceID) + ".log";
+  std::string eepromAddress = hex(_options.eepromAddress);
+  unlink(logPath.c_str());
+
+  // No need for the discovery step if the board sensor is already known
+  bool discover = (device.image.flags & CONFIG_FLAG_BOARD_SENSOR) &&
+    isZero(device.image.boardSensorAddress, CONFIG_IMAGE_ADDRESS_SIZE);
+  if (!discover) {
+    report(device, "writing OS and image");
+    if (!runEsptool(device, { "0x0", _options.osFirmware, eepromAddress, imagePath }, logPath)) return false;
+    report(device, "done");
+    return true;
+  }
+
+  report(device, "writing discovery step and image");
+  if (!runEsptool(device, { "0x0", _options.discoverFirmware, eepromAddress, imagePath }, logPath)) return false;
+  std::string outcome;
+  if (!awaitDiscovery(device, &outcome)) {
+    report(device, "discovery " + outcome);
+    return false;
+  }
+  report(device, "board sensor " + outcome + ", writing OS");
+  if (!runEsptool(device, { "0x0", _options.osFirmware }, logPath)) return false;
+  report(device, "done");
+  return true;
+}
+
+bool FleetFlasher::runEsptool(const FleetDevice & device, const std::vector<std::string> & arguments, const std::string & logPath) {
+  std::vector<std::string> command;
+  std::istringstream prefix(_options.esptool);
+  std::string word;
+  while (prefix >> word) command.push_back(word);
+  for (const std::string & argument : { std::string("--chip"), std::string("esp8266"),
+      std::string("--port"), device.serialPort, std::string("--baud"), std::to_string(_options.baud),
+      std::string("write_flash") }) {
+    command.push_back(argument);
+  }
+  command.insert(command.end(), arguments.begin(), arguments.end());
+
+  std::vector<char *> argv;
+  for (std::string & part : command) argv.push_back(&part[0]);
+  argv.push_back(NULL);
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    int log = open(logPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (log >= 0) {
+      dup2(log, STDOUT_FILENO);
+      dup2(log, STDERR_FILENO);
+      close(log);
+    }
+    execvp(argv[0], argv.data());
+    perror(argv[0]);
+    _exit(127);
+  }
+  int status = 0;
+  if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    report(device, "esptool failed, see " + logPath);
+    return false;
+  }
+  return true;
+}
+
+bool FleetFlasher::awaitDiscovery(const FleetDevice & device, std::string * outcome) {
+  int port = open(device.serialPort.c_str(), O_RDWR | O_NOCTTY);
+  if (port < 0) {
+    *outcome = "could not open the serial port";
+    return false;
+  }
+  struct termios settings;
+  tcgetattr(port, &settings);
+  cfmakeraw(&settings);
+  cfsetspeed(&settings, B57600); // DISCOVERY_BAUD
+  settings.c_cflag &= ~HUPCL;
+  settings.c_cc[VMIN] = 0;
+  settings.c_cc[VTIME] = 10; // tenths of a second
+  tcsetattr(port, TCSANOW, &settings);
+
+  // The step repeats its report, so a line cut short by opening the port is no loss
+  std::string prefix = std::string(DISCOVERY_REPORT_PREFIX) + " ";
+  std::string expected = prefix + std::to_string(device.image.deviceID) + " ";
+  std::string line;
+  time_t deadline = time(NULL) + _options.discoveryTimeout;
+  *outcome = "timed out";
+  bool found = false;
+  bool succeeded = false;
+  char c;
+  while (!found && time(NULL) < deadline) {
+    if (read(port, &c, 1) != 1) continue;
+    if (c != '\n') {
+      if (c != '\r') line += c;
+      continue;
+    }
+    if (line.compare(0, expected.size(), expected) == 0) {
+      std::string result = line.substr(expected.size());
+      found = true;
+      succeeded = result.compare(0, strlen(DISCOVERY_REPORT_OK " "), DISCOVERY_REPORT_OK " ") == 0;
+      *outcome = succeeded ? result.substr(strlen(DISCOVERY_REPORT_OK " ")) : result;
+    } else if (line.compare(0, prefix.size(), prefix) == 0) {
+      // Another device's image, or none at all
+      found = true;
+      *outcome = "reported by the wrong device: " + line.substr(prefix.size());
+    }
+    line.clear();
+  }
+  close(port);
+  return succeeded;
+}
@@ -0,0 +1,63 @@
+#ifndef FleetFlasher_h
+#define FleetFlasher_h
+
+#include <string>
+#include <vector>
+#include <FleetManifest.h>
+
+// Where a d1_mini's EEPROM sector lies, per eagle.flash.4m2m.ld
+#define DEFAULT_EEPROM_ADDRESS 0x3FB000
+
+#define DEFAULT_FLASH_BAUD 460800
+#define DEFAULT_FLASH_JOBS 4
+#define DEFAULT_DISCOVERY_TIMEOUT 30 // s
+
+struct FlasherOptions {
+  std::string esptool;          // command line prefix, e.g. "esptool.py"
+  std::string discoverFirmware; // the discover env's firmware.bin
+  std::string osFirmware;       // the OS's firmware.bin
+  std::string imageDirectory;   // holds pipsqueak-<id>.bin for each device
+  uint32_t eepromAddress;
+  uint32_t baud;
+  size_t jobs;                  // devices flashed at once
+  uint32_t discoveryTimeout;    // s
+};
+
+/**
+ * Flashes a fleet over serial, several devices at a time, each in a
+ * child process of its own. Each device is taken through:
+ *
+ * 1. esptool writes the discovery step and the device's config image,
+ *    then resets the device
+ * 2. the discovery step finds the board sensor, writes its address
+ *    into the image and reports on serial
+ * 3. esptool writes the OS over the discovery step
+ *
+ * Step 2 is skipped, and steps 1 and 3 are combined, for devices whose
+ * board sensor address is in the manifest. esptool's output for each
+ * device goes to pipsqueak-<id>.log beside its image.
+ */
+class FleetFlasher {
+  public:
+    FleetFlasher(const FlasherOptions & options);
+
+    /**
+     * Flashes the devices that have a serial port, printing a line as
+     * each one starts and finishes. Returns the number that failed.
+     */
+    size_t flash(const std::vector<FleetDevice> & devices);
+
+    /**
+     * Returns the path of the image file for the given device.
+     */
+    static std::string getImagePath(const std::string & directory, uint32_t deviceID);
+
+  private:
+    FlasherOptions _options;
+
+    bool flashDevice(const FleetDevice & device);
+    bool runEsptool(const FleetDevice & device, const std::vector<std::string> & arguments, const std::string & logPath);
+    bool awaitDiscovery(const FleetDevice & device, std::string * outcome);
+};
+
+#endif // FleetFlasher_h
@@ -0,0 +1,277 @@
+#include "FleetManifest.h"
+#include <stdlib.h>
+
+// Pipsqueak v3 pins, as in the initializer's InitializationParameters.h
+#define DEFAULT_ENABLE_PIN          5   // D1
+#define DEFAULT_ONE_WIRE_PIN        4   // D2
+#define DEFAULT_RED_INDICATOR_PIN   13  // D7
+#define DEFAULT_GREEN_INDICATOR_PIN 12  // D6
+#define DEFAULT_HEATER_PIN          15  // D8
+#define DEFAULT_CHILLER_PIN         14  // D5
+
+#define DEFAULT_HOST_PORT 9001
+#define DEFAULT_SETPOINT 15.0       // celsius
+
+#define DEVICE_SECTION "device"
+
+static std::string trim(const std::string & text) {
+  size_t start = text.find_first_not_of(" \t\r");
+  if (start == std::string::npos) return "";
+  size_t end = text.find_last_not_of(" \t\r");
+  return text.substr(start, end - start + 1);
+}
+
+static bool parseUnsigned(const std::string & text, uint32_t limit, uint32_t * value) {
+  if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos) return false;
+  unsigned long long parsed = strtoull(text.c_str(), NULL, 10);
+  if (parsed > limit) return false;
+  *value = (uint32_t) parsed;
+  return true;
+}
+
+static bool parseFloat(const std::string & text, float * value) {
+  char * end;
+  *value = strtof(text.c_str(), &end);
+  return !text.empty() && *end == '\0';
+}
+
+static bool parseBool(const std::string & text, bool * value) {
+  if (text == "true" || text == "yes" || text == "1") {
+    *value = true;
+  } else if (text == "false" || text == "no" || text == "0") {
+    *value = false;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Hex digits, optionally separated by colons as the initializer prints addresses
+static bool parseHex(const std::string & text, uint8_t * bytes, size_t size) {
+  std::string digits;
+  for (char c : text) {
+    if (c != ':') digits += c;
+  }
+  if (digits.size() != size * 2) return false;
+  if (digits.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) return false;
+  for (size_t i = 0; i < size; i++) {
+    bytes[i] = (uint8_t) strtoul(digits.substr(i * 2, 2).c_str(), NULL, 16);
+  }
+  return true;
+}
+
+static bool parseIPv4(const std::string & text, uint8_t * octets) {
+  size_t start = 0;
+  for (size_t i = 0; i < 4; i++) {
+    size_t end = text.find('.', start);
+    if ((end == std::string::npos) != (i == 3)) return false;
+    uint32_t octet;
+    if (!parseUnsigned(text.substr(start, end - start), 255, &octet)) return false;
+    octets[i] = (uint8_t) octet;
+    start = end + 1;
+  }
+  return true;
+}
+
+static bool isZero(const uint8_t * bytes, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    if (bytes[i] != 0) return false;
+  }
+  return true;
+}
+
+FleetManifest::FleetManifest()
+:
+  _devices(),
+  _error()
+{}
+
+bool FleetManifest::parse(const std::string & text) {
+  _devices.clear();
+  _error.clear();
+
+  Settings fleet;
+  Settings device;
+  uint32_t deviceID = 0;
+  size_t deviceLine = 0;
+  size_t lineNumber = 0;
+  size_t start = 0;
+  while (start <= text.size()) {
+    size_t end = text.find('\n', start);
+    if (end == std::string::npos) end = text.size();
+    std::string line = trim(text.substr(start, end - start));
+    start = end + 1;
+    lineNumber += 1;
+    if (line.empty() || line[0] == '#') continue;
+
+    if (line[0] == '[') {
+      if (line.back() != ']') return fail(lineNumber, "unterminated section");
+      std::string section = trim(line.substr(1, line.size() - 2));
+      if (section.compare(0, strlen(DEVICE_SECTION), DEVICE_SECTION) != 0) {
+        return fail(lineNumber, "unknown section, expected [" DEVICE_SECTION " <id>]");
+      }
+      if (deviceLine != 0 && !build(deviceID, deviceLine, fleet, device)) return false;
+      if (!parseUnsigned(trim(section.substr(strlen(DEVICE_SECTION))), UINT32_MAX, &deviceID) || deviceID == 0) {
+        return fail(lineNumber, "device ID must be a positive integer");
+      }
+      device.clear();
+      deviceLine = lineNumber;
+      continue;
+    }
+
+    size_t equals = line.find('=');
+    if (equals == std::string::npos) return fail(lineNumber, "expected key = value");
+    std::string key = trim(line.substr(0, equals));
+    std::string value = trim(line.substr(equals + 1));
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+      value = value.substr(1, value.size() - 2);
+    }
+    Settings & settings = deviceLine == 0 ? fleet : device;
+    if (settings.count(key)) return fail(lineNumber, "'" + key + "' is repeated");
+    settings[key] = std::make_pair(value, lineNumber);
+  }
+  if (deviceLine != 0 && !build(deviceID, deviceLine, fleet, device)) return false;
+  if (_devices.empty()) return fail(lineNumber, "no devices listed");
+  return checkFleet();
+}
+
+const std::vector<FleetDevice> & FleetManifest::getDevices() {
+  return _devices;
+}
+
+const std::string & FleetManifest::getError() {
+  return _error;
+}
+
+void FleetManifest::render(const FleetDevice & device, uint8_t * buffer) {
+  memset(buffer, 0, CONFIG_IMAGE_SIZE);
+  memcpy(buffer, &device.image, sizeof(ConfigImage));
+}
+
+bool FleetManifest::fail(size_t line, const std::string & message) {
+  _error = "line " + std::to_string(line) + ": " + message;
+  _devices.clear();
+  return false;
+}
+
+bool FleetManifest::build(uint32_t deviceID, size_t line, const Settings & fleet, const Settings & device) {
+  FleetDevice entry;
+  memset(&entry.image, 0, sizeof(ConfigImage));
+  entry.line = line;
+  entry.image.flags = CONFIG_FLAG_BOARD_SENSOR;
+  entry.image.deviceID = deviceID;
+  entry.image.setpoint = DEFAULT_SETPOINT;
+  entry.image.hostPort = DEFAULT_HOST_PORT;
+  entry.image.enablePin = DEFAULT_ENABLE_PIN;
+  entry.image.oneWirePin = DEFAULT_ONE_WIRE_PIN;
+  entry.image.redIndicatorPin = DEFAULT_RED_INDICATOR_PIN;
+  entry.image.greenIndicatorPin = DEFAULT_GREEN_INDICATOR_PIN;
+  entry.image.heaterPin = DEFAULT_HEATER_PIN;
+  entry.image.chillerPin = DEFAULT_CHILLER_PIN;
+
+  // The device's own settings override the fleet's
+  for (const auto & setting : fleet) {
+    if (device.count(setting.first)) continue;
+    if (!apply(&entry, setting.first, setting.second.first, setting.second.second)) return false;
+  }
+  for (const auto & setting : device) {
+    if (!apply(&entry, setting.first, setting.second.first, setting.second.second)) return false;
+  }
+  if (!validate(entry)) return false;
+
+  // Written once, by this tool, as far as the device is concerned
+  entry.image.writeCount = 1;
+  ConfigImageFormat::seal(&entry.image);
+  _devices.push_back(entry);
+  return true;
+}
+
+bool FleetManifest::apply(FleetDevice * device, const std::string & key, const std::string & value, size_t line) {
+  ConfigImage * image = &device->image;
+  uint32_t number;
+  float setpoint;
+  bool flag;
+  bool valid = true;
+  if (key == "ssid") {
+    valid = value.size() < CONFIG_IMAGE_SSID_SIZE;
+    if (valid) strcpy(image->wifiSSID, value.c_str());
+  } else if (key == "password") {
+    valid = value.size() < CONFIG_IMAGE_PASSWORD_SIZE;
+    if (valid) strcpy(image->wifiPassword, value.c_str());
+  } else if (key == "secret") {
+    valid = parseHex(value, image->secretKey, CONFIG_IMAGE_SECRET_KEY_SIZE);
+  } else if (key == "host") {
+    valid = parseIPv4(value, image->hostIP);
+  } else if (key == "port") {
+    valid = parseUnsigned(value, UINT16_MAX, &number);
+    if (valid) image->hostPort = (uint16_t) number;
+  } else if (key == "setpoint") {
+    valid = parseFloat(value, &setpoint);
+    if (valid) image->setpoint = setpoint;
+  } else if (key == "serial") {
+    device->serialPort = value;
+  } else if (key == "board_sensor_address") {
+    valid = parseHex(value, image->boardSensorAddress, CONFIG_IMAGE_ADDRESS_SIZE);
+  } else if (key == "remote_sensor_address") {
+    valid = parseHex(value, image->remoteSensorAddress, CONFIG_IMAGE_ADDRESS_SIZE);
+  } else if (key == "board_sensor" || key == "pid_control" || key == "monitor_mode") {
+    uint8_t bit = key == "board_sensor" ? CONFIG_FLAG_BOARD_SENSOR : key == "pid_control" ? CONFIG_FLAG_PID_CONTROL : CONFIG_FLAG_MONITOR_MODE;
+    valid = parseBool(value, &flag);
+    image->flags = flag ? (image->flags | bit) : (image->flags & ~bit);
+  } else {
+    uint8_t * pin = NULL;
+    if (key == "enable_pin") pin = &image->enablePin;
+    if (key == "one_wire_pin") pin = &image->oneWirePin;
+    if (key == "red_indicator_pin") pin = &image->redIndicatorPin;
+    if (key == "green_indicator_pin") pin = &image->greenIndicatorPin;
+    if (key == "heater_pin") pin = &image->heaterPin;
+    if (key == "chiller_pin") pin = &image->chillerPin;
+    if (!pin) return fail(line, "unknown key '" + key + "'");
+    valid = parseUnsigned(value, 16, &number);
+    if (valid) *pin = (uint8_t) number;
+  }
+  if (!valid) return fail(line, "invalid value for '" + key + "'");
+  return true;
+}
+
+bool FleetManifest::validate(const FleetDevice & device) {
+  const ConfigImage & image = device.image;
+  if (isZero(image.secretKey, CONFIG_IMAGE_SECRET_KEY_SIZE)) {
+    return fail(device.line, "secret key is missing or all zeros");
+  }
+  if (isZero(image.hostIP, 4) || (image.hostIP[0] == 127 && image.hostIP[1] == 0 && image.hostIP[2] == 0 && image.hostIP[3] == 1)) {
+    return fail(device.line, "host is missing or the loopback address");
+  }
+  if (image.hostPort == 0) {
+    return fail(device.line, "host port is zero");
+  }
+  if (strlen(image.wifiSSID) == 0 || strcmp(image.wifiSSID, "PlaceholderForSSID") == 0) {
+    return fail(device.line, "WiFi SSID is missing or the placeholder value");
+  }
+  if (strcmp(image.wifiPassword, "PlaceholderForPassword") == 0) {
+    return fail(device.line, "WiFi password is the placeholder value");
+  }
+  if (image.setpoint <= 4 || image.setpoint > 35) {
+    return fail(device.line, "initial setpoint is too low or too high");
+  }
+  return true;
+}
+
+bool FleetManifest::checkFleet() {
+  for (size_t i = 0; i < _devices.size(); i++) {
+    for (size_t j = 0; j < i; j++) {
+      const FleetDevice & a = _devices[j];
+      const FleetDevice & b = _devices[i];
+      if (a.image.deviceID == b.image.deviceID) {
+        return fail(b.line, "device ID " + std::to_string(b.image.deviceID) + " is repeated");
+      }
+      if (memcmp(a.image.secretKey, b.image.secretKey, CONFIG_IMAGE_SECRET_KEY_SIZE) == 0) {
+        return fail(b.line, "secret key is shared with device " + std::to_string(a.image.deviceID));
+      }
+      if (!b.serialPort.empty() && a.serialPort == b.serialPort) {
+        return fail(b.line, "serial port " + b.serialPort + " is shared with device " + std::to_string(a.image.deviceID));
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,73 @@
+#ifndef FleetManifest_h
+#define FleetManifest_h
+
+#include <map>
+#include <string>
+#include <vector>
+#include <ConfigImage.h>
+
+/**
+ * A device listed in a fleet manifest.
+ */
+struct FleetDevice {
+  ConfigImage image;      // sealed, ready to be written
+  std::string serialPort; // empty if the device is not to be flashed
+  size_t line;            // of the device's section in the manifest
+};
+
+/**
+ * Parses a fleet manifest, which lists the devices to be provisioned
+ * and the values to be written to their configuration.
+ *
+ * The manifest is a series of "key = value" lines. Those before the
+ * first "[device <id>]" section apply to every device; those within a
+ * section apply to that device, overriding the former. Blank lines and
+ * lines starting with # are ignored. A value may be double quoted to
+ * keep leading or trailing spaces. See README.md for the keys.
+ *
+ * Each device is checked as the initializer checks its parameters
+ * before committing them, and the fleet as a whole is checked for
+ * repeated device IDs, secret keys and serial ports.
+ */
+class FleetManifest {
+  public:
+    FleetManifest();
+
+    /**
+     * Parses the text of a manifest, replacing any devices parsed
+     * before. Returns false, and sets the error, if the manifest is
+     * malformed or any device's configuration is invalid.
+     */
+    bool parse(const std::string & text);
+
+    /**
+     * Returns the devices parsed, in manifest order.
+     */
+    const std::vector<FleetDevice> & getDevices();
+
+    /**
+     * Returns a description of why parse() failed, prefixed with the
+     * offending line number.
+     */
+    const std::string & getError();
+
+    /**
+     * Writes the CONFIG_IMAGE_SIZE bytes that the initializer's
+     * commitUpdates() writes for the device: its image, zero padded.
+     */
+    static void render(const FleetDevice & device, uint8_t * buffer);
+
+  private:
+    typedef std::map<std::string, std::pair<std::string, size_t>> Settings;
+
+    std::vector<FleetDevice> _devices;
+    std::string _error;
+
+    bool fail(size_t line, const std::string & message);
+    bool build(uint32_t deviceID, size_t line, const Settings & fleet, const Settings & device);
+    bool apply(FleetDevice * device, const std::string & key, const std::string & value, size_t line);
+    bool validate(const FleetDevice & device);
+    bool checkFleet();
+};
+
+#endif // FleetManifest_h
@@ -0,0 +1,121 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <OneWire.h>
+#include <ConfigImage.h>
+#include <DiscoveryReport.h>
+
+// The generic discovery step: the same firmware for every device. It
+// finds the board sensor on the pins named in the config image that
+// the provisioner wrote beside it, records the sensor's address in the
+// image, and reports the outcome until the OS is flashed over it.
+
+// The Maxim DS18B20 identifier byte (first byte in chip's 1Wire address)
+#define DS18B20_FAMILY_CODE 0x28
+
+// At most the board sensor and a probe are expected
+#define MAX_SENSORS 2
+
+
+ConfigImage image;
+char report[96];
+bool success = false;
+
+
+void fail(const char * reason) {
+  snprintf(report, sizeof(report), "%s %u %s %s", DISCOVERY_REPORT_PREFIX, image.deviceID, DISCOVERY_REPORT_FAILED, reason);
+}
+
+void succeed(const char * address) {
+  snprintf(report, sizeof(report), "%s %u %s %s", DISCOVERY_REPORT_PREFIX, image.deviceID, DISCOVERY_REPORT_OK, address);
+  success = true;
+}
+
+size_t search(byte * addresses) {
+  OneWire oneWire(image.oneWirePin);
+  byte address[CONFIG_IMAGE_ADDRESS_SIZE];
+  size_t count = 0;
+  while (oneWire.search(address)) {
+    if (OneWire::crc8(address, 7) != address[7]) continue;
+    if (address[0] != DS18B20_FAMILY_CODE) continue;
+    if (count < MAX_SENSORS) memcpy(&addresses[count * CONFIG_IMAGE_ADDRESS_SIZE], address, CONFIG_IMAGE_ADDRESS_SIZE);
+    count++;
+  }
+  oneWire.reset_search();
+  return count;
+}
+
+void discover() {
+  char printed[CONFIG_IMAGE_ADDRESS_SIZE * 2 + 1];
+  byte none[CONFIG_IMAGE_ADDRESS_SIZE] = { 0 };
+  if (!(image.flags & CONFIG_FLAG_BOARD_SENSOR)) {
+    succeed("none");
+    return;
+  }
+
+  byte addresses[MAX_SENSORS * CONFIG_IMAGE_ADDRESS_SIZE];
+  size_t count = search(addresses);
+  if (memcmp(image.boardSensorAddress, none, CONFIG_IMAGE_ADDRESS_SIZE) != 0) {
+    // Provisioned before; just make sure the sensor is still there
+    for (size_t i = 0; i < min(count, (size_t) MAX_SENSORS); i++) {
+      if (memcmp(&addresses[i * CONFIG_IMAGE_ADDRESS_SIZE], image.boardSensorAddress, CONFIG_IMAGE_ADDRESS_SIZE) == 0) {
+        for (size_t j = 0; j < CONFIG_IMAGE_ADDRESS_SIZE; j++) sprintf(&printed[j * 2], "%02X", image.boardSensorAddress[j]);
+        succeed(printed);
+        return;
+      }
+    }
+    fail("previously configured sensor not found");
+    return;
+  }
+  if (count != 1) {
+    // The probe must not be connected, or the two can't be told apart
+    fail(count == 0 ? "no sensors found" : "more than one sensor found");
+    return;
+  }
+
+  memcpy(image.boardSensorAddress, addresses, CONFIG_IMAGE_ADDRESS_SIZE);
+  image.writeCount += 1;
+  ConfigImageFormat::seal(&image);
+  memset(EEPROM.getDataPtr(), 0, CONFIG_IMAGE_SIZE);
+  memcpy(EEPROM.getDataPtr(), &image, sizeof(image));
+  if (!EEPROM.commit()) {
+    fail("failed to write the image");
+    return;
+  }
+  for (size_t j = 0; j < CONFIG_IMAGE_ADDRESS_SIZE; j++) sprintf(&printed[j * 2], "%02X", image.boardSensorAddress[j]);
+  succeed(printed);
+}
+
+
+void setup() {
+  Serial.begin(DISCOVERY_BAUD);
+  Serial.print("\n");
+
+  EEPROM.begin(CONFIG_IMAGE_SIZE);
+  ConfigImageStatus status = ConfigImageFormat::parse(EEPROM.getDataPtr(), &image);
+  if (status != CONFIG_IMAGE_VALID && status != CONFIG_IMAGE_MIGRATED) {
+    fail("no valid config image");
+    EEPROM.end();
+    return;
+  }
+
+  // Green and red illuminated while discovering, as in the initializer
+  pinMode(image.greenIndicatorPin, OUTPUT);
+  pinMode(image.redIndicatorPin, OUTPUT);
+  pinMode(image.enablePin, OUTPUT);
+  digitalWrite(image.greenIndicatorPin, HIGH);
+  digitalWrite(image.redIndicatorPin, HIGH);
+  digitalWrite(image.enablePin, HIGH);
+
+  discover();
+  EEPROM.end();
+
+  if (success) {
+    digitalWrite(image.redIndicatorPin, LOW);
+  }
+}
+
+
+void loop() {
+  Serial.println(report);
+  delay(DISCOVERY_REPORT_INTERVAL);
+}
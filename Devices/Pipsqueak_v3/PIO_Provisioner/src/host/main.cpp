@@ -0,0 +1,107 @@
+#include <FleetFlasher.h>
+#include <FleetManifest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+
+// Built by the discover env of this project
+#define DEFAULT_DISCOVER_FIRMWARE ".pio/build/discover/firmware.bin"
+#define DEFAULT_ESPTOOL "esptool.py"
+
+static int usage() {
+  fputs(
+    "usage: provision images <manifest> <directory>\n"
+    "       provision flash <manifest> <directory> --os <firmware.bin> [options]\n"
+    "\n"
+    "images  writes pipsqueak-<id>.bin, the config image, for each device\n"
+    "flash   writes the images, then flashes every device with a serial port\n"
+    "\n"
+    "flash options:\n"
+    "  --os <firmware.bin>        the OS, built by PIO_Arduino_OS (required)\n"
+    "  --discover <firmware.bin>  the discovery step (default " DEFAULT_DISCOVER_FIRMWARE ")\n"
+    "  --esptool <command>        (default " DEFAULT_ESPTOOL ")\n"
+    "  --jobs <n>                 devices flashed at once (default 4)\n"
+    "  --baud <n>                 esptool's baud rate (default 460800)\n"
+    "  --eeprom-address <hex>     (default 0x3FB000)\n"
+    "  --timeout <s>              discovery timeout (default 30)\n",
+    stderr);
+  return 2;
+}
+
+static bool writeImages(const std::vector<FleetDevice> & devices, const std::string & directory) {
+  mkdir(directory.c_str(), 0755);
+  uint8_t buffer[CONFIG_IMAGE_SIZE];
+  for (const FleetDevice & device : devices) {
+    std::string path = FleetFlasher::getImagePath(directory, device.image.deviceID);
+    FleetManifest::render(device, buffer);
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char *) buffer, CONFIG_IMAGE_SIZE);
+    if (!file) {
+      fprintf(stderr, "provision: failed to write %s\n", path.c_str());
+      return false;
+    }
+  }
+  printf("provision: wrote %zu images to %s\n", devices.size(), directory.c_str());
+  return true;
+}
+
+int main(int argc, char ** argv) {
+  if (argc < 4) return usage();
+  std::string command = argv[1];
+  if (command != "images" && command != "flash") return usage();
+
+  std::ifstream file(argv[2]);
+  if (!file) {
+    fprintf(stderr, "provision: cannot read %s\n", argv[2]);
+    return 1;
+  }
+  std::stringstream text;
+  text << file.rdbuf();
+  FleetManifest manifest;
+  if (!manifest.parse(text.str())) {
+    fprintf(stderr, "provision: %s: %s\n", argv[2], manifest.getError().c_str());
+    return 1;
+  }
+  const std::vector<FleetDevice> & devices = manifest.getDevices();
+
+  FlasherOptions options = {
+    DEFAULT_ESPTOOL, DEFAULT_DISCOVER_FIRMWARE, "", argv[3],
+    DEFAULT_EEPROM_ADDRESS, DEFAULT_FLASH_BAUD, DEFAULT_FLASH_JOBS, DEFAULT_DISCOVERY_TIMEOUT
+  };
+  for (int i = 4; i < argc; i++) {
+    std::string option = argv[i];
+    if (i + 1 >= argc) return usage();
+    const char * value = argv[++i];
+    if (option == "--os") {
+      options.osFirmware = value;
+    } else if (option == "--discover") {
+      options.discoverFirmware = value;
+    } else if (option == "--esptool") {
+      options.esptool = value;
+    } else if (option == "--jobs") {
+      options.jobs = strtoul(value, NULL, 10);
+    } else if (option == "--baud") {
+      options.baud = strtoul(value, NULL, 10);
+    } else if (option == "--eeprom-address") {
+      options.eepromAddress = strtoul(value, NULL, 16);
+    } else if (option == "--timeout") {
+      options.discoveryTimeout = strtoul(value, NULL, 10);
+    } else {
+      return usage();
+    }
+  }
+
+  if (!writeImages(devices, options.imageDirectory)) return 1;
+  if (command == "images") return 0;
+
+  if (options.osFirmware.empty() || options.jobs == 0) return usage();
+  FleetFlasher flasher(options);
+  size_t failures = flasher.flash(devices);
+  if (failures > 0) {
+    fprintf(stderr, "provision: %zu devices failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
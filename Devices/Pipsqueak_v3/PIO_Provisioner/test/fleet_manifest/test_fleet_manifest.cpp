@@ -0,0 +1,113 @@
+#include <unity.h>
+#include <FleetManifest.h>
+
+static const char * FLEET =
+  "# Batch 7\n"
+  "ssid = Brewery\n"
+  "password = \" hops \"\n"
+  "host = 192.168.1.20\n"
+  "pid_control = true\n"
+  "\n"
+  "[device 12]\n"
+  "secret = 00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff\n"
+  "serial = /dev/ttyUSB0\n"
+  "\n"
+  "[device 13]\n"
+  "secret = 11112233445566778899aabbccddeeff00112233445566778899aabbccddeeff\n"
+  "setpoint = 18.5\n"
+  "pid_control = false\n"
+  "board_sensor_address = 28:01:02:03:04:05:06:07\n";
+
+static const char * SECRET_12 = "00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff";
+static const char * SECRET_13 = "11112233445566778899aabbccddeeff00112233445566778899aabbccddeeff";
+
+void test_fleet_settings_and_overrides() {
+  FleetManifest manifest;
+  TEST_ASSERT_TRUE(manifest.parse(FLEET));
+  TEST_ASSERT_EQUAL(2, manifest.getDevices().size());
+
+  const ConfigImage & first = manifest.getDevices()[0].image;
+  TEST_ASSERT_EQUAL(12, first.deviceID);
+  TEST_ASSERT_EQUAL_STRING("Brewery", first.wifiSSID);
+  TEST_ASSERT_EQUAL_STRING(" hops ", first.wifiPassword);
+  TEST_ASSERT_EQUAL(192, first.hostIP[0]);
+  TEST_ASSERT_EQUAL(20, first.hostIP[3]);
+  TEST_ASSERT_EQUAL(9001, first.hostPort);
+  TEST_ASSERT_EQUAL_FLOAT(15.0, first.setpoint);
+  TEST_ASSERT_EQUAL(CONFIG_FLAG_BOARD_SENSOR | CONFIG_FLAG_PID_CONTROL, first.flags);
+  TEST_ASSERT_EQUAL(0x11, first.secretKey[1]);
+  TEST_ASSERT_EQUAL(15, first.heaterPin);
+  TEST_ASSERT_EQUAL(14, first.chillerPin);
+  TEST_ASSERT_EQUAL(0, first.boardSensorAddress[0]);
+  TEST_ASSERT_EQUAL_STRING("/dev/ttyUSB0", manifest.getDevices()[0].serialPort.c_str());
+
+  const ConfigImage & second = manifest.getDevices()[1].image;
+  TEST_ASSERT_EQUAL(13, second.deviceID);
+  TEST_ASSERT_EQUAL_FLOAT(18.5, second.setpoint);
+  TEST_ASSERT_EQUAL(CONFIG_FLAG_BOARD_SENSOR, second.flags);
+  TEST_ASSERT_EQUAL(0x28, second.boardSensorAddress[0]);
+  TEST_ASSERT_EQUAL(0x07, second.boardSensorAddress[7]);
+  TEST_ASSERT_TRUE(manifest.getDevices()[1].serialPort.empty());
+}
+
+void test_rendered_image_reads_back() {
+  FleetManifest manifest;
+  uint8_t buffer[CONFIG_IMAGE_SIZE];
+  ConfigImage parsed;
+  TEST_ASSERT_TRUE(manifest.parse(FLEET));
+  FleetManifest::render(manifest.getDevices()[0], buffer);
+  TEST_ASSERT_EQUAL(CONFIG_IMAGE_VALID, ConfigImageFormat::parse(buffer, &parsed));
+  TEST_ASSERT_EQUAL_MEMORY(&manifest.getDevices()[0].image, &parsed, sizeof(ConfigImage));
+  TEST_ASSERT_EQUAL(1, parsed.writeCount);
+  TEST_ASSERT_EQUAL(0, buffer[CONFIG_IMAGE_SIZE - 1]);
+}
+
+void test_errors_name_the_line() {
+  FleetManifest manifest;
+  std::string fleet = FLEET;
+  TEST_ASSERT_FALSE(manifest.parse(fleet + "colour = red\n"));
+  TEST_ASSERT_EQUAL_STRING("line 16: unknown key 'colour'", manifest.getError().c_str());
+  TEST_ASSERT_TRUE(manifest.getDevices().empty());
+
+  TEST_ASSERT_FALSE(manifest.parse(fleet + "port = 70000\n"));
+  TEST_ASSERT_EQUAL_STRING("line 16: invalid value for 'port'", manifest.getError().c_str());
+
+  TEST_ASSERT_FALSE(manifest.parse(fleet + "[sensor 4]\n"));
+  TEST_ASSERT_FALSE(manifest.parse(fleet + "[device 0]\n"));
+  TEST_ASSERT_FALSE(manifest.parse(fleet + "setpoint\n"));
+  TEST_ASSERT_FALSE(manifest.parse(fleet + "setpoint = 19\n"));
+  TEST_ASSERT_EQUAL_STRING("line 16: 'setpoint' is repeated", manifest.getError().c_str());
+  TEST_ASSERT_FALSE(manifest.parse("ssid = Brewery\n"));
+}
+
+void test_invalid_devices_rejected() {
+  FleetManifest manifest;
+  std::string fleet = FLEET;
+  TEST_ASSERT_FALSE(manifest.parse(fleet + "[device 14]\n"));
+  TEST_ASSERT_EQUAL_STRING("line 16: secret key is missing or all zeros", manifest.getError().c_str());
+
+  std::string device = std::string("[device 14]\nsecret = ") + SECRET_12 + "\n";
+  TEST_ASSERT_FALSE(manifest.parse(fleet + device));
+  TEST_ASSERT_EQUAL_STRING("line 16: secret key is shared with device 12", manifest.getError().c_str());
+
+  device = std::string("[device 12]\nsecret = ") + SECRET_13 + "\n";
+  TEST_ASSERT_FALSE(manifest.parse(fleet + device));
+  TEST_ASSERT_EQUAL_STRING("line 16: device ID 12 is repeated", manifest.getError().c_str());
+
+  std::string secret = "secret = 2222222222222222222222222222222222222222222222222222222222222222\n";
+  TEST_ASSERT_FALSE(manifest.parse(fleet + "[device 14]\nhost = 127.0.0.1\n" + secret));
+  TEST_ASSERT_FALSE(manifest.parse(fleet + "[device 14]\nssid = PlaceholderForSSID\n" + secret));
+  TEST_ASSERT_FALSE(manifest.parse(fleet + "[device 14]\nsetpoint = 40\n" + secret));
+  TEST_ASSERT_FALSE(manifest.parse(fleet + "[device 14]\nserial = /dev/ttyUSB0\n" + secret));
+  TEST_ASSERT_FALSE(manifest.parse(fleet + "[device 14]\nssid = ThisNameIsTooLongForAnAccessPoint\n" + secret));
+  TEST_ASSERT_TRUE(manifest.parse(fleet + "[device 14]\nserial = /dev/ttyUSB1\n" + secret));
+}
+
+int main(int argc, char ** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_fleet_settings_and_overrides);
+  RUN_TEST(test_rendered_image_reads_back);
+  RUN_TEST(test_errors_name_the_line);
+  RUN_TEST(test_invalid_devices_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,99 @@
+#include "ConfigImage.h"
+
+static_assert(sizeof(ConfigImage) == 200, "ConfigImage fields must match the layout in README.md");
+static_assert(sizeof(ConfigImage) <= CONFIG_IMAGE_SIZE, "ConfigImage must fit in its space");
+
+// Version 3 layout: a marker and version, then fields at fixed
+// offsets up to the pin lists, whose lengths vary. No CRC.
+#define V3_FLAGS_OFFSET 2
+#define V3_WRITE_COUNT_OFFSET 4
+#define V3_DEVICE_ID_OFFSET 8
+#define V3_SETPOINT_OFFSET 12
+#define V3_HOST_IP_OFFSET 16
+#define V3_HOST_PORT_OFFSET 20
+#define V3_WIFI_SSID_OFFSET 22
+#define V3_WIFI_PASSWORD_OFFSET 54
+#define V3_SECRET_KEY_OFFSET 118
+#define V3_ENABLE_PIN_OFFSET 150
+#define V3_BOARD_SENSOR_ADDRESS_OFFSET 152
+#define V3_ONE_WIRE_PIN_OFFSET 160
+#define V3_REMOTE_SENSOR_ADDRESS_OFFSET 161
+#define V3_RED_INDICATOR_PIN_OFFSET 169
+#define V3_GREEN_INDICATOR_PIN_OFFSET 170
+#define V3_HEATER_PIN_COUNT_OFFSET 171
+#define V3_TUNING_OFFSET 192
+
+ConfigImageStatus ConfigImageFormat::parse(const uint8_t * raw, ConfigImage * image) {
+  memset(image, 0, sizeof(ConfigImage));
+  if (raw[0] != CONFIG_IMAGE_MARKER) return CONFIG_IMAGE_BLANK;
+  uint8_t version = raw[1];
+  if (version < CONFIG_IMAGE_OLDEST_VERSION) return CONFIG_IMAGE_UNSUPPORTED;
+  if (version == 3) return migrateFromV3(raw, image);
+
+  uint16_t size;
+  uint32_t crc;
+  memcpy(&size, &raw[2], 2);
+  memcpy(&crc, &raw[4], 4);
+  if (size < CONFIG_IMAGE_HEADER_SIZE || size > CONFIG_IMAGE_SIZE) return CONFIG_IMAGE_CORRUPT;
+  if (crc32(&raw[CONFIG_IMAGE_HEADER_SIZE], size - CONFIG_IMAGE_HEADER_SIZE) != crc) return CONFIG_IMAGE_CORRUPT;
+
+  // A newer image is read as far as this version knows it
+  memcpy(image, raw, size < sizeof(ConfigImage) ? size : sizeof(ConfigImage));
+  return CONFIG_IMAGE_VALID;
+}
+
+ConfigImageStatus ConfigImageFormat::migrateFromV3(const uint8_t * raw, ConfigImage * image) {
+  // A Pipsqueak v3 has exactly one heater and one chiller
+  uint8_t heaterPinCount = raw[V3_HEATER_PIN_COUNT_OFFSET];
+  if (heaterPinCount != 1) return CONFIG_IMAGE_CORRUPT;
+  size_t chillerPinCountOffset = V3_HEATER_PIN_COUNT_OFFSET + 1 + heaterPinCount;
+  uint8_t chillerPinCount = raw[chillerPinCountOffset];
+  if (chillerPinCount != 1) return CONFIG_IMAGE_CORRUPT;
+
+  image->flags = raw[V3_FLAGS_OFFSET];
+  memcpy(&image->writeCount, &raw[V3_WRITE_COUNT_OFFSET], 4);
+  memcpy(&image->deviceID, &raw[V3_DEVICE_ID_OFFSET], 4);
+  memcpy(&image->setpoint, &raw[V3_SETPOINT_OFFSET], 4);
+  memcpy(image->hostIP, &raw[V3_HOST_IP_OFFSET], 4);
+  memcpy(&image->hostPort, &raw[V3_HOST_PORT_OFFSET], 2);
+  memcpy(image->wifiSSID, &raw[V3_WIFI_SSID_OFFSET], CONFIG_IMAGE_SSID_SIZE);
+  memcpy(image->wifiPassword, &raw[V3_WIFI_PASSWORD_OFFSET], CONFIG_IMAGE_PASSWORD_SIZE);
+  memcpy(image->secretKey, &raw[V3_SECRET_KEY_OFFSET], CONFIG_IMAGE_SECRET_KEY_SIZE);
+  image->enablePin = raw[V3_ENABLE_PIN_OFFSET];
+  image->oneWirePin = raw[V3_ONE_WIRE_PIN_OFFSET];
+  image->redIndicatorPin = raw[V3_RED_INDICATOR_PIN_OFFSET];
+  image->greenIndicatorPin = raw[V3_GREEN_INDICATOR_PIN_OFFSET];
+  image->heaterPin = raw[V3_HEATER_PIN_COUNT_OFFSET + 1];
+  image->chillerPin = raw[chillerPinCountOffset + 1];
+  memcpy(image->boardSensorAddress, &raw[V3_BOARD_SENSOR_ADDRESS_OFFSET], CONFIG_IMAGE_ADDRESS_SIZE);
+  memcpy(image->remoteSensorAddress, &raw[V3_REMOTE_SENSOR_ADDRESS_OFFSET], CONFIG_IMAGE_ADDRESS_SIZE);
+  memcpy(&image->proportionalGain, &raw[V3_TUNING_OFFSET], 4);
+  memcpy(&image->integralGain, &raw[V3_TUNING_OFFSET + 4], 4);
+  memcpy(&image->derivativeGain, &raw[V3_TUNING_OFFSET + 8], 4);
+  memcpy(&image->controlPeriod, &raw[V3_TUNING_OFFSET + 12], 4);
+  // Both strings were written null terminated, but make sure of it
+  image->wifiSSID[CONFIG_IMAGE_SSID_SIZE - 1] = '\0';
+  image->wifiPassword[CONFIG_IMAGE_PASSWORD_SIZE - 1] = '\0';
+  seal(image);
+  return CONFIG_IMAGE_MIGRATED;
+}
+
+void ConfigImageFormat::seal(ConfigImage * image) {
+  image->marker = CONFIG_IMAGE_MARKER;
+  image->version = CONFIG_IMAGE_VERSION;
+  image->size = sizeof(ConfigImage);
+  const uint8_t * bytes = (const uint8_t *) image;
+  image->crc = crc32(&bytes[CONFIG_IMAGE_HEADER_SIZE], sizeof(ConfigImage) - CONFIG_IMAGE_HEADER_SIZE);
+}
+
+uint32_t ConfigImageFormat::crc32(const void * data, size_t size, uint32_t crc) {
+  const uint8_t * bytes = (const uint8_t *) data;
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= bytes[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+  }
+  return ~crc;
+}
@@ -0,0 +1,117 @@
+#ifndef ConfigImage_h
+#define ConfigImage_h
+
+// Also built into the host-side provisioner, without Arduino
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#endif
+
+// first byte of an initialized image
+#define CONFIG_IMAGE_MARKER 0x0F
+
+// the version written by this code; see README.md for the history
+#define CONFIG_IMAGE_VERSION 4
+
+// the oldest version that can be migrated
+#define CONFIG_IMAGE_OLDEST_VERSION 3
+
+// bytes set aside for the image at the start of the EEPROM sector
+#define CONFIG_IMAGE_SIZE 256
+
+// the CRC covers the image from this offset to its size
+#define CONFIG_IMAGE_HEADER_SIZE 8
+
+#define CONFIG_IMAGE_SSID_SIZE 32
+#define CONFIG_IMAGE_PASSWORD_SIZE 64
+#define CONFIG_IMAGE_SECRET_KEY_SIZE 32
+#define CONFIG_IMAGE_ADDRESS_SIZE 8
+
+// Configuration flag bits
+#define CONFIG_FLAG_BOARD_SENSOR 0x01
+#define CONFIG_FLAG_PID_CONTROL 0x02
+#define CONFIG_FLAG_MONITOR_MODE 0x04
+
+/**
+ * A Pipsqueak's configuration, exactly as it lies in flash. The
+ * initializer writes it; the OS reads it in one go.
+ *
+ * Later versions may only append fields, so that firmware reads
+ * the part of a newer image it knows and ignores the rest.
+ */
+struct __attribute__((packed)) ConfigImage {
+  uint8_t marker;
+  uint8_t version;
+  uint16_t size;                // bytes, including this header
+  uint32_t crc;                 // CRC-32 of bytes 8 to size
+  uint8_t flags;
+  uint8_t reserved[3];
+  uint32_t writeCount;          // times the image has been written
+  uint32_t deviceID;
+  float setpoint;               // celsius
+  uint8_t hostIP[4];
+  uint16_t hostPort;
+  uint8_t reserved2[2];
+  char wifiSSID[CONFIG_IMAGE_SSID_SIZE];
+  char wifiPassword[CONFIG_IMAGE_PASSWORD_SIZE];
+  uint8_t secretKey[CONFIG_IMAGE_SECRET_KEY_SIZE];
+  uint8_t enablePin;
+  uint8_t oneWirePin;
+  uint8_t redIndicatorPin;
+  uint8_t greenIndicatorPin;
+  uint8_t heaterPin;
+  uint8_t chillerPin;
+  uint8_t reserved3[2];
+  uint8_t boardSensorAddress[CONFIG_IMAGE_ADDRESS_SIZE];
+  uint8_t remoteSensorAddress[CONFIG_IMAGE_ADDRESS_SIZE]; // all zeros if unknown
+  float proportionalGain;       // 0 if not tuned
+  float integralGain;
+  float derivativeGain;
+  uint32_t controlPeriod;       // ms; 0 if not tuned
+};
+
+enum ConfigImageStatus {
+  CONFIG_IMAGE_VALID,
+  CONFIG_IMAGE_MIGRATED,    // valid, once migrated from an older version
+  CONFIG_IMAGE_BLANK,       // never initialized, or wiped
+  CONFIG_IMAGE_CORRUPT,     // fails its CRC or is malformed
+  CONFIG_IMAGE_UNSUPPORTED  // older than CONFIG_IMAGE_OLDEST_VERSION
+};
+
+/**
+ * Reads, migrates and seals ConfigImages. Pure arithmetic: the
+ * caller reads and writes the flash.
+ */
+class ConfigImageFormat {
+  public:
+    /**
+     * Parses the CONFIG_IMAGE_SIZE bytes at the start of the
+     * EEPROM sector into image, migrating an older version to the
+     * current one. Fields a migration or an older image lacks are
+     * zeroed. Unless the image is valid or migrated, image is
+     * zeroed.
+     */
+    static ConfigImageStatus parse(const uint8_t * raw, ConfigImage * image);
+
+    /**
+     * Stamps the image with the marker, the current version and
+     * size, and its CRC. Invoke before writing it.
+     */
+    static void seal(ConfigImage * image);
+
+    /**
+     * Returns the CRC-32 (IEEE 802.3) of the given bytes, carrying
+     * on from the CRC of the bytes before them, if given. The one
+     * CRC-32 the OS and the provisioner use for everything they
+     * check.
+     */
+    static uint32_t crc32(const void * data, size_t size, uint32_t crc = 0);
+
+  private:
+    static ConfigImageStatus migrateFromV3(const uint8_t * raw, ConfigImage * image);
+};
+
+#endif // ConfigImage_h